@@ -0,0 +1,186 @@
+#ifndef ADVERTISEMENT_CAPTURE_H
+#define ADVERTISEMENT_CAPTURE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <atomic>
+#include "VictronBLE.h"
+
+// Binary capture of the advertisements VictronBLE::loop() takes from the ring,
+// for load tests and for reproducing field issues from customer captures.
+//
+// File format (all integers little-endian):
+//   Header (8 bytes):  "VBLC", version, 3 reserved bytes
+//   Record:            length (1 byte, number of bytes that follow)
+//                      timestamp (8, esp_timer µs)
+//                      MAC (6, most significant byte first)
+//                      RSSI (1, signed)
+//                      manufacturer data length (1) + bytes (company ID included)
+//                      name length (1) + characters (no terminator)
+//
+// Capture size is bounded: when the current file reaches half of the budget it
+// becomes <path>.1 (replacing the previous one) and a new file is started.
+#define CAPTURE_MAGIC "VBLC"
+#define CAPTURE_VERSION 1
+#define CAPTURE_HEADER_SIZE 8
+#define CAPTURE_RECORD_FIXED_SIZE 17   // Record bytes after the length byte, without data and name
+#define CAPTURE_RECORD_MAX_SIZE (1 + CAPTURE_RECORD_FIXED_SIZE + MAX_ADVERTISEMENT_DATA + MAX_ADVERTISEMENT_NAME - 1)
+#define CAPTURE_DEFAULT_PATH "/capture.bin"
+
+#ifndef CAPTURE_DEFAULT_MAX_BYTES
+#define CAPTURE_DEFAULT_MAX_BYTES (256 * 1024)   // Both files together
+#endif
+
+// Records are collected in RAM and written in one go, so flash sees a few
+// large writes instead of one per advertisement
+#define CAPTURE_BUFFER_SIZE 512
+#define CAPTURE_FLUSH_INTERVAL 2000   // ms
+
+// Fast replay parses at most this many records per loop() so the display,
+// buttons and web server keep running on the device
+#define CAPTURE_REPLAY_BATCH 64
+// Real-time replay skips idle periods longer than this
+#define CAPTURE_REPLAY_MAX_GAP 10000000   // µs
+
+struct CaptureStats {
+    bool recording;
+    uint32_t records;        // Advertisements written this session
+    uint32_t bytes;          // Bytes written this session, headers included
+    uint32_t rotations;      // Times the current file became <path>.1
+    uint32_t errors;         // Failed opens/writes (records in a failed write are lost)
+    uint32_t fileBytes;      // Current file size, buffered records included
+    uint32_t maxBytes;       // Budget for both files
+};
+
+class AdvertisementCapture {
+private:
+    fs::FS* filesystem;
+    String path;
+    String rotatedPath;
+    uint32_t maxFileBytes;   // Half of the budget
+    File file;
+    uint32_t fileBytes;      // Bytes in the open file (not counting the buffer)
+    uint8_t buffer[CAPTURE_BUFFER_SIZE];
+    size_t bufferLength;
+    unsigned long lastFlush;
+    
+    // Requests from the web server task, applied by loop()
+    std::atomic<bool> startRequested;
+    std::atomic<bool> stopRequested;
+    
+    // loop() task only, read by getStats()
+    bool recording;
+    uint32_t records;
+    uint32_t bytes;
+    uint32_t rotations;
+    uint32_t errors;
+    
+    bool openNewFile();
+    void rotate();
+    void flush();
+    void closeFile();
+
+public:
+    AdvertisementCapture();
+    ~AdvertisementCapture();
+    
+    // The filesystem must already be mounted
+    void begin(fs::FS& fs, const char* capturePath = CAPTURE_DEFAULT_PATH,
+               uint32_t maxBytes = CAPTURE_DEFAULT_MAX_BYTES);
+    
+    // Safe from any task. start() discards the previous capture.
+    void start();
+    void stop();
+    
+    // loop() task only: applies start/stop and flushes buffered records periodically
+    void loop();
+    
+    // Called by VictronBLE::loop() for every advertisement taken from the ring
+    void record(const VictronAdvertisement& adv) {
+        if (recording) {
+            append(adv);
+        }
+    }
+    void append(const VictronAdvertisement& adv);
+    
+    bool isRecording() const { return recording; }
+    CaptureStats getStats() const;
+    const String& getPath() const { return path; }
+    const String& getRotatedPath() const { return rotatedPath; }
+    
+    // Record encoding, shared with CaptureReplay and host tools.
+    // encodeRecord() needs CAPTURE_RECORD_MAX_SIZE bytes and returns the bytes used;
+    // decodeRecord() takes the bytes after the length byte and returns false if they are inconsistent.
+    static size_t encodeRecord(const VictronAdvertisement& adv, uint8_t* out);
+    static bool decodeRecord(const uint8_t* record, size_t length, VictronAdvertisement& adv);
+    static void encodeHeader(uint8_t* out);
+    static bool checkHeader(const uint8_t* header);
+};
+
+enum CaptureReplayMode {
+    REPLAY_REALTIME = 0,   // Records are parsed at their recorded spacing
+    REPLAY_FAST = 1        // As fast as possible (CAPTURE_REPLAY_BATCH per loop())
+};
+
+struct CaptureReplayStats {
+    bool active;
+    CaptureReplayMode mode;
+    uint32_t replayed;       // Records handed to VictronBLE
+    uint32_t corrupt;        // Records skipped or files abandoned because of bad framing
+    int64_t startedUs;
+    int64_t finishedUs;      // 0 while active
+};
+
+// Feeds a capture (<path>.1, then <path>) back through VictronBLE's parse path.
+// Timestamps are replaced with the replay time so data ages behave as they did live.
+class CaptureReplay {
+private:
+    fs::FS* filesystem;
+    VictronBLE* victronBLE;
+    String files[2];
+    int fileCount;
+    int fileIndex;
+    File file;
+    
+    // Next record, read ahead so real-time mode can wait for it
+    VictronAdvertisement pending;
+    bool havePending;
+    int64_t anchorRecordUs;   // Recorded time that maps to anchorTimeUs
+    int64_t anchorTimeUs;
+    int64_t lastRecordUs;
+    
+    std::atomic<bool> startRequested;
+    std::atomic<bool> stopRequested;
+    String requestedPath;     // Written before startRequested is set
+    CaptureReplayMode requestedMode;
+    
+    bool active;
+    CaptureReplayMode mode;
+    uint32_t replayed;
+    uint32_t corrupt;
+    int64_t startedUs;
+    int64_t finishedUs;
+    
+    void open(const String& capturePath, CaptureReplayMode replayMode);
+    bool openNextFile();
+    bool readRecord(VictronAdvertisement& adv);
+    void replayDue();
+    void finish();
+
+public:
+    CaptureReplay();
+    
+    void begin(fs::FS& fs, VictronBLE* target);
+    
+    // Safe from any task; the replay starts on the next loop()
+    void start(const String& capturePath = CAPTURE_DEFAULT_PATH, CaptureReplayMode replayMode = REPLAY_REALTIME);
+    void stop();
+    
+    // Same task as VictronBLE::loop(): parses the records that are due
+    void loop();
+    
+    bool isActive() const { return active || startRequested.load(); }
+    CaptureReplayStats getStats() const;
+};
+
+#endif // ADVERTISEMENT_CAPTURE_H
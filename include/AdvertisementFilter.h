@@ -0,0 +1,72 @@
+#ifndef ADVERTISEMENT_FILTER_H
+#define ADVERTISEMENT_FILTER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <vector>
+
+// Eco Worthy BW02 adapters advertise the 16-bit service UUID 0xFFF0
+// (ECOWORTHY_SERVICE_UUID in EcoWorthyBMS.h)
+#define ECOWORTHY_SERVICE_UUID16 0xFFF0
+
+// Allowlist hash set size (open addressing, kept at most half full)
+#ifndef ADVERTISEMENT_ALLOWLIST_SLOTS
+#define ADVERTISEMENT_ALLOWLIST_SLOTS 64
+#endif
+
+// Pointers into a raw advertisement payload (no copies)
+struct RawAdvertisementFields {
+    const uint8_t* manufacturerData;  // Including the 2-byte company ID
+    uint8_t manufacturerDataLength;
+    const char* name;                 // Not null-terminated
+    uint8_t nameLength;
+    bool ecoWorthyService;            // 0xFFF0 listed in the 16-bit service UUIDs
+    
+    RawAdvertisementFields()
+        : manufacturerData(nullptr), manufacturerDataLength(0),
+          name(nullptr), nameLength(0), ecoWorthyService(false) {}
+};
+
+// Cheap pre-filter run in the NimBLE host task for every advertisement.
+// Walks the raw AD structures only, so unrelated beacons are dropped before
+// any String/std::string is built. An advertisement is accepted if it carries
+// Victron manufacturer data, the Eco Worthy service UUID or name, or comes
+// from a MAC address configured in the web interface.
+class AdvertisementFilter {
+private:
+    // Double-buffered so the allowlist can be rebuilt from the web server while
+    // the BLE task keeps reading the active table. 0 marks an empty slot.
+    uint64_t allowlist[2][ADVERTISEMENT_ALLOWLIST_SLOTS];
+    std::atomic<uint8_t> activeAllowlist;
+    uint8_t allowlistSize;
+    
+    // Written by the NimBLE host task only
+    uint32_t acceptedCount;
+    uint32_t rejectedCount;
+    
+    static uint32_t hashKey(uint64_t key);
+
+public:
+    AdvertisementFilter();
+    
+    // Split a raw advertisement (advertising data + scan response) into its fields
+    static void parseAdStructures(const uint8_t* payload, size_t length, RawAdvertisementFields& fields);
+    
+    // Address helpers - mac is most significant byte first
+    static uint64_t addressKey(const uint8_t* mac);
+    static bool parseAddress(const String& address, uint8_t* mac);  // Accepts with or without colons
+    static bool isEcoWorthyName(const char* name, size_t length);
+    
+    // Replace the MAC allowlist (called from the web server when device configs change)
+    void setAllowedAddresses(const std::vector<String>& addresses);
+    bool isAllowed(uint64_t key) const;
+    uint8_t getAllowedCount() const { return allowlistSize; }
+    
+    // Called from the NimBLE host task; counts accepted/rejected advertisements
+    bool accept(const uint8_t* mac, const RawAdvertisementFields& fields);
+    
+    uint32_t getAcceptedCount() const { return acceptedCount; }
+    uint32_t getRejectedCount() const { return rejectedCount; }
+};
+
+#endif // ADVERTISEMENT_FILTER_H
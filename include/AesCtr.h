@@ -0,0 +1,98 @@
+#ifndef AES_CTR_H
+#define AES_CTR_H
+
+#include <Arduino.h>
+
+// AES-128-CTR with interchangeable backends:
+// - Software: portable table-based AES-128 (builds on any host)
+// - Hardware: ESP32 AES accelerator through esp_aes_*
+// - mbedTLS:  mbedtls_aes_* (on the ESP32 this is the accelerator behind the mbedTLS API)
+// Every key holds a ready key schedule for each compiled-in backend, so the active
+// backend can be switched at runtime, e.g. by the startup benchmark.
+
+#ifndef AES_CTR_HAVE_HARDWARE
+#if defined(ARDUINO_ARCH_ESP32) || defined(ESP_PLATFORM)
+#define AES_CTR_HAVE_HARDWARE 1
+#else
+#define AES_CTR_HAVE_HARDWARE 0
+#endif
+#endif
+
+#ifndef AES_CTR_HAVE_MBEDTLS
+#if defined(ARDUINO_ARCH_ESP32) || defined(ESP_PLATFORM) || __has_include(<mbedtls/aes.h>)
+#define AES_CTR_HAVE_MBEDTLS 1
+#else
+#define AES_CTR_HAVE_MBEDTLS 0
+#endif
+#endif
+
+#if AES_CTR_HAVE_HARDWARE
+#include <aes/esp_aes.h>
+#endif
+#if AES_CTR_HAVE_MBEDTLS
+#include <mbedtls/aes.h>
+#endif
+
+enum AesCtrBackend {
+    AES_BACKEND_SOFTWARE = 0,
+    AES_BACKEND_HARDWARE = 1,
+    AES_BACKEND_MBEDTLS = 2,
+    AES_BACKEND_COUNT
+};
+
+// Expanded AES-128 key for all available backends
+struct AesCtrKey {
+    uint32_t roundKeys[44];          // Software backend key schedule
+#if AES_CTR_HAVE_HARDWARE
+    esp_aes_context hardware;
+#endif
+#if AES_CTR_HAVE_MBEDTLS
+    mbedtls_aes_context mbedtls;
+#endif
+    bool ready;
+    
+    AesCtrKey();
+};
+
+// Result of AesCtr::benchmark() for one backend
+struct AesCtrBenchmarkResult {
+    AesCtrBackend backend;
+    bool available;       // Compiled in for this target
+    bool passed;          // Produced the NIST SP 800-38A test vector
+    float nsPerBlock;     // Average time per 16-byte block (for Victron-sized payloads)
+};
+
+class AesCtr {
+private:
+    static AesCtrBackend activeBackend;
+
+public:
+    // Expand a 128-bit key for every backend; call freeKey() before discarding it
+    static bool setKey(AesCtrKey& key, const uint8_t* keyBytes);
+    static void freeKey(AesCtrKey& key);
+    
+    // Encrypt/decrypt length bytes in CTR mode with the active backend.
+    // nonceCounter is the initial 16-byte counter block (big-endian increment); it is not modified.
+    static bool crypt(const AesCtrKey& key, const uint8_t* nonceCounter,
+                      const uint8_t* input, uint8_t* output, size_t length);
+    static bool crypt(AesCtrBackend backend, const AesCtrKey& key, const uint8_t* nonceCounter,
+                      const uint8_t* input, uint8_t* output, size_t length);
+    
+    static bool isAvailable(AesCtrBackend backend);
+    static const char* backendName(AesCtrBackend backend);
+    static AesCtrBackend getBackend() { return activeBackend; }
+    static bool setBackend(AesCtrBackend backend);
+    
+    // Check a backend against the SP 800-38A F.5.1 CTR-AES128 vector
+    static bool selfTest(AesCtrBackend backend);
+    
+    // Time payloadBytes-sized decryptions (default: largest Victron payload, 2 blocks)
+    static AesCtrBenchmarkResult benchmark(AesCtrBackend backend, int iterations = 500, size_t payloadBytes = 21);
+    
+    // Benchmark every available backend, log the results and activate the fastest
+    // one that passes the self-test. Hardware setup overhead per call can lose to
+    // software on one- or two-block payloads, so this is measured, not assumed.
+    static AesCtrBackend selectFastest(int iterations = 500);
+};
+
+#endif // AES_CTR_H
@@ -0,0 +1,268 @@
+#ifndef CHANGE_BUS_H
+#define CHANGE_BUS_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Reading fields tracked for changes, one bit each in a VictronChangeMask
+// mergeDeviceData() reports which fields an update moved; the change bus below
+// carries them to the tasks that read the snapshot. The cell voltages share a bit.
+enum VictronChangeField : uint8_t {
+    CHANGE_VOLTAGE,
+    CHANGE_CURRENT,
+    CHANGE_POWER,
+    CHANGE_SOC,
+    CHANGE_TEMPERATURE,
+    CHANGE_CONSUMED_AH,
+    CHANGE_TIME_TO_GO,
+    CHANGE_AUX_VOLTAGE,
+    CHANGE_MID_VOLTAGE,
+    CHANGE_AUX_MODE,
+    CHANGE_YIELD_TODAY,
+    CHANGE_PV_POWER,
+    CHANGE_LOAD_CURRENT,
+    CHANGE_CHARGER_ERROR,
+    CHANGE_AC_OUT_VOLTAGE,
+    CHANGE_AC_OUT_CURRENT,
+    CHANGE_AC_OUT_POWER,
+    CHANGE_INPUT_VOLTAGE,
+    CHANGE_OUTPUT_VOLTAGE,
+    CHANGE_CELL_VOLTAGES,
+    CHANGE_BALANCER_STATUS,
+    CHANGE_BMS_FLAGS,
+    CHANGE_AC_IN_POWER,
+    CHANGE_ACTIVE_AC_IN,
+    CHANGE_BATTERY_VOLTAGE2,
+    CHANGE_BATTERY_CURRENT2,
+    CHANGE_BATTERY_VOLTAGE3,
+    CHANGE_BATTERY_CURRENT3,
+    CHANGE_DEVICE_STATE,
+    CHANGE_ALARM_STATE,
+    CHANGE_OFF_REASON,
+    CHANGE_DATA_VALID,     // dataValid or a has* flag
+    CHANGE_DEVICE_INFO,    // Name or device type
+    CHANGE_FIELD_COUNT
+};
+
+typedef uint64_t VictronChangeMask;
+#define CHANGE_BIT(field) ((VictronChangeMask)1 << (field))
+#define CHANGE_ALL (CHANGE_BIT(CHANGE_FIELD_COUNT) - 1)
+
+// Publish/subscribe for device changes
+//
+// A subscriber registers for a set of fields, and optionally a set of device slots,
+// and then receives one ChangeEvent per device whose subscribed fields changed.
+// Events coalesce: while a device's event is undelivered, further changes are OR'ed
+// into it, so a slow subscriber sees each device once with everything that moved.
+// The queue keeps arrival order for up to CHANGE_QUEUE_SIZE devices; beyond that the
+// changes stay in the per-slot masks and are swept up once the queue has drained,
+// so an overflow delays events but never loses one.
+//
+// Not locked: VictronBLE keeps its bus under the snapshot mutex (DeviceLock).
+// hasEvents() is the one call safe without it, for an idle check on every tick.
+#define CHANGE_BUS_MAX_SUBSCRIBERS 6
+#define CHANGE_QUEUE_SIZE 16
+
+struct ChangeEvent {
+    uint16_t slot;                // Device table slot
+    VictronChangeMask fields;     // Subscribed fields changed since the slot's last event
+};
+
+struct ChangeSubscriberStats {
+    const char* name;
+    uint32_t events;              // Events queued (or left for the sweep)
+    uint32_t coalesced;           // Changes merged into an undelivered event
+    uint32_t overflows;           // Events that found the queue full
+    uint32_t delivered;
+};
+
+template <uint16_t Slots>
+class ChangeBus {
+private:
+    struct Subscription {
+        const char* name;         // nullptr = free
+        VictronChangeMask fields;
+        uint32_t devices[(Slots + 31) / 32];   // Followed slots
+        VictronChangeMask pending[Slots];      // Undelivered changes by slot
+        uint16_t queue[CHANGE_QUEUE_SIZE];     // Slots with pending changes, oldest first
+        uint8_t head;
+        uint8_t count;
+        bool overflowed;                       // pending[] has slots that are not queued
+        std::atomic<bool> signalled;           // Something to deliver
+        ChangeSubscriberStats stats;
+    };
+    
+    Subscription subscriptions[CHANGE_BUS_MAX_SUBSCRIBERS];
+    
+    Subscription* get(int subscriber) {
+        return subscriber >= 0 && subscriber < CHANGE_BUS_MAX_SUBSCRIBERS && subscriptions[subscriber].name
+               ? &subscriptions[subscriber] : nullptr;
+    }
+    
+    const Subscription* get(int subscriber) const {
+        return subscriber >= 0 && subscriber < CHANGE_BUS_MAX_SUBSCRIBERS && subscriptions[subscriber].name
+               ? &subscriptions[subscriber] : nullptr;
+    }
+
+public:
+    ChangeBus() {
+        for (int i = 0; i < CHANGE_BUS_MAX_SUBSCRIBERS; i++) {
+            subscriptions[i].name = nullptr;
+            subscriptions[i].signalled.store(false);
+        }
+    }
+    
+    // Follows every device to begin with. Returns the subscriber number, or -1 when
+    // all CHANGE_BUS_MAX_SUBSCRIBERS are taken.
+    int subscribe(const char* name, VictronChangeMask fields) {
+        for (int i = 0; i < CHANGE_BUS_MAX_SUBSCRIBERS; i++) {
+            Subscription& subscription = subscriptions[i];
+            if (subscription.name) {
+                continue;
+            }
+            subscription.name = name;
+            subscription.fields = fields;
+            memset(subscription.devices, 0xff, sizeof(subscription.devices));
+            memset(subscription.pending, 0, sizeof(subscription.pending));
+            subscription.head = 0;
+            subscription.count = 0;
+            subscription.overflowed = false;
+            subscription.signalled.store(false);
+            memset(&subscription.stats, 0, sizeof(subscription.stats));
+            subscription.stats.name = name;
+            return i;
+        }
+        return -1;
+    }
+    
+    void unsubscribe(int subscriber) {
+        Subscription* subscription = get(subscriber);
+        if (subscription) {
+            subscription->name = nullptr;
+            subscription->signalled.store(false);
+        }
+    }
+    
+    // Device mask: follow (or stop following) one slot, or all of them. Changes
+    // waiting for a slot that is no longer followed are dropped.
+    void followDevice(int subscriber, uint16_t slot, bool follow) {
+        Subscription* subscription = get(subscriber);
+        if (!subscription || slot >= Slots) {
+            return;
+        }
+        uint32_t bit = 1u << (slot % 32);
+        if (follow) {
+            subscription->devices[slot / 32] |= bit;
+        } else {
+            subscription->devices[slot / 32] &= ~bit;
+            subscription->pending[slot] = 0;
+        }
+    }
+    
+    void followAllDevices(int subscriber, bool follow) {
+        Subscription* subscription = get(subscriber);
+        if (!subscription) {
+            return;
+        }
+        memset(subscription->devices, follow ? 0xff : 0, sizeof(subscription->devices));
+        if (!follow) {
+            memset(subscription->pending, 0, sizeof(subscription->pending));
+        }
+    }
+    
+    // Producer side: the fields of slot that changed in one update
+    void publish(uint16_t slot, VictronChangeMask changes) {
+        if (slot >= Slots || !changes) {
+            return;
+        }
+        uint32_t bit = 1u << (slot % 32);
+        for (int i = 0; i < CHANGE_BUS_MAX_SUBSCRIBERS; i++) {
+            Subscription& subscription = subscriptions[i];
+            VictronChangeMask fields = changes & subscription.fields;
+            if (!subscription.name || !fields || !(subscription.devices[slot / 32] & bit)) {
+                continue;
+            }
+            if (subscription.pending[slot]) {
+                subscription.pending[slot] |= fields;
+                subscription.stats.coalesced++;
+                continue;
+            }
+            subscription.pending[slot] = fields;
+            subscription.stats.events++;
+            if (subscription.count < CHANGE_QUEUE_SIZE) {
+                subscription.queue[(subscription.head + subscription.count) % CHANGE_QUEUE_SIZE] = slot;
+                subscription.count++;
+            } else {
+                subscription.overflowed = true;
+                subscription.stats.overflows++;
+            }
+            subscription.signalled.store(true, std::memory_order_release);
+        }
+    }
+    
+    // Consumer side: the next event, false once there is none
+    bool next(int subscriber, ChangeEvent& event) {
+        Subscription* subscription = get(subscriber);
+        if (!subscription) {
+            return false;
+        }
+        while (subscription->count > 0) {
+            uint16_t slot = subscription->queue[subscription->head];
+            subscription->head = (subscription->head + 1) % CHANGE_QUEUE_SIZE;
+            subscription->count--;
+            if (take(*subscription, slot, event)) {
+                return true;
+            }
+        }
+        if (subscription->overflowed) {
+            for (uint16_t slot = 0; slot < Slots; slot++) {
+                if (take(*subscription, slot, event)) {
+                    return true;
+                }
+            }
+            subscription->overflowed = false;
+        }
+        subscription->signalled.store(false, std::memory_order_relaxed);
+        return false;
+    }
+    
+    // Safe without the lock: a stale true only costs one empty next()
+    bool hasEvents(int subscriber) const {
+        const Subscription* subscription = get(subscriber);
+        return subscription && subscription->signalled.load(std::memory_order_acquire);
+    }
+    
+    int subscriberCount() const {
+        int count = 0;
+        for (int i = 0; i < CHANGE_BUS_MAX_SUBSCRIBERS; i++) {
+            count += subscriptions[i].name ? 1 : 0;
+        }
+        return count;
+    }
+    
+    // By subscriber number; name is nullptr for a free one
+    ChangeSubscriberStats getStats(int subscriber) const {
+        const Subscription* subscription = get(subscriber);
+        ChangeSubscriberStats stats;
+        if (subscription) {
+            stats = subscription->stats;
+        } else {
+            memset(&stats, 0, sizeof(stats));
+        }
+        return stats;
+    }
+
+private:
+    static bool take(Subscription& subscription, uint16_t slot, ChangeEvent& event) {
+        if (!subscription.pending[slot]) {
+            return false;  // Dropped by followDevice()
+        }
+        event.slot = slot;
+        event.fields = subscription.pending[slot];
+        subscription.pending[slot] = 0;
+        subscription.stats.delivered++;
+        return true;
+    }
+};
+
+#endif // CHANGE_BUS_H
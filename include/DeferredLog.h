@@ -0,0 +1,256 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+
+// Compile-time filtered logging with deferred formatting
+//
+// Every module has its own level (LOG_LEVEL_BLE, LOG_LEVEL_MQTT, ...), set with -D
+// build flags. A LOG_x() call above its module's level is a constant-false branch, so
+// neither its arguments nor its format string end up in the firmware.
+//
+// Enabled calls format nothing. They append a compact binary record - the address of
+// the format string followed by the raw arguments - to a RAM ring, and the main loop
+// turns records into text only when the UART has room for them (logRing.drain()).
+// Writers never wait: a record that does not fit, or that races another writer, is
+// dropped and counted.
+//
+// Strings are copied into the record (up to LOG_MAX_STRING characters), so c_str() of
+// a temporary String is safe to pass. '*' widths are not supported.
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+// NO_DEBUG (release builds) silences every module that is not given its own level
+#ifndef LOG_LEVEL_DEFAULT
+#ifdef NO_DEBUG
+#define LOG_LEVEL_DEFAULT LOG_LEVEL_NONE
+#else
+#define LOG_LEVEL_DEFAULT LOG_LEVEL_INFO
+#endif
+#endif
+
+#ifndef LOG_LEVEL_MAIN
+#define LOG_LEVEL_MAIN LOG_LEVEL_DEFAULT        // main.cpp: startup, buttons, alarms
+#endif
+#ifndef LOG_LEVEL_BLE
+#define LOG_LEVEL_BLE LOG_LEVEL_DEFAULT         // VictronBLE, AdvertisementFilter, AesCtr
+#endif
+#ifndef LOG_LEVEL_MQTT
+#define LOG_LEVEL_MQTT LOG_LEVEL_DEFAULT
+#endif
+#ifndef LOG_LEVEL_WEB
+#define LOG_LEVEL_WEB LOG_LEVEL_DEFAULT
+#endif
+#ifndef LOG_LEVEL_BMS
+#define LOG_LEVEL_BMS LOG_LEVEL_DEFAULT         // EcoWorthyBMS
+#endif
+#ifndef LOG_LEVEL_CAPTURE
+#define LOG_LEVEL_CAPTURE LOG_LEVEL_DEFAULT     // AdvertisementCapture, CaptureReplay
+#endif
+
+#if LOG_LEVEL_MAIN > LOG_LEVEL_NONE || LOG_LEVEL_BLE > LOG_LEVEL_NONE || LOG_LEVEL_MQTT > LOG_LEVEL_NONE || \
+    LOG_LEVEL_WEB > LOG_LEVEL_NONE || LOG_LEVEL_BMS > LOG_LEVEL_NONE || LOG_LEVEL_CAPTURE > LOG_LEVEL_NONE
+#define LOG_RING_ENABLED 1
+#else
+#define LOG_RING_ENABLED 0
+#endif
+
+// Ring size in bytes (power of two); a token ring when every module is compiled out
+#ifndef LOG_RING_BYTES
+#if LOG_RING_ENABLED
+#define LOG_RING_BYTES 2048
+#else
+#define LOG_RING_BYTES 16
+#endif
+#endif
+
+#define LOG_MAX_RECORD 128      // Bytes per record, header included
+#define LOG_MAX_STRING 40       // Characters kept per string argument
+#define LOG_MAX_LINE 192        // Formatted line, longer output is cut
+
+#define LOG_E(module, ...) LOG_AT(LOG_LEVEL_##module, LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_W(module, ...) LOG_AT(LOG_LEVEL_##module, LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_I(module, ...) LOG_AT(LOG_LEVEL_##module, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_D(module, ...) LOG_AT(LOG_LEVEL_##module, LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+// The dead logFormatCheck() call keeps printf-style checking of every call, enabled or not
+#define LOG_AT(moduleLevel, level, ...) \
+    do { \
+        if (0) { \
+            logFormatCheck(__VA_ARGS__); \
+        } \
+        if ((moduleLevel) >= (level)) { \
+            logWrite(__VA_ARGS__); \
+        } \
+    } while (0)
+
+inline void logFormatCheck(const char* format, ...) __attribute__((format(printf, 1, 2)));
+inline void logFormatCheck(const char*, ...) {}
+
+// Argument tags inside a record
+enum LogArgType {
+    LOG_ARG_INT32 = 1,
+    LOG_ARG_UINT32 = 2,
+    LOG_ARG_INT64 = 3,
+    LOG_ARG_UINT64 = 4,
+    LOG_ARG_DOUBLE = 5,
+    LOG_ARG_STRING = 6,     // Length byte, then the characters (no terminator)
+    LOG_ARG_POINTER = 7
+};
+
+// One record being built on the writer's stack:
+// [total length][format string address][tag, value]...
+// Arguments that do not fit are left out; the formatter prints '?' for them.
+class LogRecord {
+public:
+    uint8_t bytes[LOG_MAX_RECORD];
+    size_t length;
+    
+    explicit LogRecord(const char* format) : length(1 + sizeof(format)) {
+        memcpy(&bytes[1], &format, sizeof(format));
+    }
+    
+    void add(bool value) { addSigned((int32_t)value); }
+    void add(char value) { addSigned((int32_t)value); }
+    void add(signed char value) { addSigned((int32_t)value); }
+    void add(unsigned char value) { addUnsigned((uint32_t)value); }
+    void add(short value) { addSigned((int32_t)value); }
+    void add(unsigned short value) { addUnsigned((uint32_t)value); }
+    void add(int value) { addSigned(value); }
+    void add(unsigned int value) { addUnsigned(value); }
+    void add(long value) { addSigned(value); }
+    void add(unsigned long value) { addUnsigned(value); }
+    void add(long long value) { addSigned(value); }
+    void add(unsigned long long value) { addUnsigned(value); }
+    void add(float value) { add((double)value); }
+    void add(double value) { put(LOG_ARG_DOUBLE, &value, sizeof(value)); }
+    void add(const void* value) {
+        uint64_t address = (uint64_t)(uintptr_t)value;
+        put(LOG_ARG_POINTER, &address, sizeof(address));
+    }
+    void add(const char* value) {
+        if (value == nullptr) {
+            value = "(null)";
+        }
+        size_t size = 0;
+        while (size < LOG_MAX_STRING && value[size] != '\0') {
+            size++;
+        }
+        if (length + 2 + size > LOG_MAX_RECORD) {
+            return;
+        }
+        bytes[length++] = LOG_ARG_STRING;
+        bytes[length++] = (uint8_t)size;
+        memcpy(&bytes[length], value, size);
+        length += size;
+    }
+    void add(const String& value) { add(value.c_str()); }
+    
+    template <typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type add(T value) {
+        addSigned((long long)value);
+    }
+
+private:
+    template <typename T>
+    void addSigned(T value) {
+        if (sizeof(T) <= 4) {
+            int32_t narrow = (int32_t)value;
+            put(LOG_ARG_INT32, &narrow, sizeof(narrow));
+        } else {
+            int64_t wide = (int64_t)value;
+            put(LOG_ARG_INT64, &wide, sizeof(wide));
+        }
+    }
+    
+    template <typename T>
+    void addUnsigned(T value) {
+        if (sizeof(T) <= 4) {
+            uint32_t narrow = (uint32_t)value;
+            put(LOG_ARG_UINT32, &narrow, sizeof(narrow));
+        } else {
+            uint64_t wide = (uint64_t)value;
+            put(LOG_ARG_UINT64, &wide, sizeof(wide));
+        }
+    }
+    
+    void put(uint8_t type, const void* value, size_t size) {
+        if (length + 1 + size > LOG_MAX_RECORD) {
+            return;
+        }
+        bytes[length++] = type;
+        memcpy(&bytes[length], value, size);
+        length += size;
+    }
+};
+
+struct LogStats {
+    uint32_t records;       // Records written
+    uint32_t dropped;       // Records lost to a full ring or a concurrent writer
+    uint32_t highWater;     // Most bytes waiting at once
+    uint32_t capacity;      // Ring size in bytes
+};
+
+// Byte ring of variable-length records
+// Any task may write (a try-lock serializes writers without ever spinning); only the
+// main loop reads. Reader and writers meet through head/tail like SpscRing.
+class LogRing {
+    static_assert(LOG_RING_BYTES >= 16 && (LOG_RING_BYTES & (LOG_RING_BYTES - 1)) == 0,
+                  "LOG_RING_BYTES must be a power of two");
+
+private:
+    uint8_t buffer[LOG_RING_BYTES];
+    std::atomic<uint32_t> head;         // Next byte to write (writers, under the try-lock)
+    std::atomic<uint32_t> tail;         // Next byte to read (reader only)
+    std::atomic_flag writing;
+    std::atomic<uint32_t> records;
+    std::atomic<uint32_t> drops;
+    std::atomic<uint32_t> highWater;
+    
+    // Reader state: the line being written out and the drops already reported
+    char line[LOG_MAX_LINE];
+    size_t lineLength;
+    size_t lineOffset;
+    uint32_t reportedDrops;
+    
+    void copyIn(uint32_t position, const uint8_t* data, size_t size);
+    void copyOut(uint32_t position, uint8_t* data, size_t size) const;
+    bool nextLine();
+
+public:
+    LogRing();
+    
+    // Writer side - never blocks
+    void push(const LogRecord& record);
+    
+    // Reader side (main loop): writes at most maxLines lines, and only as many bytes as
+    // out.availableForWrite() allows. A line that does not fit is continued on the next
+    // call. Returns the number of lines completed.
+    size_t drain(Print& out, size_t maxLines = 8);
+    
+    // Writes everything out, waiting for the UART (startup and shutdown only)
+    void flush(Print& out);
+    
+    LogStats getStats() const;
+    
+    // Formats one record into text; returns the text length (cut at outSize - 1)
+    static size_t format(const uint8_t* record, size_t length, char* out, size_t outSize);
+};
+
+extern LogRing logRing;
+
+template <typename... Args>
+void logWrite(const char* format, const Args&... args) {
+    LogRecord record(format);
+    int expand[] = { 0, (record.add(args), 0)... };
+    (void)expand;
+    logRing.push(record);
+}
+
+#endif // DEFERRED_LOG_H
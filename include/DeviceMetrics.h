@@ -0,0 +1,49 @@
+#ifndef DEVICE_METRICS_H
+#define DEVICE_METRICS_H
+
+#include <Arduino.h>
+
+// Per-device ingest metrics, one fixed entry per device table slot (/api/metrics).
+// They tell the causes of a stale reading apart: RF loss shows as counter gaps and
+// a weak RSSI, a wrong key as decrypt failures and key mismatches, and CPU starvation
+// as slow parses (and ring drops in the ingest statistics).
+#define METRICS_PARSE_BUCKETS 8
+#define METRICS_PARSE_FIRST_BUCKET 4096   // Cycles; each bucket doubles, the last is open-ended
+#define METRICS_RATE_WINDOW 10000         // ms over which packets per second is measured
+#define METRICS_MAX_COUNTER_GAP 256       // Larger nonce jumps are a device restart, not loss
+
+struct DeviceMetrics {
+    uint32_t packets;                // Advertisements received, repeats included
+    uint32_t frames;                 // Frames parsed (new nonce or payload)
+    uint32_t counterGaps;            // Frames missed between two parsed ones, from the nonce
+    uint32_t noKey;                  // Encrypted frames without a configured key
+    uint32_t decryptFailures;
+    uint32_t keyMismatches;          // Key match byte differs from the configured key
+    uint32_t validationRejects;      // Out-of-range voltage or temperature
+    uint32_t partialPayloads;        // Shorter than the device type's payload
+    int16_t rssiAverageX16;          // Moving average over ~8 packets, x16
+    int64_t lastPacketUs;
+    
+    // Packets per second over the last complete METRICS_RATE_WINDOW
+    float packetsPerSecond;
+    int64_t rateWindowStartUs;
+    uint32_t rateWindowPackets;
+    
+    // Parse time (decrypt + decode) histogram in CPU cycles
+    uint32_t parseHistogram[METRICS_PARSE_BUCKETS];
+    uint32_t maxParseCycles;
+};
+
+// Ingest task only; readers copy an entry under VictronBLE::IngestLock
+void metricsReset(DeviceMetrics& metrics);
+void metricsPacket(DeviceMetrics& metrics, int8_t rssi, int64_t timeUs);
+void metricsFrame(DeviceMetrics& metrics, bool hadFrame, uint16_t lastCounter, uint16_t counter);
+void metricsParse(DeviceMetrics& metrics, uint32_t cycles);
+
+// Packets per second as of nowUs: 0 once the device has been silent for a whole window
+float metricsPacketRate(const DeviceMetrics& metrics, int64_t nowUs);
+
+// Exclusive upper bound of a histogram bucket in cycles (0 for the open-ended last one)
+uint32_t metricsBucketLimit(int bucket);
+
+#endif // DEVICE_METRICS_H
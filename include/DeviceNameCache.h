@@ -0,0 +1,81 @@
+#ifndef DEVICE_NAME_CACHE_H
+#define DEVICE_NAME_CACHE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Persistent MAC -> advertised name cache (NVS)
+//
+// Victron devices put their manufacturer data in the primary advertisement but
+// their local name only in the scan response, which a passive scan never asks
+// for. Names seen once are kept here across reboots so passive scanning still
+// shows names and the name-based identifyDeviceType() fallback keeps working.
+// A MAC heard in NAME_PROBE_TRIES active probes without a name (e.g. a generic
+// module sharing the Eco Worthy service UUID) is remembered as unnamed and not
+// probed again. Those MACs are kept in a set of their own, so they never push
+// names out, and a new MAC is only counted in a free slot: at a site with more
+// nameless MACs than fit, probing stops once the cache is full instead of
+// restarting the counts forever. Counts are saved with the next name or give-up,
+// never on their own.
+#define NAME_CACHE_SIZE 32
+#define NAME_GAVE_UP_SIZE 64
+#define NAME_CACHE_NAME_LENGTH 30       // Same as MAX_ADVERTISEMENT_NAME
+#define NAME_CACHE_SAVE_DELAY 30000     // ms after the last change; batches NVS writes
+#define NAME_CACHE_NAMESPACE "victron-names"
+#define NAME_PROBE_TRIES 3
+
+struct NameCacheEntry {
+    uint64_t key;                       // AdvertisementFilter::addressKey, 0 = free
+    char name[NAME_CACHE_NAME_LENGTH];  // Empty while unnamed
+    uint8_t unnamedProbes;              // Active probes that heard the MAC without a name
+    uint8_t lastProbe;                  // Probe that last counted, so each one counts once
+};
+
+// Ingest task only (VictronBLE::loop)
+class DeviceNameCache {
+private:
+    NameCacheEntry entries[NAME_CACHE_SIZE];
+    uint8_t used;
+    uint64_t gaveUp[NAME_GAVE_UP_SIZE];  // Keys that stayed unnamed for NAME_PROBE_TRIES probes
+    uint8_t gaveUpCount;
+    uint8_t nextVictim;                 // Round-robin replacement once full
+    bool dirty;
+    unsigned long changedAt;
+    uint32_t saves;
+    
+    int indexOf(uint64_t key) const;   // -1 if not cached
+    int gaveUpIndexOf(uint64_t key) const;
+    NameCacheEntry* allocate(uint64_t key);
+    void giveUp(int slot);
+    void changed(unsigned long nowMs);
+
+public:
+    DeviceNameCache();
+    
+    // Loads the entries saved by a previous boot
+    void begin();
+    
+    // Cached name, or nullptr when the MAC has none
+    const char* lookup(uint64_t key) const;
+    
+    // Whether an active probe could still learn this MAC's name
+    bool needsProbe(uint64_t key) const;
+    
+    // A name seen in an advertisement
+    void remember(uint64_t key, const char* name, unsigned long nowMs);
+    
+    // The MAC was heard without a name during active probe number probe. A MAC not
+    // cached yet is only counted while a slot is free.
+    void heardUnnamed(uint64_t key, uint8_t probe, unsigned long nowMs);
+    
+    // Writes the cache once NAME_CACHE_SAVE_DELAY has passed since the last change
+    void saveIfDue(unsigned long nowMs);
+    void save();
+    void clear();
+    
+    uint8_t getCount() const { return used; }
+    uint8_t getGaveUpCount() const { return gaveUpCount; }
+    uint32_t getSaveCount() const { return saves; }
+};
+
+#endif // DEVICE_NAME_CACHE_H
@@ -0,0 +1,131 @@
+#ifndef DEVICE_TABLE_H
+#define DEVICE_TABLE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Fixed-capacity device table keyed by the binary 48-bit MAC address
+// (AdvertisementFilter::addressKey). Entries live in a plain array and are
+// handed out in arrival order, so a device keeps its slot index for the whole
+// run and pointers to entries never move. A separate open-addressing index
+// (linear probing, kept at most half full) maps MAC -> slot, making lookups
+// O(1) without building a String or touching the heap.
+//
+// Devices are never removed. Only one task inserts; other tasks may iterate
+// concurrently because the size is published only after a new key is indexed.
+template <typename T, uint16_t Capacity>
+class DeviceTable {
+    static_assert(Capacity >= 1 && Capacity <= 0x4000, "DeviceTable capacity out of range");
+
+public:
+    // Index size: smallest power of two that keeps the index at most half full
+    static constexpr uint32_t roundUpPowerOfTwo(uint32_t value, uint32_t power = 1) {
+        return power >= value ? power : roundUpPowerOfTwo(value, power << 1);
+    }
+    static constexpr uint32_t IndexSlots = roundUpPowerOfTwo(2u * Capacity);
+
+private:
+    T entries[Capacity];
+    uint64_t keys[Capacity];
+    int16_t index[IndexSlots];   // Slot number, -1 when empty
+    std::atomic<uint16_t> count;
+    uint32_t overflows;          // Inserts refused because the table was full
+    
+    static uint32_t hashKey(uint64_t key) {
+        // 64-bit finalizer (MurmurHash3 fmix64) folded to 32 bits
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return (uint32_t)key;
+    }
+    
+    // Index position holding key, or the empty position where it would go
+    uint32_t probe(uint64_t key) const {
+        uint32_t pos = hashKey(key) & (IndexSlots - 1);
+        while (index[pos] >= 0 && keys[index[pos]] != key) {
+            pos = (pos + 1) & (IndexSlots - 1);
+        }
+        return pos;
+    }
+
+public:
+    DeviceTable() : count(0), overflows(0) {
+        memset(keys, 0, sizeof(keys));
+        for (uint32_t i = 0; i < IndexSlots; i++) {
+            index[i] = -1;
+        }
+    }
+    
+    // Slot index of key, or -1 if the device is not in the table
+    int slotOf(uint64_t key) const {
+        return index[probe(key)];
+    }
+    
+    T* find(uint64_t key) {
+        int slot = slotOf(key);
+        return slot >= 0 ? &entries[slot] : nullptr;
+    }
+    
+    const T* find(uint64_t key) const {
+        int slot = slotOf(key);
+        return slot >= 0 ? &entries[slot] : nullptr;
+    }
+    
+    // Entry for key, claiming the next free slot for a new key.
+    // Returns nullptr (and counts an overflow) when the table is full.
+    T* insert(uint64_t key, bool* inserted = nullptr) {
+        uint32_t pos = probe(key);
+        if (inserted) {
+            *inserted = false;
+        }
+        if (index[pos] >= 0) {
+            return &entries[index[pos]];
+        }
+        
+        uint16_t slot = count.load(std::memory_order_relaxed);
+        if (slot >= Capacity) {
+            overflows++;
+            return nullptr;
+        }
+        
+        keys[slot] = key;
+        index[pos] = slot;
+        if (inserted) {
+            *inserted = true;
+        }
+        // Readers only look at slots below count, so key and index go in first
+        count.store(slot + 1, std::memory_order_release);
+        return &entries[slot];
+    }
+    
+    // Slot access - slot must be below size()
+    T& at(uint16_t slot) { return entries[slot]; }
+    const T& at(uint16_t slot) const { return entries[slot]; }
+    uint64_t keyAt(uint16_t slot) const { return keys[slot]; }
+    
+    // Slot of an entry reference obtained from this table, or -1
+    int indexOf(const T* entry) const {
+        if (entry < entries || entry >= entries + Capacity) {
+            return -1;
+        }
+        return (int)(entry - entries);
+    }
+    
+    // Iteration over occupied slots in slot order (range-for yields T&)
+    T* begin() { return entries; }
+    T* end() { return entries + size(); }
+    const T* begin() const { return entries; }
+    const T* end() const { return entries + size(); }
+    
+    uint16_t size() const { return count.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() >= Capacity; }
+    uint32_t overflowCount() const { return overflows; }
+    
+    static constexpr uint16_t capacity() { return Capacity; }
+    static constexpr size_t entryBytes() { return sizeof(T); }
+    // Fixed footprint (heap held by String members of the entries comes on top)
+    static constexpr size_t memoryBytes() { return sizeof(DeviceTable); }
+};
+
+#endif // DEVICE_TABLE_H
@@ -93,7 +93,7 @@ private:
     void extractCellVoltages(const uint8_t* data, size_t length);
     void extractTemperatures(const uint8_t* data, size_t length);
     
-
+    friend class NativeBenchmark;
     
 public:
     EcoWorthyBMS();
@@ -0,0 +1,142 @@
+#ifndef HISTORY_LOG_H
+#define HISTORY_LOG_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <mutex>
+#include <vector>
+#include "HistoryStore.h"
+
+// Append-only history on LittleFS: the closed buckets of one rollup tier, kept
+// across reboots within a flash budget.
+//
+// The log is a directory of segment files, <sequence>.seg, each written front to
+// back and never rewritten. Records are collected in RAM and written as one block
+// per flush, so flash sees a write every HISTORY_LOG_FLUSH_INTERVAL (or every
+// HISTORY_LOG_BLOCK_RECORDS records) rather than one per bucket. When the segment
+// cannot take the next block a new one is started, and the oldest segments are
+// deleted while the log is over its budget.
+//
+// A power cut can only tear the block being written. On begin() the segment headers
+// are read to index the log, and only the last segment is scanned block by block:
+// the first block with a bad marker, length or CRC ends it, and new blocks go to a
+// fresh segment instead of behind the damage. Readers of older segments stop at a
+// bad block the same way. Records still in RAM when the power goes are lost.
+//
+// File format (all integers little-endian, floats IEEE 754):
+//   Segment header (20 bytes): "VHSG", version, record size, 2 reserved,
+//                              sequence (4), first bucket start (4), CRC-32 of the 16 before (4)
+//   Block (16-byte header + records): marker 0xB10C (2), records (2), oldest and newest
+//                              bucket start (4 + 4), CRC-32 of the 12 before and the records (4)
+//   Record (32 bytes):         MAC (6, most significant byte first), metric (1), reserved (1),
+//                              start (4), count (2), reserved (2), min, max, mean, last (4 each)
+#define HISTORY_LOG_MAGIC "VHSG"
+#define HISTORY_LOG_VERSION 1
+#define HISTORY_LOG_HEADER_SIZE 20
+#define HISTORY_LOG_BLOCK_HEADER 16
+#define HISTORY_LOG_BLOCK_MARKER 0xB10C
+#define HISTORY_LOG_RECORD_SIZE 32
+#define HISTORY_LOG_SEGMENT_SIZE (16 * 1024)
+#define HISTORY_LOG_BLOCK_RECORDS 32          // A full block (1 KB) is written right away
+#define HISTORY_LOG_BUFFER_RECORDS 64         // Records beyond this are dropped until a flush
+#define HISTORY_LOG_FLUSH_INTERVAL 900000     // ms a buffered record waits at most
+#define HISTORY_LOG_MAX_SEGMENTS 64
+
+// Budgets of the two logs main.cpp keeps (15 min and 1 h buckets)
+#ifndef HISTORY_LOG_QUARTER_BUDGET
+#define HISTORY_LOG_QUARTER_BUDGET (256 * 1024)
+#endif
+#ifndef HISTORY_LOG_HOUR_BUDGET
+#define HISTORY_LOG_HOUR_BUDGET (384 * 1024)
+#endif
+
+struct HistoryLogStats {
+    uint16_t segments;
+    uint32_t bytes;              // On flash, all segments
+    uint32_t budgetBytes;
+    uint32_t oldestTime;         // First bucket start of the oldest segment
+    uint32_t blocksWritten;      // Since begin()
+    uint32_t recordsWritten;
+    uint16_t buffered;           // Waiting for the next flush
+    uint32_t dropped;            // Buffer full
+    uint32_t errors;             // Failed opens/writes
+    uint32_t recoveredRecords;   // Valid records in the last segment at begin()
+    uint32_t tornBytes;          // Cut off its end by the recovery scan
+};
+
+class HistoryLog {
+private:
+    struct Segment {
+        uint32_t sequence;
+        uint32_t firstTime;
+        uint32_t bytes;          // Valid length
+    };
+    
+    struct Record {
+        uint64_t device;
+        HistoryMetric metric;
+        HistoryBucket bucket;
+    };
+    
+    fs::FS* filesystem;
+    String directory;
+    uint32_t budgetBytes;
+    
+    // Segment index, oldest first (fileMutex)
+    std::vector<Segment> segments;
+    bool appendable;             // The last segment may take more blocks
+    uint32_t lastTime;           // Latest bucket start found by the recovery scan
+    uint8_t block[HISTORY_LOG_BLOCK_HEADER + HISTORY_LOG_BUFFER_RECORDS * HISTORY_LOG_RECORD_SIZE];
+    std::mutex fileMutex;        // Flash access: flush() and query()
+    
+    // Records not yet written (bufferMutex, never held across flash access)
+    Record buffer[HISTORY_LOG_BUFFER_RECORDS];
+    uint16_t buffered;
+    unsigned long firstBufferedAt;
+    std::mutex bufferMutex;
+    
+    uint32_t blocksWritten;
+    uint32_t recordsWritten;
+    uint32_t dropped;
+    uint32_t errors;
+    uint32_t recoveredRecords;
+    uint32_t tornBytes;
+    
+    String segmentPath(uint32_t sequence) const;
+    void indexSegments();
+    void recoverLastSegment();
+    bool startSegment(uint32_t firstTime);
+    void enforceBudget();
+    uint32_t totalBytes() const;
+
+public:
+    HistoryLog();
+    
+    // The filesystem must already be mounted. Indexes the segments and recovers the last one.
+    void begin(fs::FS& fs, const char* logDirectory, uint32_t maxBytes);
+    
+    // RAM only, safe from any task (HistoryStore calls it when a bucket closes)
+    void append(uint64_t device, HistoryMetric metric, const HistoryBucket& bucket);
+    
+    // Writes the buffered records when a block is full or the oldest has waited
+    // HISTORY_LOG_FLUSH_INTERVAL. Network task; flush() writes them now.
+    void loop();
+    void flush();
+    
+    // Buckets of one series with from <= start <= to, oldest first, appended until buckets
+    // holds maxBuckets; no more than that are held while the log is read. Reads only the
+    // blocks whose oldest..newest overlaps the range. Returns false when matching buckets
+    // were left out.
+    bool query(uint64_t device, HistoryMetric metric, uint32_t from, uint32_t to,
+               std::vector<HistoryBucket>& buckets, size_t maxBuckets);
+    
+    // Latest bucket start on flash at begin() (0 for an empty log)
+    uint32_t getLastTime() const { return lastTime; }
+    HistoryLogStats getStats();
+    
+    static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
+    static void encodeRecord(uint64_t device, HistoryMetric metric, const HistoryBucket& bucket, uint8_t* out);
+    static void decodeRecord(const uint8_t* record, uint64_t& device, HistoryMetric& metric, HistoryBucket& bucket);
+};
+
+#endif // HISTORY_LOG_H
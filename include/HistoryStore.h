@@ -0,0 +1,219 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include <Arduino.h>
+#include <mutex>
+#include <vector>
+
+struct VictronDeviceData;
+class HistoryLog;
+
+// Compressed in-memory history of the main readings, one series per device and metric
+//
+// Samples are Gorilla-encoded (Pelkonen et al., "Gorilla: A Fast, Scalable, In-Memory
+// Time Series Database"): timestamps as delta-of-delta, values as the XOR with the
+// previous value. A steady 1 Hz series costs 1 bit per timestamp and a value that did
+// not change 1 bit, so most samples take a few bits instead of eight bytes.
+//
+// The budget is cut into fixed blocks, each holding one series' samples from its own
+// first sample on, so a block decodes without its predecessors. Blocks are handed out
+// in ring order across all series: the block taken next is always the oldest one in
+// use, and it is the first block of the series that owns it. Every series therefore
+// loses its oldest data first, and busy series take more of the budget than quiet ones.
+//
+// Block layout: header (HISTORY_BLOCK_HEADER bytes) + bit stream, most significant bit first
+//   first sample   value as 32 raw bits (the time is in the header)
+//   timestamp      delta-of-delta D of the seconds since the previous sample:
+//                  '0' D=0 | '10' 7 bits | '110' 9 bits | '1110' 12 bits | '1111' 32 bits
+//   value          X = bits XOR previous bits:
+//                  '0' X=0 | '10' meaningful bits in the previous window |
+//                  '11' 5 bits leading zeros, 5 bits length-1, meaningful bits
+//
+// Rollups: every sample also updates the current bucket of each tier in HistoryTier
+// (min, max, mean, last and count), so the raw blocks only have to cover the last
+// hours and longer ranges are answered from a tier without touching raw samples.
+// A tier is a ring per series spanning a fixed time: its newest bucket is the one
+// of the last sample, and the buckets skipped by a gap are cleared on the way.
+// Series get their rings from the rollup pool in order of appearance; once it is
+// full, later series keep raw samples only.
+//
+// Persistence: a tier can have a HistoryLog (HistoryLog.h), which is handed every
+// bucket of the tier as it closes. queryRollup() answers from the log for the times
+// before the series' first bucket since begin() (or before its ring, if older), so
+// a range reaching back across a reboot comes out in one piece.
+#ifndef HISTORY_RAW_BUDGET
+#define HISTORY_RAW_BUDGET (640 * 1024)          // Bytes of raw blocks, when the board has PSRAM
+#endif
+#ifndef HISTORY_ROLLUP_BUDGET
+#define HISTORY_ROLLUP_BUDGET (1408 * 1024)      // Bytes of rollup rings; with the raw blocks 2 MB
+#endif
+#ifndef HISTORY_HEAP_BUDGET
+#define HISTORY_HEAP_BUDGET (32 * 1024)          // Bytes of raw blocks from the heap without PSRAM
+#endif
+#define HISTORY_BLOCK_SIZE 256
+#define HISTORY_BLOCK_HEADER 16
+#define HISTORY_MAX_SERIES 64
+#define HISTORY_SAMPLE_INTERVAL 1000   // ms between samples of a device
+#define HISTORY_MAX_AGE 10000          // ms; older readings are not sampled
+#define HISTORY_QUERY_MAX_POINTS 600   // Per /api/history response
+#define HISTORY_NO_ROLLUP 0xFF
+
+enum HistoryMetric : uint8_t {
+    HISTORY_VOLTAGE,
+    HISTORY_CURRENT,
+    HISTORY_POWER,
+    HISTORY_SOC,
+    HISTORY_TEMPERATURE,
+    HISTORY_PV_POWER,
+    HISTORY_YIELD_TODAY,
+    HISTORY_METRIC_COUNT
+};
+
+// Rollup tiers, finest first; widths and ring lengths are in HistoryStore.cpp
+enum HistoryTier : uint8_t {
+    HISTORY_TIER_MINUTE,      // 1 min buckets, 12 hours
+    HISTORY_TIER_QUARTER,     // 15 min buckets, 14 days
+    HISTORY_TIER_HOUR,        // 1 h buckets, 60 days
+    HISTORY_TIER_COUNT,
+    HISTORY_TIER_RAW = HISTORY_TIER_COUNT   // Resolution of a query answered from raw samples
+};
+
+struct HistoryPoint {
+    uint32_t time;     // HistoryStore::now() seconds
+    float value;
+};
+
+struct HistoryBucket {
+    uint32_t start;    // HistoryStore::now() seconds
+    uint16_t count;    // Samples in the bucket
+    float min;
+    float max;
+    float mean;
+    float last;
+};
+
+struct HistoryStats {
+    bool psram;
+    uint32_t budgetBytes;
+    uint16_t blocks;
+    uint16_t blocksUsed;
+    uint16_t series;
+    uint32_t samples;         // Held now
+    uint32_t appended;        // Since begin(), evicted ones included
+    uint32_t evictedBlocks;
+    uint32_t bytesUsed;       // Block headers plus the bits written
+    float bytesPerSample;     // bytesUsed / samples (8 uncompressed)
+    float hoursAt1Hz;         // Of one device's HISTORY_METRIC_COUNT series in the budget
+    uint32_t rollupBytes;     // Rollup pool
+    uint8_t rollupSeries;     // Series with rollup rings
+    uint8_t rollupCapacity;   // Series the pool has rings for
+};
+
+class HistoryStore {
+private:
+    struct Series {
+        uint64_t device;          // AdvertisementFilter::addressKey
+        HistoryMetric metric;
+        uint16_t head;            // Oldest block
+        uint16_t tail;            // Block being appended to
+        uint32_t samples;
+        
+        // Encoder state at the end of the tail block
+        uint32_t lastTime;
+        int32_t lastDelta;
+        uint32_t lastBits;
+        uint8_t leading;          // Window of the last '11' value
+        uint8_t meaningful;
+        
+        uint8_t rollup;                           // Ring set in the rollup pool, HISTORY_NO_ROLLUP if none
+        uint32_t newest[HISTORY_TIER_COUNT];      // Bucket number (time / width) + 1 of each tier's newest bucket
+        uint32_t firstTime;                       // First sample since begin()
+    };
+    
+    // Aggregate of one bucket; the mean is sum / count
+    struct Bucket {
+        float min;
+        float max;
+        float sum;
+        float last;
+        uint16_t count;
+    };
+    
+    uint8_t* pool;
+    uint16_t blockCount;
+    uint16_t nextBlock;           // Ring position of the next block to hand out
+    bool psram;
+    Series series[HISTORY_MAX_SERIES];
+    uint16_t seriesCount;
+    uint32_t appended;
+    uint32_t evictedBlocks;
+    Bucket* rollupPool;
+    uint8_t rollupCapacity;
+    uint8_t rollupSeries;
+    HistoryLog* logs[HISTORY_TIER_COUNT];
+    mutable std::mutex mutex;     // record() on the UI task, queries from the web server
+    static uint32_t clockBase;
+    
+    uint8_t* block(uint16_t index) const { return pool + (size_t)index * HISTORY_BLOCK_SIZE; }
+    Series* findSeries(uint64_t device, HistoryMetric metric, bool create);
+    uint16_t takeBlock(uint16_t owner);
+    void startBlock(Series& entry, uint16_t owner, uint32_t time, float value);
+    bool appendLocked(uint64_t device, HistoryMetric metric, uint32_t time, float value);
+    Bucket* ring(const Series& entry, HistoryTier tier) const;
+    void rollUp(Series& entry, uint32_t time, float value);
+    const Series* lookup(uint64_t device, HistoryMetric metric) const;
+
+public:
+    HistoryStore();
+    ~HistoryStore();
+    
+    // PSRAM when the board has it, else HISTORY_HEAP_BUDGET of raw blocks from the heap
+    // and no rollups
+    bool begin(uint32_t rawBudget = HISTORY_RAW_BUDGET, uint32_t rollupBudget = HISTORY_ROLLUP_BUDGET);
+    
+    // Closed buckets of the tier go to log (nullptr: none). Set before the first sample.
+    void setLog(HistoryTier tier, HistoryLog* log);
+    HistoryLog* getLog(HistoryTier tier) const;
+    
+    // Hands the open bucket of every logged tier to its log, for a restart: a later
+    // sample in the same bucket would log it a second time
+    void closeBuckets();
+    
+    // One sample; false for a time before the series' last sample or when not begun
+    bool append(uint64_t device, HistoryMetric metric, uint32_t time, float value);
+    
+    // The metrics a device has (voltage, current, power, SOC and temperature by their
+    // has* flags, PV power and yield for solar chargers). Call under a DeviceLock.
+    void record(const VictronDeviceData& device, uint32_t time);
+    
+    // Samples with from <= time <= to, oldest first, at most maxPoints of them.
+    // Returns false once maxPoints was reached with samples left in the range.
+    bool query(uint64_t device, HistoryMetric metric, uint32_t from, uint32_t to,
+               std::vector<HistoryPoint>& points, size_t maxPoints) const;
+    
+    // Buckets of a tier with from <= start <= to, oldest first, empty ones skipped; from
+    // the tier's log, if it has one, before the series' buckets in memory.
+    // Returns false once maxBuckets was reached with buckets left in the range.
+    bool queryRollup(uint64_t device, HistoryMetric metric, HistoryTier tier, uint32_t from, uint32_t to,
+                     std::vector<HistoryBucket>& buckets, size_t maxBuckets) const;
+    
+    // The finest resolution that covers from..to in at most maxPoints points:
+    // raw samples, then the tiers in order. The hour tier takes anything longer.
+    static HistoryTier resolutionFor(uint32_t from, uint32_t to, size_t maxPoints);
+    
+    HistoryStats getStats() const;
+    
+    // Sample clock: seconds since boot plus the base, which main.cpp moves past the
+    // newest logged bucket so times keep rising across reboots (time switched off
+    // is not counted)
+    static uint32_t now();
+    static void setClockBase(uint32_t seconds);
+    
+    static const char* metricName(HistoryMetric metric);
+    static bool metricFromName(const String& name, HistoryMetric& metric);
+    static uint32_t tierSeconds(HistoryTier tier);     // Bucket width (1 for raw)
+    static const char* tierName(HistoryTier tier);     // "raw", "1m", "15m", "1h"
+    static bool tierFromName(const String& name, HistoryTier& tier);
+};
+
+#endif // HISTORY_STORE_H
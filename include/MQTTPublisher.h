@@ -8,6 +8,11 @@
 #include <map>
 #include "VictronBLE.h"
 
+// Each publish interval only sends the devices and values named by change events
+// (VictronBLE::subscribeChanges). Everything is sent again after connecting and at this
+// interval, since the topics are not retained and late subscribers need a full set.
+#define MQTT_FULL_PUBLISH_INTERVAL 300000  // ms
+
 // MQTT Configuration structure
 struct MQTTConfig {
     String broker;              // MQTT broker address
@@ -37,19 +42,26 @@ private:
     Preferences preferences;
     MQTTConfig config;
     VictronBLE* victronBLE;
+    int changeSubscriber;             // Change events for the devices to publish
     
     unsigned long lastPublishTime;
     unsigned long lastReconnectAttempt;
+    unsigned long lastFullPublish;
+    bool fullPublishPending;          // Set on (re)connect and configuration changes
     std::map<String, bool> discoveryPublished;  // Track discovery per device address
+    VictronDeviceData publishBuffer;  // Device being published, copied out of the snapshot
     
     void reconnect();
     void publishDiscovery(VictronDeviceData* device);
-    void publishDeviceData(VictronDeviceData* device);
+    void publishDeviceData(VictronDeviceData* device, VictronChangeMask changes = CHANGE_ALL);
     String sanitizeTopicName(const String& name);
     String getDeviceClass(VictronRecordType type);
     
+    friend class NativeBenchmark;
+    
 public:
     MQTTPublisher();
+    ~MQTTPublisher();
     
     void begin(VictronBLE* vble);
     void loop();
@@ -64,7 +76,7 @@ public:
     bool isConnected();
     void connect();
     void disconnect();
-    void publishAll();
+    void publishAll(bool full = false);  // Changed values only, unless full or a full publish is due
 };
 
 #endif // MQTT_PUBLISHER_H
@@ -0,0 +1,119 @@
+#ifndef PERIODIC_TASK_H
+#define PERIODIC_TASK_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Task layout: BLE ingest and parsing on the core that runs the NimBLE host, the
+// display and networking on the other one. Override any of these with -D build flags.
+#ifndef BLE_TASK_CORE
+#define BLE_TASK_CORE 0
+#endif
+#ifndef BLE_TASK_PRIORITY
+#define BLE_TASK_PRIORITY 3
+#endif
+#ifndef BLE_TASK_PERIOD_MS
+#define BLE_TASK_PERIOD_MS 5
+#endif
+#ifndef BLE_TASK_STACK
+#define BLE_TASK_STACK 6144
+#endif
+
+#ifndef UI_TASK_CORE
+#define UI_TASK_CORE 1
+#endif
+#ifndef UI_TASK_PRIORITY
+#define UI_TASK_PRIORITY 2
+#endif
+#ifndef UI_TASK_PERIOD_MS
+#define UI_TASK_PERIOD_MS 10
+#endif
+#ifndef UI_TASK_STACK
+#define UI_TASK_STACK 8192
+#endif
+
+// MQTT, Eco Worthy GATT polling and log output - the tasks allowed to block
+#ifndef NET_TASK_CORE
+#define NET_TASK_CORE 1
+#endif
+#ifndef NET_TASK_PRIORITY
+#define NET_TASK_PRIORITY 1
+#endif
+#ifndef NET_TASK_PERIOD_MS
+#define NET_TASK_PERIOD_MS 10
+#endif
+#ifndef NET_TASK_STACK
+#define NET_TASK_STACK 8192
+#endif
+
+#define TASK_JITTER_LIMIT_US 20000   // Ticks whose spacing is off by more than this count as late
+#define MAX_PERIODIC_TASKS 4
+
+struct TaskConfig {
+    const char* name;
+    uint32_t stackBytes;
+    UBaseType_t priority;
+    BaseType_t core;          // 0 or 1, or tskNO_AFFINITY
+    uint32_t periodMs;
+};
+
+// Jitter is how far the spacing of two consecutive tick starts is from the period
+struct TaskTiming {
+    uint32_t ticks;
+    uint32_t lateTicks;       // Jitter above TASK_JITTER_LIMIT_US
+    uint32_t maxJitterUs;
+    uint32_t meanJitterUs;    // Moving average over the last ~16 ticks
+    uint32_t maxRunUs;        // Longest single tick
+};
+
+typedef void (*TaskTick)(void* context);
+
+// Calls tick(context) every periodMs on its own pinned FreeRTOS task and measures
+// the tick jitter. A tick that overruns is followed immediately by the next one,
+// without catching up on the missed periods.
+class PeriodicTask {
+private:
+    TaskConfig config;
+    TaskTick tick;
+    void* context;
+    TaskHandle_t handle;
+    std::atomic<bool> stopRequested;
+    std::atomic<bool> running;
+    
+    // Written by the task, read by anyone
+    std::atomic<uint32_t> ticks;
+    std::atomic<uint32_t> lateTicks;
+    std::atomic<uint32_t> maxJitterUs;
+    std::atomic<uint32_t> meanJitterUs;
+    std::atomic<uint32_t> maxRunUs;
+    
+    static PeriodicTask* registry[MAX_PERIODIC_TASKS];
+    static std::atomic<int> registered;
+    
+    static void entry(void* self);
+    void run();
+
+public:
+    PeriodicTask();
+    
+    bool start(const TaskConfig& taskConfig, TaskTick taskTick, void* taskContext);
+    
+    // Asks the task to finish after its current tick and waits for it, at most timeoutMs
+    // (0 = until it has). False if the tick was still running at the timeout; the task
+    // then finishes on its own once the tick returns. The firmware stops the network
+    // task before a reboot, whose tick may be stuck in a broker connect.
+    bool stop(uint32_t timeoutMs = 0);
+    bool isRunning() const { return running.load(); }
+    
+    const TaskConfig& getConfig() const { return config; }
+    TaskTiming getTiming() const;
+    void resetTiming();
+    
+    // Every task started so far, for /api/debug
+    static int taskCount();
+    static const PeriodicTask* taskAt(int index);
+};
+
+#endif // PERIODIC_TASK_H
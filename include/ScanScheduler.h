@@ -0,0 +1,115 @@
+#ifndef SCAN_SCHEDULER_H
+#define SCAN_SCHEDULER_H
+
+#include <Arduino.h>
+
+// Adaptive scan duty cycle
+//
+// A Victron device advertises on a fixed interval (plus the 0-10 ms random delay BLE
+// adds to every advertising event), so once its period and phase are known the radio
+// only has to listen around its next arrival. The scheduler learns both from arrival
+// times and tells VictronBLE::loop() whether the scan should be running:
+//
+//   discovery  scan continuously - at boot, every ADAPTIVE_SCAN_DISCOVERY_INTERVAL (new
+//              devices), while a device heard is still being learned and when a device
+//              misses ADAPTIVE_SCAN_MISS_LIMIT windows in a row. Apart from the periodic
+//              one, discovery ends once every device is locked.
+//   windowed   scan only inside the window of each locked device, one arrival per
+//              ADAPTIVE_SCAN_TARGET_PERIOD (faster advertisers skip the ones between)
+//
+// A window closes as soon as its device is heard. A window that closes empty counts
+// as a miss, and the next one is opened around the following arrival, twice as wide.
+#ifndef ADAPTIVE_SCAN_ENABLED
+#define ADAPTIVE_SCAN_ENABLED 1
+#endif
+#ifndef ADAPTIVE_SCAN_TARGET_PERIOD
+#define ADAPTIVE_SCAN_TARGET_PERIOD 1000       // ms between the arrivals listened for
+#endif
+#ifndef ADAPTIVE_SCAN_DISCOVERY_INTERVAL
+#define ADAPTIVE_SCAN_DISCOVERY_INTERVAL 60000  // ms
+#endif
+#ifndef ADAPTIVE_SCAN_DISCOVERY_DURATION
+#define ADAPTIVE_SCAN_DISCOVERY_DURATION 5000   // ms
+#endif
+#define ADAPTIVE_SCAN_GUARD 15          // ms each side of an expected arrival, plus 4x the jitter
+#define ADAPTIVE_SCAN_MISS_LIMIT 3      // Empty windows in a row before a device is relearned
+#define ADAPTIVE_SCAN_LOCK_INTERVALS 3  // Consistent intervals before a device gets windows
+#define ADAPTIVE_SCAN_MIN_GAP 20        // ms; closer reports are one advertising event (scan response)
+
+// Learned timing of one device (indexed by device table slot)
+struct DeviceScanTiming {
+    int64_t lastSeenUs;
+    int64_t periodUs;        // 0 until two arrivals were seen
+    int64_t windowStartUs;   // Next window, valid while locked
+    int64_t windowEndUs;
+    uint32_t jitterUs;       // Moving average of the distance from the predicted arrival
+    uint8_t consistent;      // Intervals in a row that matched the period
+    uint8_t misses;          // Empty windows in a row
+    bool tracked;            // Scheduled for (configured device)
+    bool locked;             // Period and phase known; the device has windows
+};
+
+struct ScanSchedulerStats {
+    bool adaptive;
+    bool discovery;          // Discovery scan running
+    uint16_t tracked;
+    uint16_t locked;
+    float radioOnPercent;    // Share of the time the scan ran since begin()
+    uint32_t windows;        // Windows closed, heard or not
+    uint32_t missed;         // Windows that closed without their device
+    float missedPercent;
+    uint32_t discoveries;    // Discovery scans started
+    uint32_t radioStarts;    // Times the scan was started
+};
+
+// Ingest task only (VictronBLE::loop), or under VictronBLE::IngestLock
+class ScanScheduler {
+private:
+    DeviceScanTiming* timings;
+    uint16_t capacity;
+    bool adaptive;
+    
+    bool discovery;
+    bool discoveryEndsWhenLocked;
+    int64_t discoveryEndUs;
+    int64_t nextDiscoveryUs;
+    
+    bool radioOn;
+    int64_t radioOnSinceUs;
+    uint64_t radioOnUs;
+    int64_t startedUs;
+    uint32_t windows;
+    uint32_t missed;
+    uint32_t discoveries;
+    uint32_t radioStarts;
+    uint16_t trackedCount;
+    uint16_t lockedCount;
+    
+    void startDiscovery(int64_t nowUs, bool endWhenLocked);
+    void learn(DeviceScanTiming& timing, int64_t timeUs);
+    void scheduleWindow(DeviceScanTiming& timing, int64_t centerUs);
+
+public:
+    // timings: one entry per device table slot, owned by the caller
+    ScanScheduler(DeviceScanTiming* deviceTimings, uint16_t slots);
+    
+    // Starts the boot discovery scan
+    void begin(int64_t nowUs);
+    
+    // Off = scan continuously, as before the scheduler existed
+    void setAdaptive(bool enabled);
+    bool isAdaptive() const { return adaptive; }
+    
+    // An advertisement from the device in slot, received at timeUs (esp_timer)
+    void observe(uint16_t slot, int64_t timeUs, bool tracked);
+    
+    // Closes expired windows and returns whether the scan should run now
+    bool update(int64_t nowUs);
+    
+    // Reports the actual scan state (idempotent), for the radio-on time
+    void radioChanged(bool on, int64_t nowUs);
+    
+    ScanSchedulerStats getStats(int64_t nowUs) const;
+};
+
+#endif // SCAN_SCHEDULER_H
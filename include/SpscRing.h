@@ -0,0 +1,72 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Fixed-size single-producer / single-consumer ring buffer
+// The producer (e.g. the NimBLE host task) and the consumer (the main loop)
+// never share a lock: each side only writes its own index, and the other side
+// reads it with acquire/release ordering. No heap allocation after construction.
+//
+// Capacity must be a power of two. Indices run freely and are masked on access,
+// so all Capacity slots are usable.
+template <typename T, uint32_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+private:
+    T slots[Capacity];
+    std::atomic<uint32_t> head;       // Next slot to write (producer only)
+    std::atomic<uint32_t> tail;       // Next slot to read (consumer only)
+    std::atomic<uint32_t> drops;      // Pushes rejected because the ring was full
+    std::atomic<uint32_t> highWater;  // Highest occupancy seen by the producer
+
+public:
+    SpscRing() : head(0), tail(0), drops(0), highWater(0) {}
+    
+    // Producer side - returns false (and counts a drop) if the ring is full
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        uint32_t used = h - t;
+        if (used >= Capacity) {
+            drops.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        
+        slots[h & (Capacity - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        
+        if (used + 1 > highWater.load(std::memory_order_relaxed)) {
+            highWater.store(used + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    
+    // Consumer side - returns false if the ring is empty
+    bool pop(T& item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t h = head.load(std::memory_order_acquire);
+        if (t == h) {
+            return false;
+        }
+        
+        item = slots[t & (Capacity - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Statistics - safe to read from any task
+    uint32_t capacity() const { return Capacity; }
+    uint32_t occupancy() const {
+        // Read tail first: head only grows, so the difference can never underflow
+        uint32_t t = tail.load(std::memory_order_acquire);
+        return head.load(std::memory_order_acquire) - t;
+    }
+    uint32_t dropCount() const { return drops.load(std::memory_order_relaxed); }
+    uint32_t highWaterMark() const { return highWater.load(std::memory_order_relaxed); }
+};
+
+#endif // SPSC_RING_H
@@ -3,12 +3,56 @@
 
 #include <Arduino.h>
 #include <NimBLEDevice.h>
+#include <atomic>
 #include <map>
+#include <mutex>
 #include <vector>
+#include "SpscRing.h"
+#include "AdvertisementFilter.h"
+#include "AesCtr.h"
+#include "DeviceTable.h"
+#include "ScanScheduler.h"
+#include "DeviceNameCache.h"
+#include "DeviceMetrics.h"
+#include "ChangeBus.h"
 
 // Victron BLE Service UUID
 #define VICTRON_MANUFACTURER_ID 0x02E1
 
+// Scanning configuration
+// Advertisements are captured in the NimBLE callback and handed to the main loop
+// through a lock-free ring, so the loop never blocks on the radio. When the scan
+// runs is up to the ScanScheduler (ScanScheduler.h).
+// Must be a power of two; raise it for sites with many devices (see /api/debug "ingest")
+#ifndef ADVERTISEMENT_RING_SIZE
+#define ADVERTISEMENT_RING_SIZE 32
+#endif
+#define MAX_ADVERTISEMENT_DATA 31      // Legacy advertising PDU payload limit
+#define MAX_ADVERTISEMENT_NAME 30      // 29 name characters + terminator
+// NimBLE keeps every seen device in its result list while scanning; restart the
+// scan periodically so this list does not grow without bound at busy sites
+#define SCAN_RESULTS_FLUSH_INTERVAL 60000  // ms
+// Passive scanning: the manufacturer data is in the primary advertisement, so no scan
+// requests are sent and names come from the DeviceNameCache. A short active probe
+// runs only while a MAC without a known name is being heard.
+#ifndef PASSIVE_SCAN_ENABLED
+#define PASSIVE_SCAN_ENABLED 1
+#endif
+#define NAME_PROBE_MAX_DURATION 5000   // ms
+#define NAME_PROBE_SETTLE 1500         // ms without an unnamed MAC before a probe ends early
+#define NAME_PROBE_INTERVAL 30000      // ms between probe starts
+// Readings from other sources (Eco Worthy GATT) waiting for the ingest task; power of two
+#define READING_QUEUE_SIZE 4
+// publishSnapshot() skips its turn while a reader holds the snapshot; after this long
+// it waits for the reader instead, so the snapshot is never more than this stale
+#define SNAPSHOT_MAX_DEFER_MS 100
+
+// Device table size - the table is allocated once and never grows.
+// Devices seen after it is full are ignored (reported in the log).
+#ifndef VICTRON_MAX_DEVICES
+#define VICTRON_MAX_DEVICES 32
+#endif
+
 // Fixed payload sizes for different device types
 #define SMART_SHUNT_PAYLOAD_SIZE 15
 #define SOLAR_CONTROLLER_PAYLOAD_SIZE 16
@@ -104,6 +148,35 @@ enum VictronProductID {
     PHOENIX_SMART_IP43_CHARGER_24_16 = 0xA346
 };
 
+// Readout type (byte 6 of the manufacturer data): which payload layout follows.
+// Victron advertisement header: [0-1] company ID, [2-3] prefix (0x10 ..),
+// [4-5] model ID (little-endian), [6] readout type, [7-8] nonce, [9] key match byte
+enum VictronReadoutType {
+    READOUT_SOLAR_CHARGER = 0x01,
+    READOUT_BATTERY_MONITOR = 0x02,
+    READOUT_INVERTER = 0x03,
+    READOUT_DCDC_CONVERTER = 0x04,
+    READOUT_SMART_LITHIUM = 0x05,
+    READOUT_INVERTER_RS = 0x06,
+    READOUT_GX_DEVICE = 0x07,
+    READOUT_AC_CHARGER = 0x08,
+    READOUT_SMART_BATTERY_PROTECT = 0x09,
+    READOUT_LYNX_SMART_BMS = 0x0A,
+    READOUT_MULTI_RS = 0x0B,
+    READOUT_VE_BUS = 0x0C,
+    READOUT_DC_ENERGY_METER = 0x0D,
+    READOUT_ORION_XS = 0x0F
+};
+
+// Victron manufacturer data ("extra manufacturer data" record), all offsets in bytes:
+// [0-1] manufacturer ID 0x02E1, [2-3] record prefix, [4-5] model ID, [6] readout type,
+// [7-8] nonce, [9] key match byte, [10+] payload encrypted with AES-128-CTR
+#define VICTRON_MODEL_ID_OFFSET 4
+#define VICTRON_READOUT_TYPE_OFFSET 6
+#define VICTRON_NONCE_OFFSET 7
+#define VICTRON_KEY_MATCH_OFFSET 9
+#define VICTRON_PAYLOAD_OFFSET 10
+
 // Record Types from Victron BLE advertising
 enum VictronRecordType {
     SOLAR_CHARGER_VOLTAGE = 0x01,
@@ -226,13 +299,53 @@ struct VictronRecord {
     }
 };
 
-// Victron Device Data Structure
-struct VictronDeviceData {
-    String name;
-    String address;
-    VictronDeviceType type;
-    int rssi;
+// Raw advertisement captured in the BLE callback context
+// Fixed size so it can be copied into the ring without any heap allocation
+struct VictronAdvertisement {
+    uint8_t mac[6];                              // Address bytes, most significant first
+    int8_t rssi;
+    uint8_t dataLength;                          // Manufacturer data length (0 if none)
+    int64_t timestampUs;                         // esp_timer time when received
+    uint8_t data[MAX_ADVERTISEMENT_DATA];        // Manufacturer data including company ID
+    char name[MAX_ADVERTISEMENT_NAME];           // Local name (empty if not advertised)
     
+    VictronAdvertisement() : rssi(0), dataLength(0), timestampUs(0) {
+        memset(mac, 0, sizeof(mac));
+        memset(data, 0, sizeof(data));
+        name[0] = '\0';
+    }
+};
+
+// Advertisement ring statistics, used to size ADVERTISEMENT_RING_SIZE
+struct IngestStats {
+    uint32_t capacity;     // Ring slots
+    uint32_t occupancy;    // Advertisements waiting to be parsed
+    uint32_t highWater;    // Highest occupancy seen since boot
+    uint32_t drops;        // Advertisements dropped because the ring was full
+    uint32_t filtered;     // Advertisements rejected by the raw pre-filter (unrelated beacons)
+    uint32_t received;     // Advertisements accepted into the ring
+    uint32_t processed;    // Advertisements parsed by loop()
+    uint32_t cacheLookups; // Victron frames checked against the nonce cache
+    uint32_t cacheHits;    // Frames identical to the last one (decrypt and parse skipped)
+};
+
+// Encryption key for one device, parsed and validated once in setEncryptionKey()
+// so the per-packet cost is only the AES-CTR keystream
+struct VictronDeviceKey {
+    String hex;              // Key as configured (returned by getEncryptionKey)
+    uint8_t bytes[16];
+    bool valid;              // false if the configured key is not 32 hex characters
+    AesCtrKey aes;           // Key schedule for every AES-CTR backend
+    
+    VictronDeviceKey() : valid(false) {
+        memset(bytes, 0, sizeof(bytes));
+    }
+};
+
+// Telemetry decoded from one Victron advertisement
+// Plain data only, so a reading can be decoded on the stack without touching the heap.
+// VictronDeviceData extends it, keeping the field names the same for all consumers.
+struct VictronReading {
     // Common measurements
     float voltage;              // V
     float current;              // A
@@ -282,7 +395,6 @@ struct VictronDeviceData {
     int alarmState;
     uint32_t offReason;         // 32-bit off reason code for DC-DC converters
     
-    unsigned long lastUpdate;
     bool dataValid;
     
     // Field availability flags
@@ -295,18 +407,7 @@ struct VictronDeviceData {
     bool hasInputVoltage;
     bool hasOutputVoltage;
     
-    // Raw debug data (BLE manufacturer data is typically 20-30 bytes for Victron devices)
-    uint8_t rawManufacturerData[64];  // Sufficient for typical BLE advertisement payloads
-    size_t rawDataLength;
-    uint16_t manufacturerId;
-    uint16_t modelId;
-    bool encrypted;
-    String errorMessage;  // Error message when parsing fails
-    std::vector<VictronRecord> parsedRecords;
-    
-    VictronDeviceData() : 
-        type(DEVICE_UNKNOWN), 
-        rssi(0),
+    VictronReading() : 
         voltage(0), 
         current(0), 
         power(0), 
@@ -337,7 +438,6 @@ struct VictronDeviceData {
         deviceState(0),
         alarmState(0),
         offReason(0),
-        lastUpdate(0), 
         dataValid(false),
         hasVoltage(false),
         hasCurrent(false),
@@ -346,68 +446,287 @@ struct VictronDeviceData {
         hasTemperature(false),
         hasAcOut(false),
         hasInputVoltage(false),
-        hasOutputVoltage(false),
-        rawDataLength(0),
-        manufacturerId(0),
+        hasOutputVoltage(false) {
+        memset(cellVoltage, 0, sizeof(cellVoltage));
+    }
+};
+
+// Victron Device Data Structure
+// Hot record: only what the display, alarm, MQTT and live data paths read.
+// Debug-only data lives in VictronDebugData, allocated while /debug is watched.
+struct VictronDeviceData : public VictronReading {
+    String name;
+    String address;
+    VictronDeviceType type;
+    int rssi;
+    unsigned long lastUpdate;
+    uint16_t modelId;
+    uint8_t readoutType;      // Last readout type seen; the type is only re-derived when it changes
+    bool encrypted;
+    
+    // Nonce cache: the last parsed frame's data counter (bytes 7-8) and payload hash.
+    // Victron devices repeat a frame until the counter changes, so repeats skip AES and parsing.
+    uint16_t frameCounter;
+    uint32_t frameHash;
+    uint32_t frameKeyGeneration;  // Encryption key generation the frame was parsed with
+    bool frameCached;
+    
+    VictronDeviceData() : 
+        type(DEVICE_UNKNOWN), 
+        rssi(0),
+        lastUpdate(0), 
         modelId(0),
-        encrypted(false) {
+        readoutType(0),
+        encrypted(false),
+        frameCounter(0),
+        frameHash(0),
+        frameKeyGeneration(0),
+        frameCached(false) {}
+};
+
+// Cold per-device record for the /debug page
+// Kept outside the device table and only allocated while the page is polling
+// (see VictronBLE::watchDebugData), so normal operation carries none of it.
+struct VictronDebugData {
+    // Raw debug data (BLE manufacturer data is typically 20-30 bytes for Victron devices)
+    uint8_t rawManufacturerData[64];  // Sufficient for typical BLE advertisement payloads
+    size_t rawDataLength;
+    uint16_t manufacturerId;
+    String errorMessage;  // Error message when parsing fails
+    std::vector<VictronRecord> parsedRecords;
+    
+    VictronDebugData() : rawDataLength(0), manufacturerId(0) {
         memset(rawManufacturerData, 0, sizeof(rawManufacturerData));
-        memset(cellVoltage, 0, sizeof(cellVoltage));
     }
 };
 
+// How long debug records are kept after the last /api/debug request
+#define DEBUG_CAPTURE_TIMEOUT 30000  // ms
+
+// A reading from outside the advertisement path, applied by the ingest task
+struct QueuedReading {
+    uint64_t key;                // 48-bit MAC (AdvertisementFilter::addressKey)
+    VictronReading reading;
+    unsigned long lastUpdate;
+    
+    QueuedReading() : key(0), lastUpdate(0) {}
+};
+
+struct VictronField;  // VictronPayloadLayout.h
+class AdvertisementCapture;  // AdvertisementCapture.h
+
+typedef DeviceTable<VictronDeviceData, VICTRON_MAX_DEVICES> VictronDeviceTable;
+
+// Threading: loop() (the ingest task) owns the device table. Other tasks read a copy of
+// it, the snapshot, which loop() refreshes from the changed slots after every batch.
+// Readers hold a DeviceLock while they use snapshot entries; the ingest task only ever
+// try-locks it (see SNAPSHOT_MAX_DEFER_MS), so a slow reader cannot stall parsing.
 class VictronBLE {
 private:
-    std::map<String, VictronDeviceData> devices;
-    std::map<String, String> encryptionKeys;  // MAC address -> encryption key
+    VictronDeviceTable devices;  // Keyed by 48-bit MAC (AdvertisementFilter::addressKey)
+    VictronDeviceTable snapshot;  // Same keys in the same slots, read by the other tasks
+    uint32_t dirtySlots[(VICTRON_MAX_DEVICES + 31) / 32];  // Slots changed since the last publish
+    VictronChangeMask pendingChanges[VICTRON_MAX_DEVICES];  // Fields merged since the last publish
+    ChangeBus<VICTRON_MAX_DEVICES> changeBus;  // Fed by publishSnapshot(), under snapshotMutex
+    float changeDeadbands[CHANGE_FIELD_COUNT];  // By VictronChangeField, 0 = any change counts
+    bool snapshotPending;
+    unsigned long lastSnapshot;
+    std::mutex snapshotMutex;  // DeviceLock
+    std::mutex ingestMutex;    // IngestLock: held by loop() while parsing
+    SpscRing<QueuedReading, READING_QUEUE_SIZE> readingQueue;  // queueReading() -> loop()
+    std::atomic<bool> scanHeld;
+    char parseError[100];  // Error text of the reading being decoded (loop() only)
+    std::map<uint64_t, VictronDeviceKey> encryptionKeys;  // 48-bit MAC (AdvertisementFilter::addressKey) -> key
     NimBLEScan* pBLEScan;
     bool retainLastData;  // Flag to retain last good data when parsing fails
+    AdvertisementFilter advertisementFilter;  // Runs in the NimBLE host task before anything is copied
+    SpscRing<VictronAdvertisement, ADVERTISEMENT_RING_SIZE> advertisementRing;  // NimBLE host task -> loop()
+    uint32_t advertisementsReceived;   // Written by the NimBLE host task only
+    uint32_t advertisementsProcessed;  // Written by loop() only
+    uint32_t frameCacheLookups;
+    uint32_t frameCacheHits;
+    uint32_t keyGeneration;            // Bumped whenever encryption keys change, invalidating the nonce cache
+    unsigned long lastResultsFlush;
+    DeviceScanTiming scanTimings[VICTRON_MAX_DEVICES];  // By device table slot
+    DeviceMetrics metrics[VICTRON_MAX_DEVICES];         // By device table slot
+    DeviceMetrics* parseMetrics;       // Metrics of the frame being decoded (loop() only)
+    ScanScheduler scanScheduler;
+    DeviceNameCache nameCache;
+    bool passiveScan;
+    bool scanActive;                   // Mode the scan was last started with
+    bool nameProbing;
+    bool nameProbeRequested;           // An unnamed MAC was heard since the last updateScan()
+    unsigned long nameProbeStarted;
+    unsigned long nameWantedAt;
+    uint32_t nameProbes;
+    
+    // Debug records by device table slot (nullptr unless /debug is being watched)
+    VictronDebugData* debugRecords[VICTRON_MAX_DEVICES];
+    std::atomic<uint32_t> debugWatchedAt;  // millis() of the last watchDebugData(), 0 = not watched
+    bool debugCaptureActive;               // loop() only
     
+    AdvertisementCapture* capture;  // Records what loop() takes from the ring (nullptr = never)
+    
+    void processAdvertisement(const VictronAdvertisement& adv);
+    bool startRadio();
+    void updateScan();
+    void updateNameProbe();
+    void nameWanted(uint64_t key);
+    void markDirty(const VictronDeviceData& device);
+    void applyQueuedReadings();
+    VictronDebugData* captureDebugData(const VictronDeviceData& device);
+    void releaseDebugData();
+    
+    // Device classification: readout type first, then model ID, then name patterns.
+    // Runs only when a device's readout type, model ID or name changes.
+    VictronDeviceType classifyDevice(uint8_t readoutType, uint16_t modelId, const String& name);
     VictronDeviceType identifyDeviceType(const String& name, uint16_t modelId = 0);
-    bool parseVictronAdvertisement(const uint8_t* data, size_t length, VictronDeviceData& device, const String& encryptionKey);
-    bool decryptData(const uint8_t* encryptedData, size_t length, uint8_t* decryptedData, const String& key);
+    static VictronDeviceType readoutDeviceType(uint8_t readoutType);
+    static VictronDeviceType modelDeviceType(uint16_t modelId);
+    bool parseVictronAdvertisement(const uint8_t* data, size_t length, VictronDeviceData& device,
+                                   const VictronDeviceKey* encryptionKey, VictronReading& reading,
+                                   VictronDebugData* debug);
+    bool decryptData(const uint8_t* encryptedData, size_t length, uint8_t* decryptedData, const VictronDeviceKey& key);
+    const VictronDeviceKey* findEncryptionKey(const uint8_t* mac) const;
     float decodeValue(const uint8_t* data, int len, float scale);
     
-    // Device-specific parsing functions for fixed structures
-    // SmartShunt: 15 bytes, Solar Controller & Blue Smart Charger: 16 bytes, DC-DC Converter: 16 bytes
-    void parseSmartShuntData(const uint8_t* output, size_t length, VictronDeviceData& device);
-    void parseSolarControllerData(const uint8_t* output, size_t length, VictronDeviceData& device);
-    void parseDCDCConverterData(const uint8_t* output, size_t length, VictronDeviceData& device);
-    void parseTLVRecords(const uint8_t* data, size_t length, size_t startPos, VictronDeviceData& device);
+    // Fallback for device types without a payload layout (see PAYLOAD_DECODERS)
+    void parseTLVRecords(const uint8_t* data, size_t length, size_t startPos, VictronReading& reading,
+                         std::vector<VictronRecord>* records);
     
-    // Helper functions for multi-byte value extraction
-    int16_t extractSigned16(const uint8_t* data, int byteIndex);
-    uint16_t extractUnsigned16(const uint8_t* data, int byteIndex);
-    int32_t extractSigned22(const uint8_t* data, int startByte);
-    uint32_t extractUnsigned20(const uint8_t* data, int startByte);
-    uint16_t extractUnsigned10(const uint8_t* data, int startByte);
+    // Table-driven decoding of bit-packed payloads (layouts in VictronPayloadLayout.h).
+    // Returns false if a field failed its sanity check.
+    bool decodeFields(const VictronField* fields, size_t count, const uint8_t* payload, size_t length,
+                      VictronReading& reading);
+    static int64_t extractBits(const uint8_t* data, uint8_t bitOffset, uint8_t bitWidth, bool isSigned);
     
     // Helper function to validate voltage readings
     // Returns true if voltage is valid, false otherwise
-    // If invalid, sets device.dataValid to false and logs an error
-    bool validateVoltage(float voltage, const char* source, VictronDeviceData& device);
+    // If invalid, sets reading.dataValid to false, fills parseError and logs an error
+    bool validateVoltage(float voltage, const char* source, VictronReading& reading);
     
     // Helper function to validate temperature readings
     // Returns true if temperature is valid, false otherwise
-    // If invalid, sets device.dataValid to false and logs an error
-    bool validateTemperature(float temperature, const char* source, VictronDeviceData& device);
+    // If invalid, sets reading.dataValid to false, fills parseError and logs an error
+    bool validateTemperature(float temperature, const char* source, VictronReading& reading);
     
-    // Helper function to normalize MAC addresses for comparison
-    // Removes colons and converts to lowercase
-    String normalizeAddress(const String& address);
+    // Apply a decoded reading to the device in place (merged or replaced, see retainLastData).
+    // Only fields that changed are written; returns their VictronChangeField bits.
+    VictronChangeMask mergeDeviceData(const VictronReading& newData, VictronDeviceData& existingData);
     
-    // Helper function to merge new device data with existing data
-    void mergeDeviceData(const VictronDeviceData& newData, VictronDeviceData& existingData);
+    friend class NativeBenchmark;  // native/bench times the private parse steps directly
+    friend class DecoderEquivalence;  // native runner compares decoding with the baseline parsers
     
 public:
+    // Holds the snapshot still while its entries are read (UI, MQTT and web tasks).
+    // Not recursive: never take it twice on the same task.
+    class DeviceLock {
+    private:
+        std::lock_guard<std::mutex> guard;
+    public:
+        explicit DeviceLock(VictronBLE& ble) : guard(ble.snapshotMutex) {}
+    };
+    
+    // Holds loop() off, for reading debug records from another task.
+    // Take it before a DeviceLock, never while holding one.
+    class IngestLock {
+    private:
+        std::lock_guard<std::mutex> guard;
+    public:
+        explicit IngestLock(VictronBLE& ble) : guard(ble.ingestMutex) {}
+    };
+    
     VictronBLE();
     void begin();
-    void scan(int duration = 5);
+    
+    // Advertisements are pushed by the BLE callback as they arrive (duplicates included)
+    // and parsed by loop() without blocking. Once started, loop() turns the scan on and
+    // off following the ScanScheduler; with the adaptive duty cycle off it runs continuously.
+    void startScanning();
+    void stopScanning();
+    bool isScanning();
+    
+    // While held, loop() does not restart a stopped scan (a GATT connection is in progress).
+    // holdScan(true) stops a running scan and waits for a loop() deciding on it to finish.
+    void holdScan(bool hold);
+    
+    // Ingest task: parses what arrived, applies queued readings and publishes the snapshot
+    void loop();
+    
+    // Copies the changed device slots into the snapshot. Called by loop(); call it from
+    // the ingest task after replayAdvertisement() too.
+    void publishSnapshot();
+    
+    // Any one task other than the ingest task: hands a reading for a known device to
+    // loop(), which merges it like a parsed advertisement (unknown devices are skipped).
+    // False if the address is invalid or the queue is full.
+    bool queueReading(const String& address, const VictronReading& reading, unsigned long lastUpdate);
+    
+    // Called from the NimBLE host task - copies the advertisement into the ring
+    void onAdvertisement(NimBLEAdvertisedDevice* advertisedDevice);
+    IngestStats getIngestStats() const;
+    
+    // Scan duty cycle (ScanScheduler.h) and passive scanning; from other tasks, call
+    // these under IngestLock
+    void setAdaptiveScan(bool enabled);
+    ScanSchedulerStats getScanStats() const;
+    void setPassiveScan(bool enabled);
+    bool isPassiveScan() const { return passiveScan; }
+    uint32_t getNameProbeCount() const { return nameProbes; }
+    uint8_t getCachedNameCount() const { return nameCache.getCount(); }
+    
+    // Capture and replay (AdvertisementCapture.h). Replayed advertisements skip the
+    // ring and the capture; call replayAdvertisement() from the loop() task only.
+    void setCapture(AdvertisementCapture* recorder);
+    void replayAdvertisement(const VictronAdvertisement& adv);
+    
+    // Configured device addresses are always let through the pre-filter
+    void setAllowedAddresses(const std::vector<String>& addresses);
+
     void setEncryptionKey(const String& address, const String& key);
     String getEncryptionKey(const String& address);
     void clearEncryptionKeys();
-    std::map<String, VictronDeviceData>& getDevices();
-    VictronDeviceData* getDevice(const String& address);
+    
+    // Snapshot of the devices in discovery order; slot indices are stable for the whole run.
+    // Hold a DeviceLock while using it and anything returned by getDevice():
+    //   VictronBLE::DeviceLock lock(*victronBLE);
+    //   for (VictronDeviceData& device : victronBLE->getDevices()) ...
+    VictronDeviceTable& getDevices();
+    VictronDeviceData* getDevice(const String& address);  // Any MAC notation, case-insensitive
+    VictronDeviceData* getDevice(const uint8_t* mac);
+    
+    // Change events (ChangeBus.h): instead of walking getDevices() on a timer, a task
+    // subscribes to the fields it shows and handles the devices that changed. Subscribe
+    // and unsubscribe without holding a DeviceLock; hold one for followDevice() and
+    // nextChange(), and while reading the device the event names. hasChanges() needs
+    // no lock, so an idle tick costs one atomic load.
+    //   if (victronBLE->hasChanges(subscriber)) {
+    //       VictronBLE::DeviceLock lock(*victronBLE);
+    //       ChangeEvent event;
+    //       while (victronBLE->nextChange(subscriber, event)) ... getDevices().at(event.slot)
+    //   }
+    int subscribeChanges(const char* name, VictronChangeMask fields);  // -1 if none left
+    void unsubscribeChanges(int subscriber);
+    void followDevice(int subscriber, uint16_t slot, bool follow) { changeBus.followDevice(subscriber, slot, follow); }
+    void followAllDevices(int subscriber, bool follow) { changeBus.followAllDevices(subscriber, follow); }
+    bool hasChanges(int subscriber) const { return changeBus.hasEvents(subscriber); }
+    bool nextChange(int subscriber, ChangeEvent& event) { return changeBus.next(subscriber, event); }
+    ChangeSubscriberStats getChangeStats(int subscriber) const { return changeBus.getStats(subscriber); }
+    
+    // Float fields count as changed only when they move by more than the deadband from
+    // the last stored value (default 0). Call before loop() runs, or under IngestLock.
+    void setChangeDeadband(VictronChangeField field, float deadband);
+    
+    // Debug records: the /debug page calls watchDebugData() on every poll; records are
+    // filled from the next advertisement of each device and freed by loop() once the
+    // page has not polled for DEBUG_CAPTURE_TIMEOUT. Hold an IngestLock while reading them.
+    void watchDebugData();
+    const VictronDebugData* getDebugData(const VictronDeviceData& device) const;
+    
+    // Ingest metrics (DeviceMetrics.h) by device slot, as in getDevices(). Hold an
+    // IngestLock while reading them.
+    const DeviceMetrics& getDeviceMetrics(uint16_t slot) const { return metrics[slot]; }
+    bool isDebugCaptureActive() const { return debugCaptureActive; }
     bool hasDevices();
     int getDeviceCount();
     void setRetainLastData(bool retain);
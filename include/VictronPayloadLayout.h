@@ -0,0 +1,222 @@
+#ifndef VICTRON_PAYLOAD_LAYOUT_H
+#define VICTRON_PAYLOAD_LAYOUT_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <type_traits>
+#include "VictronBLE.h"
+
+// Victron "extra manufacturer data" payloads are bit-packed records, LSB first
+// across little-endian bytes. Each record type is described here as a constexpr
+// table of fields and decoded by VictronBLE::decodeFields(); adding a device
+// type means adding a table, not a parser.
+//
+// Fields are decoded in table order. A field is only decoded when the payload
+// is long enough to hold it completely, and is skipped when its raw value is the
+// "not available" sentinel. A failed check stops decoding (reading.dataValid = false).
+
+// Destination field type, derived from the VictronReading member at compile time
+enum VictronFieldType : uint8_t {
+    FIELD_FLOAT,     // (raw / divisor) + offset
+    FIELD_INT,       // raw value
+    FIELD_UINT32     // raw value
+};
+
+template <typename T> struct VictronFieldTypeOf;  // Unsupported destination types do not compile
+template <> struct VictronFieldTypeOf<float> { static constexpr VictronFieldType value = FIELD_FLOAT; };
+template <> struct VictronFieldTypeOf<int> { static constexpr VictronFieldType value = FIELD_INT; };
+template <> struct VictronFieldTypeOf<uint32_t> { static constexpr VictronFieldType value = FIELD_UINT32; };
+
+// Sanity checks (see validateVoltage/validateTemperature)
+enum VictronFieldCheck : uint8_t {
+    CHECK_NONE,
+    CHECK_VOLTAGE,        // Before storing: MIN_VALID_VOLTAGE..MAX_VALID_VOLTAGE
+    CHECK_TEMPERATURE,    // Before storing: at most MAX_VALID_TEMPERATURE
+    CHECK_CURRENT_LIMIT   // After storing: within +/-100 A, otherwise the key is likely wrong
+};
+
+// Work done after a field is stored
+enum VictronFieldAction : uint8_t {
+    ACTION_NONE,
+    ACTION_POWER,         // power = voltage * current when the voltage is known
+    ACTION_SET_VOLTAGE,   // Also show the value as the main voltage
+    ACTION_SELECTOR       // Raw value selects which VICTRON_WHEN(n) fields follow
+};
+
+struct VictronField {
+    uint8_t bitOffset;
+    uint8_t bitWidth;          // 1-32
+    bool isSigned;             // Two's complement
+    int64_t notAvailable;      // Raw sentinel (after sign extension), VICTRON_NA_NONE if none
+    float divisor;             // FIELD_FLOAT only
+    double offset;             // FIELD_FLOAT only, added after dividing
+    uint16_t dest;             // Byte offset into VictronReading
+    VictronFieldType type;
+    int16_t flag;              // Byte offset of the has* flag to set, or VICTRON_NO_FLAG
+    VictronFieldCheck check;
+    VictronFieldAction action;
+    int8_t when;               // Selector value this field applies to, or VICTRON_ALWAYS
+    const char* source;        // Name used in check error messages
+};
+
+#define VICTRON_DEST(member) \
+    (uint16_t)offsetof(VictronReading, member), \
+    VictronFieldTypeOf<std::remove_reference<decltype(((VictronReading*)nullptr)->member)>::type>::value
+#define VICTRON_FLAG(member) (int16_t)offsetof(VictronReading, member)
+#define VICTRON_NO_FLAG -1
+#define VICTRON_NA_NONE INT64_MIN
+#define VICTRON_ALWAYS -1
+#define VICTRON_WHEN(selector) selector
+
+// Compile-time layout check: widths in range and every field inside the payload
+constexpr bool victronLayoutValid(const VictronField* fields, size_t count, size_t payloadBytes) {
+    return count == 0 ||
+           (fields->bitWidth >= 1 && fields->bitWidth <= 32 &&
+            (size_t)fields->bitOffset + fields->bitWidth <= payloadBytes * 8 &&
+            (fields->type == FIELD_FLOAT || fields->divisor == 1.0f) &&
+            victronLayoutValid(fields + 1, count - 1, payloadBytes));
+}
+
+template <size_t N>
+constexpr size_t victronLayoutSize(const VictronField (&)[N]) {
+    return N;
+}
+
+#define VICTRON_LAYOUT_CHECK(layout, payloadBytes) \
+    static_assert(victronLayoutValid(layout, victronLayoutSize(layout), payloadBytes), \
+                  #layout " has a field outside the payload or an invalid width")
+
+// Longest payload after the 10-byte encrypted header
+#define VICTRON_MAX_PAYLOAD (MAX_ADVERTISEMENT_DATA - 10)
+
+// Columns: bit, width, signed, n/a, divisor, offset, destination, flag, check, action, when, source
+
+// SmartShunt / BMV (record type 0x02), 15 bytes - based on VBM.cpp from the reference implementation
+static constexpr VictronField SMART_SHUNT_LAYOUT[] = {
+    // Time to go, minutes
+    {   0, 16, false, 0xFFFF,   1.0f,   0.0,    VICTRON_DEST(timeToGo),    VICTRON_NO_FLAG,                CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // Battery voltage, 10 mV
+    {  16, 16, true,  0x7FFF,   100.0f, 0.0,    VICTRON_DEST(voltage),     VICTRON_FLAG(hasVoltage),       CHECK_VOLTAGE,     ACTION_NONE,     VICTRON_ALWAYS,   "SmartShunt" },
+    // Alarm reason bits
+    {  32, 16, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(alarmState), VICTRON_NO_FLAG,               CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // Aux input mode (0=aux voltage, 1=midpoint, 2=temperature, 3=none), selects the aux value below
+    {  64,  2, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(auxMode),   VICTRON_NO_FLAG,                CHECK_NONE,        ACTION_SELECTOR, VICTRON_ALWAYS,   nullptr },
+    // Aux value: starter voltage (10 mV, signed), midpoint voltage (10 mV) or temperature (0.01 K)
+    {  48, 16, true,  0x7FFF,   100.0f, 0.0,    VICTRON_DEST(auxVoltage),  VICTRON_NO_FLAG,                CHECK_NONE,        ACTION_NONE,     VICTRON_WHEN(0),  nullptr },
+    {  48, 16, false, 0xFFFF,   100.0f, 0.0,    VICTRON_DEST(midVoltage),  VICTRON_NO_FLAG,                CHECK_NONE,        ACTION_NONE,     VICTRON_WHEN(1),  nullptr },
+    {  48, 16, false, 0xFFFF,   100.0f, -273.15, VICTRON_DEST(temperature), VICTRON_FLAG(hasTemperature),  CHECK_TEMPERATURE, ACTION_NONE,     VICTRON_WHEN(2),  "SmartShunt" },
+    // Battery current, mA (22 bits)
+    {  66, 22, true,  0x1FFFFF, 1000.0f, 0.0,   VICTRON_DEST(current),     VICTRON_FLAG(hasCurrent),       CHECK_NONE,        ACTION_POWER,    VICTRON_ALWAYS,   nullptr },
+    // Consumed, 0.1 Ah (20 bits)
+    {  88, 20, false, 0xFFFFF,  10.0f,  0.0,    VICTRON_DEST(consumedAh),  VICTRON_NO_FLAG,                CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // State of charge, 0.1 % (10 bits)
+    { 108, 10, false, 0x3FF,    10.0f,  0.0,    VICTRON_DEST(batterySOC),  VICTRON_FLAG(hasSOC),           CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+};
+VICTRON_LAYOUT_CHECK(SMART_SHUNT_LAYOUT, SMART_SHUNT_PAYLOAD_SIZE);
+
+// Solar charger and Blue Smart charger (record type 0x01), 16 bytes - based on VSC.cpp
+static constexpr VictronField SOLAR_CONTROLLER_LAYOUT[] = {
+    {   0,  8, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(deviceState), VICTRON_NO_FLAG,              CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {   8,  8, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(chargerError), VICTRON_NO_FLAG,             CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // Battery voltage, 10 mV
+    {  16, 16, true,  0x7FFF,   100.0f, 0.0,    VICTRON_DEST(voltage),     VICTRON_FLAG(hasVoltage),       CHECK_VOLTAGE,     ACTION_NONE,     VICTRON_ALWAYS,   "SolarController" },
+    // Battery current, 100 mA (signed for both chargers)
+    {  32, 16, true,  0x7FFF,   10.0f,  0.0,    VICTRON_DEST(current),     VICTRON_FLAG(hasCurrent),       CHECK_CURRENT_LIMIT, ACTION_POWER,  VICTRON_ALWAYS,   nullptr },
+    // Yield today, 10 Wh
+    {  48, 16, false, 0xFFFF,   100.0f, 0.0,    VICTRON_DEST(yieldToday),  VICTRON_NO_FLAG,                CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // PV power, W
+    {  64, 16, false, 0xFFFF,   1.0f,   0.0,    VICTRON_DEST(pvPower),     VICTRON_NO_FLAG,                CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // Load current, 100 mA (9 bits)
+    {  80,  9, false, 0x1FF,    10.0f,  0.0,    VICTRON_DEST(loadCurrent), VICTRON_NO_FLAG,                CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+};
+VICTRON_LAYOUT_CHECK(SOLAR_CONTROLLER_LAYOUT, SOLAR_CONTROLLER_PAYLOAD_SIZE);
+
+// DC-DC converter (record type 0x04), 16 bytes - based on mp-se/victron-receiver
+static constexpr VictronField DCDC_CONVERTER_LAYOUT[] = {
+    {   0,  8, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(deviceState), VICTRON_NO_FLAG,              CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {   8,  8, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(chargerError), VICTRON_NO_FLAG,             CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // Input voltage, 10 mV
+    {  16, 16, false, 0xFFFF,   100.0f, 0.0,    VICTRON_DEST(inputVoltage), VICTRON_FLAG(hasInputVoltage), CHECK_VOLTAGE,     ACTION_NONE,     VICTRON_ALWAYS,   "DCDC input" },
+    // Output voltage, 10 mV (also shown as the main voltage)
+    {  32, 16, true,  0x7FFF,   100.0f, 0.0,    VICTRON_DEST(outputVoltage), VICTRON_FLAG(hasOutputVoltage), CHECK_VOLTAGE,   ACTION_SET_VOLTAGE, VICTRON_ALWAYS, "DCDC output" },
+    {  48, 32, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(offReason), VICTRON_NO_FLAG,                CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+};
+VICTRON_LAYOUT_CHECK(DCDC_CONVERTER_LAYOUT, DCDC_CONVERTER_PAYLOAD_SIZE);
+
+// Inverter (record type 0x03)
+static constexpr VictronField INVERTER_LAYOUT[] = {
+    {   0,  8, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(deviceState), VICTRON_NO_FLAG,              CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {   8, 16, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(alarmState), VICTRON_NO_FLAG,               CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // Battery voltage, 10 mV
+    {  24, 16, true,  0x7FFF,   100.0f, 0.0,    VICTRON_DEST(voltage),     VICTRON_FLAG(hasVoltage),       CHECK_VOLTAGE,     ACTION_NONE,     VICTRON_ALWAYS,   "Inverter" },
+    // AC apparent power, VA
+    {  40, 16, false, 0xFFFF,   1.0f,   0.0,    VICTRON_DEST(acOutPower),  VICTRON_FLAG(hasAcOut),         CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // AC voltage, 10 mV (15 bits)
+    {  56, 15, false, 0x7FFF,   100.0f, 0.0,    VICTRON_DEST(acOutVoltage), VICTRON_FLAG(hasAcOut),        CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // AC current, 100 mA (11 bits)
+    {  71, 11, false, 0x7FF,    10.0f,  0.0,    VICTRON_DEST(acOutCurrent), VICTRON_FLAG(hasAcOut),        CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+};
+VICTRON_LAYOUT_CHECK(INVERTER_LAYOUT, VICTRON_MAX_PAYLOAD);
+
+// SmartLithium battery (record type 0x05); the 16-bit error flags at bit 32 are not decoded
+static constexpr VictronField SMART_LITHIUM_LAYOUT[] = {
+    {   0, 32, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(bmsFlags),   VICTRON_NO_FLAG,               CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // Cells 1-7: 2.60 V + 10 mV steps (7 bits each)
+    {  48,  7, false, 0x7F,     100.0f, 2.60,   VICTRON_DEST(cellVoltage[0]), VICTRON_NO_FLAG,             CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {  55,  7, false, 0x7F,     100.0f, 2.60,   VICTRON_DEST(cellVoltage[1]), VICTRON_NO_FLAG,             CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {  62,  7, false, 0x7F,     100.0f, 2.60,   VICTRON_DEST(cellVoltage[2]), VICTRON_NO_FLAG,             CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {  69,  7, false, 0x7F,     100.0f, 2.60,   VICTRON_DEST(cellVoltage[3]), VICTRON_NO_FLAG,             CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {  76,  7, false, 0x7F,     100.0f, 2.60,   VICTRON_DEST(cellVoltage[4]), VICTRON_NO_FLAG,             CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {  83,  7, false, 0x7F,     100.0f, 2.60,   VICTRON_DEST(cellVoltage[5]), VICTRON_NO_FLAG,             CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {  90,  7, false, 0x7F,     100.0f, 2.60,   VICTRON_DEST(cellVoltage[6]), VICTRON_NO_FLAG,             CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // Battery voltage, 10 mV (12 bits)
+    {  97, 12, false, 0xFFF,    100.0f, 0.0,    VICTRON_DEST(voltage),     VICTRON_FLAG(hasVoltage),       CHECK_VOLTAGE,     ACTION_NONE,     VICTRON_ALWAYS,   "SmartLithium" },
+    { 109,  4, false, 0xF,      1.0f,   0.0,    VICTRON_DEST(balancerStatus), VICTRON_NO_FLAG,             CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // Battery temperature, -40 °C offset (7 bits)
+    { 113,  7, false, 0x7F,     1.0f,   -40.0,  VICTRON_DEST(temperature), VICTRON_FLAG(hasTemperature),   CHECK_TEMPERATURE, ACTION_NONE,     VICTRON_ALWAYS,   "SmartLithium" },
+};
+VICTRON_LAYOUT_CHECK(SMART_LITHIUM_LAYOUT, VICTRON_MAX_PAYLOAD);
+
+// AC charger (record type 0x08), up to three outputs
+static constexpr VictronField AC_CHARGER_LAYOUT[] = {
+    {   0,  8, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(deviceState), VICTRON_NO_FLAG,              CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {   8,  8, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(chargerError), VICTRON_NO_FLAG,             CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // Output 1: voltage 10 mV (13 bits), current 100 mA (11 bits)
+    {  16, 13, false, 0x1FFF,   100.0f, 0.0,    VICTRON_DEST(voltage),     VICTRON_FLAG(hasVoltage),       CHECK_VOLTAGE,     ACTION_NONE,     VICTRON_ALWAYS,   "AC Charger" },
+    {  29, 11, false, 0x7FF,    10.0f,  0.0,    VICTRON_DEST(current),     VICTRON_FLAG(hasCurrent),       CHECK_NONE,        ACTION_POWER,    VICTRON_ALWAYS,   nullptr },
+    // Outputs 2 and 3
+    {  40, 13, false, 0x1FFF,   100.0f, 0.0,    VICTRON_DEST(batteryVoltage2), VICTRON_NO_FLAG,            CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {  53, 11, false, 0x7FF,    10.0f,  0.0,    VICTRON_DEST(batteryCurrent2), VICTRON_NO_FLAG,            CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {  64, 13, false, 0x1FFF,   100.0f, 0.0,    VICTRON_DEST(batteryVoltage3), VICTRON_NO_FLAG,            CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {  77, 11, false, 0x7FF,    10.0f,  0.0,    VICTRON_DEST(batteryCurrent3), VICTRON_NO_FLAG,            CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // Temperature, -40 °C offset (7 bits); the AC input current that follows is not decoded
+    {  88,  7, false, 0x7F,     1.0f,   -40.0,  VICTRON_DEST(temperature), VICTRON_FLAG(hasTemperature),   CHECK_TEMPERATURE, ACTION_NONE,     VICTRON_ALWAYS,   "AC Charger" },
+};
+VICTRON_LAYOUT_CHECK(AC_CHARGER_LAYOUT, VICTRON_MAX_PAYLOAD);
+
+// DC energy meter (record type 0x0D) - SmartShunt layout with the meter type in place of time to go
+static constexpr VictronField DC_ENERGY_METER_LAYOUT[] = {
+    {  16, 16, true,  0x7FFF,   100.0f, 0.0,    VICTRON_DEST(voltage),     VICTRON_FLAG(hasVoltage),       CHECK_VOLTAGE,     ACTION_NONE,     VICTRON_ALWAYS,   "DC Energy Meter" },
+    {  32, 16, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(alarmState), VICTRON_NO_FLAG,               CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {  64,  2, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(auxMode),   VICTRON_NO_FLAG,                CHECK_NONE,        ACTION_SELECTOR, VICTRON_ALWAYS,   nullptr },
+    {  48, 16, true,  0x7FFF,   100.0f, 0.0,    VICTRON_DEST(auxVoltage),  VICTRON_NO_FLAG,                CHECK_NONE,        ACTION_NONE,     VICTRON_WHEN(0),  nullptr },
+    {  48, 16, false, 0xFFFF,   100.0f, 0.0,    VICTRON_DEST(midVoltage),  VICTRON_NO_FLAG,                CHECK_NONE,        ACTION_NONE,     VICTRON_WHEN(1),  nullptr },
+    {  48, 16, false, 0xFFFF,   100.0f, -273.15, VICTRON_DEST(temperature), VICTRON_FLAG(hasTemperature),  CHECK_TEMPERATURE, ACTION_NONE,     VICTRON_WHEN(2),  "DC Energy Meter" },
+    {  66, 22, true,  0x1FFFFF, 1000.0f, 0.0,   VICTRON_DEST(current),     VICTRON_FLAG(hasCurrent),       CHECK_NONE,        ACTION_POWER,    VICTRON_ALWAYS,   nullptr },
+};
+VICTRON_LAYOUT_CHECK(DC_ENERGY_METER_LAYOUT, VICTRON_MAX_PAYLOAD);
+
+// Orion XS DC-DC charger (record type 0x0F); input current (bit 64) has no VictronReading field
+static constexpr VictronField ORION_XS_LAYOUT[] = {
+    {   0,  8, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(deviceState), VICTRON_NO_FLAG,              CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    {   8,  8, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(chargerError), VICTRON_NO_FLAG,             CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+    // Output voltage 10 mV, output current 100 mA
+    {  16, 16, true,  0x7FFF,   100.0f, 0.0,    VICTRON_DEST(outputVoltage), VICTRON_FLAG(hasOutputVoltage), CHECK_VOLTAGE,   ACTION_SET_VOLTAGE, VICTRON_ALWAYS, "Orion XS output" },
+    {  32, 16, true,  0x7FFF,   10.0f,  0.0,    VICTRON_DEST(current),     VICTRON_FLAG(hasCurrent),       CHECK_NONE,        ACTION_POWER,    VICTRON_ALWAYS,   nullptr },
+    // Input voltage, 10 mV
+    {  48, 16, false, 0xFFFF,   100.0f, 0.0,    VICTRON_DEST(inputVoltage), VICTRON_FLAG(hasInputVoltage), CHECK_VOLTAGE,     ACTION_NONE,     VICTRON_ALWAYS,   "Orion XS input" },
+    {  80, 32, false, VICTRON_NA_NONE, 1.0f, 0.0, VICTRON_DEST(offReason), VICTRON_NO_FLAG,                CHECK_NONE,        ACTION_NONE,     VICTRON_ALWAYS,   nullptr },
+};
+VICTRON_LAYOUT_CHECK(ORION_XS_LAYOUT, VICTRON_MAX_PAYLOAD);
+
+#endif // VICTRON_PAYLOAD_LAYOUT_H
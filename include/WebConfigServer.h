@@ -8,6 +8,10 @@
 #include <LittleFS.h>
 #include <vector>
 
+// /api/devices/live is answered from the last document until a change event arrives
+// (VictronBLE::subscribeChanges); RSSI and lastUpdate make it refresh at least this often
+#define LIVE_DATA_MAX_AGE 5000  // ms
+
 // Structure to store device configuration
 struct DeviceConfig {
     String name;
@@ -40,6 +44,13 @@ private:
     bool serverStarted;
     bool filesystemMounted;
     
+    // Last /api/devices/live document (under the VictronBLE DeviceLock)
+    String liveDataJson;
+    unsigned long liveDataBuiltAt;
+    uint16_t liveDataDevices;
+    bool liveDataCached;
+    int liveDataSubscriber;    // Change events for the fields in the document
+    
     // Configuration persistence
     void saveWiFiConfig();
     void loadWiFiConfig();
@@ -47,6 +58,7 @@ private:
     void loadDeviceConfigs();
     void syncEncryptionKeys();  // Sync all encryption keys to VictronBLE instance
     void syncSingleEncryptionKey(const DeviceConfig& config);  // Sync a single encryption key
+    void syncDeviceAllowlist();  // Sync enabled device addresses to the BLE pre-filter
     
     // Request handlers
     void handleRoot(AsyncWebServerRequest *request);
@@ -55,6 +67,7 @@ private:
     void handleGetDevices(AsyncWebServerRequest *request);
     void handleGetLiveData(AsyncWebServerRequest *request);
     void handleGetDebugData(AsyncWebServerRequest *request);
+    void handleGetMetrics(AsyncWebServerRequest *request);
     void handleAddDevice(AsyncWebServerRequest *request);
     void handleUpdateDevice(AsyncWebServerRequest *request);
     void handleDeleteDevice(AsyncWebServerRequest *request);
@@ -69,6 +82,10 @@ private:
     void handleGetLCDConfig(AsyncWebServerRequest *request);
     void handleSetLCDConfig(AsyncWebServerRequest *request);
     void handleRestart(AsyncWebServerRequest *request);
+    void handleGetCapture(AsyncWebServerRequest *request);
+    void handleSetCapture(AsyncWebServerRequest *request);
+    void handleDownloadCapture(AsyncWebServerRequest *request);
+    void handleGetHistory(AsyncWebServerRequest *request);
     
     // Pointer to VictronBLE instance for live data
     class VictronBLE* victronBLE;
@@ -76,6 +93,15 @@ private:
     // Pointer to MQTTPublisher instance for MQTT config
     class MQTTPublisher* mqttPublisher;
     
+    // Advertisement capture recorder and replay engine (optional)
+    class AdvertisementCapture* capture;
+    class CaptureReplay* captureReplay;
+    
+    // Reading history for /api/history (optional)
+    class HistoryStore* history;
+    
+    friend class NativeBenchmark;
+    
 public:
     WebConfigServer();
     ~WebConfigServer();
@@ -90,6 +116,12 @@ public:
     // Set MQTTPublisher instance for MQTT config
     void setMQTTPublisher(class MQTTPublisher* mqtt);
     
+    // Set capture recorder and replay engine for /api/capture
+    void setCapture(class AdvertisementCapture* recorder, class CaptureReplay* replay);
+    
+    // Set history store for /api/history
+    void setHistory(class HistoryStore* store);
+    
     // Device configuration access
     std::vector<DeviceConfig>& getDeviceConfigs();
     DeviceConfig* getDeviceConfig(const String& address);
@@ -0,0 +1,555 @@
+// Host benchmark for the native environment (pio run -e native_bench -t exec).
+// Times the per-advertisement and per-request code paths and counts heap
+// allocations (operator new) per call. Results go to a CSV file so two
+// commits can be compared:
+//
+//   program [--out FILE] [--baseline FILE] [--quick]
+//
+// --out       results file (default bench_results.csv)
+// --baseline  earlier results file; prints the change per benchmark
+// --quick     shorter runs, for a smoke test
+//
+// Each benchmark is calibrated to run for ~TARGET_RUN_MS and repeated REPEATS
+// times; ns_per_call is the median run, ns_min the fastest.
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <new>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "VictronBLE.h"
+#include "MQTTPublisher.h"
+#include "WebConfigServer.h"
+#include "EcoWorthyBMS.h"
+
+// Heap allocation counter: every operator new form ends up here
+static uint64_t allocationCount = 0;
+static uint64_t allocationBytes = 0;
+
+void* operator new(size_t size) {
+    allocationCount++;
+    allocationBytes += size;
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        abort();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    allocationCount++;
+    allocationBytes += size;
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+static const uint32_t REPEATS = 5;
+static uint32_t TARGET_RUN_MS = 200;
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;      // Calls per run
+    double nsPerCall;         // Median of REPEATS runs
+    double nsMin;
+    double allocsPerCall;
+    double bytesPerCall;
+};
+
+static std::vector<BenchResult> results;
+
+// Keeps results observable so the optimizer cannot drop the measured work
+static volatile uint32_t sink;
+
+static double nowNs() {
+    return (double)esp_timer_get_time() * 1000.0;
+}
+
+template <typename Body>
+static void measure(const char* name, Body body) {
+    // Warm up caches, lazily built tables and first-time allocations
+    for (int i = 0; i < 100; i++) {
+        body();
+    }
+    
+    // Calibrate: double the batch until it runs for at least 1/10 of the target
+    uint64_t batch = 1;
+    double elapsed = 0;
+    for (;;) {
+        double start = nowNs();
+        for (uint64_t i = 0; i < batch; i++) {
+            body();
+        }
+        elapsed = nowNs() - start;
+        if (elapsed >= TARGET_RUN_MS * 100000.0 || batch >= (1ULL << 30)) {
+            break;
+        }
+        batch *= 2;
+    }
+    uint64_t iterations = (uint64_t)(batch * (TARGET_RUN_MS * 1e6 / (elapsed > 0 ? elapsed : 1)));
+    if (iterations < 1) {
+        iterations = 1;
+    }
+    
+    std::vector<double> runs;
+    uint64_t allocsBefore = allocationCount;
+    uint64_t bytesBefore = allocationBytes;
+    for (uint32_t r = 0; r < REPEATS; r++) {
+        double start = nowNs();
+        for (uint64_t i = 0; i < iterations; i++) {
+            body();
+        }
+        runs.push_back((nowNs() - start) / iterations);
+    }
+    uint64_t allocs = allocationCount - allocsBefore;
+    uint64_t bytes = allocationBytes - bytesBefore;
+    std::sort(runs.begin(), runs.end());
+    
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.nsPerCall = runs[runs.size() / 2];
+    result.nsMin = runs[0];
+    result.allocsPerCall = (double)allocs / (iterations * REPEATS);
+    result.bytesPerCall = (double)bytes / (iterations * REPEATS);
+    results.push_back(result);
+    
+    fprintf(stdout, "%-44s %12.1f ns %8.2f allocs %10.1f B\n", name, result.nsPerCall,
+            result.allocsPerCall, result.bytesPerCall);
+    fflush(stdout);
+}
+
+// Write value into a payload little-endian at a bit position (Victron record order)
+static void putBits(uint8_t* payload, int bitOffset, int bitWidth, uint32_t value) {
+    for (int i = 0; i < bitWidth; i++) {
+        int bit = bitOffset + i;
+        if (value & (1u << i)) {
+            payload[bit / 8] |= (uint8_t)(1u << (bit % 8));
+        } else {
+            payload[bit / 8] &= (uint8_t)~(1u << (bit % 8));
+        }
+    }
+}
+
+struct BenchField {
+    uint8_t bitOffset;
+    uint8_t bitWidth;
+    uint32_t value;
+};
+
+// One device type with a plausible record (fields not listed stay zero)
+struct BenchDevice {
+    const char* label;
+    const char* name;
+    VictronDeviceType type;
+    uint8_t readoutType;
+    uint16_t modelId;
+    size_t payloadBytes;
+    BenchField fields[6];
+};
+
+static const BenchDevice BENCH_DEVICES[] = {
+    { "smartshunt", "SmartShunt HQ2203", DEVICE_SMART_SHUNT, READOUT_BATTERY_MONITOR, 0xA389, SMART_SHUNT_PAYLOAD_SIZE,
+      { {0, 16, 480}, {16, 16, 1284}, {48, 16, 0x7FFF}, {66, 22, 0x3FF34E}, {88, 20, 125}, {108, 10, 875} } },
+    { "smartsolar", "SmartSolar HQ2104", DEVICE_SMART_SOLAR, READOUT_SOLAR_CHARGER, 0xA053, SOLAR_CONTROLLER_PAYLOAD_SIZE,
+      { {0, 8, 3}, {16, 16, 1352}, {32, 16, 87}, {48, 16, 142}, {64, 16, 118}, {80, 9, 0x1FF} } },
+    { "bluesmart", "Blue Smart IP22 Charger", DEVICE_BLUE_SMART_CHARGER, READOUT_SOLAR_CHARGER, 0xA330, SOLAR_CONTROLLER_PAYLOAD_SIZE,
+      { {0, 8, 4}, {16, 16, 1380}, {32, 16, 150}, {48, 16, 0xFFFF}, {64, 16, 0xFFFF}, {80, 9, 0x1FF} } },
+    { "inverter", "Phoenix Inverter", DEVICE_INVERTER, READOUT_INVERTER, 0xA231, 16,
+      { {0, 8, 9}, {24, 16, 1265}, {40, 16, 350}, {56, 15, 23000}, {71, 11, 15}, {0, 0, 0} } },
+    { "dcdc", "Orion Smart HQ2240", DEVICE_DCDC_CONVERTER, READOUT_DCDC_CONVERTER, 0xA3C0, DCDC_CONVERTER_PAYLOAD_SIZE,
+      { {0, 8, 3}, {16, 16, 1296}, {32, 16, 1410}, {48, 32, 0}, {0, 0, 0}, {0, 0, 0} } },
+    { "smartlithium", "SmartLithium 12.8V", DEVICE_SMART_LITHIUM, READOUT_SMART_LITHIUM, 0xA3E0, 16,
+      { {48, 7, 70}, {55, 7, 71}, {62, 7, 70}, {69, 7, 72}, {97, 12, 1334}, {113, 7, 62} } },
+    { "accharger", "Blue Smart IP65 Charger", DEVICE_AC_CHARGER, READOUT_AC_CHARGER, 0xA339, 16,
+      { {0, 8, 4}, {16, 13, 1380}, {29, 11, 72}, {40, 13, 0x1FFF}, {64, 13, 0x1FFF}, {88, 7, 65} } },
+    { "dcmeter", "SmartShunt Energy Meter", DEVICE_DC_ENERGY_METER, READOUT_DC_ENERGY_METER, 0xA3A5, 16,
+      { {16, 16, 1276}, {48, 16, 0x7FFF}, {64, 2, 0}, {66, 22, 2500}, {0, 0, 0}, {0, 0, 0} } },
+    { "orionxs", "Orion XS 12/12-50A", DEVICE_ORION_XS, READOUT_ORION_XS, 0xA3F0, 16,
+      { {0, 8, 3}, {16, 16, 1405}, {32, 16, 302}, {48, 16, 1288}, {80, 32, 0}, {0, 0, 0} } },
+    { "unknown_tlv", "Victron Device", DEVICE_UNKNOWN, 0x00, 0xA0FF, 16,
+      { {0, 8, 0x03}, {8, 8, 2}, {16, 16, 1270}, {32, 8, 0x06}, {40, 8, 2}, {48, 16, 8750} } },
+};
+
+static const char* BENCH_KEY = "0df4d0395b7d1a876c0c33ecb9e70dcd";
+
+// Manufacturer data for one device: 10-byte header and the encrypted payload
+static size_t buildManufacturerData(const BenchDevice& device, uint16_t counter, const VictronDeviceKey& key,
+                                    uint8_t* out) {
+    uint8_t payload[16];
+    memset(payload, 0, sizeof(payload));
+    for (size_t i = 0; i < sizeof(device.fields) / sizeof(device.fields[0]); i++) {
+        if (device.fields[i].bitWidth) {
+            putBits(payload, device.fields[i].bitOffset, device.fields[i].bitWidth, device.fields[i].value);
+        }
+    }
+    
+    out[0] = 0xe1;
+    out[1] = 0x02;
+    out[2] = 0x10;
+    out[3] = 0x00;
+    
+    uint8_t nonce[16] = {0};
+    nonce[0] = (uint8_t)(counter & 0xff);
+    nonce[1] = (uint8_t)(counter >> 8);
+    out[4] = (uint8_t)(device.modelId & 0xff);
+    out[5] = (uint8_t)(device.modelId >> 8);
+    out[6] = device.readoutType;
+    out[7] = nonce[0];
+    out[8] = nonce[1];
+    out[9] = key.bytes[0];
+    AesCtr::crypt(AES_BACKEND_SOFTWARE, key.aes, nonce, payload, &out[10], device.payloadBytes);
+    return 10 + device.payloadBytes;
+}
+
+// Full advertisement (flags, manufacturer data, complete local name)
+static void buildAdvertisement(const BenchDevice& device, const uint8_t* mac, uint16_t counter,
+                               const VictronDeviceKey& key, NimBLEAdvertisedDevice& advertisement) {
+    uint8_t data[MAX_ADVERTISEMENT_DATA];
+    size_t dataLength = buildManufacturerData(device, counter, key, data);
+    size_t nameLength = strlen(device.name);
+    
+    uint8_t payload[80];
+    size_t length = 0;
+    payload[length++] = 2;
+    payload[length++] = 0x01;
+    payload[length++] = 0x06;
+    payload[length++] = (uint8_t)(1 + dataLength);
+    payload[length++] = 0xff;
+    memcpy(&payload[length], data, dataLength);
+    length += dataLength;
+    payload[length++] = (uint8_t)(1 + nameLength);
+    payload[length++] = 0x09;
+    memcpy(&payload[length], device.name, nameLength);
+    length += nameLength;
+    
+    // NimBLE keeps addresses little-endian
+    uint8_t native[6];
+    for (int i = 0; i < 6; i++) {
+        native[i] = mac[5 - i];
+    }
+    advertisement.setAddress(NimBLEAddress(native));
+    advertisement.setRSSI(-70);
+    advertisement.setPayload(payload, length);
+}
+
+static String formatMac(const uint8_t* mac) {
+    char buffer[18];
+    snprintf(buffer, sizeof(buffer), "%02x:%02x:%02x:%02x:%02x:%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return String(buffer);
+}
+
+class NativeBenchmark {
+private:
+    static VictronDeviceKey makeKey() {
+        VictronDeviceKey key;
+        key.hex = BENCH_KEY;
+        for (int i = 0; i < 16; i++) {
+            unsigned int value;
+            sscanf(BENCH_KEY + i * 2, "%2x", &value);
+            key.bytes[i] = (uint8_t)value;
+        }
+        key.valid = AesCtr::setKey(key.aes, key.bytes);
+        return key;
+    }
+    
+    // A VictronBLE with count devices (mixed types, all with data) discovered through the ingest path
+    static VictronBLE* populate(int count) {
+        VictronBLE* victronBLE = new VictronBLE();
+        victronBLE->begin();
+        victronBLE->startScanning();
+        VictronDeviceKey key = makeKey();
+        NimBLEAdvertisedDevice advertisement;
+        NimBLEScan* scan = NimBLEDevice::getScan();
+        
+        for (int i = 0; i < count; i++) {
+            uint8_t mac[6] = {0xc0, 0x3b, 0x98, 0x00, (uint8_t)(i >> 8), (uint8_t)i};
+            victronBLE->setEncryptionKey(formatMac(mac), BENCH_KEY);
+            // SmartShunt, SmartSolar and DC-DC in turn, like a typical installation
+            const BenchDevice& device = BENCH_DEVICES[(i % 3 == 0) ? 0 : (i % 3 == 1 ? 1 : 4)];
+            buildAdvertisement(device, mac, (uint16_t)(i + 1), key, advertisement);
+            scan->nativeDeliver(&advertisement);
+            victronBLE->loop();
+        }
+        return victronBLE;
+    }
+
+public:
+    static void parseBenchmarks() {
+        VictronBLE victronBLE;
+        VictronDeviceKey key = makeKey();
+        
+        for (size_t d = 0; d < sizeof(BENCH_DEVICES) / sizeof(BENCH_DEVICES[0]); d++) {
+            const BenchDevice& bench = BENCH_DEVICES[d];
+            VictronDeviceData device;
+            device.type = bench.type;
+            device.address = "c0:3b:98:2a:11:01";
+            
+            uint8_t data[MAX_ADVERTISEMENT_DATA];
+            size_t length = buildManufacturerData(bench, 0x1234, key, data);
+            std::string name = std::string("parse/") + bench.label + "/encrypted";
+            
+            // A frame that fails to parse would only time the error path
+            VictronReading check;
+            if (!victronBLE.parseVictronAdvertisement(data, length, device, &key, check, nullptr)) {
+                fprintf(stderr, "%s: frame does not parse (%s)\n", name.c_str(), victronBLE.parseError);
+            }
+            measure(name.c_str(), [&]() {
+                VictronReading reading;
+                victronBLE.parseVictronAdvertisement(data, length, device, &key, reading, nullptr);
+                sink = (uint32_t)reading.dataValid;
+            });
+        }
+    }
+    
+    static void decryptBenchmarks() {
+        VictronBLE victronBLE;
+        VictronDeviceKey key = makeKey();
+        uint8_t data[MAX_ADVERTISEMENT_DATA];
+        size_t length = buildManufacturerData(BENCH_DEVICES[0], 0x1234, key, data);
+        uint8_t decrypted[MAX_ADVERTISEMENT_DATA];
+        
+        measure("decryptData/15B", [&]() {
+            victronBLE.decryptData(data, length, decrypted, key);
+            sink = decrypted[12];
+        });
+    }
+    
+    static void mergeBenchmarks() {
+        VictronBLE victronBLE;
+        VictronDeviceKey key = makeKey();
+        uint8_t data[MAX_ADVERTISEMENT_DATA];
+        size_t length = buildManufacturerData(BENCH_DEVICES[0], 0x1234, key, data);
+        VictronDeviceData device;
+        device.type = DEVICE_SMART_SHUNT;
+        VictronReading reading;
+        victronBLE.parseVictronAdvertisement(data, length, device, &key, reading, nullptr);
+        
+        victronBLE.setRetainLastData(true);
+        measure("mergeDeviceData/retain", [&]() {
+            victronBLE.mergeDeviceData(reading, device);
+            sink = (uint32_t)device.hasVoltage;
+        });
+        victronBLE.setRetainLastData(false);
+        measure("mergeDeviceData/replace", [&]() {
+            victronBLE.mergeDeviceData(reading, device);
+            sink = (uint32_t)device.hasVoltage;
+        });
+    }
+    
+    static void identifyBenchmarks() {
+        VictronBLE victronBLE;
+        const String names[] = {"SmartShunt HQ2203", "SmartSolar HQ2104", "Orion Smart HQ2240", "Phoenix Inverter"};
+        size_t next = 0;
+        
+        measure("identifyDeviceType/name", [&]() {
+            sink = (uint32_t)victronBLE.identifyDeviceType(names[next], 0);
+            next = (next + 1) & 3;
+        });
+        measure("classifyDevice/readout", [&]() {
+            sink = (uint32_t)victronBLE.classifyDevice(READOUT_BATTERY_MONITOR, 0xA389, names[next]);
+            next = (next + 1) & 3;
+        });
+    }
+    
+    static void ecoWorthyBenchmarks() {
+        EcoWorthyBMS bms;
+        
+        // A1: status record; A2: cell voltages and temperatures. CRC over everything before it.
+        uint8_t a1[1 + 60 + 2];
+        memset(a1, 0, sizeof(a1));
+        a1[0] = 0xA1;
+        uint8_t* body = &a1[1];
+        body[16] = 87;                  // Battery level %
+        body[18] = 100;                 // Health %
+        body[20] = 0x24; body[21] = 0x05;   // 13.16 V
+        body[22] = 0x2C; body[23] = 0x01;   // 3.00 A
+        body[26] = 0x10; body[27] = 0x27;   // 100 Ah
+        uint16_t crc = EcoWorthyBMS::calculateModbusCRC(a1, sizeof(a1) - 2);
+        a1[sizeof(a1) - 2] = (uint8_t)(crc & 0xff);
+        a1[sizeof(a1) - 1] = (uint8_t)(crc >> 8);
+        
+        uint8_t a2[1 + 90 + 2];
+        memset(a2, 0, sizeof(a2));
+        a2[0] = 0xA2;
+        body = &a2[1];
+        body[14] = 4;                   // Cells
+        for (int i = 0; i < 4; i++) {
+            uint16_t mv = (uint16_t)(3290 + i * 3);
+            body[16 + i * 2] = (uint8_t)(mv & 0xff);
+            body[17 + i * 2] = (uint8_t)(mv >> 8);
+        }
+        body[80] = 2;                   // Temperature sensors
+        body[82] = 215;                 // 21.5 °C
+        body[84] = 220;                 // 22.0 °C
+        crc = EcoWorthyBMS::calculateModbusCRC(a2, sizeof(a2) - 2);
+        a2[sizeof(a2) - 2] = (uint8_t)(crc & 0xff);
+        a2[sizeof(a2) - 1] = (uint8_t)(crc >> 8);
+        
+        measure("EcoWorthyBMS::parseResponse/A1", [&]() {
+            sink = (uint32_t)bms.parseResponse(a1, sizeof(a1));
+        });
+        measure("EcoWorthyBMS::parseResponse/A2", [&]() {
+            sink = (uint32_t)bms.parseResponse(a2, sizeof(a2));
+        });
+    }
+    
+    static void mqttBenchmarks() {
+        VictronBLE* victronBLE = populate(3);
+        {
+            // Unsubscribes from victronBLE's change bus when it goes out of scope
+            MQTTPublisher publisher;
+            publisher.begin(victronBLE);
+            MQTTConfig config;
+            config.broker = "localhost";
+            config.enabled = true;
+            publisher.setConfig(config);
+            publisher.connect();
+            
+            VictronDeviceTable& devices = victronBLE->getDevices();
+            const char* labels[] = {"publishDeviceData/smartshunt", "publishDeviceData/smartsolar", "publishDeviceData/dcdc"};
+            for (uint16_t slot = 0; slot < devices.size() && slot < 3; slot++) {
+                VictronDeviceData* device = &devices.at(slot);
+                measure(labels[slot], [&]() {
+                    publisher.publishDeviceData(device);
+                });
+            }
+            measure("publishDiscovery/smartshunt", [&]() {
+                publisher.publishDiscovery(&devices.at(0));
+            });
+        }
+        delete victronBLE;
+    }
+    
+    static void liveDataBenchmarks() {
+        const int counts[] = {1, 10, 100};
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+            if (counts[c] > VICTRON_MAX_DEVICES) {
+                fprintf(stderr, "skipping handleGetLiveData/%d: VICTRON_MAX_DEVICES is %d\n",
+                        counts[c], VICTRON_MAX_DEVICES);
+                continue;
+            }
+            VictronBLE* victronBLE = populate(counts[c]);
+            {
+                WebConfigServer webServer;
+                webServer.setVictronBLE(victronBLE);
+                
+                char name[48];
+                snprintf(name, sizeof(name), "handleGetLiveData/%d", counts[c]);
+                size_t responseBytes = 0;
+                measure(name, [&]() {
+                    AsyncWebServerRequest request(HTTP_GET, "/api/devices/live");
+                    webServer.liveDataCached = false;  // Time the document build, not the cached answer
+                    webServer.handleGetLiveData(&request);
+                    responseBytes = request.nativeResponseBody().length();
+                });
+                sink = (uint32_t)responseBytes;
+            }
+            delete victronBLE;
+        }
+    }
+};
+
+static bool writeResults(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "# ESP32-Victron host benchmark\n");
+    fprintf(file, "# compiler=%s\n", __VERSION__);
+    fprintf(file, "# victron_max_devices=%d\n", VICTRON_MAX_DEVICES);
+    fprintf(file, "# aes_backend=%s\n", AesCtr::backendName(AesCtr::getBackend()));
+    fprintf(file, "# repeats=%u target_run_ms=%u\n", REPEATS, TARGET_RUN_MS);
+    fprintf(file, "benchmark,iterations,ns_per_call,ns_min,allocs_per_call,bytes_per_call\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(file, "%s,%llu,%.1f,%.1f,%.3f,%.1f\n", r.name.c_str(), (unsigned long long)r.iterations,
+                r.nsPerCall, r.nsMin, r.allocsPerCall, r.bytesPerCall);
+    }
+    fclose(file);
+    return true;
+}
+
+// Print the change against an earlier results file (matched by benchmark name)
+static void compareBaseline(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "cannot read baseline %s\n", path);
+        return;
+    }
+    
+    printf("\n%-44s %12s %12s %8s %10s %10s\n", "benchmark", "base ns", "ns", "change", "base alloc", "alloc");
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || strncmp(line, "benchmark,", 10) == 0) {
+            continue;
+        }
+        char name[128];
+        unsigned long long iterations;
+        double ns, nsMin, allocs, bytes;
+        if (sscanf(line, "%127[^,],%llu,%lf,%lf,%lf,%lf", name, &iterations, &ns, &nsMin, &allocs, &bytes) != 6) {
+            continue;
+        }
+        for (size_t i = 0; i < results.size(); i++) {
+            if (results[i].name == name) {
+                double change = ns > 0 ? (results[i].nsPerCall - ns) * 100.0 / ns : 0;
+                printf("%-44s %12.1f %12.1f %+7.1f%% %10.2f %10.2f\n", name, ns, results[i].nsPerCall,
+                       change, allocs, results[i].allocsPerCall);
+            }
+        }
+    }
+    fclose(file);
+}
+
+int main(int argc, char** argv) {
+    const char* outPath = "bench_results.csv";
+    const char* baselinePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            TARGET_RUN_MS = 20;
+        } else {
+            fprintf(stderr, "usage: %s [--out FILE] [--baseline FILE] [--quick]\n", argv[0]);
+            return 2;
+        }
+    }
+    
+    // Per-packet log calls are LOG_D and compiled out at the default level; the
+    // remaining records queue in logRing, which nothing drains here
+    Serial.setQuiet(true);
+    
+    NativeBenchmark::parseBenchmarks();
+    NativeBenchmark::decryptBenchmarks();
+    NativeBenchmark::mergeBenchmarks();
+    NativeBenchmark::identifyBenchmarks();
+    NativeBenchmark::ecoWorthyBenchmarks();
+    NativeBenchmark::mqttBenchmarks();
+    NativeBenchmark::liveDataBenchmarks();
+    
+    if (!writeResults(outPath)) {
+        fprintf(stderr, "cannot write %s\n", outPath);
+        return 1;
+    }
+    printf("\n%u benchmarks written to %s\n", (unsigned)results.size(), outPath);
+    
+    if (baselinePath) {
+        compareBaseline(baselinePath);
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Host shim for the subset of the Arduino-ESP32 core used by the portable
+// sources (native environment only - never on the include path of the ESP32 build)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include "WString.h"
+#include "esp_timer.h"
+
+#define HEX 16
+#define DEC 10
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+// The host behaves like a board with PSRAM, so the history store gets its full budget
+inline bool psramFound() { return true; }
+inline void* ps_malloc(size_t size) { return malloc(size); }
+
+// Advance the simulated clock (millis/micros/esp_timer_get_time) without sleeping
+void nativeAdvanceTime(uint64_t us);
+
+// glibc only gained strlcpy in 2.38 (macOS and the BSDs always had it)
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+size_t strlcpy(char* dst, const char* src, size_t size);
+#endif
+
+class Print;
+
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    virtual int availableForWrite() { return 0; }
+    
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(unsigned int value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(unsigned long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(double value, int decimals = 2) { return print(String(value, (unsigned int)decimals)); }
+    size_t print(const Printable& value) { return value.printTo(*this); }
+    
+    template <typename T>
+    size_t println(const T& value) { size_t n = print(value); return n + println(); }
+    size_t println() { return print("\r\n"); }
+    
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+// Serial writes to stdout unless quiet (the benchmark silences it)
+class HardwareSerial : public Print {
+private:
+    bool quiet;
+
+public:
+    HardwareSerial() : quiet(false) {}
+    void begin(unsigned long) {}
+    int available() { return 0; }
+    int read() { return -1; }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int availableForWrite() override { return 4096; }   // stdout never makes the caller wait
+    void setQuiet(bool q) { quiet = q; }
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    void restart();
+    uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+    uint32_t getFreeHeap() { return 320 * 1024; }
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint32_t getCycleCount();   // Wall-clock time scaled to getCpuFreqMHz(), not the simulated clock
+};
+
+extern EspClass ESP;
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,35 @@
+#ifndef NATIVE_BASELINE_PARSERS_H
+#define NATIVE_BASELINE_PARSERS_H
+
+// The hand-written SmartShunt, solar charger and DC-DC parsers that the payload
+// layout tables replaced, kept for the native runner only: it decodes the same
+// payloads with both and expects identical readings and error text.
+// Copied as they were, except that they fill a VictronReading and an error buffer
+// instead of a VictronDeviceData, and do not print.
+
+#include <Arduino.h>
+#include "VictronBLE.h"
+
+class BaselineParsers {
+public:
+    char error[100];
+    
+    BaselineParsers() {
+        error[0] = '\0';
+    }
+    
+    void parseSmartShuntData(const uint8_t* output, size_t length, VictronReading& device);
+    void parseSolarControllerData(const uint8_t* output, size_t length, VictronReading& device);
+    void parseDCDCConverterData(const uint8_t* output, size_t length, VictronReading& device);
+
+private:
+    static int16_t extractSigned16(const uint8_t* data, int byteIndex);
+    static uint16_t extractUnsigned16(const uint8_t* data, int byteIndex);
+    static int32_t extractSigned22(const uint8_t* data, int startByte);
+    static uint32_t extractUnsigned20(const uint8_t* data, int startByte);
+    static uint16_t extractUnsigned10(const uint8_t* data, int startByte);
+    bool validateVoltage(float voltage, VictronReading& device);
+    bool validateTemperature(float temperature, VictronReading& device);
+};
+
+#endif // NATIVE_BASELINE_PARSERS_H
@@ -0,0 +1,121 @@
+#ifndef NATIVE_ESP_ASYNC_WEB_SERVER_H
+#define NATIVE_ESP_ASYNC_WEB_SERVER_H
+
+// Host shim for ESPAsyncWebServer. Routes are recorded by on(); a request is
+// built by the caller and dispatched synchronously with nativeHandle(), and
+// the response is kept on the request for inspection.
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <functional>
+#include <vector>
+
+typedef enum {
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebParameter {
+private:
+    String paramName;
+    String paramValue;
+    bool post;
+
+public:
+    AsyncWebParameter(const String& name, const String& value, bool isPost)
+        : paramName(name), paramValue(value), post(isPost) {}
+    const String& name() const { return paramName; }
+    const String& value() const { return paramValue; }
+    bool isPost() const { return post; }
+};
+
+class AsyncWebServerRequest {
+private:
+    WebRequestMethodComposite requestMethod;
+    String requestUrl;
+    std::vector<AsyncWebParameter> parameters;
+    int responseCode;
+    String responseType;
+    String responseBody;
+
+public:
+    AsyncWebServerRequest(WebRequestMethodComposite method, const String& url)
+        : requestMethod(method), requestUrl(url), responseCode(0) {}
+    
+    WebRequestMethodComposite method() const { return requestMethod; }
+    const String& url() const { return requestUrl; }
+    
+    void addParam(const String& name, const String& value, bool isPost = false) {
+        parameters.push_back(AsyncWebParameter(name, value, isPost));
+    }
+    size_t params() const { return parameters.size(); }
+    bool hasParam(const String& name, bool post = false, bool file = false) const;
+    AsyncWebParameter* getParam(const String& name, bool post = false, bool file = false);
+    
+    void send(int code, const String& contentType = String(), const String& content = String()) {
+        responseCode = code;
+        responseType = contentType;
+        responseBody = content;
+    }
+    void send(fs::FS& fs, const String& path, const String& contentType = String(), bool download = false);
+    
+    // Host-only: the response produced by the handler
+    int nativeResponseCode() const { return responseCode; }
+    const String& nativeResponseType() const { return responseType; }
+    const String& nativeResponseBody() const { return responseBody; }
+};
+
+typedef std::function<void(AsyncWebServerRequest* request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest* request, const String& filename, size_t index,
+                           uint8_t* data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                           size_t index, size_t total)> ArBodyHandlerFunction;
+
+class AsyncWebServer {
+private:
+    struct Route {
+        String uri;
+        WebRequestMethodComposite method;
+        ArRequestHandlerFunction handler;
+    };
+    
+    uint16_t serverPort;
+    bool started;
+    std::vector<Route> routes;
+
+public:
+    AsyncWebServer(uint16_t port) : serverPort(port), started(false) {}
+    ~AsyncWebServer();
+    
+    void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest) {
+        Route route;
+        route.uri = uri;
+        route.method = method;
+        route.handler = onRequest;
+        routes.push_back(route);
+    }
+    void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+            ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody = nullptr) {
+        (void)onUpload;
+        (void)onBody;
+        on(uri, method, onRequest);
+    }
+    void begin();
+    void end() { started = false; }
+    
+    // Host-only: dispatch to the first matching route the way AsyncCallbackWebHandler
+    // matches (exact URI or a sub-path of it). Returns false if nothing matched (404).
+    bool nativeHandle(AsyncWebServerRequest* request);
+    // Most recently started server, so a runner can reach servers owned by other classes
+    static AsyncWebServer* nativeLastStarted();
+};
+
+#endif // NATIVE_ESP_ASYNC_WEB_SERVER_H
@@ -0,0 +1,91 @@
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+// Host shim for the Arduino FS API backed by an in-memory file tree.
+// Directories are implied by file paths; the size budget is fixed so code
+// that checks totalBytes()/usedBytes() sees a realistic partition.
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs {
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class FS;
+
+class File : public Print {
+private:
+    friend class FS;
+    FS* owner;
+    std::string filePath;
+    std::shared_ptr<std::vector<uint8_t> > data;
+    size_t pos;
+    bool writable;
+    bool directory;
+    std::vector<std::string> entries;   // Directory listing
+    size_t nextEntry;
+
+public:
+    File() : owner(nullptr), pos(0), writable(false), directory(false), nextEntry(0) {}
+    
+    operator bool() const { return owner != nullptr; }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() { return data && pos < data->size() ? (int)(data->size() - pos) : 0; }
+    int read();
+    size_t read(uint8_t* buffer, size_t size);
+    int peek() { return available() ? (*data)[pos] : -1; }
+    bool seek(uint32_t offset, SeekMode mode = SeekSet);
+    size_t position() const { return pos; }
+    size_t size() const { return data ? data->size() : 0; }
+    void flush() {}
+    void close();
+    const char* path() const { return filePath.c_str(); }
+    const char* name() const;
+    bool isDirectory() const { return directory; }
+    File openNextFile(const char* mode = "r");
+};
+
+class FS {
+private:
+    friend class File;
+    std::map<std::string, std::shared_ptr<std::vector<uint8_t> > > files;
+    size_t capacity;
+    bool mounted;
+
+public:
+    FS(size_t capacityBytes) : capacity(capacityBytes), mounted(false) {}
+    
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char* partitionLabel = "spiffs");
+    void end() { mounted = false; }
+    bool format() { files.clear(); return true; }
+    File open(const char* path, const char* mode = "r", bool create = false);
+    File open(const String& path, const char* mode = "r", bool create = false) { return open(path.c_str(), mode, create); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char*) { return true; }
+    bool mkdir(const String&) { return true; }
+    bool rmdir(const char*) { return true; }
+    size_t totalBytes() const { return capacity; }
+    size_t usedBytes() const;
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+
+#endif // NATIVE_FS_H
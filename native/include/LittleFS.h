@@ -0,0 +1,16 @@
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+// Host shim for LittleFS: an in-memory fs::FS (see FS.h) with the size of the
+// M5StickC Plus2 filesystem partition
+
+#include "FS.h"
+
+class LittleFSFS : public fs::FS {
+public:
+    LittleFSFS() : fs::FS(1536 * 1024) {}
+};
+
+extern LittleFSFS LittleFS;
+
+#endif // NATIVE_LITTLEFS_H
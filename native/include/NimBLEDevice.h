@@ -0,0 +1,161 @@
+#ifndef NATIVE_NIMBLE_DEVICE_H
+#define NATIVE_NIMBLE_DEVICE_H
+
+// Host shim for the NimBLE-Arduino 1.4 API used by VictronBLE and EcoWorthyBMS.
+// There is no radio: advertisements are built by the caller (setAddress,
+// setRSSI, setPayload) and handed to the scan callbacks with
+// NimBLEScan::nativeDeliver(). GATT clients never connect.
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+class NimBLEAddress {
+private:
+    uint8_t m_address[6];   // Little-endian, as NimBLE stores it
+
+public:
+    NimBLEAddress() { memset(m_address, 0, sizeof(m_address)); }
+    NimBLEAddress(const uint8_t address[6]) { memcpy(m_address, address, sizeof(m_address)); }
+    NimBLEAddress(const std::string& address);   // "aa:bb:cc:dd:ee:ff"
+    
+    const uint8_t* getNative() const { return m_address; }
+    std::string toString() const;
+    bool operator==(const NimBLEAddress& other) const { return memcmp(m_address, other.m_address, 6) == 0; }
+};
+
+class NimBLEUUID {
+private:
+    uint8_t m_uuid[16];     // 128-bit form, little-endian as in advertisements
+    bool m_valid;
+
+public:
+    NimBLEUUID(const std::string& uuid);
+    NimBLEUUID(uint16_t uuid16);
+    
+    const uint8_t* getNative() const { return m_uuid; }
+    bool isValid() const { return m_valid; }
+    // 16-bit alias when the UUID is built on the Bluetooth base UUID, else 0
+    uint16_t getShort() const;
+};
+
+class NimBLEAdvertisedDevice {
+private:
+    NimBLEAddress m_address;
+    int m_rssi;
+    std::vector<uint8_t> m_payload;
+    
+    // First AD structure of the given type, or nullptr
+    const uint8_t* findField(uint8_t type, size_t* length) const;
+
+public:
+    NimBLEAdvertisedDevice() : m_rssi(0) {}
+    
+    NimBLEAddress getAddress() { return m_address; }
+    int getRSSI() { return m_rssi; }
+    bool haveName();
+    std::string getName();
+    bool haveManufacturerData();
+    std::string getManufacturerData();
+    bool isAdvertisingService(const NimBLEUUID& uuid);
+    uint8_t* getPayload() { return m_payload.empty() ? nullptr : &m_payload[0]; }
+    size_t getPayloadLength() { return m_payload.size(); }
+    
+    // Host-only setters used to build advertisements
+    void setAddress(const NimBLEAddress& address) { m_address = address; }
+    void setRSSI(int rssi) { m_rssi = rssi; }
+    void setPayload(const uint8_t* payload, size_t length) { m_payload.assign(payload, payload + length); }
+};
+
+class NimBLEAdvertisedDeviceCallbacks {
+public:
+    virtual ~NimBLEAdvertisedDeviceCallbacks() {}
+    virtual void onResult(NimBLEAdvertisedDevice* advertisedDevice) = 0;
+};
+
+class NimBLEScanResults {};
+
+class NimBLEScan {
+private:
+    NimBLEAdvertisedDeviceCallbacks* m_callbacks;
+    bool m_activeScan;
+    bool m_scanning;
+    uint16_t m_interval;
+    uint16_t m_window;
+
+public:
+    NimBLEScan() : m_callbacks(nullptr), m_activeScan(false), m_scanning(false), m_interval(100), m_window(100) {}
+    
+    void setAdvertisedDeviceCallbacks(NimBLEAdvertisedDeviceCallbacks* callbacks, bool wantDuplicates = false) {
+        (void)wantDuplicates;
+        m_callbacks = callbacks;
+    }
+    void setActiveScan(bool active) { m_activeScan = active; }
+    void setInterval(uint16_t intervalMs) { m_interval = intervalMs; }
+    void setWindow(uint16_t windowMs) { m_window = windowMs; }
+    void setDuplicateFilter(bool) {}
+    void setMaxResults(uint8_t) {}
+    bool start(uint32_t duration, void (*scanEnded)(NimBLEScanResults), bool isContinue = false) {
+        (void)duration;
+        (void)scanEnded;
+        (void)isContinue;
+        m_scanning = true;
+        return true;
+    }
+    bool stop() { m_scanning = false; return true; }
+    bool isScanning() { return m_scanning; }
+    void clearResults() {}
+    
+    bool getActiveScan() const { return m_activeScan; }
+    uint16_t getInterval() const { return m_interval; }
+    uint16_t getWindow() const { return m_window; }
+    
+    // Host-only: report an advertisement as the NimBLE host task would.
+    // Dropped while the scan is stopped.
+    bool nativeDeliver(NimBLEAdvertisedDevice* device) {
+        if (!m_scanning || !m_callbacks) {
+            return false;
+        }
+        m_callbacks->onResult(device);
+        return true;
+    }
+};
+
+class NimBLERemoteCharacteristic;
+typedef std::function<void(NimBLERemoteCharacteristic*, uint8_t*, size_t, bool)> notify_callback;
+
+class NimBLERemoteCharacteristic {
+public:
+    bool canNotify() { return false; }
+    bool subscribe(bool notifications = true, notify_callback callback = nullptr, bool response = false) {
+        (void)notifications;
+        (void)callback;
+        (void)response;
+        return false;
+    }
+    bool writeValue(const uint8_t*, size_t, bool = false) { return false; }
+};
+
+class NimBLERemoteService {
+public:
+    NimBLERemoteCharacteristic* getCharacteristic(const char*) { return nullptr; }
+};
+
+class NimBLEClient {
+public:
+    bool connect(const NimBLEAddress&, bool deleteAttributes = true) { (void)deleteAttributes; return false; }
+    int disconnect() { return 0; }
+    bool isConnected() { return false; }
+    NimBLERemoteService* getService(const char*) { return nullptr; }
+};
+
+class NimBLEDevice {
+public:
+    static void init(const std::string& deviceName) { (void)deviceName; }
+    static NimBLEScan* getScan();
+    static NimBLEClient* createClient() { return new NimBLEClient(); }
+    static bool deleteClient(NimBLEClient* client) { delete client; return true; }
+};
+
+#endif // NATIVE_NIMBLE_DEVICE_H
@@ -0,0 +1,48 @@
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+// Host shim for the ESP32 Preferences (NVS) API. Values live in a
+// process-wide in-memory store, so they survive end()/begin() and separate
+// Preferences instances, but not a restart of the process.
+
+#include <Arduino.h>
+
+class Preferences {
+private:
+    String ns;
+    bool opened;
+    bool readOnly;
+    
+    bool putRaw(const char* key, const void* value, size_t length);
+    size_t getRaw(const char* key, void* value, size_t length) const;
+
+public:
+    Preferences() : opened(false), readOnly(false) {}
+    
+    bool begin(const char* name, bool readOnly = false);
+    void end();
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key) const;
+    
+    size_t putBool(const char* key, bool value) { return putRaw(key, &value, sizeof(value)) ? sizeof(value) : 0; }
+    size_t putInt(const char* key, int32_t value) { return putRaw(key, &value, sizeof(value)) ? sizeof(value) : 0; }
+    size_t putUInt(const char* key, uint32_t value) { return putRaw(key, &value, sizeof(value)) ? sizeof(value) : 0; }
+    size_t putUShort(const char* key, uint16_t value) { return putRaw(key, &value, sizeof(value)) ? sizeof(value) : 0; }
+    size_t putUChar(const char* key, uint8_t value) { return putRaw(key, &value, sizeof(value)) ? sizeof(value) : 0; }
+    size_t putFloat(const char* key, float value) { return putRaw(key, &value, sizeof(value)) ? sizeof(value) : 0; }
+    size_t putString(const char* key, const String& value) { return putRaw(key, value.c_str(), value.length()) ? value.length() : 0; }
+    size_t putBytes(const char* key, const void* value, size_t length) { return putRaw(key, value, length) ? length : 0; }
+    
+    bool getBool(const char* key, bool defaultValue = false) const { bool v = defaultValue; getRaw(key, &v, sizeof(v)); return v; }
+    int32_t getInt(const char* key, int32_t defaultValue = 0) const { int32_t v = defaultValue; getRaw(key, &v, sizeof(v)); return v; }
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) const { uint32_t v = defaultValue; getRaw(key, &v, sizeof(v)); return v; }
+    uint16_t getUShort(const char* key, uint16_t defaultValue = 0) const { uint16_t v = defaultValue; getRaw(key, &v, sizeof(v)); return v; }
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0) const { uint8_t v = defaultValue; getRaw(key, &v, sizeof(v)); return v; }
+    float getFloat(const char* key, float defaultValue = 0) const { float v = defaultValue; getRaw(key, &v, sizeof(v)); return v; }
+    String getString(const char* key, const String& defaultValue = String()) const;
+    size_t getBytesLength(const char* key) const;
+    size_t getBytes(const char* key, void* buffer, size_t length) const { return getRaw(key, buffer, length); }
+};
+
+#endif // NATIVE_PREFERENCES_H
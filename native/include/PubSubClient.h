@@ -0,0 +1,80 @@
+#ifndef NATIVE_PUBSUBCLIENT_H
+#define NATIVE_PUBSUBCLIENT_H
+
+// Host shim for PubSubClient. connect() always succeeds and publish() hands
+// each message to an optional process-wide sink instead of a broker, so payload
+// formatting can be checked and timed without a network. A simulated outage makes
+// connect() block in real time and fail, like a TCP connect to a dead broker.
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define MQTT_CONNECTED 0
+#define MQTT_DISCONNECTED -1
+
+class PubSubClient {
+public:
+    typedef void (*PublishSink)(const char* topic, const char* payload, bool retained, void* context);
+
+private:
+    struct Sink {
+        PublishSink callback;
+        void* context;
+    };
+    static Sink& sink() {
+        static Sink instance = {nullptr, nullptr};
+        return instance;
+    }
+    static std::atomic<uint32_t>& outageMs() {
+        static std::atomic<uint32_t> instance(0);
+        return instance;
+    }
+    bool attempt() {
+        uint32_t blockMs = outageMs().load();
+        if (blockMs > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(blockMs));
+        }
+        isConnected = blockMs == 0;
+        return isConnected;
+    }
+    
+    bool isConnected;
+
+public:
+    PubSubClient(WiFiClient&) : isConnected(false) {}
+    
+    PubSubClient& setServer(const char*, uint16_t) { return *this; }
+    bool setBufferSize(uint16_t) { return true; }
+    bool connect(const char*) { return attempt(); }
+    bool connect(const char*, const char*, const char*) { return attempt(); }
+    bool connected() { return isConnected; }
+    void disconnect() { isConnected = false; }
+    bool loop() { return isConnected; }
+    int state() { return isConnected ? MQTT_CONNECTED : MQTT_DISCONNECTED; }
+    
+    bool publish(const char* topic, const char* payload, bool retained = false) {
+        if (!isConnected) {
+            return false;
+        }
+        if (sink().callback) {
+            sink().callback(topic, payload, retained, sink().context);
+        }
+        return true;
+    }
+    
+    // Host-only: observe messages published by every client (nullptr to stop)
+    static void nativeSetSink(PublishSink callback, void* context) {
+        sink().callback = callback;
+        sink().context = context;
+    }
+    
+    // Host-only: every connect() blocks for blockMs and fails (0 ends the outage)
+    static void nativeSetOutage(uint32_t blockMs) {
+        outageMs().store(blockMs);
+    }
+};
+
+#endif // NATIVE_PUBSUBCLIENT_H
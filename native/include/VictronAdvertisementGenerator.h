@@ -0,0 +1,102 @@
+#ifndef NATIVE_VICTRON_ADVERTISEMENT_GENERATOR_H
+#define NATIVE_VICTRON_ADVERTISEMENT_GENERATOR_H
+
+// Synthetic Victron advertisements for host load tests (native environments only).
+// Produces SmartShunt, SmartSolar and DC-DC frames in the layouts VictronBLE
+// decodes, encrypted with AES-128-CTR through the esp_aes shim (independent of
+// AesCtr, so a symmetric bug in the parser's decryption would still show up).
+// Devices advertise on a simulated clock; frames can be lost or corrupted.
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <queue>
+#include <vector>
+
+enum GeneratedDeviceKind {
+    GENERATED_SMART_SHUNT = 0,
+    GENERATED_SMART_SOLAR = 1,
+    GENERATED_DCDC = 2
+};
+
+struct GeneratorConfig {
+    int deviceCount;
+    float rateHz;            // Advertisements per second per device
+    float lossRatio;         // Advertisements never delivered (0-1)
+    float corruptRatio;      // Delivered advertisements with a damaged frame (0-1)
+    int repeat;              // Advertisements per frame before the counter (and data) changes
+    uint16_t counterStart;   // First nonce counter; wraps at 0xFFFF like the devices do
+    uint32_t seed;           // Same seed, same devices, keys and traffic
+    String keyHex;           // 32 hex characters for every device; empty = a random key per device
+    
+    GeneratorConfig()
+        : deviceCount(10), rateHz(2.0f), lossRatio(0.0f), corruptRatio(0.0f), repeat(1),
+          counterStart(1), seed(1), keyHex("") {}
+};
+
+struct GeneratedDevice {
+    String address;          // aa:bb:cc:dd:ee:ff
+    String name;
+    String keyHex;
+    GeneratedDeviceKind kind;
+    uint8_t mac[6];          // Most significant byte first
+    uint8_t key[16];
+    uint16_t counter;
+    int framesLeft;          // Advertisements left before the next frame
+    int64_t nextDueUs;
+    
+    // Current values, random-walked between frames
+    int32_t voltage10mV;
+    int32_t current;         // mA (SmartShunt), 0.1 A (SmartSolar)
+    int32_t secondary;       // SOC 0.1 % (SmartShunt), PV W (SmartSolar), output 10 mV (DC-DC)
+    uint8_t payload[16];
+    size_t payloadLength;
+};
+
+struct GeneratorStats {
+    uint32_t generated;      // Advertisements due, delivered or not
+    uint32_t lost;
+    uint32_t corrupted;
+    uint32_t frames;         // Distinct frames (counter changes)
+};
+
+class VictronAdvertisementGenerator {
+private:
+    struct Due {
+        int64_t timeUs;
+        int device;
+        bool operator>(const Due& other) const {
+            return timeUs > other.timeUs || (timeUs == other.timeUs && device > other.device);
+        }
+    };
+    
+    GeneratorConfig config;
+    std::vector<GeneratedDevice> devices;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due> > schedule;
+    uint32_t randomState;
+    int64_t intervalUs;
+    GeneratorStats stats;
+    
+    uint32_t random();
+    float randomUnit();
+    int32_t walk(int32_t value, int32_t step, int32_t low, int32_t high);
+    void nextFrame(GeneratedDevice& device);
+    void buildPayload(GeneratedDevice& device);
+    size_t buildManufacturerData(const GeneratedDevice& device, uint8_t* out);
+    void corrupt(uint8_t* data, size_t& length);
+
+public:
+    VictronAdvertisementGenerator();
+    
+    // Creates the devices; the first advertisement of each is spread over one interval from startUs
+    void begin(const GeneratorConfig& generatorConfig, int64_t startUs = 0);
+    
+    // The next advertisement due at or before untilUs (simulated µs). Lost advertisements
+    // are skipped and counted. Returns false when nothing more is due.
+    bool next(int64_t untilUs, NimBLEAdvertisedDevice& advertisement);
+    
+    const std::vector<GeneratedDevice>& getDevices() const { return devices; }
+    const GeneratorConfig& getConfig() const { return config; }
+    GeneratorStats getStats() const { return stats; }
+};
+
+#endif // NATIVE_VICTRON_ADVERTISEMENT_GENERATOR_H
@@ -0,0 +1,147 @@
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+// Host shim for the Arduino String class, backed by std::string.
+// Covers the members the portable sources use; semantics follow Arduino
+// (e.g. replace/toLowerCase modify in place, numeric constructors are explicit).
+
+#include <string>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+class String {
+private:
+    std::string text;
+    
+    void fromSigned(long long value, unsigned char base) {
+        if (value < 0 && base == 10) {
+            text = "-";
+            appendUnsigned(0ULL - (unsigned long long)value, base);
+        } else {
+            text.clear();
+            appendUnsigned((unsigned long long)value, base);
+        }
+    }
+    void fromUnsigned(unsigned long long value, unsigned char base) {
+        text.clear();
+        appendUnsigned(value, base);
+    }
+    void appendUnsigned(unsigned long long value, unsigned char base) {
+        char buffer[66];
+        int pos = sizeof(buffer) - 1;
+        buffer[pos] = '\0';
+        do {
+            int digit = (int)(value % base);
+            buffer[--pos] = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+            value /= base;
+        } while (value);
+        text += &buffer[pos];
+    }
+    void fromDouble(double value, unsigned int decimals) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+        text = buffer;
+    }
+
+public:
+    String() {}
+    String(const char* s) : text(s ? s : "") {}
+    String(const String& other) = default;
+    String(String&& other) = default;
+    String& operator=(const String& other) = default;
+    String& operator=(String&& other) = default;
+    String& operator=(const char* s) { text = s ? s : ""; return *this; }
+    
+    explicit String(char c) : text(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10) { fromUnsigned(value, base); }
+    explicit String(int value, unsigned char base = 10) { fromSigned(value, base); }
+    explicit String(unsigned int value, unsigned char base = 10) { fromUnsigned(value, base); }
+    explicit String(long value, unsigned char base = 10) { fromSigned(value, base); }
+    explicit String(unsigned long value, unsigned char base = 10) { fromUnsigned(value, base); }
+    explicit String(long long value, unsigned char base = 10) { fromSigned(value, base); }
+    explicit String(unsigned long long value, unsigned char base = 10) { fromUnsigned(value, base); }
+    explicit String(float value, unsigned int decimals = 2) { fromDouble(value, decimals); }
+    explicit String(double value, unsigned int decimals = 2) { fromDouble(value, decimals); }
+    
+    const char* c_str() const { return text.c_str(); }
+    unsigned int length() const { return (unsigned int)text.length(); }
+    bool isEmpty() const { return text.empty(); }
+    bool reserve(unsigned int size) { text.reserve(size); return true; }
+    
+    char charAt(unsigned int i) const { return i < text.size() ? text[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+    char& operator[](unsigned int i) { return text[i]; }
+    
+    String& operator+=(const String& other) { text += other.text; return *this; }
+    String& operator+=(const char* other) { text += other; return *this; }
+    String& operator+=(char c) { text += c; return *this; }
+    bool concat(const String& other) { text += other.text; return true; }
+    bool concat(const char* other) { text += other; return true; }
+    bool concat(char c) { text += c; return true; }
+    
+    bool operator==(const String& other) const { return text == other.text; }
+    bool operator==(const char* other) const { return text == other; }
+    bool operator!=(const String& other) const { return text != other.text; }
+    bool operator!=(const char* other) const { return text != other; }
+    bool operator<(const String& other) const { return text < other.text; }
+    bool equals(const String& other) const { return text == other.text; }
+    bool equalsIgnoreCase(const String& other) const { return strcasecmp(c_str(), other.c_str()) == 0; }
+    bool startsWith(const String& prefix) const { return text.compare(0, prefix.text.size(), prefix.text) == 0; }
+    bool endsWith(const String& suffix) const {
+        return text.size() >= suffix.text.size() &&
+               text.compare(text.size() - suffix.text.size(), suffix.text.size(), suffix.text) == 0;
+    }
+    
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t pos = text.find(c, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    int indexOf(const String& target, unsigned int from = 0) const {
+        size_t pos = text.find(target.text, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    int lastIndexOf(char c) const {
+        size_t pos = text.rfind(c);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    String substring(unsigned int from) const {
+        return from >= text.size() ? String() : String(text.substr(from).c_str());
+    }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) {
+            std::swap(from, to);
+        }
+        return from >= text.size() ? String() : String(text.substr(from, to - from).c_str());
+    }
+    
+    void toLowerCase() { for (size_t i = 0; i < text.size(); i++) text[i] = (char)tolower((unsigned char)text[i]); }
+    void toUpperCase() { for (size_t i = 0; i < text.size(); i++) text[i] = (char)toupper((unsigned char)text[i]); }
+    void replace(const String& find, const String& replacement) {
+        if (find.text.empty()) {
+            return;
+        }
+        size_t pos = 0;
+        while ((pos = text.find(find.text, pos)) != std::string::npos) {
+            text.replace(pos, find.text.size(), replacement.text);
+            pos += replacement.text.size();
+        }
+    }
+    void trim() {
+        size_t first = text.find_first_not_of(" \t\r\n");
+        size_t last = text.find_last_not_of(" \t\r\n");
+        text = first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+    }
+    
+    long toInt() const { return atol(c_str()); }
+    float toFloat() const { return (float)atof(c_str()); }
+    
+    friend String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+    friend String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+    friend String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+    friend String operator+(const String& a, char b) { String r(a); r += b; return r; }
+};
+
+#endif // NATIVE_WSTRING_H
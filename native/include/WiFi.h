@@ -0,0 +1,70 @@
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+// Host shim for the Arduino-ESP32 WiFi API. The host network is always
+// "up": station mode connects immediately and both addresses are loopback.
+
+#include <Arduino.h>
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+class IPAddress : public Printable {
+private:
+    uint8_t octets[4];
+
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) {
+        octets[0] = a;
+        octets[1] = b;
+        octets[2] = c;
+        octets[3] = d;
+    }
+    String toString() const {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+        return String(buffer);
+    }
+    size_t printTo(Print& p) const override { return p.print(toString()); }
+};
+
+class WiFiClient {};
+
+class WiFiClass {
+private:
+    wifi_mode_t currentMode;
+    wl_status_t currentStatus;
+
+public:
+    WiFiClass() : currentMode(WIFI_OFF), currentStatus(WL_DISCONNECTED) {}
+    
+    void persistent(bool) {}
+    bool mode(wifi_mode_t m) { currentMode = m; return true; }
+    wifi_mode_t getMode() const { return currentMode; }
+    bool softAP(const char*, const char* = nullptr) { return true; }
+    IPAddress softAPIP() const { return IPAddress(127, 0, 0, 1); }
+    IPAddress localIP() const { return IPAddress(127, 0, 0, 1); }
+    wl_status_t begin(const char*, const char* = nullptr) { currentStatus = WL_CONNECTED; return currentStatus; }
+    bool disconnect(bool = false) { currentStatus = WL_DISCONNECTED; return true; }
+    bool setAutoReconnect(bool) { return true; }
+    wl_status_t status() const { return currentStatus; }
+    int8_t RSSI() const { return -50; }
+};
+
+extern WiFiClass WiFi;
+
+#endif // NATIVE_WIFI_H
@@ -0,0 +1,26 @@
+#ifndef NATIVE_ESP_AES_H
+#define NATIVE_ESP_AES_H
+
+// Host shim for the ESP32 AES accelerator API (aes/esp_aes.h).
+// A plain byte-oriented AES so the hardware backend of AesCtr runs on the
+// host and is cross-checked against the table-based software backend.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ESP_AES_ENCRYPT 1
+#define ESP_AES_DECRYPT 0
+
+typedef struct {
+    uint8_t key_bytes;
+    uint8_t key[32];
+} esp_aes_context;
+
+void esp_aes_init(esp_aes_context* ctx);
+void esp_aes_free(esp_aes_context* ctx);
+int esp_aes_setkey(esp_aes_context* ctx, const unsigned char* key, unsigned int keybits);
+int esp_aes_crypt_ecb(esp_aes_context* ctx, int mode, const unsigned char input[16], unsigned char output[16]);
+int esp_aes_crypt_ctr(esp_aes_context* ctx, size_t length, size_t* nc_off, unsigned char nonce_counter[16],
+                      unsigned char stream_block[16], const unsigned char* input, unsigned char* output);
+
+#endif // NATIVE_ESP_AES_H
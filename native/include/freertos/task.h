@@ -0,0 +1,15 @@
+#ifndef NATIVE_FREERTOS_TASK_H
+#define NATIVE_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+// The thread ends when taskFunction returns; vTaskDelete() is a no-op
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t taskFunction, const char* name, uint32_t stackBytes,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* createdTask,
+                                   BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+
+// Sleeps for real (unlike delay(), which only moves the simulated clock)
+void vTaskDelay(TickType_t ticks);
+
+#endif // NATIVE_FREERTOS_TASK_H
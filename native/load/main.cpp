@@ -0,0 +1,312 @@
+// Host load test for the native environment (pio run -e native_load -t exec).
+// Drives VictronBLE with synthetic encrypted advertisements (VictronAdvertisementGenerator)
+// on a simulated clock and reports, per device count:
+//
+//   - ingest throughput (wall-clock ns per advertisement for the scan callback and loop())
+//   - ring drops and nonce cache hits (IngestStats), generator loss and corruption
+//   - heap in use after warm-up and at the end (growth), and the peak
+//   - MQTTPublisher::publishAll() and /api/devices/live cost at that device count
+//
+//   program [--devices N[,N...]] [--seconds S] [--rate HZ] [--loss R] [--corrupt R]
+//           [--repeat N] [--loop-ms MS] [--key HEX] [--counter N] [--seed N] [--out FILE]
+//
+// Defaults: 10,100,500 devices, 60 simulated seconds, 2 advertisements/s per device,
+// loop() every 10 ms. Results also go to load_results.csv (one row per device count).
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <new>
+#include <string>
+#include <vector>
+#include "VictronBLE.h"
+#include "MQTTPublisher.h"
+#include "WebConfigServer.h"
+#include "VictronAdvertisementGenerator.h"
+
+// Heap accounting: each block carries its size in front so frees can be subtracted
+static size_t heapInUse = 0;
+static size_t heapPeak = 0;
+static uint64_t heapAllocations = 0;
+static const size_t HEADER_SIZE = 16;   // Keeps the returned pointer 16-byte aligned
+
+// Not inlined into the operators, where GCC would flag the header arithmetic
+static __attribute__((noinline)) void* countedAlloc(size_t size) {
+    uint8_t* block = (uint8_t*)malloc(size + HEADER_SIZE);
+    if (!block) {
+        return nullptr;
+    }
+    *(size_t*)block = size;
+    heapInUse += size;
+    heapAllocations++;
+    if (heapInUse > heapPeak) {
+        heapPeak = heapInUse;
+    }
+    return block + HEADER_SIZE;
+}
+
+static __attribute__((noinline)) void countedFree(void* p) {
+    if (p) {
+        uint8_t* block = (uint8_t*)p - HEADER_SIZE;
+        heapInUse -= *(size_t*)block;
+        free(block);
+    }
+}
+
+void* operator new(size_t size) {
+    void* p = countedAlloc(size);
+    if (!p) {
+        abort();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, size_t) noexcept { countedFree(p); }
+
+struct LoadResult {
+    int devices;
+    uint32_t generated;
+    uint32_t lost;
+    uint32_t corrupted;
+    uint32_t delivered;       // Handed to the scan callback
+    IngestStats ingest;
+    int devicesSeen;
+    int devicesValid;
+    double callbackNs;        // Per delivered advertisement
+    double loopNs;            // Per processed advertisement
+    double advertisementsPerSecond;   // Sustainable rate: delivered / (callback + loop time)
+    size_t heapWarm;          // After the first 10 % of the run
+    size_t heapEnd;
+    size_t heapPeak;
+    double publishAllUs;
+    double liveDataUs;
+    size_t liveDataBytes;
+};
+
+static double wallNs() {
+    return (double)esp_timer_get_time() * 1000.0;
+}
+
+static LoadResult runScenario(const GeneratorConfig& generatorConfig, int seconds, int loopMs) {
+    LoadResult result;
+    memset(&result, 0, sizeof(result));
+    result.devices = generatorConfig.deviceCount;
+    if (generatorConfig.deviceCount > VICTRON_MAX_DEVICES) {
+        fprintf(stderr, "warning: %d devices but VICTRON_MAX_DEVICES is %d; the rest are ignored\n",
+                generatorConfig.deviceCount, VICTRON_MAX_DEVICES);
+    }
+    
+    size_t heapBefore = heapInUse;
+    heapPeak = heapInUse;
+    
+    VictronAdvertisementGenerator generator;
+    VictronBLE* victronBLE = new VictronBLE();
+    victronBLE->begin();
+    victronBLE->setAdaptiveScan(false);  // Measures ingest throughput, not the duty cycle
+    victronBLE->startScanning();
+    
+    // esp_timer time is the simulated clock: nativeAdvanceTime() moves it without sleeping
+    int64_t startUs = esp_timer_get_time();
+    generator.begin(generatorConfig, startUs);
+    const std::vector<GeneratedDevice>& devices = generator.getDevices();
+    for (size_t i = 0; i < devices.size(); i++) {
+        victronBLE->setEncryptionKey(devices[i].address, devices[i].keyHex);
+    }
+    
+    NimBLEScan* scan = NimBLEDevice::getScan();
+    NimBLEAdvertisedDevice advertisement;
+    double callbackNs = 0;
+    double loopNs = 0;
+    int64_t loopUs = (int64_t)loopMs * 1000;
+    int64_t steps = (int64_t)seconds * 1000000 / loopUs;
+    int64_t warmStep = steps / 10;
+    
+    for (int64_t step = 0; step < steps; step++) {
+        int64_t until = startUs + (step + 1) * loopUs;
+        
+        // Everything due during this loop period arrives before loop() runs
+        while (generator.next(until, advertisement)) {
+            double t0 = wallNs();
+            scan->nativeDeliver(&advertisement);
+            callbackNs += wallNs() - t0;
+            result.delivered++;
+        }
+        
+        double t0 = wallNs();
+        victronBLE->loop();
+        loopNs += wallNs() - t0;
+        
+        // Only the wall-clock time measured above counts; the clock jumps to the next period
+        int64_t now = esp_timer_get_time();
+        if (now < until) {
+            nativeAdvanceTime((uint64_t)(until - now));
+        }
+        if (step == warmStep) {
+            result.heapWarm = heapInUse - heapBefore;
+        }
+    }
+    
+    GeneratorStats generated = generator.getStats();
+    result.generated = generated.generated;
+    result.lost = generated.lost;
+    result.corrupted = generated.corrupted;
+    result.ingest = victronBLE->getIngestStats();
+    result.callbackNs = result.delivered ? callbackNs / result.delivered : 0;
+    result.loopNs = result.ingest.processed ? loopNs / result.ingest.processed : 0;
+    result.advertisementsPerSecond = (callbackNs + loopNs) > 0 ? result.delivered * 1e9 / (callbackNs + loopNs) : 0;
+    for (VictronDeviceData& device : victronBLE->getDevices()) {
+        result.devicesSeen++;
+        if (device.dataValid) {
+            result.devicesValid++;
+        }
+    }
+    result.heapEnd = heapInUse - heapBefore;
+    
+    // Consumers at this device count
+    MQTTPublisher* publisher = new MQTTPublisher();
+    publisher->begin(victronBLE);
+    MQTTConfig mqttConfig;
+    mqttConfig.broker = "localhost";
+    mqttConfig.enabled = true;
+    publisher->setConfig(mqttConfig);
+    publisher->connect();
+    publisher->publishAll();   // First pass includes Home Assistant discovery
+    double t0 = wallNs();
+    publisher->publishAll(true);  // Every device, as after a reconnect
+    result.publishAllUs = (wallNs() - t0) / 1000.0;
+    
+    WebConfigServer* webServer = new WebConfigServer();
+    webServer->setVictronBLE(victronBLE);
+    webServer->begin();
+    AsyncWebServer* server = AsyncWebServer::nativeLastStarted();
+    if (server) {
+        AsyncWebServerRequest request(HTTP_GET, "/api/devices/live");
+        t0 = wallNs();
+        server->nativeHandle(&request);
+        result.liveDataUs = (wallNs() - t0) / 1000.0;
+        result.liveDataBytes = request.nativeResponseBody().length();
+    }
+    result.heapPeak = heapPeak - heapBefore;
+    
+    delete webServer;
+    delete publisher;
+    delete victronBLE;
+    return result;
+}
+
+static void parseDeviceCounts(const char* text, std::vector<int>& counts) {
+    counts.clear();
+    while (*text) {
+        int value = atoi(text);
+        if (value > 0) {
+            counts.push_back(value);
+        }
+        const char* comma = strchr(text, ',');
+        if (!comma) {
+            break;
+        }
+        text = comma + 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    GeneratorConfig generatorConfig;
+    std::vector<int> deviceCounts;
+    deviceCounts.push_back(10);
+    deviceCounts.push_back(100);
+    deviceCounts.push_back(500);
+    int seconds = 60;
+    int loopMs = 10;
+    const char* outPath = "load_results.csv";
+    
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--devices") == 0 && hasValue) {
+            parseDeviceCounts(argv[++i], deviceCounts);
+        } else if (strcmp(argv[i], "--seconds") == 0 && hasValue) {
+            seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && hasValue) {
+            generatorConfig.rateHz = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--loss") == 0 && hasValue) {
+            generatorConfig.lossRatio = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--corrupt") == 0 && hasValue) {
+            generatorConfig.corruptRatio = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--repeat") == 0 && hasValue) {
+            generatorConfig.repeat = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--loop-ms") == 0 && hasValue) {
+            loopMs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--key") == 0 && hasValue) {
+            generatorConfig.keyHex = argv[++i];
+        } else if (strcmp(argv[i], "--counter") == 0 && hasValue) {
+            generatorConfig.counterStart = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            generatorConfig.seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        } else if (strcmp(argv[i], "--out") == 0 && hasValue) {
+            outPath = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--devices N[,N...]] [--seconds S] [--rate HZ] [--loss R] [--corrupt R]\n"
+                            "          [--repeat N] [--loop-ms MS] [--key HEX] [--counter N] [--seed N] [--out FILE]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (seconds <= 0 || loopMs <= 0) {
+        fprintf(stderr, "--seconds and --loop-ms must be positive\n");
+        return 2;
+    }
+    
+    Serial.setQuiet(true);
+    printf("%d s simulated, %.1f adv/s per device, loop() every %d ms, loss %.2f, corrupt %.2f, ring %d\n\n",
+           seconds, generatorConfig.rateHz, loopMs, generatorConfig.lossRatio, generatorConfig.corruptRatio,
+           ADVERTISEMENT_RING_SIZE);
+    printf("%7s %9s %8s %7s %9s %9s %10s %9s %9s %9s %10s %9s %9s %9s\n", "devices", "delivered", "drops", "drop%",
+           "cache%", "valid", "ns/adv cb", "ns/adv", "kadv/s", "heap KB", "growth KB", "peak KB", "mqtt ms", "live ms");
+    
+    std::vector<LoadResult> results;
+    for (size_t i = 0; i < deviceCounts.size(); i++) {
+        generatorConfig.deviceCount = deviceCounts[i];
+        LoadResult r = runScenario(generatorConfig, seconds, loopMs);
+        results.push_back(r);
+        
+        double dropPercent = r.delivered ? 100.0 * r.ingest.drops / r.delivered : 0;
+        double cachePercent = r.ingest.cacheLookups ? 100.0 * r.ingest.cacheHits / r.ingest.cacheLookups : 0;
+        char valid[24];
+        snprintf(valid, sizeof(valid), "%d/%d", r.devicesValid, r.devicesSeen);
+        printf("%7d %9u %8u %6.2f%% %8.1f%% %9s %10.0f %9.0f %9.1f %9.1f %10.1f %9.1f %9.2f %9.2f\n", r.devices,
+               r.delivered, r.ingest.drops, dropPercent, cachePercent, valid, r.callbackNs, r.loopNs,
+               r.advertisementsPerSecond / 1000.0, r.heapEnd / 1024.0, ((double)r.heapEnd - r.heapWarm) / 1024.0,
+               r.heapPeak / 1024.0, r.publishAllUs / 1000.0, r.liveDataUs / 1000.0);
+        fflush(stdout);
+    }
+    
+    FILE* file = fopen(outPath, "w");
+    if (!file) {
+        fprintf(stderr, "cannot write %s\n", outPath);
+        return 1;
+    }
+    fprintf(file, "# ESP32-Victron host load test\n");
+    fprintf(file, "# seconds=%d rate_hz=%.2f loop_ms=%d loss=%.3f corrupt=%.3f repeat=%d seed=%u\n", seconds,
+            generatorConfig.rateHz, loopMs, generatorConfig.lossRatio, generatorConfig.corruptRatio,
+            generatorConfig.repeat, (unsigned)generatorConfig.seed);
+    fprintf(file, "# victron_max_devices=%d ring=%d device_table_bytes=%u\n", VICTRON_MAX_DEVICES,
+            ADVERTISEMENT_RING_SIZE, (unsigned)VictronDeviceTable::memoryBytes());
+    fprintf(file, "devices,generated,lost,corrupted,delivered,ring_drops,filtered,processed,cache_hits,"
+                  "devices_seen,devices_valid,callback_ns,loop_ns,adv_per_s,heap_warm,heap_end,heap_peak,"
+                  "publish_all_us,live_data_us,live_data_bytes\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const LoadResult& r = results[i];
+        fprintf(file, "%d,%u,%u,%u,%u,%u,%u,%u,%u,%d,%d,%.1f,%.1f,%.0f,%u,%u,%u,%.1f,%.1f,%u\n", r.devices,
+                r.generated, r.lost, r.corrupted, r.delivered, r.ingest.drops, r.ingest.filtered,
+                r.ingest.processed, r.ingest.cacheHits, r.devicesSeen, r.devicesValid, r.callbackNs, r.loopNs,
+                r.advertisementsPerSecond, (unsigned)r.heapWarm, (unsigned)r.heapEnd, (unsigned)r.heapPeak,
+                r.publishAllUs, r.liveDataUs, (unsigned)r.liveDataBytes);
+    }
+    fclose(file);
+    printf("\nresults written to %s\n", outPath);
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include <chrono>
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+
+// Simulated time = host steady clock since start + offset added by
+// nativeAdvanceTime() and delay(), so replays can run faster than real time
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+static std::atomic<uint64_t> timeOffsetUs(0);   // Atomic: PeriodicTask threads read the clock too
+
+int64_t esp_timer_get_time() {
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - startTime;
+    return (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + (int64_t)timeOffsetUs.load();
+}
+
+unsigned long millis() {
+    return (unsigned long)(esp_timer_get_time() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)esp_timer_get_time();
+}
+
+void delay(unsigned long ms) {
+    // Nothing runs concurrently on the host, so waiting only needs to move the clock
+    timeOffsetUs += (uint64_t)ms * 1000;
+}
+
+void yield() {
+}
+
+void nativeAdvanceTime(uint64_t us) {
+    timeOffsetUs += us;
+}
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t length = strlen(src);
+    if (size) {
+        size_t count = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, count);
+        dst[count] = '\0';
+    }
+    return length;
+}
+#endif
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    (void)buffer;
+    return size;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) {
+        return 0;
+    }
+    if ((size_t)length < sizeof(buffer)) {
+        return write((const uint8_t*)buffer, length);
+    }
+    
+    // Long output: format again into a buffer of the right size
+    char* large = (char*)malloc(length + 1);
+    if (!large) {
+        return 0;
+    }
+    va_start(args, format);
+    vsnprintf(large, length + 1, format, args);
+    va_end(args);
+    size_t written = write((const uint8_t*)large, length);
+    free(large);
+    return written;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if (quiet) {
+        return size;
+    }
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void EspClass::restart() {
+    Serial.println("ESP.restart() requested (ignored on the host)");
+}
+
+uint32_t EspClass::getCycleCount() {
+    std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint32_t)((uint64_t)elapsed.count() * getCpuFreqMHz() / 1000);
+}
@@ -0,0 +1,312 @@
+#include "BaselineParsers.h"
+
+// Helper functions for multi-byte value extraction
+
+// Extract signed 16-bit value (little-endian with sign bit)
+int16_t BaselineParsers::extractSigned16(const uint8_t* data, int byteIndex) {
+    bool neg = (data[byteIndex + 1] & 0x80) >> 7;  // extract sign bit from MSB
+    int16_t value = ((data[byteIndex + 1] & 0x7F) << 8) | data[byteIndex];  // exclude sign bit
+    if (neg) value = value - 32768;  // 2's complement = val - 2^(b-1), b=16
+    return value;
+}
+
+// Extract unsigned 16-bit value (little-endian)
+uint16_t BaselineParsers::extractUnsigned16(const uint8_t* data, int byteIndex) {
+    return (data[byteIndex + 1] << 8) | data[byteIndex];
+}
+
+// Extract signed 22-bit value (spread across 3 bytes, little-endian)
+// Battery current for SmartShunt: bytes 8-10
+int32_t BaselineParsers::extractSigned22(const uint8_t* data, int startByte) {
+    bool neg = (data[startByte + 2] & 0x80) >> 7;  // bit 21 (sign bit)
+    
+    // Extract the 21-bit unsigned value spread across the bytes
+    // Byte 0 (8): bits 2-7 contain bits 0-5 of value
+    // Byte 1 (9): bits 0-1 contain bits 6-7, bits 2-7 contain bits 8-13
+    // Byte 2 (10): bits 0-1 contain bits 14-15, bits 2-6 contain bits 16-20
+    int32_t value = ((data[startByte] & 0xFC) >> 2) |                           // bits 0-5
+                   (((data[startByte + 1] & 0x03) << 6)) |                       // bits 6-7
+                   (((data[startByte + 1] & 0xFC) >> 2) << 8) |                  // bits 8-13
+                   (((data[startByte + 2] & 0x03) << 14)) |                      // bits 14-15
+                   (((data[startByte + 2] & 0x7C) >> 2) << 16);                  // bits 16-20
+    
+    if (neg) value = value - 2097152;  // 2's complement = val - 2^(b-1), b=22
+    return value;
+}
+
+// Extract unsigned 20-bit value (spread across 3 bytes, little-endian)
+// Consumed Ah for SmartShunt: bytes 11-13 (lower 4 bits of byte 13)
+uint32_t BaselineParsers::extractUnsigned20(const uint8_t* data, int startByte) {
+    return data[startByte] |                     // bits 0-7
+          (data[startByte + 1] << 8) |           // bits 8-15
+          ((data[startByte + 2] & 0x0F) << 16);  // bits 16-19
+}
+
+// Extract unsigned 10-bit value (spread across 2 bytes)
+// State of Charge for SmartShunt: bytes 13-14 (upper 4 bits of byte 13, bits 0-5 of byte 14)
+uint16_t BaselineParsers::extractUnsigned10(const uint8_t* data, int startByte) {
+    // Byte 13: bits 4-7 contain bits 0-3 of value (extract with 0xF0, shift right by 4)
+    // Byte 14: bits 0-3 contain bits 4-7 of value (extract with 0x0F, shift left by 4)
+    // Byte 14: bits 4-5 contain bits 8-9 of value (extract with 0x30, shift left by 4 more)
+    return ((data[startByte] & 0xF0) >> 4) |       // bits 0-3
+           ((data[startByte + 1] & 0x0F) << 4) |   // bits 4-7
+           ((data[startByte + 1] & 0x30) << 4);    // bits 8-9 (bits 4-5 of byte shifted to 8-9)
+}
+
+// Validate voltage reading with sanity check
+// Returns true if voltage is valid (within MIN_VALID_VOLTAGE to MAX_VALID_VOLTAGE), false if invalid
+// If invalid, sets device.dataValid to false and fills error
+bool BaselineParsers::validateVoltage(float voltage, VictronReading& device) {
+    // Sanity check: discard packet if voltage > MAX_VALID_VOLTAGE or < MIN_VALID_VOLTAGE (clearly incorrect data)
+    if (voltage > MAX_VALID_VOLTAGE || voltage < MIN_VALID_VOLTAGE) {
+        device.dataValid = false;
+        snprintf(error, sizeof(error), "Invalid voltage reading (%.2fV, valid range: %.0fV to %.0fV) - packet discarded", 
+                 voltage, MIN_VALID_VOLTAGE, MAX_VALID_VOLTAGE);
+        return false;
+    }
+    return true;
+}
+
+// Validate temperature reading with sanity check
+// Returns true if temperature is valid (between valid range and not exceeding MAX_VALID_TEMPERATURE), false if invalid
+// If invalid, sets device.dataValid to false and fills error
+bool BaselineParsers::validateTemperature(float temperature, VictronReading& device) {
+    // Sanity check: discard packet if temperature > MAX_VALID_TEMPERATURE (clearly incorrect data)
+    if (temperature > MAX_VALID_TEMPERATURE) {
+        device.dataValid = false;
+        snprintf(error, sizeof(error), "Invalid temperature reading (%.1f°C, max: %.0f°C) - packet discarded", 
+                 temperature, MAX_VALID_TEMPERATURE);
+        return false;
+    }
+    return true;
+}
+
+// Parse SmartShunt data (15-byte fixed structure, but handle partial data)
+// Based on VBM.cpp from reference implementation
+void BaselineParsers::parseSmartShuntData(const uint8_t* output, size_t length, VictronReading& device) {
+    // Parse whatever fields are available based on actual data length
+    // Each field is only parsed if we have enough bytes for it
+    
+    // Time To Go (bytes 0-1, little-endian, unsigned 16-bit, units: minutes)
+    if (length >= 2) {
+        uint16_t ttgMinutes = extractUnsigned16(output, 0);
+        if (ttgMinutes != 0xFFFF) {
+            device.timeToGo = ttgMinutes;
+        }
+    }
+    
+    // Battery Voltage (bytes 2-3, signed 16-bit, units: 10mV)
+    if (length >= 4) {
+        int16_t battMv10 = extractSigned16(output, 2);
+        if (battMv10 != 0x7FFF) {
+            float voltage = battMv10 / 100.0f;  // convert 10mV to V
+            if (!validateVoltage(voltage, device)) {
+                return;
+            }
+            device.voltage = voltage;
+            device.hasVoltage = true;
+        }
+    }
+    
+    // Alarm bits (bytes 4-5)
+    if (length >= 6) {
+        device.alarmState = extractUnsigned16(output, 4);
+    }
+    
+    // Auxiliary input (bytes 6-7) and aux mode (byte 8)
+    // The type is determined by bits 0-1 of byte 8
+    if (length >= 9) {
+        device.auxMode = output[8] & 0x03;
+        
+        if (device.auxMode == 0) {
+            // Aux voltage (signed 16-bit, units: 10mV)
+            int16_t auxMv10 = extractSigned16(output, 6);
+            if (auxMv10 != 0x7FFF) {
+                device.auxVoltage = auxMv10 / 100.0f;
+            }
+        } else if (device.auxMode == 1) {
+            // Mid-point voltage (unsigned 16-bit, units: 10mV)
+            uint16_t midMv10 = extractUnsigned16(output, 6);
+            if (midMv10 != 0xFFFF) {
+                device.midVoltage = midMv10 / 100.0f;
+            }
+        } else if (device.auxMode == 2) {
+            // Temperature (unsigned 16-bit, units: 10mK = 0.01K)
+            uint16_t tempK01 = extractUnsigned16(output, 6);
+            if (tempK01 != 0xFFFF) {
+                float temperature = (tempK01 / 100.0f) - 273.15;  // convert 0.01K to Celsius
+                if (!validateTemperature(temperature, device)) {
+                    return;
+                }
+                device.temperature = temperature;
+                device.hasTemperature = true;
+            }
+        }
+    }
+    
+    // Battery Current (bytes 8-10, signed 22-bit, units: mA)
+    if (length >= 11) {
+        int32_t battMa = extractSigned22(output, 8);
+        if (battMa != 0x1FFFFF) {
+            device.current = battMa / 1000.0f;  // convert mA to A
+            device.hasCurrent = true;
+            
+            // Calculate power if we have both voltage and current
+            if (device.hasVoltage) {
+                device.power = device.voltage * device.current;
+                device.hasPower = true;
+            }
+        }
+    }
+    
+    // Consumed Ah (bytes 11-13, unsigned 20-bit, units: 100mAh = 0.1Ah)
+    if (length >= 14) {
+        uint32_t consumedAh01 = extractUnsigned20(output, 11);
+        if (consumedAh01 != 0xFFFFF) {
+            device.consumedAh = consumedAh01 / 10.0f;  // convert 0.1Ah to Ah
+        }
+    }
+    
+    // State of Charge (bytes 13-14, unsigned 10-bit, units: 0.1%)
+    if (length >= 15) {
+        uint16_t soc01 = extractUnsigned10(output, 13);
+        if (soc01 != 0x3FF) {
+            device.batterySOC = soc01 / 10.0f;  // convert 0.1% to %
+            device.hasSOC = true;
+        }
+    }
+}
+
+// Parse Solar Controller data (16-byte fixed structure, but handle partial data)
+// Blue Smart Chargers also use this same format
+// Based on VSC.cpp from reference implementation
+void BaselineParsers::parseSolarControllerData(const uint8_t* output, size_t length, VictronReading& device) {
+    // Parse whatever fields are available based on actual data length
+    // Each field is only parsed if we have enough bytes for it
+    
+    // Device State (byte 0)
+    if (length >= 1) {
+        device.deviceState = output[0];
+    }
+    
+    // Charger Error (byte 1)
+    if (length >= 2) {
+        device.chargerError = output[1];
+    }
+    
+    // Battery Voltage (bytes 2-3, signed 16-bit, units: 10mV)
+    if (length >= 4) {
+        int16_t battMv10 = extractSigned16(output, 2);
+        if (battMv10 != 0x7FFF) {
+            float voltage = battMv10 / 100.0f;  // convert 10mV to V
+            if (!validateVoltage(voltage, device)) {
+                return;
+            }
+            device.voltage = voltage;
+            device.hasVoltage = true;
+        }
+    }
+    
+    // Battery Current (bytes 4-5, signed 16-bit, units: 100mA)
+    // Both Solar Controllers and Blue Smart Chargers use SIGNED current
+    if (length >= 6) {
+        int16_t battMa100 = extractSigned16(output, 4);
+        if (battMa100 != 0x7FFF) {
+            device.current = battMa100 / 10.0f;  // convert 100mA to A
+            device.hasCurrent = true;
+            
+            // Sanity check: If current seems unrealistic (>100A or <-100A), encryption key is likely wrong
+            if (device.current > 100.0f || device.current < -100.0f) {
+                device.dataValid = false;
+                strlcpy(error, "Invalid current reading - check encryption key", sizeof(error));
+                return;
+            }
+            
+            // Calculate power if we have both voltage and current
+            if (device.hasVoltage) {
+                device.power = device.voltage * device.current;
+                device.hasPower = true;
+            }
+        }
+    }
+    
+    // Yield Today (bytes 6-7, unsigned 16-bit, units: 10Wh = 0.01kWh)
+    if (length >= 8) {
+        uint16_t yieldWh10 = extractUnsigned16(output, 6);
+        if (yieldWh10 != 0xFFFF) {
+            device.yieldToday = yieldWh10 / 100.0f;  // convert 10Wh to kWh
+        }
+    }
+    
+    // PV Power (bytes 8-9, unsigned 16-bit, units: W)
+    if (length >= 10) {
+        uint16_t pvW = extractUnsigned16(output, 8);
+        if (pvW != 0xFFFF) {
+            device.pvPower = pvW;
+        }
+    }
+    
+    // Load Current (bytes 10-11, partially used, units: 100mA)
+    // Only 9 bits are used: bit 0 of byte 11 + all 8 bits of byte 10
+    if (length >= 12) {
+        uint16_t loadMa100 = ((output[11] & 0x01) << 8) | output[10];
+        if (loadMa100 != 0x1FF) {
+            device.loadCurrent = loadMa100 / 10.0f;  // convert 100mA to A
+        }
+    }
+}
+
+// Parse DC-DC Converter data (16-byte fixed structure, but handle partial data)
+// Based on reference implementation: mp-se/victron-receiver
+// Data layout: state(8), error(8), inputV(16), outputV(16), offReason(32)
+void BaselineParsers::parseDCDCConverterData(const uint8_t* output, size_t length, VictronReading& device) {
+    // Parse whatever fields are available based on actual data length
+    // Each field is only parsed if we have enough bytes for it
+    
+    // Device State (byte 0)
+    if (length >= 1) {
+        device.deviceState = output[0];
+    }
+    
+    // Error code (byte 1)
+    if (length >= 2) {
+        device.chargerError = output[1];
+    }
+    
+    // Input Voltage (bytes 2-3, unsigned 16-bit, units: 10mV)
+    if (length >= 4) {
+        uint16_t inputMv10 = extractUnsigned16(output, 2);
+        if (inputMv10 != 0xFFFF) {
+            float inputVoltage = inputMv10 / 100.0f;
+            if (!validateVoltage(inputVoltage, device)) {
+                return;
+            }
+            device.inputVoltage = inputVoltage;
+            device.hasInputVoltage = true;
+        }
+    }
+    
+    // Output Voltage (bytes 4-5, signed 16-bit, units: 10mV)
+    if (length >= 6) {
+        int16_t outputMv10 = extractSigned16(output, 4);
+        if (outputMv10 != 0x7FFF) {
+            float outputVoltage = outputMv10 / 100.0f;
+            if (!validateVoltage(outputVoltage, device)) {
+                return;
+            }
+            device.outputVoltage = outputVoltage;
+            device.hasOutputVoltage = true;
+            // Also set as general voltage for display
+            device.voltage = device.outputVoltage;
+            device.hasVoltage = true;
+        }
+    }
+    
+    // Off Reason (bytes 6-9, unsigned 32-bit)
+    if (length >= 10) {
+        device.offReason = (uint32_t)output[6] | 
+                          ((uint32_t)output[7] << 8) | 
+                          ((uint32_t)output[8] << 16) | 
+                          ((uint32_t)output[9] << 24);
+    }
+}
@@ -0,0 +1,72 @@
+#include <ESPAsyncWebServer.h>
+
+static AsyncWebServer* lastStarted = nullptr;
+
+bool AsyncWebServerRequest::hasParam(const String& name, bool post, bool file) const {
+    (void)file;
+    for (size_t i = 0; i < parameters.size(); i++) {
+        if (parameters[i].isPost() == post && parameters[i].name() == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+AsyncWebParameter* AsyncWebServerRequest::getParam(const String& name, bool post, bool file) {
+    (void)file;
+    for (size_t i = 0; i < parameters.size(); i++) {
+        if (parameters[i].isPost() == post && parameters[i].name() == name) {
+            return &parameters[i];
+        }
+    }
+    return nullptr;
+}
+
+void AsyncWebServerRequest::send(fs::FS& fs, const String& path, const String& contentType, bool download) {
+    (void)download;
+    File file = fs.open(path.c_str(), "r");
+    if (!file || file.isDirectory()) {
+        send(404);
+        return;
+    }
+    String body;
+    int c;
+    while ((c = file.read()) >= 0) {
+        body += (char)c;
+    }
+    send(200, contentType, body);
+}
+
+AsyncWebServer::~AsyncWebServer() {
+    if (lastStarted == this) {
+        lastStarted = nullptr;
+    }
+}
+
+void AsyncWebServer::begin() {
+    started = true;
+    lastStarted = this;
+}
+
+bool AsyncWebServer::nativeHandle(AsyncWebServerRequest* request) {
+    if (!started) {
+        return false;
+    }
+    const String& url = request->url();
+    for (size_t i = 0; i < routes.size(); i++) {
+        const Route& route = routes[i];
+        if (!(route.method & request->method())) {
+            continue;
+        }
+        if (url == route.uri || (url.startsWith(route.uri + "/") && route.uri != "/")) {
+            route.handler(request);
+            return true;
+        }
+    }
+    request->send(404);
+    return false;
+}
+
+AsyncWebServer* AsyncWebServer::nativeLastStarted() {
+    return lastStarted;
+}
@@ -0,0 +1,26 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <chrono>
+#include <thread>
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t taskFunction, const char* name, uint32_t stackBytes,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* createdTask,
+                                   BaseType_t core) {
+    (void)name;
+    (void)stackBytes;
+    (void)priority;
+    (void)core;
+    std::thread(taskFunction, parameter).detach();
+    if (createdTask) {
+        *createdTask = (TaskHandle_t)taskFunction;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    (void)task;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
@@ -0,0 +1,162 @@
+#include <LittleFS.h>
+
+LittleFSFS LittleFS;
+
+namespace fs {
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    if (!data || !writable) {
+        return 0;
+    }
+    // Refuse writes that would overflow the partition, like LittleFS does
+    size_t grow = pos + size > data->size() ? pos + size - data->size() : 0;
+    if (owner->usedBytes() + grow > owner->totalBytes()) {
+        return 0;
+    }
+    if (grow) {
+        data->resize(pos + size);
+    }
+    memcpy(&(*data)[pos], buffer, size);
+    pos += size;
+    return size;
+}
+
+int File::read() {
+    uint8_t value;
+    return read(&value, 1) == 1 ? value : -1;
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+    size_t count = (size_t)available() < size ? (size_t)available() : size;
+    if (count) {
+        memcpy(buffer, &(*data)[pos], count);
+        pos += count;
+    }
+    return count;
+}
+
+bool File::seek(uint32_t offset, SeekMode mode) {
+    if (!data) {
+        return false;
+    }
+    size_t base = mode == SeekSet ? 0 : (mode == SeekCur ? pos : data->size());
+    if (base + offset > data->size()) {
+        return false;
+    }
+    pos = base + offset;
+    return true;
+}
+
+void File::close() {
+    owner = nullptr;
+    data.reset();
+    entries.clear();
+}
+
+const char* File::name() const {
+    size_t slash = filePath.rfind('/');
+    return slash == std::string::npos ? filePath.c_str() : filePath.c_str() + slash + 1;
+}
+
+File File::openNextFile(const char* mode) {
+    if (!directory || !owner || nextEntry >= entries.size()) {
+        return File();
+    }
+    return owner->open(entries[nextEntry++].c_str(), mode);
+}
+
+bool FS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+    (void)formatOnFail;
+    (void)basePath;
+    (void)maxOpenFiles;
+    (void)partitionLabel;
+    mounted = true;
+    return true;
+}
+
+File FS::open(const char* path, const char* mode, bool create) {
+    (void)create;
+    File file;
+    if (!mounted || !path || path[0] != '/') {
+        return file;
+    }
+    
+    std::string name(path);
+    std::map<std::string, std::shared_ptr<std::vector<uint8_t> > >::iterator it = files.find(name);
+    bool write = mode[0] == 'w' || mode[0] == 'a' || strchr(mode, '+') != nullptr;
+    
+    if (it == files.end() && !write) {
+        // Directory: any file below this path
+        std::string prefix = name == "/" ? name : name + "/";
+        for (it = files.begin(); it != files.end(); ++it) {
+            if (it->first.compare(0, prefix.size(), prefix) == 0 &&
+                it->first.find('/', prefix.size()) == std::string::npos) {
+                file.entries.push_back(it->first);
+            }
+        }
+        if (file.entries.empty() && name != "/") {
+            return file;
+        }
+        file.owner = this;
+        file.filePath = name;
+        file.directory = true;
+        return file;
+    }
+    
+    if (it == files.end() || mode[0] == 'w') {
+        files[name] = std::make_shared<std::vector<uint8_t> >();
+        it = files.find(name);
+    }
+    file.owner = this;
+    file.filePath = name;
+    file.data = it->second;
+    file.writable = write;
+    file.pos = mode[0] == 'a' ? file.data->size() : 0;
+    return file;
+}
+
+bool FS::exists(const char* path) {
+    if (!mounted || !path) {
+        return false;
+    }
+    if (files.count(path)) {
+        return true;
+    }
+    std::string prefix = std::string(path) + "/";
+    for (std::map<std::string, std::shared_ptr<std::vector<uint8_t> > >::const_iterator it = files.begin();
+         it != files.end(); ++it) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FS::remove(const char* path) {
+    return mounted && path && files.erase(path) > 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+    if (!mounted || !from || !to) {
+        return false;
+    }
+    std::map<std::string, std::shared_ptr<std::vector<uint8_t> > >::iterator it = files.find(from);
+    if (it == files.end()) {
+        return false;
+    }
+    std::shared_ptr<std::vector<uint8_t> > data = it->second;
+    files.erase(it);
+    files[to] = data;
+    return true;
+}
+
+size_t FS::usedBytes() const {
+    size_t used = 0;
+    for (std::map<std::string, std::shared_ptr<std::vector<uint8_t> > >::const_iterator it = files.begin();
+         it != files.end(); ++it) {
+        used += it->second->size();
+    }
+    return used;
+}
+
+} // namespace fs
@@ -0,0 +1,30 @@
+#include <Arduino.h>
+#include "VictronBLE.h"
+
+// Display, buzzer and reboot settings that src/main.cpp owns on the device.
+// WebConfigServer reads and writes them through extern declarations; the
+// native build has no display, so they are plain variables with the
+// firmware defaults and saving them is a no-op.
+
+VictronBLE *victron = nullptr;
+bool pendingReboot = false;
+unsigned long rebootScheduledTime = 0;
+
+bool buzzerEnabled = true;
+float buzzerThreshold = 10.0;
+bool retainLastData = true;
+
+int lcdFontSize = 1;
+int lcdScrollRate = 5;
+String lcdOrientation = "landscape";
+bool lcdAutoScroll = true;
+int largeDisplayTimeout = 60;
+
+void saveBuzzerConfig() {
+}
+
+void saveDataRetentionConfig() {
+}
+
+void saveLCDConfig() {
+}
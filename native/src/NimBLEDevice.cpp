@@ -0,0 +1,150 @@
+#include <NimBLEDevice.h>
+
+// Bluetooth base UUID 00000000-0000-1000-8000-00805f9b34fb, little-endian
+static const uint8_t BASE_UUID[16] = {
+    0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Parse hex digits (separators skipped) most significant byte first into out, reversed
+static bool parseHexReversed(const std::string& text, uint8_t* out, size_t bytes) {
+    size_t count = 0;
+    int high = -1;
+    for (size_t i = 0; i < text.size(); i++) {
+        int value = hexValue(text[i]);
+        if (value < 0) {
+            continue;
+        }
+        if (high < 0) {
+            high = value;
+        } else {
+            if (count >= bytes) {
+                return false;
+            }
+            out[bytes - 1 - count] = (uint8_t)((high << 4) | value);
+            count++;
+            high = -1;
+        }
+    }
+    return count == bytes && high < 0;
+}
+
+NimBLEAddress::NimBLEAddress(const std::string& address) {
+    if (!parseHexReversed(address, m_address, sizeof(m_address))) {
+        memset(m_address, 0, sizeof(m_address));
+    }
+}
+
+std::string NimBLEAddress::toString() const {
+    char buffer[18];
+    snprintf(buffer, sizeof(buffer), "%02x:%02x:%02x:%02x:%02x:%02x",
+             m_address[5], m_address[4], m_address[3], m_address[2], m_address[1], m_address[0]);
+    return std::string(buffer);
+}
+
+NimBLEUUID::NimBLEUUID(const std::string& uuid) {
+    m_valid = parseHexReversed(uuid, m_uuid, sizeof(m_uuid));
+    if (!m_valid) {
+        // Short forms: "fff0" or "0xfff0"
+        uint8_t shortUuid[2];
+        std::string digits = uuid.compare(0, 2, "0x") == 0 ? uuid.substr(2) : uuid;
+        memcpy(m_uuid, BASE_UUID, sizeof(m_uuid));
+        m_valid = parseHexReversed(digits, shortUuid, sizeof(shortUuid));
+        m_uuid[12] = shortUuid[0];
+        m_uuid[13] = shortUuid[1];
+    }
+}
+
+NimBLEUUID::NimBLEUUID(uint16_t uuid16) : m_valid(true) {
+    memcpy(m_uuid, BASE_UUID, sizeof(m_uuid));
+    m_uuid[12] = (uint8_t)(uuid16 & 0xff);
+    m_uuid[13] = (uint8_t)(uuid16 >> 8);
+}
+
+uint16_t NimBLEUUID::getShort() const {
+    if (memcmp(m_uuid, BASE_UUID, 12) != 0 || m_uuid[14] != 0 || m_uuid[15] != 0) {
+        return 0;
+    }
+    return (uint16_t)(m_uuid[12] | (m_uuid[13] << 8));
+}
+
+const uint8_t* NimBLEAdvertisedDevice::findField(uint8_t type, size_t* length) const {
+    size_t pos = 0;
+    while (pos < m_payload.size()) {
+        uint8_t fieldLength = m_payload[pos];
+        if (fieldLength == 0 || pos + 1 + fieldLength > m_payload.size()) {
+            break;
+        }
+        if (m_payload[pos + 1] == type) {
+            *length = fieldLength - 1;
+            return &m_payload[pos + 2];
+        }
+        pos += 1 + fieldLength;
+    }
+    return nullptr;
+}
+
+bool NimBLEAdvertisedDevice::haveName() {
+    size_t length;
+    return findField(0x09, &length) || findField(0x08, &length);
+}
+
+std::string NimBLEAdvertisedDevice::getName() {
+    size_t length = 0;
+    const uint8_t* name = findField(0x09, &length);
+    if (!name) {
+        name = findField(0x08, &length);
+    }
+    return name ? std::string((const char*)name, length) : std::string();
+}
+
+bool NimBLEAdvertisedDevice::haveManufacturerData() {
+    size_t length;
+    return findField(0xff, &length) != nullptr;
+}
+
+std::string NimBLEAdvertisedDevice::getManufacturerData() {
+    size_t length = 0;
+    const uint8_t* data = findField(0xff, &length);
+    return data ? std::string((const char*)data, length) : std::string();
+}
+
+bool NimBLEAdvertisedDevice::isAdvertisingService(const NimBLEUUID& uuid) {
+    size_t length = 0;
+    const uint8_t* list;
+    uint16_t shortUuid = uuid.getShort();
+    
+    // Incomplete/complete lists of 16-bit and 128-bit service UUIDs
+    if (shortUuid != 0) {
+        for (uint8_t type = 0x02; type <= 0x03; type++) {
+            if ((list = findField(type, &length)) != nullptr) {
+                for (size_t i = 0; i + 1 < length; i += 2) {
+                    if ((uint16_t)(list[i] | (list[i + 1] << 8)) == shortUuid) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    for (uint8_t type = 0x06; type <= 0x07; type++) {
+        if ((list = findField(type, &length)) != nullptr) {
+            for (size_t i = 0; i + 15 < length; i += 16) {
+                if (memcmp(&list[i], uuid.getNative(), 16) == 0) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+NimBLEScan* NimBLEDevice::getScan() {
+    static NimBLEScan scan;
+    return &scan;
+}
@@ -0,0 +1,89 @@
+#include <Preferences.h>
+#include <map>
+#include <string>
+
+// namespace -> key -> raw value bytes
+typedef std::map<std::string, std::map<std::string, std::string> > PreferenceStore;
+
+static PreferenceStore& store() {
+    static PreferenceStore instance;
+    return instance;
+}
+
+bool Preferences::begin(const char* name, bool ro) {
+    // NVS namespace names are limited to 15 characters
+    if (!name || strlen(name) > 15) {
+        return false;
+    }
+    ns = name;
+    readOnly = ro;
+    opened = true;
+    return true;
+}
+
+void Preferences::end() {
+    opened = false;
+}
+
+bool Preferences::clear() {
+    if (!opened || readOnly) {
+        return false;
+    }
+    store()[ns.c_str()].clear();
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!opened || readOnly) {
+        return false;
+    }
+    return store()[ns.c_str()].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) const {
+    if (!opened) {
+        return false;
+    }
+    const std::map<std::string, std::string>& values = store()[ns.c_str()];
+    return values.find(key) != values.end();
+}
+
+bool Preferences::putRaw(const char* key, const void* value, size_t length) {
+    // NVS keys are limited to 15 characters as well
+    if (!opened || readOnly || !key || strlen(key) > 15) {
+        return false;
+    }
+    store()[ns.c_str()][key] = std::string((const char*)value, length);
+    return true;
+}
+
+size_t Preferences::getRaw(const char* key, void* value, size_t length) const {
+    if (!opened) {
+        return 0;
+    }
+    const std::map<std::string, std::string>& values = store()[ns.c_str()];
+    std::map<std::string, std::string>::const_iterator it = values.find(key);
+    if (it == values.end() || it->second.size() > length) {
+        return 0;
+    }
+    memcpy(value, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) const {
+    if (!opened) {
+        return defaultValue;
+    }
+    const std::map<std::string, std::string>& values = store()[ns.c_str()];
+    std::map<std::string, std::string>::const_iterator it = values.find(key);
+    return it == values.end() ? defaultValue : String(it->second.c_str());
+}
+
+size_t Preferences::getBytesLength(const char* key) const {
+    if (!opened) {
+        return 0;
+    }
+    const std::map<std::string, std::string>& values = store()[ns.c_str()];
+    std::map<std::string, std::string>::const_iterator it = values.find(key);
+    return it == values.end() ? 0 : it->second.size();
+}
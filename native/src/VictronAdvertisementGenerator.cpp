@@ -0,0 +1,245 @@
+#include "VictronAdvertisementGenerator.h"
+#include <aes/esp_aes.h>
+
+// Model IDs and readout types the generated devices advertise
+static const uint16_t GENERATED_MODEL_IDS[] = { 0xA389, 0xA053, 0xA3C0 };
+static const uint8_t GENERATED_READOUT_TYPES[] = { 0x02, 0x01, 0x04 };
+static const char* const GENERATED_NAMES[] = { "SmartShunt HQ", "SmartSolar HQ", "Orion Smart HQ" };
+static const size_t GENERATED_PAYLOAD_BYTES[] = { 15, 16, 16 };
+
+// Write value into a payload little-endian at a bit position (Victron record order)
+static void putBits(uint8_t* payload, int bitOffset, int bitWidth, uint32_t value) {
+    for (int i = 0; i < bitWidth; i++) {
+        int bit = bitOffset + i;
+        if (value & (1u << i)) {
+            payload[bit / 8] |= (uint8_t)(1u << (bit % 8));
+        } else {
+            payload[bit / 8] &= (uint8_t)~(1u << (bit % 8));
+        }
+    }
+}
+
+VictronAdvertisementGenerator::VictronAdvertisementGenerator() : randomState(1), intervalUs(500000) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+// xorshift32: reproducible on every host, unlike rand()
+uint32_t VictronAdvertisementGenerator::random() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+float VictronAdvertisementGenerator::randomUnit() {
+    return (random() >> 8) / 16777216.0f;
+}
+
+int32_t VictronAdvertisementGenerator::walk(int32_t value, int32_t step, int32_t low, int32_t high) {
+    value += (int32_t)(random() % (uint32_t)(2 * step + 1)) - step;
+    return value < low ? low : (value > high ? high : value);
+}
+
+void VictronAdvertisementGenerator::begin(const GeneratorConfig& generatorConfig, int64_t startUs) {
+    config = generatorConfig;
+    randomState = config.seed != 0 ? config.seed : 1;
+    intervalUs = config.rateHz > 0 ? (int64_t)(1000000.0f / config.rateHz) : 1000000;
+    devices.clear();
+    devices.resize(config.deviceCount > 0 ? config.deviceCount : 0);
+    schedule = std::priority_queue<Due, std::vector<Due>, std::greater<Due> >();
+    memset(&stats, 0, sizeof(stats));
+    
+    for (size_t i = 0; i < devices.size(); i++) {
+        GeneratedDevice& device = devices[i];
+        device.kind = (GeneratedDeviceKind)(i % 3);
+        
+        // Victron OUI-style prefix, then the device index
+        uint32_t suffix = (uint32_t)i + 1;
+        uint8_t mac[6] = { 0xc0, 0x3b, (uint8_t)(random() & 0xfe), (uint8_t)(suffix >> 16),
+                           (uint8_t)(suffix >> 8), (uint8_t)suffix };
+        memcpy(device.mac, mac, sizeof(mac));
+        char text[40];
+        snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        device.address = text;
+        snprintf(text, sizeof(text), "%s%04u", GENERATED_NAMES[device.kind], (unsigned)suffix);
+        device.name = text;
+        
+        for (int b = 0; b < 16; b++) {
+            unsigned int value = 0;
+            if (config.keyHex.length() == 32) {
+                sscanf(config.keyHex.c_str() + b * 2, "%2x", &value);
+            } else {
+                value = random() & 0xff;
+            }
+            device.key[b] = (uint8_t)value;
+            snprintf(&text[b * 2], 3, "%02x", device.key[b]);
+        }
+        device.keyHex = text;
+        
+        device.counter = (uint16_t)(config.counterStart - 1);   // nextFrame() advances it before the first frame
+        device.framesLeft = 0;
+        device.voltage10mV = 1200 + (int32_t)(random() % 150);
+        device.current = device.kind == GENERATED_SMART_SHUNT ? -5000 : 50;
+        device.secondary = device.kind == GENERATED_SMART_SHUNT ? 800 : (device.kind == GENERATED_SMART_SOLAR ? 100 : 1400);
+        device.payloadLength = GENERATED_PAYLOAD_BYTES[device.kind];
+        buildPayload(device);
+        
+        device.nextDueUs = startUs + (int64_t)(randomUnit() * intervalUs);
+        Due due = { device.nextDueUs, (int)i };
+        schedule.push(due);
+    }
+}
+
+void VictronAdvertisementGenerator::nextFrame(GeneratedDevice& device) {
+    device.counter++;
+    switch (device.kind) {
+        case GENERATED_SMART_SHUNT:
+            device.voltage10mV = walk(device.voltage10mV, 2, 1150, 1400);
+            device.current = walk(device.current, 250, -40000, 40000);
+            device.secondary = walk(device.secondary, 1, 0, 1000);
+            break;
+        case GENERATED_SMART_SOLAR:
+            device.voltage10mV = walk(device.voltage10mV, 2, 1200, 1450);
+            device.current = walk(device.current, 3, 0, 300);
+            device.secondary = walk(device.secondary, 5, 0, 400);
+            break;
+        case GENERATED_DCDC:
+            device.voltage10mV = walk(device.voltage10mV, 2, 1150, 1400);
+            device.secondary = walk(device.secondary, 1, 1350, 1450);
+            break;
+    }
+    buildPayload(device);
+    stats.frames++;
+}
+
+void VictronAdvertisementGenerator::buildPayload(GeneratedDevice& device) {
+    uint8_t* payload = device.payload;
+    memset(payload, 0, sizeof(device.payload));
+    switch (device.kind) {
+        case GENERATED_SMART_SHUNT:
+            putBits(payload, 0, 16, 600);                                   // Time to go, minutes
+            putBits(payload, 16, 16, (uint32_t)device.voltage10mV);
+            putBits(payload, 32, 16, 0);                                    // No alarm
+            putBits(payload, 48, 16, 0x7FFF);                               // No aux input
+            putBits(payload, 64, 2, 3);
+            putBits(payload, 66, 22, (uint32_t)device.current & 0x3FFFFF);
+            putBits(payload, 88, 20, 120);                                  // 12.0 Ah consumed
+            putBits(payload, 108, 10, (uint32_t)device.secondary);
+            break;
+        case GENERATED_SMART_SOLAR:
+            putBits(payload, 0, 8, 3);                                      // Bulk
+            putBits(payload, 16, 16, (uint32_t)device.voltage10mV);
+            putBits(payload, 32, 16, (uint32_t)device.current);
+            putBits(payload, 48, 16, 85);                                   // 0.85 kWh today
+            putBits(payload, 64, 16, (uint32_t)device.secondary);
+            putBits(payload, 80, 9, 0x1FF);                                 // No load output
+            break;
+        case GENERATED_DCDC:
+            putBits(payload, 0, 8, 3);
+            putBits(payload, 16, 16, (uint32_t)device.voltage10mV);
+            putBits(payload, 32, 16, (uint32_t)device.secondary);
+            putBits(payload, 48, 32, 0);
+            break;
+    }
+}
+
+size_t VictronAdvertisementGenerator::buildManufacturerData(const GeneratedDevice& device, uint8_t* out) {
+    uint16_t modelId = GENERATED_MODEL_IDS[device.kind];
+    out[0] = 0xe1;                              // Victron company ID 0x02E1
+    out[1] = 0x02;
+    out[2] = 0x10;                              // Record prefix
+    out[3] = 0x00;
+    out[4] = (uint8_t)(modelId & 0xff);
+    out[5] = (uint8_t)(modelId >> 8);
+    out[6] = GENERATED_READOUT_TYPES[device.kind];
+    out[7] = (uint8_t)(device.counter & 0xff);
+    out[8] = (uint8_t)(device.counter >> 8);
+    out[9] = device.key[0];
+    
+    // AES-128-CTR, counter block = nonce (little-endian) followed by zeros
+    uint8_t nonce[16] = { out[7], out[8] };
+    uint8_t stream[16];
+    size_t offset = 0;
+    esp_aes_context aes;
+    esp_aes_init(&aes);
+    esp_aes_setkey(&aes, device.key, 128);
+    esp_aes_crypt_ctr(&aes, device.payloadLength, &offset, nonce, stream, device.payload, &out[10]);
+    esp_aes_free(&aes);
+    return 10 + device.payloadLength;
+}
+
+void VictronAdvertisementGenerator::corrupt(uint8_t* data, size_t& length) {
+    switch (random() % 3) {
+        case 0:
+            // Bit error in the encrypted payload: decrypts to wrong values
+            data[10 + random() % (length - 10)] ^= (uint8_t)(1u << (random() % 8));
+            break;
+        case 1:
+            // Key match byte damaged: decryption is refused
+            data[9] ^= 0x5a;
+            break;
+        default:
+            // Frame cut short
+            length = 10 + random() % (length - 10);
+            break;
+    }
+}
+
+bool VictronAdvertisementGenerator::next(int64_t untilUs, NimBLEAdvertisedDevice& advertisement) {
+    while (!schedule.empty() && schedule.top().timeUs <= untilUs) {
+        Due due = schedule.top();
+        schedule.pop();
+        GeneratedDevice& device = devices[due.device];
+        
+        // Victron devices advertise with some jitter around their interval
+        device.nextDueUs = due.timeUs + intervalUs - intervalUs / 10 + (int64_t)(randomUnit() * intervalUs / 5);
+        Due following = { device.nextDueUs, due.device };
+        schedule.push(following);
+        
+        if (device.framesLeft <= 0) {
+            nextFrame(device);
+            device.framesLeft = config.repeat > 0 ? config.repeat : 1;
+        }
+        device.framesLeft--;
+        stats.generated++;
+        
+        if (config.lossRatio > 0 && randomUnit() < config.lossRatio) {
+            stats.lost++;
+            continue;
+        }
+        
+        uint8_t data[32];
+        size_t dataLength = buildManufacturerData(device, data);
+        if (config.corruptRatio > 0 && randomUnit() < config.corruptRatio) {
+            corrupt(data, dataLength);
+            stats.corrupted++;
+        }
+        
+        // Flags, manufacturer data and complete local name in one payload
+        uint8_t payload[80];
+        size_t length = 0;
+        size_t nameLength = device.name.length();
+        payload[length++] = 2;
+        payload[length++] = 0x01;
+        payload[length++] = 0x06;
+        payload[length++] = (uint8_t)(1 + dataLength);
+        payload[length++] = 0xff;
+        memcpy(&payload[length], data, dataLength);
+        length += dataLength;
+        payload[length++] = (uint8_t)(1 + nameLength);
+        payload[length++] = 0x09;
+        memcpy(&payload[length], device.name.c_str(), nameLength);
+        length += nameLength;
+        
+        // NimBLE keeps addresses little-endian
+        uint8_t native[6];
+        for (int i = 0; i < 6; i++) {
+            native[i] = device.mac[5 - i];
+        }
+        advertisement.setAddress(NimBLEAddress(native));
+        advertisement.setRSSI(-55 - (int)(random() % 40));
+        advertisement.setPayload(payload, length);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,147 @@
+#include <aes/esp_aes.h>
+#include <string.h>
+
+// Reference AES-128 forward cipher: the S-box is derived from GF(2^8)
+// inverses at first use and the state is processed one byte at a time.
+// Only 128-bit keys and encryption are supported (all AesCtr needs).
+
+static uint8_t sbox[256];
+static bool sboxReady = false;
+
+static uint8_t xtime(uint8_t x) {
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1b : 0x00));
+}
+
+static uint8_t multiply(uint8_t a, uint8_t b) {
+    uint8_t result = 0;
+    while (b) {
+        if (b & 1) {
+            result ^= a;
+        }
+        a = xtime(a);
+        b >>= 1;
+    }
+    return result;
+}
+
+static void buildSbox() {
+    for (int i = 0; i < 256; i++) {
+        // Multiplicative inverse (0 maps to 0), then the affine transform
+        uint8_t inverse = 0;
+        for (int j = 1; j < 256 && i != 0; j++) {
+            if (multiply((uint8_t)i, (uint8_t)j) == 1) {
+                inverse = (uint8_t)j;
+                break;
+            }
+        }
+        uint8_t s = inverse;
+        uint8_t x = inverse;
+        for (int r = 0; r < 4; r++) {
+            x = (uint8_t)((x << 1) | (x >> 7));
+            s ^= x;
+        }
+        sbox[i] = s ^ 0x63;
+    }
+    sboxReady = true;
+}
+
+static void encryptBlock(const uint8_t* key, const uint8_t* input, uint8_t* output) {
+    uint8_t roundKeys[176];
+    uint8_t state[16];
+    uint8_t rcon = 1;
+    
+    memcpy(roundKeys, key, 16);
+    for (int i = 16; i < 176; i += 4) {
+        uint8_t t[4] = {roundKeys[i - 4], roundKeys[i - 3], roundKeys[i - 2], roundKeys[i - 1]};
+        if (i % 16 == 0) {
+            uint8_t first = t[0];
+            t[0] = sbox[t[1]] ^ rcon;
+            t[1] = sbox[t[2]];
+            t[2] = sbox[t[3]];
+            t[3] = sbox[first];
+            rcon = xtime(rcon);
+        }
+        for (int j = 0; j < 4; j++) {
+            roundKeys[i + j] = roundKeys[i + j - 16] ^ t[j];
+        }
+    }
+    
+    for (int i = 0; i < 16; i++) {
+        state[i] = input[i] ^ roundKeys[i];
+    }
+    for (int round = 1; round <= 10; round++) {
+        uint8_t shifted[16];
+        // SubBytes + ShiftRows (state is column-major)
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 4; row++) {
+                shifted[col * 4 + row] = sbox[state[((col + row) % 4) * 4 + row]];
+            }
+        }
+        if (round < 10) {
+            // MixColumns
+            for (int col = 0; col < 4; col++) {
+                uint8_t* c = &shifted[col * 4];
+                uint8_t a0 = c[0], a1 = c[1], a2 = c[2], a3 = c[3];
+                uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+                c[0] ^= all ^ xtime(a0 ^ a1);
+                c[1] ^= all ^ xtime(a1 ^ a2);
+                c[2] ^= all ^ xtime(a2 ^ a3);
+                c[3] ^= all ^ xtime(a3 ^ a0);
+            }
+        }
+        for (int i = 0; i < 16; i++) {
+            state[i] = shifted[i] ^ roundKeys[round * 16 + i];
+        }
+    }
+    memcpy(output, state, 16);
+}
+
+void esp_aes_init(esp_aes_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void esp_aes_free(esp_aes_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int esp_aes_setkey(esp_aes_context* ctx, const unsigned char* key, unsigned int keybits) {
+    if (keybits != 128) {
+        return -1;
+    }
+    if (!sboxReady) {
+        buildSbox();
+    }
+    memcpy(ctx->key, key, 16);
+    ctx->key_bytes = 16;
+    return 0;
+}
+
+int esp_aes_crypt_ecb(esp_aes_context* ctx, int mode, const unsigned char input[16], unsigned char output[16]) {
+    if (mode != ESP_AES_ENCRYPT || ctx->key_bytes != 16) {
+        return -1;
+    }
+    encryptBlock(ctx->key, input, output);
+    return 0;
+}
+
+int esp_aes_crypt_ctr(esp_aes_context* ctx, size_t length, size_t* nc_off, unsigned char nonce_counter[16],
+                      unsigned char stream_block[16], const unsigned char* input, unsigned char* output) {
+    if (ctx->key_bytes != 16) {
+        return -1;
+    }
+    size_t offset = *nc_off;
+    for (size_t i = 0; i < length; i++) {
+        if (offset == 0) {
+            encryptBlock(ctx->key, nonce_counter, stream_block);
+            for (int j = 15; j >= 0; j--) {
+                if (++nonce_counter[j] != 0) {
+                    break;
+                }
+            }
+        }
+        output[i] = input[i] ^ stream_block[offset];
+        offset = (offset + 1) & 0x0f;
+    }
+    *nc_off = offset;
+    return 0;
+}
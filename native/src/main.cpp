@@ -0,0 +1,1283 @@
+// Host runner for the native environment (pio run -e native -t exec).
+// Feeds encrypted SmartShunt, SmartSolar and Orion DC-DC advertisements through the
+// NimBLE shim into VictronBLE, then checks the decoded readings, the MQTT payloads
+// and the /api/devices/live JSON. Exits non-zero if any check fails.
+//
+//   program [-v]                                       run the checks
+//   program --replay FILE [--realtime] [--key MAC=HEX]... replay a capture from /api/capture/file
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include "VictronBLE.h"
+#include "MQTTPublisher.h"
+#include "WebConfigServer.h"
+#include "EcoWorthyBMS.h"
+#include "AdvertisementCapture.h"
+#include "DeferredLog.h"
+#include "PeriodicTask.h"
+#include "HistoryStore.h"
+#include "HistoryLog.h"
+#include "BaselineParsers.h"
+#include <new>
+#include <string>
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// Heap allocation counter, like the benchmark's, but only for the thread that is
+// measuring: the shim's tasks and the web server allocate on their own
+static thread_local bool countingAllocations = false;
+static thread_local uint64_t allocationCount = 0;
+
+void* operator new(size_t size) {
+    if (countingAllocations) {
+        allocationCount++;
+    }
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        abort();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    if (countingAllocations) {
+        allocationCount++;
+    }
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+static void checkNear(float actual, float expected, float tolerance, const char* what) {
+    if (fabsf(actual - expected) > tolerance) {
+        fprintf(stderr, "FAIL: %s = %.3f, expected %.3f\n", what, actual, expected);
+        failures++;
+    }
+}
+
+// Log drain target that takes at most room bytes until refilled, like a busy UART
+class LogSink : public Print {
+public:
+    std::string text;
+    int room;
+    
+    LogSink() : room(0) {}
+    int availableForWrite() override { return room; }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        size_t taken = size < (size_t)room ? size : (size_t)room;
+        text.append((const char*)buffer, taken);
+        room -= (int)taken;
+        return taken;
+    }
+    using Print::write;
+};
+
+static int evaluations = 0;
+
+static int countEvaluation() {
+    return ++evaluations;
+}
+
+// Write value into payload little-endian at an arbitrary bit position (Victron record order)
+static void putBits(uint8_t* payload, int bitOffset, int bitWidth, uint32_t value) {
+    for (int i = 0; i < bitWidth; i++) {
+        int bit = bitOffset + i;
+        if (value & (1u << i)) {
+            payload[bit / 8] |= (uint8_t)(1u << (bit % 8));
+        } else {
+            payload[bit / 8] &= (uint8_t)~(1u << (bit % 8));
+        }
+    }
+}
+
+struct SampleDevice {
+    const char* address;
+    const char* name;
+    const char* keyHex;
+    uint16_t modelId;
+    uint8_t readoutType;
+    uint8_t payload[16];
+    size_t payloadLength;
+};
+
+static bool parseHex(const char* hex, uint8_t* out, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        unsigned int value;
+        if (sscanf(hex + i * 2, "%2x", &value) != 1) {
+            return false;
+        }
+        out[i] = (uint8_t)value;
+    }
+    return true;
+}
+
+// Build a complete advertisement (flags, Victron manufacturer data, name) and
+// encrypt the record with AES-128-CTR as the device would. The name is in the scan
+// response, which only an active scan receives (withName).
+static void buildAdvertisement(const SampleDevice& sample, uint16_t counter, NimBLEAdvertisedDevice& device,
+                               bool withName = true) {
+    uint8_t key[16];
+    parseHex(sample.keyHex, key, sizeof(key));
+    AesCtrKey aesKey;
+    AesCtr::setKey(aesKey, key);
+    
+    uint8_t nonce[16] = {0};
+    nonce[0] = (uint8_t)(counter & 0xff);
+    nonce[1] = (uint8_t)(counter >> 8);
+    
+    uint8_t manufacturerData[MAX_ADVERTISEMENT_DATA];
+    manufacturerData[0] = 0xe1;                             // Victron company ID 0x02E1
+    manufacturerData[1] = 0x02;
+    manufacturerData[2] = 0x10;                             // Record prefix
+    manufacturerData[3] = 0x00;
+    manufacturerData[4] = (uint8_t)(sample.modelId & 0xff);
+    manufacturerData[5] = (uint8_t)(sample.modelId >> 8);
+    manufacturerData[6] = sample.readoutType;
+    manufacturerData[7] = nonce[0];
+    manufacturerData[8] = nonce[1];
+    manufacturerData[9] = key[0];
+    AesCtr::crypt(AES_BACKEND_SOFTWARE, aesKey, nonce, sample.payload, &manufacturerData[10], sample.payloadLength);
+    AesCtr::freeKey(aesKey);
+    
+    uint8_t payload[64];
+    size_t length = 0;
+    size_t dataLength = 10 + sample.payloadLength;
+    size_t nameLength = withName ? strlen(sample.name) : 0;
+    payload[length++] = 2;
+    payload[length++] = 0x01;
+    payload[length++] = 0x06;
+    payload[length++] = (uint8_t)(1 + dataLength);
+    payload[length++] = 0xff;
+    memcpy(&payload[length], manufacturerData, dataLength);
+    length += dataLength;
+    if (nameLength > 0) {
+        payload[length++] = (uint8_t)(1 + nameLength);
+        payload[length++] = 0x09;
+        memcpy(&payload[length], sample.name, nameLength);
+        length += nameLength;
+    }
+    
+    device.setAddress(NimBLEAddress(std::string(sample.address)));
+    device.setRSSI(-67);
+    device.setPayload(payload, length);
+}
+
+// Firmware task layout in miniature: ingest, a display stand-in and MQTT
+struct TaskTestContext {
+    VictronBLE* victronBLE;
+    MQTTPublisher* mqttPublisher;
+    const SampleDevice* samples[3];
+    uint16_t counter;
+    String screen;
+};
+
+static void bleTestTick(void* context) {
+    TaskTestContext* test = static_cast<TaskTestContext*>(context);
+    NimBLEAdvertisedDevice advertisement;
+    test->counter++;
+    for (int i = 0; i < 3; i++) {
+        buildAdvertisement(*test->samples[i], test->counter, advertisement);
+        NimBLEDevice::getScan()->nativeDeliver(&advertisement);
+    }
+    test->victronBLE->loop();
+}
+
+static void uiTestTick(void* context) {
+    TaskTestContext* test = static_cast<TaskTestContext*>(context);
+    VictronBLE::DeviceLock lock(*test->victronBLE);
+    VictronDeviceData* device = test->victronBLE->getDevice(String(test->samples[0]->address));
+    if (device) {
+        test->screen = device->name + " " + String(device->voltage, 2) + " V " + String(device->current, 3) + " A";
+    }
+}
+
+static void netTestTick(void* context) {
+    static_cast<TaskTestContext*>(context)->mqttPublisher->loop();
+}
+
+static void slowTestTick(void* context) {
+    (void)context;
+    vTaskDelay(pdMS_TO_TICKS(500));
+}
+
+static void publishSink(const char* topic, const char* payload, bool retained, void* context) {
+    (void)retained;
+    String* messages = (String*)context;
+    *messages += topic;
+    *messages += "=";
+    *messages += payload;
+    *messages += "\n";
+}
+
+// The fields changed on one slot, from every event the subscriber has waiting
+static VictronChangeMask takeSlotChanges(VictronBLE& victronBLE, int subscriber, int slot) {
+    VictronBLE::DeviceLock lock(victronBLE);
+    VictronChangeMask changes = 0;
+    ChangeEvent event;
+    while (victronBLE.nextChange(subscriber, event)) {
+        if (event.slot == slot) {
+            changes |= event.fields;
+        }
+    }
+    return changes;
+}
+
+// Decodes payloads through parseVictronAdvertisement() (the layout tables) and the
+// baseline parsers, and counts the ones whose reading or error text differ
+class DecoderEquivalence {
+public:
+    // Field positions of the baseline parsers with their sentinels and the raw
+    // values around the voltage, temperature and current checks
+    struct SpecialField {
+        uint8_t bitOffset;
+        uint8_t bitWidth;
+        int32_t values[5];
+    };
+    
+    static int run(VictronDeviceType type, int payloads, uint32_t seed) {
+        static const SpecialField SHUNT[] = {
+            {   0, 16, { 0xFFFF, 0, 1, 0xFFFE, 0xFFFF } },
+            {  16, 16, { 0x7FFF, 3000, 3001, -3000, -3001 } },
+            {  48, 16, { 0x7FFF, 0xFFFF, 32315, 32316, 0 } },
+            {  64,  2, { 0, 1, 2, 3, 2 } },
+            {  66, 22, { 0x1FFFFF, -0x200000, 0, 100000, -100000 } },
+            {  88, 20, { 0xFFFFF, 0, 0xFFFFE, 1, 0 } },
+            { 108, 10, { 0x3FF, 0x3FE, 1000, 0, 0x3FF } },
+        };
+        static const SpecialField SOLAR[] = {
+            {  16, 16, { 0x7FFF, 3000, 3001, -3000, -3001 } },
+            {  32, 16, { 0x7FFF, 1000, 1001, -1000, -1001 } },
+            {  48, 16, { 0xFFFF, 0, 0xFFFE, 1, 0xFFFF } },
+            {  64, 16, { 0xFFFF, 0, 0xFFFE, 1, 0xFFFF } },
+            {  80,  9, { 0x1FF, 0x1FE, 0, 0x100, 0x1FF } },
+        };
+        static const SpecialField DCDC[] = {
+            {  16, 16, { 0xFFFF, 3000, 3001, 0, 0xFFFE } },
+            {  32, 16, { 0x7FFF, 3000, 3001, -3000, -3001 } },
+        };
+        const SpecialField* special = DCDC;
+        size_t specialCount = sizeof(DCDC) / sizeof(DCDC[0]);
+        if (type == DEVICE_SMART_SHUNT) {
+            special = SHUNT;
+            specialCount = sizeof(SHUNT) / sizeof(SHUNT[0]);
+        } else if (type == DEVICE_SMART_SOLAR || type == DEVICE_BLUE_SMART_CHARGER) {
+            special = SOLAR;
+            specialCount = sizeof(SOLAR) / sizeof(SOLAR[0]);
+        }
+        
+        VictronBLE victronBLE;
+        VictronDeviceData device;
+        device.address = "aa:bb:cc:dd:ee:ff";
+        device.type = type;
+        VictronDeviceKey key;
+        key.hex = "0df4d0395b7d1a876c0c33ecb9e70dcd";
+        parseHex(key.hex.c_str(), key.bytes, sizeof(key.bytes));
+        key.valid = AesCtr::setKey(key.aes, key.bytes);
+        uint32_t state = seed;
+        int mismatches = 0;
+        
+        for (int n = 0; n < payloads; n++) {
+            // Random bytes, with about half of the fields set near a sentinel or check limit
+            uint8_t payload[16];
+            for (size_t i = 0; i < sizeof(payload); i++) {
+                payload[i] = (uint8_t)next(state);
+            }
+            for (size_t f = 0; f < specialCount; f++) {
+                if (next(state) & 1) {
+                    int32_t value = special[f].values[next(state) % 5] + (int32_t)(next(state) % 3) - 1;
+                    putBits(payload, special[f].bitOffset, special[f].bitWidth, (uint32_t)value);
+                }
+            }
+            
+            for (size_t length = 0; length <= sizeof(payload); length++) {
+                // Manufacturer ID, record prefix, model ID, readout type, nonce, key match byte,
+                // then the payload encrypted as the device would
+                uint8_t advertisement[VICTRON_PAYLOAD_OFFSET + sizeof(payload)] = {
+                    0xE1, 0x02, 0x10, 0x00, 0x89, 0xA3, 0x00, (uint8_t)n, (uint8_t)(n >> 8), key.bytes[0]
+                };
+                uint8_t nonce[16] = { (uint8_t)n, (uint8_t)(n >> 8) };
+                AesCtr::crypt(AES_BACKEND_SOFTWARE, key.aes, nonce, payload, advertisement + VICTRON_PAYLOAD_OFFSET,
+                              length);
+                
+                VictronReading decoded;
+                VictronReading expected;
+                memset((void*)&decoded, 0, sizeof(decoded));
+                memset((void*)&expected, 0, sizeof(expected));
+                new (&decoded) VictronReading();
+                new (&expected) VictronReading();
+                
+                bool valid = victronBLE.parseVictronAdvertisement(advertisement, VICTRON_PAYLOAD_OFFSET + length,
+                                                                  device, &key, decoded, nullptr);
+                BaselineParsers baseline;
+                expected.dataValid = true;
+                if (type == DEVICE_SMART_SHUNT) {
+                    baseline.parseSmartShuntData(payload, length, expected);
+                } else if (type == DEVICE_SMART_SOLAR || type == DEVICE_BLUE_SMART_CHARGER) {
+                    baseline.parseSolarControllerData(payload, length, expected);
+                } else {
+                    baseline.parseDCDCConverterData(payload, length, expected);
+                }
+                
+                if (valid != expected.dataValid || memcmp(&decoded, &expected, sizeof(decoded)) != 0 ||
+                    strcmp(victronBLE.parseError, baseline.error) != 0) {
+                    if (mismatches++ < 5) {
+                        fprintf(stderr, "decoder mismatch: type %d, %u bytes:", (int)type, (unsigned)length);
+                        for (size_t i = 0; i < length; i++) {
+                            fprintf(stderr, " %02X", payload[i]);
+                        }
+                        fprintf(stderr, " (\"%s\" / \"%s\")\n", victronBLE.parseError, baseline.error);
+                    }
+                }
+            }
+        }
+        AesCtr::freeKey(key.aes);
+        return mismatches;
+    }
+
+private:
+    static uint32_t next(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+};
+
+// Replay a capture file from the host filesystem and print the resulting devices.
+// Real-time mode paces on the simulated clock, so it finishes as fast as fast mode
+// but data ages and time-based logic see the recorded spacing.
+static int replayCapture(const char* path, bool realtime, const std::vector<String>& keys) {
+    FILE* input = fopen(path, "rb");
+    if (!input) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 2;
+    }
+    LittleFS.begin(true);
+    File file = LittleFS.open(CAPTURE_DEFAULT_PATH, "w");
+    uint8_t chunk[4096];
+    size_t length;
+    while ((length = fread(chunk, 1, sizeof(chunk), input)) > 0) {
+        file.write(chunk, length);
+    }
+    fclose(input);
+    file.close();
+    
+    VictronBLE victronBLE;
+    for (size_t i = 0; i < keys.size(); i++) {
+        int separator = keys[i].indexOf('=');
+        if (separator > 0) {
+            victronBLE.setEncryptionKey(keys[i].substring(0, separator), keys[i].substring(separator + 1));
+        }
+    }
+    
+    CaptureReplay replay;
+    replay.begin(LittleFS, &victronBLE);
+    replay.start(CAPTURE_DEFAULT_PATH, realtime ? REPLAY_REALTIME : REPLAY_FAST);
+    do {
+        replay.loop();
+        if (realtime) {
+            delay(1);
+        }
+    } while (replay.isActive());
+    
+    logRing.flush(Serial);
+    CaptureReplayStats stats = replay.getStats();
+    printf("replay: %u records, %u corrupt, %d devices\n", (unsigned)stats.replayed, (unsigned)stats.corrupt,
+           victronBLE.getDeviceCount());
+    for (VictronDeviceData& device : victronBLE.getDevices()) {
+        printf("  %s %-24s type=%d valid=%d V=%.2f A=%.3f SOC=%.1f rssi=%d\n", device.address.c_str(),
+               device.name.c_str(), (int)device.type, (int)device.dataValid, device.voltage, device.current,
+               device.batterySOC, device.rssi);
+    }
+    return stats.corrupt == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    bool verbose = false;
+    const char* replayPath = nullptr;
+    bool realtime = false;
+    std::vector<String> replayKeys;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--realtime") == 0) {
+            realtime = true;
+        } else if (strcmp(argv[i], "--key") == 0 && i + 1 < argc) {
+            replayKeys.push_back(String(argv[++i]));
+        } else {
+            fprintf(stderr, "usage: %s [-v] [--replay FILE [--realtime] [--key MAC=HEX]...]\n", argv[0]);
+            return 2;
+        }
+    }
+    Serial.setQuiet(!verbose);
+    
+    if (replayPath) {
+        return replayCapture(replayPath, realtime, replayKeys);
+    }
+    
+    SampleDevice shunt = {"c0:3b:98:2a:11:01", "SmartShunt HQ2203", "0df4d0395b7d1a876c0c33ecb9e70dcd",
+                          0xA389, READOUT_BATTERY_MONITOR, {0}, SMART_SHUNT_PAYLOAD_SIZE};
+    putBits(shunt.payload, 0, 16, 480);                           // 8 h to go
+    putBits(shunt.payload, 16, 16, 1284);                         // 12.84 V
+    putBits(shunt.payload, 48, 16, 0x7FFF);                       // No aux voltage
+    putBits(shunt.payload, 64, 2, 0);
+    putBits(shunt.payload, 66, 22, (uint32_t)(-3250) & 0x3FFFFF); // -3.250 A
+    putBits(shunt.payload, 88, 20, 125);                          // 12.5 Ah consumed
+    putBits(shunt.payload, 108, 10, 875);                         // 87.5 %
+    
+    SampleDevice solar = {"f4:12:fa:77:20:02", "SmartSolar HQ2104", "5d1a9ec1f8b43e7e2a11cc7a6d82b9f0",
+                          0xA053, READOUT_SOLAR_CHARGER, {0}, SOLAR_CONTROLLER_PAYLOAD_SIZE};
+    putBits(solar.payload, 0, 8, 3);                              // Bulk
+    putBits(solar.payload, 8, 8, 0);
+    putBits(solar.payload, 16, 16, 1352);                         // 13.52 V
+    putBits(solar.payload, 32, 16, 87);                           // 8.7 A
+    putBits(solar.payload, 48, 16, 142);                          // 1.42 kWh
+    putBits(solar.payload, 64, 16, 118);                          // 118 W
+    putBits(solar.payload, 80, 9, 0x1FF);                         // No load output
+    
+    SampleDevice dcdc = {"d8:8c:79:0e:30:03", "Orion Smart HQ2240", "b3f0e4a1967c2d58e0a4f1c3d27b6e95",
+                         0xA3C0, READOUT_DCDC_CONVERTER, {0}, DCDC_CONVERTER_PAYLOAD_SIZE};
+    putBits(dcdc.payload, 0, 8, 3);
+    putBits(dcdc.payload, 8, 8, 0);
+    putBits(dcdc.payload, 16, 16, 1296);                          // 12.96 V in
+    putBits(dcdc.payload, 32, 16, 1410);                          // 14.10 V out
+    putBits(dcdc.payload, 48, 32, 0);
+    
+    const SampleDevice* samples[] = {&shunt, &solar, &dcdc};
+    const size_t sampleCount = sizeof(samples) / sizeof(samples[0]);
+    
+    // Ingest: scan callback -> ring -> loop() parse and merge, recorded by the capture
+    // Advertisements are delivered in bursts here, so the scan runs continuously; the
+    // duty cycle has its own check below
+    VictronBLE victronBLE;
+    victronBLE.begin();
+    victronBLE.setAdaptiveScan(false);
+    victronBLE.startScanning();
+    for (size_t i = 0; i < sampleCount; i++) {
+        victronBLE.setEncryptionKey(samples[i]->address, samples[i]->keyHex);
+    }
+    
+    LittleFS.begin(true);
+    AdvertisementCapture capture;
+    capture.begin(LittleFS);
+    victronBLE.setCapture(&capture);
+    capture.start();
+    capture.loop();
+    check(capture.isRecording(), "capture recording");
+    
+    NimBLEScan* scan = NimBLEDevice::getScan();
+    NimBLEAdvertisedDevice advertisement;
+    for (uint16_t counter = 1; counter <= 20; counter++) {
+        for (size_t i = 0; i < sampleCount; i++) {
+            buildAdvertisement(*samples[i], counter, advertisement);
+            scan->nativeDeliver(&advertisement);
+        }
+        victronBLE.loop();
+        capture.loop();
+        nativeAdvanceTime(1000000);
+    }
+    capture.stop();
+    capture.loop();
+    victronBLE.setCapture(nullptr);
+    
+    check(victronBLE.getDeviceCount() == (int)sampleCount, "device count");
+    
+    VictronDeviceData* device = victronBLE.getDevice(String(shunt.address));
+    check(device != nullptr, "SmartShunt present");
+    if (device) {
+        check(device->type == DEVICE_SMART_SHUNT, "SmartShunt type");
+        check(device->dataValid, "SmartShunt data valid");
+        checkNear(device->voltage, 12.84f, 0.001f, "SmartShunt voltage");
+        checkNear(device->current, -3.25f, 0.001f, "SmartShunt current");
+        checkNear(device->power, 12.84f * -3.25f, 0.01f, "SmartShunt power");
+        checkNear(device->batterySOC, 87.5f, 0.01f, "SmartShunt SOC");
+        checkNear(device->consumedAh, 12.5f, 0.01f, "SmartShunt consumed Ah");
+        check(device->timeToGo == 480, "SmartShunt time to go");
+    }
+    
+    device = victronBLE.getDevice(String(solar.address));
+    check(device != nullptr, "SmartSolar present");
+    if (device) {
+        check(device->type == DEVICE_SMART_SOLAR, "SmartSolar type");
+        checkNear(device->voltage, 13.52f, 0.001f, "SmartSolar voltage");
+        checkNear(device->current, 8.7f, 0.001f, "SmartSolar current");
+        checkNear(device->yieldToday, 1.42f, 0.001f, "SmartSolar yield");
+        checkNear(device->pvPower, 118.0f, 0.001f, "SmartSolar PV power");
+    }
+    
+    device = victronBLE.getDevice(String(dcdc.address));
+    check(device != nullptr, "Orion present");
+    if (device) {
+        check(device->type == DEVICE_DCDC_CONVERTER, "Orion type");
+        checkNear(device->inputVoltage, 12.96f, 0.001f, "Orion input voltage");
+        checkNear(device->outputVoltage, 14.10f, 0.001f, "Orion output voltage");
+    }
+    
+    // The layout tables decode exactly like the hand-written parsers they replaced:
+    // random and near-sentinel payloads of 0-16 bytes, same reading bytes and error text
+    check(DecoderEquivalence::run(DEVICE_SMART_SHUNT, 2000, 0x5EED0001) == 0, "SmartShunt layout matches baseline parser");
+    check(DecoderEquivalence::run(DEVICE_SMART_SOLAR, 2000, 0x5EED0002) == 0, "SmartSolar layout matches baseline parser");
+    check(DecoderEquivalence::run(DEVICE_BLUE_SMART_CHARGER, 2000, 0x5EED0003) == 0,
+          "Blue Smart charger layout matches baseline parser");
+    check(DecoderEquivalence::run(DEVICE_DCDC_CONVERTER, 2000, 0x5EED0004) == 0, "DC-DC layout matches baseline parser");
+    
+    // MQTT payload formatting
+    String messages;
+    PubSubClient::nativeSetSink(publishSink, &messages);
+    MQTTPublisher mqttPublisher;
+    mqttPublisher.begin(&victronBLE);
+    MQTTConfig mqttConfig;
+    mqttConfig.broker = "localhost";
+    mqttConfig.enabled = true;
+    mqttPublisher.setConfig(mqttConfig);
+    mqttPublisher.connect();
+    check(mqttPublisher.isConnected(), "MQTT connected");
+    mqttPublisher.publishAll();
+    PubSubClient::nativeSetSink(nullptr, nullptr);
+    
+    check(messages.indexOf("victron/c0_3b_98_2a_11_01/voltage=12.84\n") >= 0, "MQTT SmartShunt voltage");
+    check(messages.indexOf("victron/c0_3b_98_2a_11_01/current=-3.250\n") >= 0, "MQTT SmartShunt current");
+    check(messages.indexOf("homeassistant/sensor/") >= 0, "MQTT discovery");
+    
+    // Web JSON builders through the registered routes
+    WebConfigServer webServer;
+    webServer.setVictronBLE(&victronBLE);
+    webServer.setMQTTPublisher(&mqttPublisher);
+    webServer.begin();
+    AsyncWebServer* server = AsyncWebServer::nativeLastStarted();
+    check(server != nullptr, "web server started");
+    
+    String liveJson;
+    if (server) {
+        AsyncWebServerRequest request(HTTP_GET, "/api/devices/live");
+        check(server->nativeHandle(&request), "live data route");
+        check(request.nativeResponseCode() == 200, "live data status");
+        liveJson = request.nativeResponseBody();
+        check(liveJson.startsWith("[{") && liveJson.endsWith("}]"), "live data is a JSON array");
+        check(liveJson.indexOf("\"address\":\"c0:3b:98:2a:11:01\"") >= 0, "live data SmartShunt address");
+        check(liveJson.indexOf("\"voltage\":12.84") >= 0, "live data SmartShunt voltage");
+        
+        AsyncWebServerRequest debugRequest(HTTP_GET, "/api/debug");
+        check(server->nativeHandle(&debugRequest), "debug route");
+        check(debugRequest.nativeResponseCode() == 200, "debug status");
+    }
+    
+    // Ingest metrics: counters 21-24 of the SmartShunt never arrive, and one SmartSolar
+    // frame is encrypted with another key (the correct frame follows)
+    SampleDevice wrongKey = solar;
+    wrongKey.keyHex = "00112233445566778899aabbccddeeff";
+    buildAdvertisement(shunt, 25, advertisement);
+    scan->nativeDeliver(&advertisement);
+    buildAdvertisement(wrongKey, 21, advertisement);
+    scan->nativeDeliver(&advertisement);
+    victronBLE.loop();
+    buildAdvertisement(solar, 22, advertisement);
+    scan->nativeDeliver(&advertisement);
+    victronBLE.loop();
+    {
+        VictronBLE::IngestLock ingestLock(victronBLE);
+        const DeviceMetrics& shuntMetrics = victronBLE.getDeviceMetrics(0);
+        const DeviceMetrics& solarMetrics = victronBLE.getDeviceMetrics(1);
+        check(shuntMetrics.packets == 21 && shuntMetrics.frames == 21 && shuntMetrics.counterGaps == 4,
+              "metrics count the missed SmartShunt frames");
+        check(shuntMetrics.rssiAverageX16 == -67 * 16 && shuntMetrics.noKey == 0 && shuntMetrics.keyMismatches == 0,
+              "metrics SmartShunt RSSI and key");
+        check(solarMetrics.keyMismatches == 1 && solarMetrics.counterGaps == 0, "metrics count the key mismatch");
+        uint32_t parses = 0;
+        for (int i = 0; i < METRICS_PARSE_BUCKETS; i++) {
+            parses += shuntMetrics.parseHistogram[i];
+        }
+        check(parses == shuntMetrics.frames && shuntMetrics.maxParseCycles > 0, "metrics parse-time histogram");
+    }
+    if (server) {
+        AsyncWebServerRequest request(HTTP_GET, "/api/metrics");
+        check(server->nativeHandle(&request) && request.nativeResponseCode() == 200, "metrics route");
+        String metricsJson = request.nativeResponseBody();
+        check(metricsJson.indexOf("\"address\":\"c0:3b:98:2a:11:01\",\"packets\":21,") >= 0 &&
+              metricsJson.indexOf("\"counterGaps\":4,") >= 0 && metricsJson.indexOf("\"keyMismatches\":1,") >= 0,
+              "metrics JSON");
+        if (verbose) {
+            printf("--- /api/metrics ---\n%s\n", metricsJson.c_str());
+        }
+    }
+    
+    // Capture replay: the recorded advertisements rebuild the same readings in a new
+    // instance; real-time mode waits for the recorded spacing
+    CaptureStats captureStats = capture.getStats();
+    check(captureStats.records == 20 * sampleCount, "capture record count");
+    check(captureStats.errors == 0, "capture errors");
+    
+    VictronBLE replayed;
+    for (size_t i = 0; i < sampleCount; i++) {
+        replayed.setEncryptionKey(samples[i]->address, samples[i]->keyHex);
+    }
+    CaptureReplay replay;
+    replay.begin(LittleFS, &replayed);
+    replay.start(capture.getPath(), REPLAY_REALTIME);
+    replay.loop();
+    check(replay.isActive() && replay.getStats().replayed < captureStats.records, "real-time replay is paced");
+    for (int second = 0; second < 25 && replay.isActive(); second++) {
+        nativeAdvanceTime(1000000);
+        replay.loop();
+    }
+    check(!replay.isActive() && replay.getStats().replayed == captureStats.records, "real-time replay complete");
+    device = replayed.getDevice(String(shunt.address));
+    check(device && device->dataValid, "replayed SmartShunt valid");
+    if (device) {
+        checkNear(device->voltage, 12.84f, 0.001f, "replayed SmartShunt voltage");
+        checkNear(device->current, -3.25f, 0.001f, "replayed SmartShunt current");
+    }
+    
+    // A record cut short by a power loss ends the file without losing the ones before it
+    File captureFile = LittleFS.open(capture.getPath(), "a");
+    const uint8_t truncated[] = {40, 0x01, 0x02};
+    captureFile.write(truncated, sizeof(truncated));
+    captureFile.close();
+    replay.start(capture.getPath(), REPLAY_FAST);
+    do {
+        replay.loop();
+    } while (replay.isActive());
+    check(replay.getStats().replayed == captureStats.records, "fast replay count");
+    check(replay.getStats().corrupt == 1, "truncated record detected");
+    
+    webServer.setCapture(&capture, &replay);
+    if (server) {
+        AsyncWebServerRequest request(HTTP_GET, "/api/capture");
+        check(server->nativeHandle(&request) && request.nativeResponseCode() == 200, "capture status route");
+        check(request.nativeResponseBody().indexOf("\"records\":60,") >= 0, "capture status records");
+        AsyncWebServerRequest download(HTTP_GET, "/api/capture/file");
+        check(server->nativeHandle(&download) && download.nativeResponseCode() == 200, "capture download route");
+    }
+    
+    // Rotation keeps both files within the budget
+    AdvertisementCapture rotating;
+    rotating.begin(LittleFS, "/rotate.bin", 8192);
+    rotating.start();
+    rotating.loop();
+    VictronAdvertisement adv;
+    adv.dataLength = 25;
+    strlcpy(adv.name, "SmartShunt HQ2203", sizeof(adv.name));
+    for (int i = 0; i < 400; i++) {
+        adv.timestampUs = i * 1000;
+        rotating.record(adv);
+    }
+    rotating.stop();
+    rotating.loop();
+    check(rotating.getStats().rotations > 0, "capture rotated");
+    File current = LittleFS.open("/rotate.bin", "r");
+    File previous = LittleFS.open("/rotate.bin.1", "r");
+    check(current && previous && current.size() <= 4096 && previous.size() <= 4096, "capture files within budget");
+    
+    // Deferred log: raw arguments are queued and formatted when drained
+    uint32_t recordsBefore = logRing.getStats().records;
+    LOG_AT(LOG_LEVEL_NONE, LOG_LEVEL_ERROR, "never %d\n", countEvaluation());
+    check(evaluations == 0 && logRing.getStats().records == recordsBefore, "disabled log call compiled out");
+#if LOG_RING_ENABLED
+    logRing.flush(Serial);
+    String deviceName = "SmartShunt";
+    logWrite("%s V=%.2f A=%.3f flags=%08X n=%ld %u%%\n", (deviceName + " HQ").c_str(), 12.84f, -3.5, -1, -7L, 42u);
+    LogSink sink;
+    sink.room = 16;
+    check(logRing.drain(sink) == 0 && sink.text.size() == 16, "log drain stops when the UART is full");
+    for (int i = 0; i < 8; i++) {
+        sink.room = 16;
+        if (logRing.drain(sink) == 1) {
+            break;
+        }
+    }
+    check(sink.text == "SmartShunt HQ V=12.84 A=-3.500 flags=FFFFFFFF n=-7 42%\n", "log record formatted on drain");
+    
+    uint32_t droppedBefore = logRing.getStats().dropped;
+    for (int i = 0; i < 500; i++) {
+        logWrite("filler %d\n", i);
+    }
+    check(logRing.getStats().dropped > droppedBefore, "full log ring drops records");
+    sink.text.clear();
+    sink.room = 1 << 20;
+    logRing.drain(sink, 1000);
+    check(sink.text.compare(0, 6, "[log] ") == 0 && sink.text.find("filler 0\n") != std::string::npos,
+          "dropped log records reported");
+#endif
+    
+    // Eco Worthy advertisement recognition (name and service UUID paths)
+    NimBLEAdvertisedDevice bms;
+    const uint8_t bmsPayload[] = {2, 0x01, 0x06, 3, 0x03, 0xf0, 0xff, 8, 0x09, 'D', 'C', 'H', 'O', 'U', 'S', 'E'};
+    bms.setPayload(bmsPayload, sizeof(bmsPayload));
+    check(EcoWorthyBMS::isEcoWorthyDevice(&bms), "Eco Worthy name");
+    const uint8_t servicePayload[] = {2, 0x01, 0x06, 3, 0x03, 0xf0, 0xff};
+    bms.setPayload(servicePayload, sizeof(servicePayload));
+    check(EcoWorthyBMS::isEcoWorthyDevice(&bms), "Eco Worthy service UUID");
+    
+    // Queued readings (Eco Worthy GATT data) are merged by the ingest task
+    VictronReading queued;
+    queued.voltage = 13.05f;
+    queued.hasVoltage = true;
+    queued.dataValid = true;
+    check(victronBLE.queueReading(dcdc.address, queued, millis()), "reading queued");
+    victronBLE.loop();
+    device = victronBLE.getDevice(String(dcdc.address));
+    check(device && fabsf(device->voltage - 13.05f) < 0.001f, "queued reading merged by loop()");
+    
+    // Field changes: consumers only see what moved, and a deadband holds back jitter
+    int dcdcSlot = victronBLE.getDevices().indexOf(device);
+    int testSubscriber = victronBLE.subscribeChanges("test", CHANGE_ALL);
+    check(testSubscriber >= 0, "change subscriber added");
+    mqttPublisher.publishAll();
+    messages = "";
+    PubSubClient::nativeSetSink(publishSink, &messages);
+    mqttPublisher.publishAll();
+    check(messages.length() == 0, "MQTT skips devices without changes");
+    queued.voltage = 13.10f;
+    victronBLE.queueReading(dcdc.address, queued, millis());
+    victronBLE.loop();
+    mqttPublisher.publishAll();
+    PubSubClient::nativeSetSink(nullptr, nullptr);
+    check(messages == "victron/d8_8c_79_0e_30_03/voltage=13.10\nvictron/d8_8c_79_0e_30_03/rssi=-67\n",
+          "MQTT publishes only the changed field");
+    check(takeSlotChanges(victronBLE, testSubscriber, dcdcSlot) == CHANGE_BIT(CHANGE_VOLTAGE),
+          "change event names the field");
+    victronBLE.setChangeDeadband(CHANGE_VOLTAGE, 0.05f);
+    queued.voltage = 13.14f;
+    victronBLE.queueReading(dcdc.address, queued, millis());
+    victronBLE.loop();
+    check(!victronBLE.hasChanges(testSubscriber) && fabsf(device->voltage - 13.10f) < 0.001f,
+          "change within the deadband suppressed");
+    queued.voltage = 13.20f;
+    victronBLE.queueReading(dcdc.address, queued, millis());
+    victronBLE.loop();
+    check(takeSlotChanges(victronBLE, testSubscriber, dcdcSlot) == CHANGE_BIT(CHANGE_VOLTAGE) &&
+          fabsf(device->voltage - 13.20f) < 0.001f, "change beyond the deadband reported");
+    victronBLE.setChangeDeadband(CHANGE_VOLTAGE, 0.0f);
+    victronBLE.unsubscribeChanges(testSubscriber);
+    
+    // Change bus: undelivered events coalesce, device filters apply, and an overflowed
+    // queue still delivers every slot
+    static ChangeBus<40> bus;
+    int voltageSubscriber = bus.subscribe("voltage", CHANGE_BIT(CHANGE_VOLTAGE) | CHANGE_BIT(CHANGE_SOC));
+    int currentSubscriber = bus.subscribe("current", CHANGE_BIT(CHANGE_CURRENT));
+    ChangeEvent event;
+    bus.publish(3, CHANGE_BIT(CHANGE_VOLTAGE));
+    bus.publish(3, CHANGE_BIT(CHANGE_SOC) | CHANGE_BIT(CHANGE_POWER));
+    check(!bus.hasEvents(currentSubscriber) && bus.next(voltageSubscriber, event) && event.slot == 3 &&
+          event.fields == (CHANGE_BIT(CHANGE_VOLTAGE) | CHANGE_BIT(CHANGE_SOC)) && !bus.next(voltageSubscriber, event),
+          "change events coalesced per slot");
+    bus.followAllDevices(voltageSubscriber, false);
+    bus.followDevice(voltageSubscriber, 7, true);
+    bus.publish(6, CHANGE_BIT(CHANGE_VOLTAGE));
+    bus.publish(7, CHANGE_BIT(CHANGE_VOLTAGE));
+    check(bus.next(voltageSubscriber, event) && event.slot == 7 && !bus.next(voltageSubscriber, event),
+          "change events filtered by device");
+    uint64_t seen = 0;
+    for (uint16_t slot = 0; slot < 40; slot++) {
+        bus.publish(slot, CHANGE_BIT(CHANGE_CURRENT));
+    }
+    while (bus.next(currentSubscriber, event)) {
+        seen |= 1ULL << event.slot;
+    }
+    ChangeSubscriberStats busStats = bus.getStats(currentSubscriber);
+    check(seen == (1ULL << 40) - 1 && busStats.overflows == 40 - CHANGE_QUEUE_SIZE && busStats.delivered == 40,
+          "overflowed change queue delivers every slot");
+    if (server) {
+        AsyncWebServerRequest request(HTTP_GET, "/api/devices/live");
+        check(server->nativeHandle(&request) && request.nativeResponseBody().indexOf("\"voltage\":13.20") >= 0,
+              "live data rebuilt after a change");
+    }
+    
+    // Tasks: the display tick keeps its period while the MQTT task is stuck connecting
+    // to an unreachable broker
+    WiFi.begin("native");
+    PubSubClient::nativeSetOutage(1200);
+    MQTTPublisher stalled;
+    stalled.begin(&victronBLE);
+    stalled.setConfig(mqttConfig);
+    TaskTestContext taskTest = {&victronBLE, &stalled, {&shunt, &solar, &dcdc}, 100, String()};
+    TaskConfig bleTask = {"ble", BLE_TASK_STACK, BLE_TASK_PRIORITY, BLE_TASK_CORE, BLE_TASK_PERIOD_MS};
+    TaskConfig uiTask = {"ui", UI_TASK_STACK, UI_TASK_PRIORITY, UI_TASK_CORE, UI_TASK_PERIOD_MS};
+    TaskConfig netTask = {"net", NET_TASK_STACK, NET_TASK_PRIORITY, NET_TASK_CORE, NET_TASK_PERIOD_MS};
+    PeriodicTask ble, ui, net;
+    check(ble.start(bleTask, bleTestTick, &taskTest), "BLE task started");
+    check(ui.start(uiTask, uiTestTick, &taskTest), "UI task started");
+    check(net.start(netTask, netTestTick, &taskTest), "NET task started");
+    vTaskDelay(pdMS_TO_TICKS(1500));
+    ui.stop();
+    ble.stop();
+    net.stop();
+    PubSubClient::nativeSetOutage(0);
+    
+    // A timed stop returns while the tick is still running, as on the reboot path
+    TaskConfig slowTask = {"slow", NET_TASK_STACK, NET_TASK_PRIORITY, NET_TASK_CORE, NET_TASK_PERIOD_MS};
+    PeriodicTask slow;
+    slow.start(slowTask, slowTestTick, nullptr);
+    vTaskDelay(pdMS_TO_TICKS(50));
+    unsigned long stopStarted = millis();
+    bool slowStopped = slow.stop(100);
+    check(!slowStopped && millis() - stopStarted < 300 && slow.isRunning(), "task stop gives up after its timeout");
+    check(slow.stop() && !slow.isRunning(), "task stop waits for the tick without a timeout");
+    
+    TaskTiming uiTiming = ui.getTiming();
+    TaskTiming netTiming = net.getTiming();
+    check(netTiming.maxRunUs >= 1000000, "MQTT task blocked by the outage");
+    check(ble.getTiming().ticks > 100, "BLE task kept ingesting");
+    check(uiTiming.ticks > 100 && uiTiming.lateTicks == 0 && uiTiming.maxJitterUs < TASK_JITTER_LIMIT_US,
+          "display tick jitter under 20 ms during the outage");
+    check(taskTest.screen.startsWith("SmartShunt HQ2203 12.84 V"), "display read the snapshot");
+    if (server) {
+        AsyncWebServerRequest request(HTTP_GET, "/api/debug");
+        check(server->nativeHandle(&request) && request.nativeResponseBody().indexOf("\"tasks\":[{\"name\":\"ble\"") >= 0,
+              "debug task timing");
+    }
+    if (verbose) {
+        printf("tasks: ui %u ticks, max jitter %u us; net max run %u us\n", (unsigned)uiTiming.ticks,
+               (unsigned)uiTiming.maxJitterUs, (unsigned)netTiming.maxRunUs);
+    }
+    
+    // Adaptive scan duty cycle: devices advertise on their own period plus the 0-10 ms
+    // BLE advertising delay and are only heard while the scan runs. The Orion starts
+    // advertising late and is found by the periodic discovery scan.
+    VictronBLE dutyCycled;
+    dutyCycled.begin();
+    for (size_t i = 0; i < sampleCount; i++) {
+        dutyCycled.setEncryptionKey(samples[i]->address, samples[i]->keyHex);
+    }
+    dutyCycled.startScanning();
+    const int64_t periodsUs[] = {1000000, 780000, 1210000};
+    int64_t nextArrivalUs[] = {137000, 412000, 30000000};
+    uint32_t advertisingDelay = 12345;
+    uint16_t dutyCounter = 1;
+    int arrivals = 0;
+    int heard = 0;
+    int64_t dutyStartUs = esp_timer_get_time();
+    for (int64_t elapsedUs = 0; elapsedUs < 120000000; elapsedUs += 5000) {
+        nativeAdvanceTime(5000);
+        for (size_t i = 0; i < sampleCount; i++) {
+            if (elapsedUs < nextArrivalUs[i]) {
+                continue;
+            }
+            buildAdvertisement(*samples[i], dutyCounter++, advertisement);
+            arrivals++;
+            heard += scan->nativeDeliver(&advertisement) ? 1 : 0;
+            advertisingDelay = advertisingDelay * 1103515245u + 12345u;
+            nextArrivalUs[i] += periodsUs[i] + (advertisingDelay >> 16) % 11 * 1000;
+        }
+        dutyCycled.loop();
+    }
+    ScanSchedulerStats scanStats = dutyCycled.getScanStats();
+    check(scanStats.adaptive && scanStats.tracked == sampleCount && scanStats.locked == sampleCount,
+          "duty cycle locked onto every device");
+    check(scanStats.radioOnPercent < 40.0f, "duty cycle radio-on under 40%");
+    check(scanStats.windows > 100 && scanStats.missedPercent < 5.0f, "duty cycle misses under 5% of windows");
+    check(scanStats.discoveries >= 2, "periodic discovery scan ran");
+    for (size_t i = 0; i < sampleCount; i++) {
+        device = dutyCycled.getDevice(String(samples[i]->address));
+        int64_t sinceUs = esp_timer_get_time() - (int64_t)(device ? device->lastUpdate : 0) * 1000;
+        check(device && device->dataValid && sinceUs < 2500000, "duty-cycled device kept up to date");
+    }
+    if (server) {
+        AsyncWebServerRequest request(HTTP_GET, "/api/debug");
+        check(server->nativeHandle(&request) && request.nativeResponseBody().indexOf("\"scan\":{\"adaptive\":false") >= 0,
+              "debug scan statistics");
+    }
+    if (verbose) {
+        printf("scan: radio on %.1f%% of %.0f s, %u windows, %.1f%% missed, %d of %d arrivals heard, %u discoveries\n",
+               scanStats.radioOnPercent, (esp_timer_get_time() - dutyStartUs) / 1e6, (unsigned)scanStats.windows,
+               scanStats.missedPercent, heard, arrivals, (unsigned)scanStats.discoveries);
+    }
+    
+    // Passive scanning: the first advertisement of an unnamed MAC starts an active probe
+    // for its name, which is cached across reboots. Without a known readout type or model the
+    // SmartShunt is only recognised by its name.
+    Preferences namePreferences;
+    namePreferences.begin(NAME_CACHE_NAMESPACE, false);
+    namePreferences.clear();
+    namePreferences.end();
+    SampleDevice namedOnly = shunt;
+    namedOnly.readoutType = 0;
+    namedOnly.modelId = 0x0100;  // Unknown model, with a zero byte 4 that must not read as a plain frame
+    VictronBLE passive;
+    passive.begin();
+    passive.setAdaptiveScan(false);
+    passive.setEncryptionKey(namedOnly.address, namedOnly.keyHex);
+    passive.startScanning();
+    check(passive.isPassiveScan() && !scan->getActiveScan(), "passive scan by default");
+    buildAdvertisement(namedOnly, 1, advertisement, scan->getActiveScan());
+    scan->nativeDeliver(&advertisement);
+    passive.loop();
+    check(scan->getActiveScan() && passive.getNameProbeCount() == 1, "unnamed MAC starts an active probe");
+    for (uint16_t counter = 2; counter < 40; counter++) {
+        nativeAdvanceTime(100000);
+        buildAdvertisement(namedOnly, counter, advertisement, scan->getActiveScan());
+        scan->nativeDeliver(&advertisement);
+        passive.loop();
+    }
+    check(!scan->getActiveScan() && passive.getNameProbeCount() == 1, "probe ends once the name is known");
+    nativeAdvanceTime((int64_t)NAME_CACHE_SAVE_DELAY * 1000);
+    passive.loop();
+    
+    VictronBLE rebooted;
+    rebooted.begin();
+    rebooted.setAdaptiveScan(false);
+    rebooted.setEncryptionKey(namedOnly.address, namedOnly.keyHex);
+    rebooted.startScanning();
+    check(rebooted.getCachedNameCount() == 1, "name cache loaded after reboot");
+    buildAdvertisement(namedOnly, 50, advertisement, scan->getActiveScan());
+    scan->nativeDeliver(&advertisement);
+    rebooted.loop();
+    device = rebooted.getDevice(String(namedOnly.address));
+    check(device && device->name == namedOnly.name && device->type == DEVICE_SMART_SHUNT,
+          "cached name identifies the device after reboot");
+    check(device && fabsf(device->voltage - 12.84f) < 0.001f, "name-identified SmartShunt decoded");
+    check(!scan->getActiveScan() && rebooted.getNameProbeCount() == 0, "no probe for a cached name");
+    
+    // A GATT connection holds the scan: it is stopped before holdScan() returns and
+    // loop() leaves it off until the hold is released
+    rebooted.loop();
+    check(scan->isScanning(), "scan running before the hold");
+    rebooted.holdScan(true);
+    check(!scan->isScanning(), "holdScan stops the scan");
+    rebooted.loop();
+    check(!scan->isScanning(), "held scan not restarted by loop()");
+    rebooted.holdScan(false);
+    rebooted.loop();
+    check(scan->isScanning(), "scan resumes after the hold");
+    
+    // More nameless MACs than the cache holds: probes stop once the cache is full of
+    // MACs given up on, rather than restarting their counts and saving them forever
+    namePreferences.begin(NAME_CACHE_NAMESPACE, false);
+    namePreferences.clear();
+    namePreferences.end();
+    DeviceNameCache crowded;
+    crowded.begin();
+    const uint64_t CROWD_BASE = 0x0000A4C138000000ULL;
+    const int CROWD_SIZE = 200;
+    int crowdProbes = 0;
+    unsigned long crowdTime = 0;
+    for (int probe = 1; probe <= 200; probe++) {
+        bool wanted = false;
+        for (int i = 0; i < CROWD_SIZE; i++) {
+            wanted = crowded.needsProbe(CROWD_BASE + i) || wanted;
+        }
+        if (!wanted) {
+            continue;
+        }
+        crowdProbes++;
+        for (int i = 0; i < CROWD_SIZE; i++) {
+            crowded.heardUnnamed(CROWD_BASE + i, (uint8_t)probe, crowdTime);
+        }
+        crowdTime += NAME_PROBE_INTERVAL;
+        crowded.saveIfDue(crowdTime);
+    }
+    uint32_t crowdSaves = crowded.getSaveCount();
+    bool crowdWanted = false;
+    for (int i = 0; i < CROWD_SIZE; i++) {
+        crowdWanted = crowded.needsProbe(CROWD_BASE + i) || crowdWanted;
+    }
+    check(!crowdWanted && crowdProbes < 20, "nameless crowd stops being probed");
+    check(crowded.getGaveUpCount() == NAME_GAVE_UP_SIZE && crowdSaves <= (uint32_t)crowdProbes,
+          "nameless crowd saved only when given up on");
+    crowded.remember(CROWD_BASE + CROWD_SIZE, "SmartShunt HQ", crowdTime);
+    check(crowded.lookup(CROWD_BASE + CROWD_SIZE) != nullptr, "name cached next to the nameless crowd");
+    crowded.save();
+    DeviceNameCache crowdReloaded;
+    crowdReloaded.begin();
+    check(crowdReloaded.getGaveUpCount() == NAME_GAVE_UP_SIZE && !crowdReloaded.needsProbe(CROWD_BASE),
+          "given-up MACs stay unprobed after reboot");
+    namePreferences.begin(NAME_CACHE_NAMESPACE, false);
+    namePreferences.clear();
+    namePreferences.end();
+    
+    // Steady-state ingest allocates nothing: 100k replayed frames, a new counter and
+    // reading each, go scan callback -> ring -> loop() parse, merge and change events
+    VictronBLE steady;
+    steady.begin();
+    steady.setAdaptiveScan(false);
+    for (size_t i = 0; i < sampleCount; i++) {
+        steady.setEncryptionKey(samples[i]->address, samples[i]->keyHex);
+    }
+    steady.startScanning();
+    int steadySubscriber = steady.subscribeChanges("test", CHANGE_ALL);
+    SampleDevice replayedShunt = shunt;
+    const SampleDevice* replayedSamples[] = {&replayedShunt, &solar, &dcdc};
+    const uint32_t frames = 100000;
+    uint32_t delivered = 0;
+    uint64_t steadyAllocations = 0;
+    uint32_t steadyEvents = 0;
+    for (uint32_t round = 0; delivered < frames; round++) {
+        // Warm-up: the first 1000 rounds, and the name cache save they lead to
+        bool measured = round > 1000;
+        if (round == 1000) {
+            nativeAdvanceTime((int64_t)NAME_CACHE_SAVE_DELAY * 1000);
+        }
+        putBits(replayedShunt.payload, 16, 16, 1200 + round % 100);
+        for (size_t i = 0; i < sampleCount && delivered < frames; i++) {
+            buildAdvertisement(*replayedSamples[i], (uint16_t)(round + 1), advertisement);
+            allocationCount = 0;
+            countingAllocations = measured;
+            scan->nativeDeliver(&advertisement);
+            countingAllocations = false;
+            steadyAllocations += allocationCount;
+            delivered += measured ? 1 : 0;
+        }
+        allocationCount = 0;
+        countingAllocations = measured;
+        steady.loop();
+        {
+            VictronBLE::DeviceLock lock(steady);
+            ChangeEvent event;
+            while (steady.nextChange(steadySubscriber, event)) {
+                steadyEvents += measured ? 1 : 0;
+            }
+        }
+        countingAllocations = false;
+        steadyAllocations += allocationCount;
+        nativeAdvanceTime(10000);
+    }
+    IngestStats steadyStats = steady.getIngestStats();
+    check(steadyStats.processed >= frames && steadyStats.drops == 0 && steadyEvents > 0,
+          "replayed frames ingested");
+    check(steadyAllocations == 0, "no heap allocation per replayed frame");
+    steady.unsubscribeChanges(steadySubscriber);
+    
+    // History: four hours of a SmartShunt/SmartSolar pair at 1 Hz, at the readings'
+    // resolution, decode back exactly; the pool evicts oldest-first once it is full
+    HistoryStore history;
+    check(history.begin() && history.getStats().psram, "history store in PSRAM");
+    const uint64_t historyDevice = 0xd88c790e3003ULL;
+    const uint32_t historySeconds = 4 * 3600;
+    std::vector<float> voltages;
+    uint32_t noise = 12345;
+    float yield = 0.0f;
+    for (uint32_t t = 0; t < historySeconds; t++) {
+        noise = noise * 1103515245u + 12345u;
+        float jitter = (int)((noise >> 16) % 3) - 1;   // -1, 0 or +1 in the last digit
+        float voltage = roundf((12.8f + 0.3f * sinf(t / 3600.0f)) * 100.0f + jitter) / 100.0f;
+        float current = roundf((-3.5f + 2.0f * sinf(t / 600.0f)) * 1000.0f + 20.0f * jitter) / 1000.0f;
+        float pvPower = roundf(fmaxf(0.0f, 300.0f * sinf(3.14159f * t / 43200.0f)));
+        yield += pvPower / 3600000.0f;
+        history.append(historyDevice, HISTORY_VOLTAGE, t, voltage);
+        history.append(historyDevice, HISTORY_CURRENT, t, current);
+        history.append(historyDevice, HISTORY_POWER, t, roundf(voltage * current));
+        history.append(historyDevice, HISTORY_SOC, t, roundf((80.0f - t / 720.0f) * 10.0f) / 10.0f);
+        history.append(historyDevice, HISTORY_TEMPERATURE, t, roundf((21.5f + t / 7200.0f) * 100.0f) / 100.0f);
+        history.append(historyDevice, HISTORY_PV_POWER, t, pvPower);
+        history.append(historyDevice, HISTORY_YIELD_TODAY, t, roundf(yield * 100.0f) / 100.0f);
+        voltages.push_back(voltage);
+    }
+    std::vector<HistoryPoint> points;
+    bool complete = history.query(historyDevice, HISTORY_VOLTAGE, 0, historySeconds, points, historySeconds);
+    bool exact = complete && points.size() == voltages.size();
+    for (size_t i = 0; exact && i < points.size(); i++) {
+        exact = points[i].time == i && points[i].value == voltages[i];
+    }
+    check(exact, "history decodes every sample exactly");
+    points.clear();
+    check(!history.query(historyDevice, HISTORY_VOLTAGE, 100, 200, points, 50) && points.size() == 50 &&
+          points[0].time == 100 && points[49].time == 149, "history query truncated at maxPoints");
+    HistoryStats historyStats = history.getStats();
+    check(historyStats.samples == historySeconds * HISTORY_METRIC_COUNT && historyStats.evictedBlocks == 0,
+          "history holds every sample");
+    check(historyStats.bytesPerSample < 2.0f, "history under 2 bytes per sample");
+    printf("history: %.2f bytes/sample (8 uncompressed), %.0f h of 1 Hz data for %d metrics in %u KB\n",
+           historyStats.bytesPerSample, historyStats.hoursAt1Hz, HISTORY_METRIC_COUNT,
+           (unsigned)(historyStats.budgetBytes / 1024));
+    
+    // Rollups: each tier's buckets aggregate exactly the raw samples they cover, a
+    // long range is answered from a coarse tier, and a gap clears what it skipped
+    std::vector<HistoryBucket> buckets;
+    check(history.queryRollup(historyDevice, HISTORY_VOLTAGE, HISTORY_TIER_MINUTE, 0, historySeconds, buckets, 1000) &&
+          buckets.size() == historySeconds / 60, "minute rollups cover the range");
+    float minimum = voltages[600];
+    float maximum = voltages[600];
+    double sum = 0.0;
+    for (uint32_t t = 600; t < 660; t++) {
+        minimum = fminf(minimum, voltages[t]);
+        maximum = fmaxf(maximum, voltages[t]);
+        sum += voltages[t];
+    }
+    const HistoryBucket& minute = buckets[10];
+    check(minute.start == 600 && minute.count == 60 && minute.min == minimum && minute.max == maximum &&
+          minute.last == voltages[659] && fabsf(minute.mean - (float)(sum / 60)) < 0.001f, "minute rollup aggregates");
+    buckets.clear();
+    history.queryRollup(historyDevice, HISTORY_VOLTAGE, HISTORY_TIER_HOUR, 0, historySeconds, buckets, 1000);
+    check(buckets.size() == 4 && buckets[1].start == 3600 && buckets[1].count == 3600 &&
+          buckets[1].last == voltages[7199], "hour rollups");
+    check(HistoryStore::resolutionFor(0, 599, 600) == HISTORY_TIER_RAW &&
+          HistoryStore::resolutionFor(0, 10 * 3600 - 1, 600) == HISTORY_TIER_MINUTE &&
+          HistoryStore::resolutionFor(0, 6 * 86400 - 1, 600) == HISTORY_TIER_QUARTER &&
+          HistoryStore::resolutionFor(0, 30 * 86400 - 1, 600) == HISTORY_TIER_HOUR, "query resolution by range");
+    uint32_t afterGap = historySeconds + 2 * 86400;
+    history.append(historyDevice, HISTORY_VOLTAGE, afterGap, 12.5f);
+    buckets.clear();
+    history.queryRollup(historyDevice, HISTORY_VOLTAGE, HISTORY_TIER_MINUTE, 0, afterGap, buckets, 1000);
+    check(buckets.size() == 1 && buckets[0].start == afterGap / 60 * 60 && buckets[0].count == 1,
+          "minute ring cleared by a gap longer than its span");
+    buckets.clear();
+    history.queryRollup(historyDevice, HISTORY_VOLTAGE, HISTORY_TIER_QUARTER, 0, afterGap, buckets, 1000);
+    check(buckets.size() == historySeconds / 900 + 1, "quarter-hour ring keeps data across the gap");
+    
+    HistoryStore small;
+    small.begin(8 * HISTORY_BLOCK_SIZE);
+    for (uint32_t t = 0; t < historySeconds; t++) {
+        small.append(historyDevice, HISTORY_VOLTAGE, t, voltages[t]);
+    }
+    points.clear();
+    small.query(historyDevice, HISTORY_VOLTAGE, 0, historySeconds, points, historySeconds);
+    HistoryStats smallStats = small.getStats();
+    check(smallStats.evictedBlocks > 0 && smallStats.blocksUsed == 8 && points.size() == smallStats.samples &&
+          points.back().time == historySeconds - 1 && points.back().value == voltages.back() &&
+          points[0].value == voltages[points[0].time], "full history evicts the oldest block");
+    
+    // Persistence: closed quarter-hour buckets go to a segment log on LittleFS, come
+    // back after a reboot and are queried together with the new ones in memory
+    const char* logDirectory = "/history-test/15m";
+    const String lastSegment = String(logDirectory) + "/1.seg";
+    HistoryBucket beforeReboot = {};
+    {
+        HistoryLog log;
+        log.begin(LittleFS, logDirectory, 64 * 1024);
+        HistoryStore persisted;
+        persisted.setLog(HISTORY_TIER_QUARTER, &log);
+        persisted.begin();
+        for (uint32_t t = 0; t < historySeconds; t++) {
+            persisted.append(historyDevice, HISTORY_VOLTAGE, t, voltages[t]);
+        }
+        log.flush();
+        HistoryLogStats logStats = log.getStats();
+        check(logStats.segments == 1 && logStats.recordsWritten == historySeconds / 900 - 1 && logStats.blocksWritten == 1,
+              "closed quarter-hour buckets written as one block");
+        buckets.clear();
+        persisted.queryRollup(historyDevice, HISTORY_VOLTAGE, HISTORY_TIER_QUARTER, 0, historySeconds, buckets, 1000);
+        beforeReboot = buckets[1];
+    }
+    {
+        HistoryLog log;
+        log.begin(LittleFS, logDirectory, 64 * 1024);
+        HistoryLogStats logStats = log.getStats();
+        check(logStats.recoveredRecords == historySeconds / 900 - 1 && logStats.tornBytes == 0 &&
+              log.getLastTime() == historySeconds - 2 * 900, "history log recovered after a reboot");
+        HistoryStore rebooted;
+        rebooted.setLog(HISTORY_TIER_QUARTER, &log);
+        rebooted.begin();
+        uint32_t base = log.getLastTime() + 900;
+        for (uint32_t t = base; t < base + 1800; t++) {
+            rebooted.append(historyDevice, HISTORY_VOLTAGE, t, 13.0f);
+        }
+        buckets.clear();
+        check(rebooted.queryRollup(historyDevice, HISTORY_VOLTAGE, HISTORY_TIER_QUARTER, 0, base + 1800, buckets, 1000) &&
+              buckets.size() == historySeconds / 900 + 1 && buckets[1].start == 900 &&
+              buckets[1].count == beforeReboot.count && buckets[1].min == beforeReboot.min &&
+              buckets[1].max == beforeReboot.max && buckets[1].last == beforeReboot.last &&
+              buckets[historySeconds / 900 - 1].start == base && buckets.back().last == 13.0f,
+              "rollup query spans the log and memory");
+        buckets.clear();
+        check(!rebooted.queryRollup(historyDevice, HISTORY_VOLTAGE, HISTORY_TIER_QUARTER, 0, base + 1800, buckets, 3) &&
+              buckets.size() == 3 && buckets[2].start == 1800, "logged rollups truncated at maxBuckets");
+        if (server) {
+            webServer.setHistory(&rebooted);
+            AsyncWebServerRequest metricsRequest(HTTP_GET, "/api/metrics");
+            check(server->nativeHandle(&metricsRequest) &&
+                  metricsRequest.nativeResponseBody().indexOf("\"logs\":{\"15m\":{\"segments\":1,") >= 0,
+                  "history log statistics in /api/metrics");
+            webServer.setHistory(nullptr);
+        }
+    }
+    {
+        // A block torn by a power cut: the scan stops in front of it and new blocks go to a new segment
+        File segment = LittleFS.open(lastSegment, "a");
+        const uint8_t torn[] = {0x0C, 0xB1, 0x20, 0x00, 0x01, 0x02, 0x03};
+        segment.write(torn, sizeof(torn));
+        segment.close();
+        HistoryLog log;
+        log.begin(LittleFS, logDirectory, 64 * 1024);
+        HistoryLogStats logStats = log.getStats();
+        check(logStats.recoveredRecords == historySeconds / 900 - 1 && logStats.tornBytes == sizeof(torn),
+              "torn block cut off by the recovery scan");
+        HistoryBucket next = {historySeconds, 1, 12.0f, 12.0f, 12.0f, 12.0f};
+        log.append(historyDevice, HISTORY_VOLTAGE, next);
+        log.flush();
+        buckets.clear();
+        check(log.getStats().segments == 2 &&
+              log.query(historyDevice, HISTORY_VOLTAGE, 0, historySeconds, buckets, 1000) &&
+              buckets.size() == historySeconds / 900 && buckets.back().start == historySeconds,
+              "blocks after a torn tail go to a new segment");
+    }
+    {
+        // Rotation: a log four times its budget keeps the newest segments
+        HistoryLog log;
+        log.begin(LittleFS, "/history-test/rotate", 2 * HISTORY_LOG_SEGMENT_SIZE);
+        const uint32_t records = 4 * 2 * HISTORY_LOG_SEGMENT_SIZE / HISTORY_LOG_RECORD_SIZE;
+        for (uint32_t i = 0; i < records; i++) {
+            HistoryBucket bucket = {i * 900, 900, 12.0f, 13.0f, 12.5f, 12.7f};
+            log.append(historyDevice, HISTORY_VOLTAGE, bucket);
+            log.loop();
+        }
+        log.flush();
+        HistoryLogStats logStats = log.getStats();
+        buckets.clear();
+        log.query(historyDevice, HISTORY_VOLTAGE, 0, records * 900, buckets, records);
+        check(logStats.bytes <= 2 * HISTORY_LOG_SEGMENT_SIZE && logStats.dropped == 0 && !buckets.empty() &&
+              buckets[0].start > 0 && buckets.back().start == (records - 1) * 900 &&
+              !LittleFS.exists("/history-test/rotate/1.seg"), "history log rotates within its budget");
+        
+        // A query over the whole log holds no more than maxBuckets candidates
+        uint32_t oldest = buckets[0].start;
+        std::vector<HistoryBucket> limited;
+        check(buckets.size() > 500 &&
+              !log.query(historyDevice, HISTORY_VOLTAGE, 0, records * 900, limited, 50) && limited.size() == 50 &&
+              limited.capacity() <= 64 && limited[0].start == oldest && limited[49].start == oldest + 49 * 900,
+              "history log query bounded by maxBuckets");
+    }
+    
+    if (server) {
+        webServer.setHistory(&history);
+        AsyncWebServerRequest request(HTTP_GET, "/api/history");
+        request.addParam("address", "d8:8c:79:0e:30:03");
+        request.addParam("metric", "voltage");
+        request.addParam("from", "0");
+        request.addParam("to", "2");
+        String firstPoints = "\"points\":[[0," + String(voltages[0], 3) + "],[1," + String(voltages[1], 3) + "],";
+        check(server->nativeHandle(&request) && request.nativeResponseBody().indexOf(firstPoints) >= 0,
+              "history served by /api/history");
+        AsyncWebServerRequest hourly(HTTP_GET, "/api/history");
+        hourly.addParam("address", "d8:8c:79:0e:30:03");
+        hourly.addParam("metric", "voltage");
+        hourly.addParam("from", "0");
+        hourly.addParam("to", String(30 * 86400));
+        check(server->nativeHandle(&hourly) && hourly.nativeResponseBody().indexOf("\"resolution\":\"1h\"") >= 0 &&
+              hourly.nativeResponseBody().indexOf(",3600],[3600,") >= 0, "long history range served from the hour tier");
+        AsyncWebServerRequest metricsRequest(HTTP_GET, "/api/metrics");
+        check(server->nativeHandle(&metricsRequest) && metricsRequest.nativeResponseBody().indexOf("\"history\":{\"psram\":true") >= 0,
+              "history statistics in /api/metrics");
+        webServer.setHistory(nullptr);
+    }
+    
+    logRing.flush(Serial);
+    if (verbose) {
+        printf("\n--- MQTT ---\n%s--- /api/devices/live ---\n%s\n", messages.c_str(), liveJson.c_str());
+    }
+    
+    IngestStats stats = victronBLE.getIngestStats();
+    printf("native: %d devices, %u advertisements processed, AES backend %s, %d failure(s)\n",
+           victronBLE.getDeviceCount(), (unsigned)stats.processed,
+           AesCtr::backendName(AesCtr::getBackend()), failures);
+    return failures == 0 ? 0 : 1;
+}
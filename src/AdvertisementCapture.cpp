@@ -0,0 +1,410 @@
+#include "AdvertisementCapture.h"
+#include "DeferredLog.h"
+#include <esp_timer.h>
+
+// Smallest budget that still holds a few seconds of a busy site per file
+#define CAPTURE_MIN_FILE_BYTES 4096
+
+AdvertisementCapture::AdvertisementCapture()
+    : filesystem(nullptr), maxFileBytes(CAPTURE_DEFAULT_MAX_BYTES / 2), fileBytes(0), bufferLength(0),
+      lastFlush(0), startRequested(false), stopRequested(false), recording(false),
+      records(0), bytes(0), rotations(0), errors(0) {
+}
+
+AdvertisementCapture::~AdvertisementCapture() {
+    if (recording) {
+        flush();
+        closeFile();
+    }
+}
+
+void AdvertisementCapture::begin(fs::FS& fs, const char* capturePath, uint32_t maxBytes) {
+    filesystem = &fs;
+    path = capturePath;
+    rotatedPath = path + ".1";
+    maxFileBytes = maxBytes / 2 < CAPTURE_MIN_FILE_BYTES ? CAPTURE_MIN_FILE_BYTES : maxBytes / 2;
+}
+
+void AdvertisementCapture::start() {
+    stopRequested.store(false);
+    startRequested.store(true);
+}
+
+void AdvertisementCapture::stop() {
+    startRequested.store(false);
+    stopRequested.store(true);
+}
+
+void AdvertisementCapture::loop() {
+    if (stopRequested.exchange(false) && recording) {
+        flush();
+        closeFile();
+        recording = false;
+        LOG_I(CAPTURE, "Capture stopped: %u records, %u bytes\n", records, bytes);
+    }
+    
+    if (startRequested.exchange(false)) {
+        if (recording) {
+            closeFile();
+            recording = false;
+        }
+        if (!filesystem) {
+            LOG_E(CAPTURE, "ERROR: Capture has no filesystem (begin() not called)\n");
+            errors++;
+            return;
+        }
+        
+        // A new capture replaces the previous one, rotated file included
+        filesystem->remove(rotatedPath);
+        filesystem->remove(path);
+        records = 0;
+        bytes = 0;
+        rotations = 0;
+        errors = 0;
+        bufferLength = 0;
+        if (openNewFile()) {
+            recording = true;
+            lastFlush = millis();
+            LOG_I(CAPTURE, "Capture started: %s (%u bytes per file)\n", path.c_str(), maxFileBytes);
+        }
+    }
+    
+    if (recording && bufferLength > 0 && millis() - lastFlush >= CAPTURE_FLUSH_INTERVAL) {
+        flush();
+    }
+}
+
+void AdvertisementCapture::append(const VictronAdvertisement& adv) {
+    if (bufferLength + CAPTURE_RECORD_MAX_SIZE > sizeof(buffer)) {
+        flush();
+    }
+    size_t length = encodeRecord(adv, &buffer[bufferLength]);
+    bufferLength += length;
+    records++;
+    bytes += length;
+}
+
+bool AdvertisementCapture::openNewFile() {
+    file = filesystem->open(path, "w");
+    if (!file) {
+        LOG_E(CAPTURE, "ERROR: Cannot create capture file %s\n", path.c_str());
+        errors++;
+        return false;
+    }
+    
+    uint8_t header[CAPTURE_HEADER_SIZE];
+    encodeHeader(header);
+    if (file.write(header, sizeof(header)) != sizeof(header)) {
+        LOG_E(CAPTURE, "ERROR: Cannot write capture header to %s\n", path.c_str());
+        errors++;
+        file.close();
+        return false;
+    }
+    fileBytes = sizeof(header);
+    bytes += sizeof(header);
+    return true;
+}
+
+void AdvertisementCapture::rotate() {
+    closeFile();
+    filesystem->remove(rotatedPath);
+    if (!filesystem->rename(path, rotatedPath)) {
+        LOG_E(CAPTURE, "ERROR: Cannot rotate %s\n", path.c_str());
+        errors++;
+    }
+    rotations++;
+    if (!openNewFile()) {
+        recording = false;
+    }
+}
+
+void AdvertisementCapture::flush() {
+    lastFlush = millis();
+    if (bufferLength == 0 || !file) {
+        bufferLength = 0;
+        return;
+    }
+    
+    // Records never straddle files, so each file replays on its own
+    if (fileBytes + bufferLength > maxFileBytes) {
+        rotate();
+        if (!recording) {
+            bufferLength = 0;
+            return;
+        }
+    }
+    
+    size_t written = file.write(buffer, bufferLength);
+    if (written != bufferLength) {
+        // Partition full or flash error: stop rather than retrying on every flush
+        LOG_E(CAPTURE, "ERROR: Capture write failed (%u of %u bytes), recording stopped\n",
+                       (unsigned)written, (unsigned)bufferLength);
+        errors++;
+        closeFile();
+        recording = false;
+    } else {
+        file.flush();
+        fileBytes += written;
+    }
+    bufferLength = 0;
+}
+
+void AdvertisementCapture::closeFile() {
+    if (file) {
+        file.close();
+    }
+    fileBytes = 0;
+}
+
+CaptureStats AdvertisementCapture::getStats() const {
+    CaptureStats stats;
+    stats.recording = recording;
+    stats.records = records;
+    stats.bytes = bytes;
+    stats.rotations = rotations;
+    stats.errors = errors;
+    stats.fileBytes = fileBytes + bufferLength;
+    stats.maxBytes = maxFileBytes * 2;
+    return stats;
+}
+
+size_t AdvertisementCapture::encodeRecord(const VictronAdvertisement& adv, uint8_t* out) {
+    size_t dataLength = adv.dataLength > MAX_ADVERTISEMENT_DATA ? MAX_ADVERTISEMENT_DATA : adv.dataLength;
+    size_t nameLength = strnlen(adv.name, MAX_ADVERTISEMENT_NAME - 1);
+    
+    size_t pos = 1;
+    uint64_t timestamp = (uint64_t)adv.timestampUs;
+    for (int i = 0; i < 8; i++) {
+        out[pos++] = (uint8_t)(timestamp >> (8 * i));
+    }
+    memcpy(&out[pos], adv.mac, sizeof(adv.mac));
+    pos += sizeof(adv.mac);
+    out[pos++] = (uint8_t)adv.rssi;
+    out[pos++] = (uint8_t)dataLength;
+    memcpy(&out[pos], adv.data, dataLength);
+    pos += dataLength;
+    out[pos++] = (uint8_t)nameLength;
+    memcpy(&out[pos], adv.name, nameLength);
+    pos += nameLength;
+    
+    out[0] = (uint8_t)(pos - 1);
+    return pos;
+}
+
+bool AdvertisementCapture::decodeRecord(const uint8_t* record, size_t length, VictronAdvertisement& adv) {
+    if (length < CAPTURE_RECORD_FIXED_SIZE) {
+        return false;
+    }
+    
+    size_t pos = 0;
+    uint64_t timestamp = 0;
+    for (int i = 0; i < 8; i++) {
+        timestamp |= (uint64_t)record[pos++] << (8 * i);
+    }
+    adv.timestampUs = (int64_t)timestamp;
+    memcpy(adv.mac, &record[pos], sizeof(adv.mac));
+    pos += sizeof(adv.mac);
+    adv.rssi = (int8_t)record[pos++];
+    
+    uint8_t dataLength = record[pos++];
+    if (dataLength > MAX_ADVERTISEMENT_DATA || pos + dataLength + 1 > length) {
+        return false;
+    }
+    adv.dataLength = dataLength;
+    memcpy(adv.data, &record[pos], dataLength);
+    pos += dataLength;
+    
+    uint8_t nameLength = record[pos++];
+    if (nameLength > MAX_ADVERTISEMENT_NAME - 1 || pos + nameLength != length) {
+        return false;
+    }
+    memcpy(adv.name, &record[pos], nameLength);
+    adv.name[nameLength] = '\0';
+    return true;
+}
+
+void AdvertisementCapture::encodeHeader(uint8_t* out) {
+    memset(out, 0, CAPTURE_HEADER_SIZE);
+    memcpy(out, CAPTURE_MAGIC, 4);
+    out[4] = CAPTURE_VERSION;
+}
+
+bool AdvertisementCapture::checkHeader(const uint8_t* header) {
+    return memcmp(header, CAPTURE_MAGIC, 4) == 0 && header[4] == CAPTURE_VERSION;
+}
+
+CaptureReplay::CaptureReplay()
+    : filesystem(nullptr), victronBLE(nullptr), fileCount(0), fileIndex(0), havePending(false),
+      anchorRecordUs(0), anchorTimeUs(0), lastRecordUs(0), startRequested(false), stopRequested(false),
+      requestedMode(REPLAY_REALTIME), active(false), mode(REPLAY_REALTIME), replayed(0), corrupt(0),
+      startedUs(0), finishedUs(0) {
+}
+
+void CaptureReplay::begin(fs::FS& fs, VictronBLE* target) {
+    filesystem = &fs;
+    victronBLE = target;
+}
+
+void CaptureReplay::start(const String& capturePath, CaptureReplayMode replayMode) {
+    requestedPath = capturePath;
+    requestedMode = replayMode;
+    stopRequested.store(false);
+    startRequested.store(true);
+}
+
+void CaptureReplay::stop() {
+    startRequested.store(false);
+    stopRequested.store(true);
+}
+
+void CaptureReplay::open(const String& capturePath, CaptureReplayMode replayMode) {
+    if (file) {
+        file.close();
+    }
+    
+    // Oldest first: the rotated file, then the current one
+    fileCount = 0;
+    fileIndex = 0;
+    String rotated = capturePath + ".1";
+    if (filesystem->exists(rotated)) {
+        files[fileCount++] = rotated;
+    }
+    if (filesystem->exists(capturePath)) {
+        files[fileCount++] = capturePath;
+    }
+    
+    mode = replayMode;
+    replayed = 0;
+    corrupt = 0;
+    havePending = false;
+    lastRecordUs = 0;
+    anchorRecordUs = 0;
+    anchorTimeUs = 0;
+    startedUs = esp_timer_get_time();
+    finishedUs = 0;
+    active = true;
+    
+    if (fileCount == 0) {
+        LOG_W(CAPTURE, "Replay: no capture at %s\n", capturePath.c_str());
+        finish();
+        return;
+    }
+    LOG_I(CAPTURE, "Replay started: %s (%d file(s), %s)\n", capturePath.c_str(), fileCount,
+                   mode == REPLAY_FAST ? "fast" : "real time");
+}
+
+bool CaptureReplay::openNextFile() {
+    while (fileIndex < fileCount) {
+        file = filesystem->open(files[fileIndex++], "r");
+        if (!file) {
+            continue;
+        }
+        uint8_t header[CAPTURE_HEADER_SIZE];
+        if (file.read(header, sizeof(header)) == sizeof(header) && AdvertisementCapture::checkHeader(header)) {
+            return true;
+        }
+        LOG_W(CAPTURE, "Replay: %s is not a capture file\n", file.path());
+        corrupt++;
+        file.close();
+    }
+    return false;
+}
+
+bool CaptureReplay::readRecord(VictronAdvertisement& adv) {
+    uint8_t record[CAPTURE_RECORD_MAX_SIZE];
+    for (;;) {
+        if (!file && !openNextFile()) {
+            return false;
+        }
+        
+        uint8_t length = 0;
+        if (file.read(&length, 1) == 1) {
+            if (length > 0 && length <= CAPTURE_RECORD_MAX_SIZE - 1 && file.read(record, length) == length) {
+                adv = VictronAdvertisement();
+                if (AdvertisementCapture::decodeRecord(record, length, adv)) {
+                    return true;
+                }
+                // The framing held, only this record is bad
+                corrupt++;
+                continue;
+            }
+            // Bad length or a record cut short by a power loss: nothing after it can be trusted
+            corrupt++;
+        }
+        file.close();
+    }
+}
+
+void CaptureReplay::finish() {
+    if (file) {
+        file.close();
+    }
+    active = false;
+    havePending = false;
+    finishedUs = esp_timer_get_time();
+    LOG_I(CAPTURE, "Replay finished: %u records in %.1f ms, %u corrupt\n", replayed,
+                   (finishedUs - startedUs) / 1000.0, corrupt);
+}
+
+void CaptureReplay::loop() {
+    if (stopRequested.exchange(false) && active) {
+        finish();
+    }
+    if (startRequested.exchange(false)) {
+        if (!filesystem || !victronBLE) {
+            LOG_E(CAPTURE, "ERROR: Replay has no filesystem or VictronBLE (begin() not called)\n");
+            return;
+        }
+        open(requestedPath, requestedMode);
+    }
+    if (!active) {
+        return;
+    }
+    
+    replayDue();
+    // Replayed advertisements bypass VictronBLE::loop(), which publishes everything else
+    victronBLE->publishSnapshot();
+}
+
+void CaptureReplay::replayDue() {
+    for (int batch = 0; batch < CAPTURE_REPLAY_BATCH; batch++) {
+        if (!havePending) {
+            if (!readRecord(pending)) {
+                finish();
+                return;
+            }
+            havePending = true;
+        }
+        
+        int64_t now = esp_timer_get_time();
+        if (mode == REPLAY_REALTIME) {
+            // Re-anchor on the first record, after a reboot inside the capture (time went
+            // backwards) and after long idle periods
+            if (replayed == 0 || pending.timestampUs < lastRecordUs ||
+                pending.timestampUs - lastRecordUs > CAPTURE_REPLAY_MAX_GAP) {
+                anchorRecordUs = pending.timestampUs;
+                anchorTimeUs = now;
+            }
+            if (pending.timestampUs - anchorRecordUs > now - anchorTimeUs) {
+                return;  // Not due yet
+            }
+        }
+        
+        lastRecordUs = pending.timestampUs;
+        pending.timestampUs = now;
+        victronBLE->replayAdvertisement(pending);
+        havePending = false;
+        replayed++;
+    }
+}
+
+CaptureReplayStats CaptureReplay::getStats() const {
+    CaptureReplayStats stats;
+    stats.active = active;
+    stats.mode = mode;
+    stats.replayed = replayed;
+    stats.corrupt = corrupt;
+    stats.startedUs = startedUs;
+    stats.finishedUs = finishedUs;
+    return stats;
+}
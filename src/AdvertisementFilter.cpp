@@ -0,0 +1,203 @@
+#include "AdvertisementFilter.h"
+#include "VictronBLE.h"
+#include "DeferredLog.h"
+
+// AD structure types (Bluetooth Core Specification Supplement, Part A)
+#define AD_TYPE_INCOMPLETE_UUID16 0x02
+#define AD_TYPE_COMPLETE_UUID16   0x03
+#define AD_TYPE_SHORT_NAME        0x08
+#define AD_TYPE_COMPLETE_NAME     0x09
+#define AD_TYPE_MANUFACTURER_DATA 0xFF
+
+static_assert((ADVERTISEMENT_ALLOWLIST_SLOTS & (ADVERTISEMENT_ALLOWLIST_SLOTS - 1)) == 0,
+              "ADVERTISEMENT_ALLOWLIST_SLOTS must be a power of two");
+
+AdvertisementFilter::AdvertisementFilter()
+    : activeAllowlist(0), allowlistSize(0), acceptedCount(0), rejectedCount(0) {
+    memset(allowlist, 0, sizeof(allowlist));
+}
+
+void AdvertisementFilter::parseAdStructures(const uint8_t* payload, size_t length, RawAdvertisementFields& fields) {
+    // Each AD structure is [length][type][data...], where length covers type + data
+    size_t pos = 0;
+    while (pos + 1 < length) {
+        uint8_t adLength = payload[pos];
+        if (adLength == 0) {
+            break;  // Padding - rest of the payload is empty
+        }
+        if (pos + 1 + adLength > length) {
+            break;  // Truncated structure
+        }
+        
+        uint8_t adType = payload[pos + 1];
+        const uint8_t* adData = &payload[pos + 2];
+        uint8_t dataLength = adLength - 1;
+        
+        switch (adType) {
+            case AD_TYPE_MANUFACTURER_DATA:
+                // Keep the first one; scan responses rarely repeat it
+                if (!fields.manufacturerData) {
+                    fields.manufacturerData = adData;
+                    fields.manufacturerDataLength = dataLength;
+                }
+                break;
+            case AD_TYPE_SHORT_NAME:
+            case AD_TYPE_COMPLETE_NAME:
+                // Prefer the complete name (usually in the scan response)
+                if (!fields.name || adType == AD_TYPE_COMPLETE_NAME) {
+                    fields.name = (const char*)adData;
+                    fields.nameLength = dataLength;
+                }
+                break;
+            case AD_TYPE_INCOMPLETE_UUID16:
+            case AD_TYPE_COMPLETE_UUID16:
+                for (uint8_t i = 0; i + 1 < dataLength; i += 2) {
+                    if ((uint16_t)(adData[i + 1] << 8 | adData[i]) == ECOWORTHY_SERVICE_UUID16) {
+                        fields.ecoWorthyService = true;
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+        
+        pos += 1 + adLength;
+    }
+}
+
+uint64_t AdvertisementFilter::addressKey(const uint8_t* mac) {
+    uint64_t key = 0;
+    for (int i = 0; i < 6; i++) {
+        key = (key << 8) | mac[i];
+    }
+    return key;
+}
+
+bool AdvertisementFilter::parseAddress(const String& address, uint8_t* mac) {
+    // Accepts "AA:BB:CC:DD:EE:FF", "aa-bb-..." or "aabbccddeeff"
+    int nibbles = 0;
+    for (size_t i = 0; i < address.length(); i++) {
+        char c = address[i];
+        if (c == ':' || c == '-') {
+            continue;
+        }
+        
+        int value;
+        if (c >= '0' && c <= '9') {
+            value = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            value = 10 + (c - 'a');
+        } else if (c >= 'A' && c <= 'F') {
+            value = 10 + (c - 'A');
+        } else {
+            return false;
+        }
+        
+        if (nibbles >= 12) {
+            return false;
+        }
+        if (nibbles % 2 == 0) {
+            mac[nibbles / 2] = value << 4;
+        } else {
+            mac[nibbles / 2] |= value;
+        }
+        nibbles++;
+    }
+    return nibbles == 12;
+}
+
+bool AdvertisementFilter::isEcoWorthyName(const char* name, size_t length) {
+    // Same patterns as EcoWorthyBMS::isEcoWorthyDevice, without building a String
+    static const char ecoWorthy[] = "ECO-WORTHY";
+    static const char dcHouse[] = "DCHOUSE";
+    static const char bw02[] = "ECO-WORTHY 02_";
+    
+    if (!name) {
+        return false;
+    }
+    if (length >= sizeof(ecoWorthy) - 1 && memcmp(name, ecoWorthy, sizeof(ecoWorthy) - 1) == 0) {
+        return true;
+    }
+    if (length >= sizeof(dcHouse) - 1 && memcmp(name, dcHouse, sizeof(dcHouse) - 1) == 0) {
+        return true;
+    }
+    for (size_t i = 0; i + sizeof(bw02) - 1 <= length; i++) {
+        if (memcmp(name + i, bw02, sizeof(bw02) - 1) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t AdvertisementFilter::hashKey(uint64_t key) {
+    // 64-bit finalizer (MurmurHash3 fmix64) folded to 32 bits
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+void AdvertisementFilter::setAllowedAddresses(const std::vector<String>& addresses) {
+    // Build into the inactive table, then publish it with a single store.
+    // Rebuilds only happen on configuration changes, so the BLE task is long done
+    // with the previous table by the time it is reused.
+    uint8_t next = activeAllowlist.load(std::memory_order_relaxed) ^ 1;
+    uint64_t* table = allowlist[next];
+    memset(table, 0, sizeof(allowlist[next]));
+    
+    uint8_t count = 0;
+    for (const String& address : addresses) {
+        uint8_t mac[6];
+        if (!parseAddress(address, mac)) {
+            LOG_W(BLE, "WARNING: Ignoring invalid MAC address in allowlist: %s\n", address.c_str());
+            continue;
+        }
+        if (count >= ADVERTISEMENT_ALLOWLIST_SLOTS / 2) {
+            LOG_W(BLE, "WARNING: MAC allowlist full, raise ADVERTISEMENT_ALLOWLIST_SLOTS\n");
+            break;
+        }
+        
+        uint64_t key = addressKey(mac);
+        uint32_t slot = hashKey(key) & (ADVERTISEMENT_ALLOWLIST_SLOTS - 1);
+        while (table[slot] != 0 && table[slot] != key) {
+            slot = (slot + 1) & (ADVERTISEMENT_ALLOWLIST_SLOTS - 1);
+        }
+        if (table[slot] == 0) {
+            table[slot] = key;
+            count++;
+        }
+    }
+    
+    allowlistSize = count;
+    activeAllowlist.store(next, std::memory_order_release);
+}
+
+bool AdvertisementFilter::isAllowed(uint64_t key) const {
+    const uint64_t* table = allowlist[activeAllowlist.load(std::memory_order_acquire)];
+    uint32_t slot = hashKey(key) & (ADVERTISEMENT_ALLOWLIST_SLOTS - 1);
+    // The table is at most half full, so probing always reaches an empty slot
+    while (table[slot] != 0) {
+        if (table[slot] == key) {
+            return true;
+        }
+        slot = (slot + 1) & (ADVERTISEMENT_ALLOWLIST_SLOTS - 1);
+    }
+    return false;
+}
+
+bool AdvertisementFilter::accept(const uint8_t* mac, const RawAdvertisementFields& fields) {
+    bool isVictron = fields.manufacturerDataLength >= 2 &&
+                     (uint16_t)(fields.manufacturerData[1] << 8 | fields.manufacturerData[0]) == VICTRON_MANUFACTURER_ID;
+    
+    // The Eco Worthy service UUID is shared with many generic BLE modules; let those
+    // through so their name (often only in the scan response) can be checked later
+    if (isVictron || fields.ecoWorthyService ||
+        isEcoWorthyName(fields.name, fields.nameLength) ||
+        (allowlistSize > 0 && isAllowed(addressKey(mac)))) {
+        acceptedCount++;
+        return true;
+    }
+    
+    rejectedCount++;
+    return false;
+}
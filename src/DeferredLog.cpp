@@ -0,0 +1,240 @@
+#include "DeferredLog.h"
+
+LogRing logRing;
+
+LogRing::LogRing()
+    : head(0), tail(0), records(0), drops(0), highWater(0),
+      lineLength(0), lineOffset(0), reportedDrops(0) {
+    writing.clear();
+    line[0] = '\0';
+}
+
+void LogRing::copyIn(uint32_t position, const uint8_t* data, size_t size) {
+    size_t offset = position & (LOG_RING_BYTES - 1);
+    size_t first = size < LOG_RING_BYTES - offset ? size : LOG_RING_BYTES - offset;
+    memcpy(&buffer[offset], data, first);
+    memcpy(buffer, data + first, size - first);
+}
+
+void LogRing::copyOut(uint32_t position, uint8_t* data, size_t size) const {
+    size_t offset = position & (LOG_RING_BYTES - 1);
+    size_t first = size < LOG_RING_BYTES - offset ? size : LOG_RING_BYTES - offset;
+    memcpy(data, &buffer[offset], first);
+    memcpy(data + first, buffer, size - first);
+}
+
+void LogRing::push(const LogRecord& record) {
+    // Another writer is mid-copy: drop rather than wait (it may be a lower-priority task)
+    if (writing.test_and_set(std::memory_order_acquire)) {
+        drops.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+    uint32_t used = h - t;
+    if (used + record.length > LOG_RING_BYTES) {
+        writing.clear(std::memory_order_release);
+        drops.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    
+    uint8_t size = (uint8_t)record.length;
+    copyIn(h, &size, 1);
+    copyIn(h + 1, &record.bytes[1], record.length - 1);
+    head.store(h + record.length, std::memory_order_release);
+    writing.clear(std::memory_order_release);
+    
+    records.fetch_add(1, std::memory_order_relaxed);
+    if (used + record.length > highWater.load(std::memory_order_relaxed)) {
+        highWater.store(used + record.length, std::memory_order_relaxed);
+    }
+}
+
+// Fetches the next line to write: a drop notice, or the oldest record formatted
+bool LogRing::nextLine() {
+    lineOffset = 0;
+    lineLength = 0;
+    
+    uint32_t dropped = drops.load(std::memory_order_relaxed);
+    if (dropped != reportedDrops) {
+        lineLength = snprintf(line, sizeof(line), "[log] %u record(s) dropped\n",
+                              (unsigned int)(dropped - reportedDrops));
+        reportedDrops = dropped;
+        return true;
+    }
+    
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+        return false;
+    }
+    
+    uint8_t record[LOG_MAX_RECORD];
+    copyOut(t, record, 1);
+    copyOut(t + 1, &record[1], record[0] - 1);
+    tail.store(t + record[0], std::memory_order_release);
+    
+    lineLength = format(record, record[0], line, sizeof(line));
+    if (lineLength == sizeof(line) - 1 && line[lineLength - 1] != '\n') {
+        line[lineLength - 1] = '\n';
+    }
+    return true;
+}
+
+size_t LogRing::drain(Print& out, size_t maxLines) {
+    size_t completed = 0;
+    while (completed < maxLines) {
+        if (lineOffset >= lineLength && !nextLine()) {
+            break;
+        }
+        
+        int room = out.availableForWrite();
+        if (room <= 0) {
+            break;
+        }
+        size_t chunk = lineLength - lineOffset;
+        if (chunk > (size_t)room) {
+            chunk = room;
+        }
+        lineOffset += out.write((const uint8_t*)&line[lineOffset], chunk);
+        if (lineOffset < lineLength) {
+            break;
+        }
+        completed++;
+    }
+    return completed;
+}
+
+void LogRing::flush(Print& out) {
+    while (lineOffset < lineLength || nextLine()) {
+        out.write((const uint8_t*)&line[lineOffset], lineLength - lineOffset);
+        lineOffset = lineLength;
+    }
+}
+
+LogStats LogRing::getStats() const {
+    LogStats stats;
+    stats.records = records.load(std::memory_order_relaxed);
+    stats.dropped = drops.load(std::memory_order_relaxed);
+    stats.highWater = highWater.load(std::memory_order_relaxed);
+    stats.capacity = LOG_RING_BYTES;
+    return stats;
+}
+
+// Walks the format string and prints each conversion with its stored argument.
+// Length modifiers in the format are replaced by ones matching the stored width, so
+// "%ld" of a 64-bit long on the host and of a 32-bit long on the ESP32 both work.
+size_t LogRing::format(const uint8_t* record, size_t length, char* out, size_t outSize) {
+    if (outSize == 0) {
+        return 0;
+    }
+    
+    const char* fmt;
+    memcpy(&fmt, &record[1], sizeof(fmt));
+    size_t position = 1 + sizeof(fmt);
+    size_t written = 0;
+    
+    while (*fmt != '\0' && written + 1 < outSize) {
+        if (*fmt != '%') {
+            out[written++] = *fmt++;
+            continue;
+        }
+        if (fmt[1] == '%') {
+            out[written++] = '%';
+            fmt += 2;
+            continue;
+        }
+        
+        // Copy flags, width and precision; skip length modifiers
+        char spec[24];
+        size_t specLength = 0;
+        spec[specLength++] = *fmt++;
+        while (*fmt != '\0' && strchr("-+ #0123456789.", *fmt) != nullptr) {
+            if (specLength < sizeof(spec) - 4) {
+                spec[specLength++] = *fmt;
+            }
+            fmt++;
+        }
+        while (*fmt != '\0' && strchr("hlLqjzt", *fmt) != nullptr) {
+            fmt++;
+        }
+        char conversion = *fmt;
+        if (conversion == '\0') {
+            break;
+        }
+        fmt++;
+        
+        size_t room = outSize - written;
+        if (position >= length) {
+            written += snprintf(&out[written], room, "?");
+            continue;
+        }
+        
+        uint8_t type = record[position++];
+        size_t valueSize = type == LOG_ARG_INT32 || type == LOG_ARG_UINT32 ? 4 :
+                           (type == LOG_ARG_STRING ? 1 + record[position] : 8);
+        if (position + valueSize > length) {
+            break;
+        }
+        const uint8_t* value = &record[position];
+        position += valueSize;
+        
+        int32_t i32 = 0;
+        uint32_t u32 = 0;
+        int64_t i64 = 0;
+        uint64_t u64 = 0;
+        double real = 0;
+        switch (type) {
+            case LOG_ARG_INT32: memcpy(&i32, value, 4); i64 = i32; real = i32; break;
+            case LOG_ARG_UINT32: memcpy(&u32, value, 4); i64 = u32; real = u32; break;
+            case LOG_ARG_INT64: memcpy(&i64, value, 8); real = (double)i64; break;
+            case LOG_ARG_UINT64:
+            case LOG_ARG_POINTER: memcpy(&u64, value, 8); i64 = (int64_t)u64; real = (double)u64; break;
+            case LOG_ARG_DOUBLE: memcpy(&real, value, 8); i64 = (int64_t)real; break;
+        }
+        
+        int n = 0;
+        if (conversion == 's') {
+            spec[specLength++] = 's';
+            spec[specLength] = '\0';
+            char text[LOG_MAX_STRING + 1];
+            if (type == LOG_ARG_STRING) {
+                memcpy(text, &value[1], value[0]);
+                text[value[0]] = '\0';
+            } else {
+                strcpy(text, "?");
+            }
+            n = snprintf(&out[written], room, spec, text);
+        } else if (strchr("fFeEgGaA", conversion) != nullptr) {
+            spec[specLength++] = conversion;
+            spec[specLength] = '\0';
+            n = snprintf(&out[written], room, spec, real);
+        } else if (conversion == 'p') {
+            spec[specLength++] = 'p';
+            spec[specLength] = '\0';
+            n = snprintf(&out[written], room, spec, (void*)(uintptr_t)u64);
+        } else if (strchr("diouxXc", conversion) != nullptr) {
+            // 32-bit values keep their width, so %08X of a negative int stays 8 digits
+            bool wide = type == LOG_ARG_INT64 || type == LOG_ARG_UINT64 || type == LOG_ARG_POINTER ||
+                        type == LOG_ARG_DOUBLE;
+            if (wide && conversion != 'c') {
+                spec[specLength++] = 'l';
+                spec[specLength++] = 'l';
+            }
+            spec[specLength++] = conversion;
+            spec[specLength] = '\0';
+            if (wide && conversion != 'c') {
+                n = snprintf(&out[written], room, spec, (long long)i64);
+            } else {
+                n = snprintf(&out[written], room, spec, type == LOG_ARG_UINT32 ? (int)u32 : (int)i64);
+            }
+        }
+        
+        if (n > 0) {
+            written += (size_t)n < room ? (size_t)n : room - 1;
+        }
+    }
+    
+    out[written] = '\0';
+    return written;
+}
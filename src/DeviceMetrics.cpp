@@ -0,0 +1,63 @@
+#include "DeviceMetrics.h"
+
+void metricsReset(DeviceMetrics& metrics) {
+    memset(&metrics, 0, sizeof(metrics));
+}
+
+void metricsPacket(DeviceMetrics& metrics, int8_t rssi, int64_t timeUs) {
+    if (metrics.packets == 0) {
+        metrics.rssiAverageX16 = (int16_t)(rssi * 16);
+        metrics.rateWindowStartUs = timeUs;
+    } else {
+        metrics.rssiAverageX16 += (int16_t)((rssi * 16 - metrics.rssiAverageX16) / 8);
+    }
+    metrics.packets++;
+    metrics.lastPacketUs = timeUs;
+    
+    metrics.rateWindowPackets++;
+    int64_t windowUs = timeUs - metrics.rateWindowStartUs;
+    if (windowUs >= (int64_t)METRICS_RATE_WINDOW * 1000) {
+        metrics.packetsPerSecond = metrics.rateWindowPackets * 1e6f / windowUs;
+        metrics.rateWindowStartUs = timeUs;
+        metrics.rateWindowPackets = 0;
+    }
+}
+
+void metricsFrame(DeviceMetrics& metrics, bool hadFrame, uint16_t lastCounter, uint16_t counter) {
+    metrics.frames++;
+    if (!hadFrame || counter == lastCounter) {
+        return;
+    }
+    uint16_t skipped = (uint16_t)(counter - lastCounter - 1);
+    if (skipped < METRICS_MAX_COUNTER_GAP) {
+        metrics.counterGaps += skipped;
+    }
+}
+
+void metricsParse(DeviceMetrics& metrics, uint32_t cycles) {
+    int bucket = 0;
+    while (bucket < METRICS_PARSE_BUCKETS - 1 && cycles >= metricsBucketLimit(bucket)) {
+        bucket++;
+    }
+    metrics.parseHistogram[bucket]++;
+    if (cycles > metrics.maxParseCycles) {
+        metrics.maxParseCycles = cycles;
+    }
+}
+
+float metricsPacketRate(const DeviceMetrics& metrics, int64_t nowUs) {
+    int64_t silentUs = nowUs - metrics.lastPacketUs;
+    if (metrics.packets == 0 || silentUs >= (int64_t)METRICS_RATE_WINDOW * 1000) {
+        return 0.0f;
+    }
+    // Until the first window completes, estimate from the one in progress
+    int64_t windowUs = metrics.lastPacketUs - metrics.rateWindowStartUs;
+    if (metrics.packetsPerSecond == 0.0f && windowUs > 0) {
+        return (metrics.rateWindowPackets - 1) * 1e6f / windowUs;
+    }
+    return metrics.packetsPerSecond;
+}
+
+uint32_t metricsBucketLimit(int bucket) {
+    return bucket < METRICS_PARSE_BUCKETS - 1 ? (uint32_t)METRICS_PARSE_FIRST_BUCKET << bucket : 0;
+}
@@ -0,0 +1,186 @@
+#include "DeviceNameCache.h"
+#include "DeferredLog.h"
+
+DeviceNameCache::DeviceNameCache() : used(0), gaveUpCount(0), nextVictim(0), dirty(false), changedAt(0), saves(0) {
+    memset(entries, 0, sizeof(entries));
+    memset(gaveUp, 0, sizeof(gaveUp));
+}
+
+void DeviceNameCache::begin() {
+    memset(entries, 0, sizeof(entries));
+    memset(gaveUp, 0, sizeof(gaveUp));
+    used = 0;
+    gaveUpCount = 0;
+    
+    Preferences preferences;
+    preferences.begin(NAME_CACHE_NAMESPACE, true);  // read-only
+    size_t length = preferences.getBytesLength("entries");
+    // A blob of another size comes from a build with a different layout - start over
+    if (length > 0 && length % sizeof(NameCacheEntry) == 0 && length <= sizeof(entries)) {
+        preferences.getBytes("entries", entries, length);
+        used = (uint8_t)(length / sizeof(NameCacheEntry));
+    }
+    length = preferences.getBytesLength("gaveup");
+    if (length > 0 && length % sizeof(uint64_t) == 0 && length <= sizeof(gaveUp)) {
+        preferences.getBytes("gaveup", gaveUp, length);
+        gaveUpCount = (uint8_t)(length / sizeof(uint64_t));
+    }
+    preferences.end();
+    
+    for (uint8_t i = 0; i < used; i++) {
+        entries[i].name[NAME_CACHE_NAME_LENGTH - 1] = '\0';
+    }
+    nextVictim = used % NAME_CACHE_SIZE;
+    dirty = false;
+    LOG_I(BLE, "Name cache: %u cached name(s), %u unnamed MAC(s)\n", (unsigned)used, (unsigned)gaveUpCount);
+}
+
+int DeviceNameCache::indexOf(uint64_t key) const {
+    for (uint8_t i = 0; i < used; i++) {
+        if (entries[i].key == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int DeviceNameCache::gaveUpIndexOf(uint64_t key) const {
+    for (uint8_t i = 0; i < gaveUpCount; i++) {
+        if (gaveUp[i] == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+NameCacheEntry* DeviceNameCache::allocate(uint64_t key) {
+    NameCacheEntry* entry;
+    if (used < NAME_CACHE_SIZE) {
+        entry = &entries[used++];
+    } else {
+        // Unnamed entries go first, then the names in round-robin order
+        entry = nullptr;
+        for (uint8_t i = 0; i < NAME_CACHE_SIZE && !entry; i++) {
+            entry = entries[i].name[0] == '\0' ? &entries[i] : nullptr;
+        }
+        if (!entry) {
+            entry = &entries[nextVictim];
+            nextVictim = (nextVictim + 1) % NAME_CACHE_SIZE;
+        }
+    }
+    memset(entry, 0, sizeof(*entry));
+    entry->key = key;
+    return entry;
+}
+
+// Moves an entry that used up its probes to the unnamed set, freeing its slot for
+// names and new MACs. With the set full it stays in the cache, still unprobed.
+void DeviceNameCache::giveUp(int slot) {
+    if (gaveUpCount >= NAME_GAVE_UP_SIZE) {
+        return;
+    }
+    gaveUp[gaveUpCount++] = entries[slot].key;
+    entries[slot] = entries[--used];
+    memset(&entries[used], 0, sizeof(entries[used]));
+    if (nextVictim >= used) {
+        nextVictim = 0;
+    }
+}
+
+void DeviceNameCache::changed(unsigned long nowMs) {
+    dirty = true;
+    changedAt = nowMs;
+}
+
+const char* DeviceNameCache::lookup(uint64_t key) const {
+    int slot = indexOf(key);
+    return slot >= 0 && entries[slot].name[0] != '\0' ? entries[slot].name : nullptr;
+}
+
+bool DeviceNameCache::needsProbe(uint64_t key) const {
+    int slot = indexOf(key);
+    if (slot >= 0) {
+        return entries[slot].name[0] == '\0' && entries[slot].unnamedProbes < NAME_PROBE_TRIES;
+    }
+    // A new MAC is only worth a probe while a slot is free to count it
+    return used < NAME_CACHE_SIZE && gaveUpIndexOf(key) < 0;
+}
+
+void DeviceNameCache::remember(uint64_t key, const char* name, unsigned long nowMs) {
+    int slot = indexOf(key);
+    NameCacheEntry* entry = slot >= 0 ? &entries[slot] : nullptr;
+    if (entry && strncmp(entry->name, name, NAME_CACHE_NAME_LENGTH - 1) == 0) {
+        return;
+    }
+    if (!entry) {
+        // A MAC given up on has a name after all
+        int gaveUpSlot = gaveUpIndexOf(key);
+        if (gaveUpSlot >= 0) {
+            gaveUp[gaveUpSlot] = gaveUp[--gaveUpCount];
+        }
+        entry = allocate(key);
+    }
+    strlcpy(entry->name, name, sizeof(entry->name));
+    entry->unnamedProbes = 0;
+    changed(nowMs);
+}
+
+void DeviceNameCache::heardUnnamed(uint64_t key, uint8_t probe, unsigned long nowMs) {
+    int slot = indexOf(key);
+    NameCacheEntry* entry = slot >= 0 ? &entries[slot] : nullptr;
+    if (!entry) {
+        // Never evict for a new MAC: restarting another MAC's count would keep it probed
+        if (used >= NAME_CACHE_SIZE || gaveUpIndexOf(key) >= 0) {
+            return;
+        }
+        slot = used;
+        entry = allocate(key);
+    } else if (entry->name[0] != '\0' || entry->lastProbe == probe || entry->unnamedProbes >= NAME_PROBE_TRIES) {
+        return;
+    }
+    entry->lastProbe = probe;
+    entry->unnamedProbes++;
+    
+    // Only giving up is saved; an unsaved count costs a few probes after a reboot
+    if (entry->unnamedProbes >= NAME_PROBE_TRIES) {
+        giveUp(slot);
+        changed(nowMs);
+    }
+}
+
+void DeviceNameCache::saveIfDue(unsigned long nowMs) {
+    if (dirty && nowMs - changedAt >= NAME_CACHE_SAVE_DELAY) {
+        save();
+    }
+}
+
+void DeviceNameCache::save() {
+    Preferences preferences;
+    if (!preferences.begin(NAME_CACHE_NAMESPACE, false)) {
+        LOG_E(BLE, "ERROR: Failed to open the name cache for writing\n");
+        return;
+    }
+    preferences.putBytes("entries", entries, used * sizeof(NameCacheEntry));
+    if (gaveUpCount > 0) {
+        preferences.putBytes("gaveup", gaveUp, gaveUpCount * sizeof(uint64_t));
+    } else {
+        preferences.remove("gaveup");
+    }
+    preferences.end();
+    dirty = false;
+    saves++;
+    LOG_D(BLE, "Name cache saved: %u name(s)\n", (unsigned)used);
+}
+
+void DeviceNameCache::clear() {
+    memset(entries, 0, sizeof(entries));
+    memset(gaveUp, 0, sizeof(gaveUp));
+    used = 0;
+    gaveUpCount = 0;
+    nextVictim = 0;
+    dirty = false;
+    Preferences preferences;
+    preferences.begin(NAME_CACHE_NAMESPACE, false);
+    preferences.clear();
+    preferences.end();
+}
@@ -1,4 +1,5 @@
 #include "EcoWorthyBMS.h"
+#include "DeferredLog.h"
 
 EcoWorthyBMS::EcoWorthyBMS() : 
     pClient(nullptr),
@@ -23,7 +24,7 @@ EcoWorthyBMS::~EcoWorthyBMS() {
 }
 
 bool EcoWorthyBMS::begin() {
-    Serial.println("Initializing Eco Worthy BMS...");
+    LOG_I(BMS, "Initializing Eco Worthy BMS...\n");
     // NimBLE should already be initialized by VictronBLE
     return true;
 }
@@ -78,11 +79,11 @@ bool EcoWorthyBMS::connectToDevice(NimBLEAdvertisedDevice* device) {
 
 bool EcoWorthyBMS::connectToAddress(const String& address) {
     if (isConnected) {
-        Serial.println("Already connected to a device");
+        LOG_W(BMS, "Already connected to a device\n");
         return true;
     }
     
-    Serial.printf("Connecting to Eco Worthy BMS: %s\n", address.c_str());
+    LOG_I(BMS, "Connecting to Eco Worthy BMS: %s\n", address.c_str());
     
     // Parse MAC address into bytes
     int values[6];
@@ -96,25 +97,25 @@ bool EcoWorthyBMS::connectToAddress(const String& address) {
     // Create client
     pClient = NimBLEDevice::createClient();
     if (!pClient) {
-        Serial.println("Failed to create BLE client");
+        LOG_E(BMS, "Failed to create BLE client\n");
         return false;
     }
     
     // Connect to device
     NimBLEAddress bleAddress(address.c_str());
     if (!pClient->connect(bleAddress)) {
-        Serial.println("Failed to connect to device");
+        LOG_E(BMS, "Failed to connect to device\n");
         NimBLEDevice::deleteClient(pClient);
         pClient = nullptr;
         return false;
     }
     
-    Serial.println("Connected to device");
+    LOG_I(BMS, "Connected to device\n");
     
     // Get service
     pService = pClient->getService(ECOWORTHY_SERVICE_UUID);
     if (!pService) {
-        Serial.println("Failed to find service");
+        LOG_E(BMS, "Failed to find service\n");
         disconnect();
         return false;
     }
@@ -122,7 +123,7 @@ bool EcoWorthyBMS::connectToAddress(const String& address) {
     // Get RX characteristic
     pRxCharacteristic = pService->getCharacteristic(ECOWORTHY_RX_UUID);
     if (!pRxCharacteristic) {
-        Serial.println("Failed to find RX characteristic");
+        LOG_E(BMS, "Failed to find RX characteristic\n");
         disconnect();
         return false;
     }
@@ -144,7 +145,7 @@ bool EcoWorthyBMS::connectToAddress(const String& address) {
     currentData.address = address;
     currentData.connected = true;
     
-    Serial.println("Successfully connected and subscribed to notifications");
+    LOG_I(BMS, "Successfully connected and subscribed to notifications\n");
     return true;
 }
 
@@ -201,7 +202,7 @@ bool EcoWorthyBMS::parseResponse(const uint8_t* data, size_t length) {
             header = data[0];
             dataStart = 1;
         } else {
-            Serial.println("Invalid header byte");
+            LOG_W(BMS, "Invalid header byte\n");
             return false;
         }
     }
@@ -214,7 +215,7 @@ bool EcoWorthyBMS::parseResponse(const uint8_t* data, size_t length) {
     uint16_t calculatedCRC = calculateModbusCRC(data, length - 2);
     
     if (receivedCRC != calculatedCRC) {
-        Serial.printf("CRC mismatch: received 0x%04X, calculated 0x%04X\n", receivedCRC, calculatedCRC);
+        LOG_W(BMS, "CRC mismatch: received 0x%04X, calculated 0x%04X\n", receivedCRC, calculatedCRC);
         return false;
     }
     
@@ -336,7 +337,7 @@ void EcoWorthyBMS::extractTemperatures(const uint8_t* data, size_t length) {
 
 bool EcoWorthyBMS::updateData() {
     if (!isDeviceConnected()) {
-        Serial.println("Not connected to device");
+        LOG_W(BMS, "Not connected to device\n");
         return false;
     }
     
@@ -355,7 +356,7 @@ bool EcoWorthyBMS::updateData() {
         
         // Keep connection alive
         if (!pClient->isConnected()) {
-            Serial.println("Connection lost during update");
+            LOG_W(BMS, "Connection lost during update\n");
             isConnected = false;
             currentData.connected = false;
             return false;
@@ -363,11 +364,11 @@ bool EcoWorthyBMS::updateData() {
     }
     
     if (!hasDataA1 || !hasDataA2) {
-        Serial.printf("Timeout waiting for data (A1: %d, A2: %d)\n", hasDataA1, hasDataA2);
+        LOG_W(BMS, "Timeout waiting for data (A1: %d, A2: %d)\n", hasDataA1, hasDataA2);
         return false;
     }
     
-    Serial.println("Successfully updated Eco Worthy BMS data");
+    LOG_I(BMS, "Successfully updated Eco Worthy BMS data\n");
     return true;
 }
 
@@ -0,0 +1,460 @@
+#include "HistoryLog.h"
+#include "DeferredLog.h"
+#include <algorithm>
+
+// Little-endian field access
+static void put16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void put32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint16_t get16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+static void putFloat(uint8_t* out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put32(out, bits);
+}
+
+static float getFloat(const uint8_t* in) {
+    uint32_t bits = get32(in);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static bool bucketBefore(const HistoryBucket& a, const HistoryBucket& b) {
+    return a.start < b.start;
+}
+
+HistoryLog::HistoryLog()
+    : filesystem(nullptr), budgetBytes(0), appendable(false), lastTime(0), buffered(0), firstBufferedAt(0),
+      blocksWritten(0), recordsWritten(0), dropped(0), errors(0), recoveredRecords(0), tornBytes(0) {
+}
+
+uint32_t HistoryLog::crc32(const uint8_t* data, size_t length, uint32_t crc) {
+    // CRC-32 (IEEE 802.3), bitwise: a block is checked once per flush or read
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+void HistoryLog::encodeRecord(uint64_t device, HistoryMetric metric, const HistoryBucket& bucket, uint8_t* out) {
+    for (int i = 0; i < 6; i++) {
+        out[i] = (device >> (8 * (5 - i))) & 0xFF;
+    }
+    out[6] = metric;
+    out[7] = 0;
+    put32(&out[8], bucket.start);
+    put16(&out[12], bucket.count);
+    put16(&out[14], 0);
+    putFloat(&out[16], bucket.min);
+    putFloat(&out[20], bucket.max);
+    putFloat(&out[24], bucket.mean);
+    putFloat(&out[28], bucket.last);
+}
+
+void HistoryLog::decodeRecord(const uint8_t* record, uint64_t& device, HistoryMetric& metric, HistoryBucket& bucket) {
+    device = 0;
+    for (int i = 0; i < 6; i++) {
+        device = (device << 8) | record[i];
+    }
+    metric = (HistoryMetric)record[6];
+    bucket.start = get32(&record[8]);
+    bucket.count = get16(&record[12]);
+    bucket.min = getFloat(&record[16]);
+    bucket.max = getFloat(&record[20]);
+    bucket.mean = getFloat(&record[24]);
+    bucket.last = getFloat(&record[28]);
+}
+
+// Block header fields; the CRC covers the header before it and the records
+struct BlockInfo {
+    uint16_t records;
+    uint32_t oldest;
+    uint32_t newest;
+    uint32_t crc;
+};
+
+static bool readBlockHeader(File& file, BlockInfo& info) {
+    uint8_t header[HISTORY_LOG_BLOCK_HEADER];
+    if (file.read(header, sizeof(header)) != sizeof(header) || get16(header) != HISTORY_LOG_BLOCK_MARKER) {
+        return false;
+    }
+    info.records = get16(&header[2]);
+    info.oldest = get32(&header[4]);
+    info.newest = get32(&header[8]);
+    info.crc = get32(&header[12]);
+    return info.records > 0 && info.records <= HISTORY_LOG_BUFFER_RECORDS && info.oldest <= info.newest;
+}
+
+// Reads the records of a block whose header was just read, into out; false if
+// they are cut off or do not match the CRC
+static bool readBlockRecords(File& file, const BlockInfo& info, uint8_t* out) {
+    size_t length = (size_t)info.records * HISTORY_LOG_RECORD_SIZE;
+    if (file.read(out, length) != length) {
+        return false;
+    }
+    uint8_t header[12];
+    put16(header, HISTORY_LOG_BLOCK_MARKER);
+    put16(&header[2], info.records);
+    put32(&header[4], info.oldest);
+    put32(&header[8], info.newest);
+    return HistoryLog::crc32(out, length, HistoryLog::crc32(header, sizeof(header))) == info.crc;
+}
+
+String HistoryLog::segmentPath(uint32_t sequence) const {
+    return directory + "/" + String(sequence) + ".seg";
+}
+
+void HistoryLog::begin(fs::FS& fs, const char* logDirectory, uint32_t maxBytes) {
+    std::lock_guard<std::mutex> guard(fileMutex);
+    filesystem = &fs;
+    directory = logDirectory;
+    budgetBytes = maxBytes < 2 * HISTORY_LOG_SEGMENT_SIZE ? 2 * HISTORY_LOG_SEGMENT_SIZE : maxBytes;
+    
+    // LittleFS creates one directory level at a time
+    for (int slash = directory.indexOf('/', 1); slash > 0; slash = directory.indexOf('/', slash + 1)) {
+        filesystem->mkdir(directory.substring(0, slash));
+    }
+    filesystem->mkdir(directory);
+    
+    segments.clear();
+    lastTime = 0;
+    recoveredRecords = 0;
+    tornBytes = 0;
+    indexSegments();
+    recoverLastSegment();
+    enforceBudget();
+    LOG_I(MAIN, "History log %s: %u segments, %u bytes, %u records recovered, %u torn bytes\n",
+          directory.c_str(), (unsigned)segments.size(), (unsigned)totalBytes(), (unsigned)recoveredRecords,
+          (unsigned)tornBytes);
+}
+
+// Reads the header of every segment file; files without a valid one are removed
+void HistoryLog::indexSegments() {
+    std::vector<String> invalid;
+    File dir = filesystem->open(directory);
+    if (!dir || !dir.isDirectory()) {
+        return;
+    }
+    for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+        String name = file.name();
+        int slash = name.lastIndexOf('/');
+        if (slash >= 0) {
+            name = name.substring(slash + 1);
+        }
+        if (file.isDirectory() || !name.endsWith(".seg")) {
+            continue;
+        }
+        
+        uint8_t header[HISTORY_LOG_HEADER_SIZE];
+        Segment segment;
+        bool valid = file.read(header, sizeof(header)) == sizeof(header) &&
+                     memcmp(header, HISTORY_LOG_MAGIC, 4) == 0 && header[4] == HISTORY_LOG_VERSION &&
+                     header[5] == HISTORY_LOG_RECORD_SIZE && get32(&header[16]) == crc32(header, 16);
+        if (valid) {
+            segment.sequence = get32(&header[8]);
+            segment.firstTime = get32(&header[12]);
+            segment.bytes = file.size();
+            valid = name == String(segment.sequence) + ".seg";
+        }
+        file.close();
+        if (!valid) {
+            invalid.push_back(directory + "/" + name);
+            continue;
+        }
+        
+        // Oldest first
+        std::vector<Segment>::iterator it = segments.begin();
+        while (it != segments.end() && it->sequence < segment.sequence) {
+            ++it;
+        }
+        segments.insert(it, segment);
+        if (segment.firstTime > lastTime) {
+            lastTime = segment.firstTime;
+        }
+    }
+    dir.close();
+    
+    for (size_t i = 0; i < invalid.size(); i++) {
+        LOG_W(MAIN, "History log: removing %s (bad header)\n", invalid[i].c_str());
+        filesystem->remove(invalid[i]);
+    }
+}
+
+// Walks the blocks of the newest segment up to the first bad one. Older segments
+// were closed by a clean rotation and are only checked when read.
+void HistoryLog::recoverLastSegment() {
+    appendable = false;
+    if (segments.empty()) {
+        return;
+    }
+    Segment& segment = segments.back();
+    File file = filesystem->open(segmentPath(segment.sequence), "r");
+    if (!file) {
+        errors++;
+        return;
+    }
+    
+    uint32_t valid = HISTORY_LOG_HEADER_SIZE;
+    BlockInfo info;
+    file.seek(valid);
+    while (readBlockHeader(file, info) && readBlockRecords(file, info, &block[HISTORY_LOG_BLOCK_HEADER])) {
+        valid += HISTORY_LOG_BLOCK_HEADER + (uint32_t)info.records * HISTORY_LOG_RECORD_SIZE;
+        recoveredRecords += info.records;
+        if (info.newest > lastTime) {
+            lastTime = info.newest;
+        }
+    }
+    file.close();
+    
+    // Blocks are only ever added behind a valid one: a torn tail ends the segment
+    tornBytes = segment.bytes > valid ? segment.bytes - valid : 0;
+    segment.bytes = valid;
+    appendable = tornBytes == 0;
+    if (tornBytes > 0) {
+        LOG_W(MAIN, "History log: %s ends in %u torn bytes\n", segmentPath(segment.sequence).c_str(),
+              (unsigned)tornBytes);
+    }
+}
+
+bool HistoryLog::startSegment(uint32_t firstTime) {
+    Segment segment;
+    segment.sequence = segments.empty() ? 1 : segments.back().sequence + 1;
+    segment.firstTime = firstTime;
+    segment.bytes = HISTORY_LOG_HEADER_SIZE;
+    
+    uint8_t header[HISTORY_LOG_HEADER_SIZE];
+    memcpy(header, HISTORY_LOG_MAGIC, 4);
+    header[4] = HISTORY_LOG_VERSION;
+    header[5] = HISTORY_LOG_RECORD_SIZE;
+    put16(&header[6], 0);
+    put32(&header[8], segment.sequence);
+    put32(&header[12], firstTime);
+    put32(&header[16], crc32(header, 16));
+    
+    String path = segmentPath(segment.sequence);
+    File file = filesystem->open(path, "w");
+    if (!file || file.write(header, sizeof(header)) != sizeof(header)) {
+        LOG_E(MAIN, "ERROR: Cannot create history segment %s\n", path.c_str());
+        errors++;
+        if (file) {
+            file.close();
+            filesystem->remove(path);
+        }
+        appendable = false;
+        return false;
+    }
+    file.close();
+    segments.push_back(segment);
+    appendable = true;
+    return true;
+}
+
+void HistoryLog::enforceBudget() {
+    while (segments.size() > 1 && (totalBytes() > budgetBytes || segments.size() > HISTORY_LOG_MAX_SEGMENTS)) {
+        filesystem->remove(segmentPath(segments.front().sequence));
+        segments.erase(segments.begin());
+    }
+}
+
+uint32_t HistoryLog::totalBytes() const {
+    uint32_t total = 0;
+    for (size_t i = 0; i < segments.size(); i++) {
+        total += segments[i].bytes;
+    }
+    return total;
+}
+
+void HistoryLog::append(uint64_t device, HistoryMetric metric, const HistoryBucket& bucket) {
+    std::lock_guard<std::mutex> guard(bufferMutex);
+    if (!filesystem) {
+        return;
+    }
+    if (buffered >= HISTORY_LOG_BUFFER_RECORDS) {
+        dropped++;
+        return;
+    }
+    if (buffered == 0) {
+        firstBufferedAt = millis();
+    }
+    Record& record = buffer[buffered++];
+    record.device = device;
+    record.metric = metric;
+    record.bucket = bucket;
+}
+
+void HistoryLog::loop() {
+    bool due;
+    {
+        std::lock_guard<std::mutex> guard(bufferMutex);
+        due = buffered >= HISTORY_LOG_BLOCK_RECORDS ||
+              (buffered > 0 && millis() - firstBufferedAt >= HISTORY_LOG_FLUSH_INTERVAL);
+    }
+    if (due) {
+        flush();
+    }
+}
+
+void HistoryLog::flush() {
+    std::lock_guard<std::mutex> guard(fileMutex);
+    if (!filesystem) {
+        return;
+    }
+    
+    // Encode the buffer into one block; append() may refill it while the block is written
+    uint16_t records;
+    uint32_t oldest = 0xFFFFFFFF;
+    uint32_t newest = 0;
+    {
+        std::lock_guard<std::mutex> bufferGuard(bufferMutex);
+        records = buffered;
+        for (uint16_t i = 0; i < records; i++) {
+            const Record& record = buffer[i];
+            encodeRecord(record.device, record.metric, record.bucket,
+                         &block[HISTORY_LOG_BLOCK_HEADER + (size_t)i * HISTORY_LOG_RECORD_SIZE]);
+            oldest = record.bucket.start < oldest ? record.bucket.start : oldest;
+            newest = record.bucket.start > newest ? record.bucket.start : newest;
+        }
+        buffered = 0;
+    }
+    if (records == 0) {
+        return;
+    }
+    size_t length = HISTORY_LOG_BLOCK_HEADER + (size_t)records * HISTORY_LOG_RECORD_SIZE;
+    put16(block, HISTORY_LOG_BLOCK_MARKER);
+    put16(&block[2], records);
+    put32(&block[4], oldest);
+    put32(&block[8], newest);
+    put32(&block[12], crc32(&block[HISTORY_LOG_BLOCK_HEADER], length - HISTORY_LOG_BLOCK_HEADER, crc32(block, 12)));
+    
+    if (!appendable || segments.empty() || segments.back().bytes + length > HISTORY_LOG_SEGMENT_SIZE) {
+        if (!startSegment(oldest)) {
+            return;
+        }
+    }
+    
+    Segment& segment = segments.back();
+    String path = segmentPath(segment.sequence);
+    File file = filesystem->open(path, "a");
+    size_t written = file ? file.write(block, length) : 0;
+    if (file) {
+        file.close();
+    }
+    if (written != length) {
+        // Part of the block may be on flash: readers stop there, and the next block goes to a new segment
+        LOG_E(MAIN, "ERROR: Cannot write history block to %s\n", path.c_str());
+        errors++;
+        segment.bytes += written;
+        appendable = false;
+    } else {
+        segment.bytes += length;
+        blocksWritten++;
+        recordsWritten += records;
+    }
+    enforceBudget();
+}
+
+bool HistoryLog::query(uint64_t device, HistoryMetric metric, uint32_t from, uint32_t to,
+                       std::vector<HistoryBucket>& buckets, size_t maxBuckets) {
+    std::lock_guard<std::mutex> guard(fileMutex);
+    if (!filesystem || from > to) {
+        return true;
+    }
+    
+    // Series close their buckets at different times, so the log is only nearly in order.
+    // The oldest matches found so far are kept as a max-heap behind the caller's buckets,
+    // never more than there is room for: a newer match only replaces its top.
+    size_t first = buckets.size();
+    size_t room = maxBuckets > first ? maxBuckets - first : 0;
+    bool complete = true;
+    for (size_t s = 0; s < segments.size(); s++) {
+        File file = filesystem->open(segmentPath(segments[s].sequence), "r");
+        if (!file) {
+            errors++;
+            continue;
+        }
+        
+        // Hop from block header to block header; only blocks overlapping the range are read,
+        // and once matches were left out, only blocks that can hold older ones
+        uint32_t position = HISTORY_LOG_HEADER_SIZE;
+        BlockInfo info;
+        while (position < segments[s].bytes && file.seek(position) && readBlockHeader(file, info)) {
+            position += HISTORY_LOG_BLOCK_HEADER + (uint32_t)info.records * HISTORY_LOG_RECORD_SIZE;
+            uint32_t cutoff = complete ? to : (room > 0 ? buckets[first].start : 0);
+            if (info.newest < from || info.oldest > cutoff || (!complete && room == 0)) {
+                continue;
+            }
+            uint8_t* data = &block[HISTORY_LOG_BLOCK_HEADER];
+            if (!readBlockRecords(file, info, data)) {
+                break;
+            }
+            for (uint16_t i = 0; i < info.records; i++) {
+                uint64_t recordDevice;
+                HistoryMetric recordMetric;
+                HistoryBucket bucket;
+                decodeRecord(&data[(size_t)i * HISTORY_LOG_RECORD_SIZE], recordDevice, recordMetric, bucket);
+                if (recordDevice != device || recordMetric != metric || bucket.start < from || bucket.start > to) {
+                    continue;
+                }
+                if (buckets.size() - first < room) {
+                    buckets.push_back(bucket);
+                    std::push_heap(buckets.begin() + first, buckets.end(), bucketBefore);
+                    continue;
+                }
+                complete = false;
+                if (room > 0 && bucket.start < buckets[first].start) {
+                    std::pop_heap(buckets.begin() + first, buckets.end(), bucketBefore);
+                    buckets.back() = bucket;
+                    std::push_heap(buckets.begin() + first, buckets.end(), bucketBefore);
+                }
+            }
+        }
+        file.close();
+    }
+    std::sort_heap(buckets.begin() + first, buckets.end(), bucketBefore);
+    return complete;
+}
+
+HistoryLogStats HistoryLog::getStats() {
+    HistoryLogStats stats;
+    memset(&stats, 0, sizeof(stats));
+    {
+        std::lock_guard<std::mutex> guard(fileMutex);
+        stats.segments = segments.size();
+        stats.bytes = totalBytes();
+        stats.budgetBytes = budgetBytes;
+        stats.oldestTime = segments.empty() ? 0 : segments.front().firstTime;
+        stats.blocksWritten = blocksWritten;
+        stats.recordsWritten = recordsWritten;
+        stats.errors = errors;
+        stats.recoveredRecords = recoveredRecords;
+        stats.tornBytes = tornBytes;
+    }
+    std::lock_guard<std::mutex> guard(bufferMutex);
+    stats.buffered = buffered;
+    stats.dropped = dropped;
+    return stats;
+}
@@ -0,0 +1,681 @@
+#include "HistoryStore.h"
+#include "HistoryLog.h"
+#include "VictronBLE.h"
+#include "AdvertisementFilter.h"
+#include "DeferredLog.h"
+
+#define HISTORY_NONE 0xFFFF
+#define HISTORY_NO_TIME 0xFFFFFFFF
+#define HISTORY_BLOCK_BITS ((HISTORY_BLOCK_SIZE - HISTORY_BLOCK_HEADER) * 8)
+
+struct HistoryBlockHeader {
+    uint16_t owner;        // Series index, HISTORY_NONE while free
+    uint16_t next;         // Next block of the series
+    uint16_t count;        // Samples
+    uint16_t bits;         // Bits written
+    uint32_t firstTime;
+    uint32_t lastTime;
+};
+
+static_assert(sizeof(HistoryBlockHeader) == HISTORY_BLOCK_HEADER, "HistoryBlockHeader size");
+
+static const char* const METRIC_NAMES[HISTORY_METRIC_COUNT] = {
+    "voltage", "current", "power", "batterySOC", "temperature", "pvPower", "yieldToday"
+};
+
+// Rollup tiers: bucket width and ring length (retention = width x buckets)
+struct TierConfig {
+    const char* name;
+    uint32_t seconds;
+    uint16_t buckets;
+};
+
+static const TierConfig TIERS[HISTORY_TIER_COUNT] = {
+    {"1m",  60,   720},    // 12 hours
+    {"15m", 900,  1344},   // 14 days
+    {"1h",  3600, 1440},   // 60 days
+};
+
+// Buckets of all tiers of one series, and where each tier starts among them
+static uint32_t ringBuckets() {
+    uint32_t total = 0;
+    for (int tier = 0; tier < HISTORY_TIER_COUNT; tier++) {
+        total += TIERS[tier].buckets;
+    }
+    return total;
+}
+
+static uint32_t tierOffset(HistoryTier tier) {
+    uint32_t offset = 0;
+    for (int i = 0; i < tier; i++) {
+        offset += TIERS[i].buckets;
+    }
+    return offset;
+}
+
+// Bit stream helpers; bit 0 is the most significant bit of the first data byte
+static void writeBits(uint8_t* data, uint16_t& position, uint32_t value, uint8_t count) {
+    while (count > 0) {
+        count--;
+        uint8_t mask = 0x80 >> (position & 7);
+        if ((value >> count) & 1) {
+            data[position >> 3] |= mask;
+        } else {
+            data[position >> 3] &= ~mask;
+        }
+        position++;
+    }
+}
+
+static uint32_t readBits(const uint8_t* data, uint16_t& position, uint8_t count) {
+    uint32_t value = 0;
+    while (count > 0) {
+        count--;
+        value = (value << 1) | ((data[position >> 3] >> (7 - (position & 7))) & 1);
+        position++;
+    }
+    return value;
+}
+
+static int32_t signExtend(uint32_t value, uint8_t bits) {
+    uint32_t sign = 1u << (bits - 1);
+    return (int32_t)((value ^ sign) - sign);
+}
+
+static uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Delta-of-delta encoding: prefix and payload width by magnitude
+struct TimestampCode {
+    uint8_t prefix;
+    uint8_t prefixBits;
+    uint8_t valueBits;
+};
+
+static TimestampCode timestampCode(int64_t dod) {
+    if (dod == 0) {
+        return {0x0, 1, 0};
+    } else if (dod >= -64 && dod <= 63) {
+        return {0x2, 2, 7};
+    } else if (dod >= -256 && dod <= 255) {
+        return {0x6, 3, 9};
+    } else if (dod >= -2048 && dod <= 2047) {
+        return {0xE, 4, 12};
+    }
+    return {0xF, 4, 32};
+}
+
+static uint8_t leadingZeros(uint32_t value) {
+    uint8_t count = (uint8_t)__builtin_clz(value);
+    return count > 31 ? 31 : count;   // Fits the 5-bit field
+}
+
+// Bits the value takes after the previous one, given the window of the last '11' value
+static uint8_t valueCost(uint32_t x, uint8_t leading, uint8_t meaningful) {
+    if (x == 0) {
+        return 1;
+    }
+    uint8_t lz = leadingZeros(x);
+    uint8_t tz = (uint8_t)__builtin_ctz(x);
+    if (meaningful > 0 && lz >= leading && tz >= 32 - leading - meaningful) {
+        return 2 + meaningful;
+    }
+    return 2 + 5 + 5 + (32 - lz - tz);
+}
+
+HistoryStore::HistoryStore() :
+    pool(nullptr),
+    blockCount(0),
+    nextBlock(0),
+    psram(false),
+    seriesCount(0),
+    appended(0),
+    evictedBlocks(0),
+    rollupPool(nullptr),
+    rollupCapacity(0),
+    rollupSeries(0) {
+    for (int tier = 0; tier < HISTORY_TIER_COUNT; tier++) {
+        logs[tier] = nullptr;
+    }
+}
+
+uint32_t HistoryStore::clockBase = 0;
+
+HistoryStore::~HistoryStore() {
+    free(pool);
+    free(rollupPool);
+}
+
+bool HistoryStore::begin(uint32_t rawBudget, uint32_t rollupBudget) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (pool) {
+        return true;
+    }
+    
+    // Block numbers are 16-bit, with HISTORY_NONE reserved
+    uint32_t budget = rawBudget;
+    if (budget / HISTORY_BLOCK_SIZE >= HISTORY_NONE) {
+        budget = (HISTORY_NONE - 1) * (uint32_t)HISTORY_BLOCK_SIZE;
+    }
+    psram = psramFound();
+    if (psram) {
+        pool = (uint8_t*)ps_malloc(budget);
+    }
+    if (!pool) {
+        psram = false;
+        budget = HISTORY_HEAP_BUDGET;
+        pool = (uint8_t*)malloc(budget);
+    }
+    if (!pool || budget / HISTORY_BLOCK_SIZE < 2) {
+        LOG_E(MAIN, "History store: cannot allocate %u bytes\n", (unsigned)budget);
+        free(pool);
+        pool = nullptr;
+        return false;
+    }
+    
+    blockCount = budget / HISTORY_BLOCK_SIZE;
+    for (uint16_t i = 0; i < blockCount; i++) {
+        HistoryBlockHeader* header = (HistoryBlockHeader*)block(i);
+        header->owner = HISTORY_NONE;
+    }
+    
+    // Rollup rings only fit in PSRAM
+    uint32_t ringBytes = ringBuckets() * sizeof(Bucket);
+    uint32_t rings = psram ? rollupBudget / ringBytes : 0;
+    if (rings >= HISTORY_NO_ROLLUP) {
+        rings = HISTORY_NO_ROLLUP - 1;
+    }
+    if (rings > 0) {
+        rollupPool = (Bucket*)ps_malloc(rings * ringBytes);
+    }
+    rollupCapacity = rollupPool ? rings : 0;
+    LOG_I(MAIN, "History store: %u blocks of %d bytes in %s, rollups for %u series\n", (unsigned)blockCount,
+          HISTORY_BLOCK_SIZE, psram ? "PSRAM" : "heap", (unsigned)rollupCapacity);
+    return true;
+}
+
+void HistoryStore::setLog(HistoryTier tier, HistoryLog* log) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (tier < HISTORY_TIER_COUNT) {
+        logs[tier] = log;
+    }
+}
+
+HistoryLog* HistoryStore::getLog(HistoryTier tier) const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return tier < HISTORY_TIER_COUNT ? logs[tier] : nullptr;
+}
+
+HistoryStore::Bucket* HistoryStore::ring(const Series& entry, HistoryTier tier) const {
+    return rollupPool + (size_t)entry.rollup * ringBuckets() + tierOffset(tier);
+}
+
+// Fold one sample into the current bucket of every tier
+void HistoryStore::rollUp(Series& entry, uint32_t time, float value) {
+    if (entry.rollup == HISTORY_NO_ROLLUP) {
+        return;
+    }
+    for (uint8_t t = 0; t < HISTORY_TIER_COUNT; t++) {
+        HistoryTier tier = (HistoryTier)t;
+        const TierConfig& config = TIERS[tier];
+        Bucket* buckets = ring(entry, tier);
+        uint32_t number = time / config.seconds + 1;
+        
+        // Entering a new bucket: log the one it closes, then clear it and any skipped by a gap
+        if (number > entry.newest[tier]) {
+            if (entry.newest[tier] > 0) {
+                const Bucket& closed = buckets[entry.newest[tier] % config.buckets];
+                if (logs[tier] && closed.count > 0) {
+                    HistoryBucket result = {(entry.newest[tier] - 1) * config.seconds, closed.count, closed.min,
+                                            closed.max, closed.sum / closed.count, closed.last};
+                    logs[tier]->append(entry.device, entry.metric, result);
+                }
+                for (uint32_t n = entry.newest[tier] + 1; n <= number && n <= entry.newest[tier] + config.buckets; n++) {
+                    buckets[n % config.buckets].count = 0;
+                }
+            }
+            entry.newest[tier] = number;
+        }
+        
+        Bucket& bucket = buckets[number % config.buckets];
+        if (bucket.count == 0) {
+            bucket.min = value;
+            bucket.max = value;
+            bucket.sum = 0.0f;
+        } else {
+            bucket.min = value < bucket.min ? value : bucket.min;
+            bucket.max = value > bucket.max ? value : bucket.max;
+        }
+        if (bucket.count < 0xFFFF) {
+            bucket.sum += value;
+            bucket.count++;
+        }
+        bucket.last = value;
+    }
+}
+
+HistoryStore::Series* HistoryStore::findSeries(uint64_t device, HistoryMetric metric, bool create) {
+    for (uint16_t i = 0; i < seriesCount; i++) {
+        if (series[i].device == device && series[i].metric == metric) {
+            return &series[i];
+        }
+    }
+    if (!create || seriesCount >= HISTORY_MAX_SERIES) {
+        return nullptr;
+    }
+    Series& entry = series[seriesCount++];
+    memset(&entry, 0, sizeof(entry));
+    entry.device = device;
+    entry.metric = metric;
+    entry.head = HISTORY_NONE;
+    entry.tail = HISTORY_NONE;
+    entry.rollup = HISTORY_NO_ROLLUP;
+    entry.firstTime = HISTORY_NO_TIME;
+    if (rollupSeries < rollupCapacity) {
+        entry.rollup = rollupSeries++;
+        memset(ring(entry, (HistoryTier)0), 0, ringBuckets() * sizeof(Bucket));
+    }
+    return &entry;
+}
+
+const HistoryStore::Series* HistoryStore::lookup(uint64_t device, HistoryMetric metric) const {
+    for (uint16_t i = 0; i < seriesCount; i++) {
+        if (series[i].device == device && series[i].metric == metric) {
+            return &series[i];
+        }
+    }
+    return nullptr;
+}
+
+// The next block in ring order, taken from the series holding it. That block is
+// the oldest in use, so it is always the first block of its series.
+uint16_t HistoryStore::takeBlock(uint16_t owner) {
+    uint16_t index = nextBlock;
+    nextBlock = (nextBlock + 1) % blockCount;
+    
+    HistoryBlockHeader* header = (HistoryBlockHeader*)block(index);
+    if (header->owner != HISTORY_NONE) {
+        Series& previous = series[header->owner];
+        previous.head = header->next;
+        previous.samples -= header->count;
+        if (previous.head == HISTORY_NONE) {
+            previous.tail = HISTORY_NONE;
+        }
+        evictedBlocks++;
+    }
+    header->owner = owner;
+    header->next = HISTORY_NONE;
+    return index;
+}
+
+void HistoryStore::startBlock(Series& entry, uint16_t owner, uint32_t time, float value) {
+    uint16_t index = takeBlock(owner);
+    HistoryBlockHeader* header = (HistoryBlockHeader*)block(index);
+    uint32_t bits = floatBits(value);
+    uint16_t position = 0;
+    writeBits(block(index) + HISTORY_BLOCK_HEADER, position, bits, 32);
+    header->count = 1;
+    header->bits = position;
+    header->firstTime = time;
+    header->lastTime = time;
+    
+    if (entry.tail != HISTORY_NONE) {
+        ((HistoryBlockHeader*)block(entry.tail))->next = index;
+    } else {
+        entry.head = index;
+    }
+    entry.tail = index;
+    entry.samples++;
+    entry.lastTime = time;
+    entry.lastDelta = 0;
+    entry.lastBits = bits;
+    entry.leading = 0;
+    entry.meaningful = 0;
+}
+
+bool HistoryStore::appendLocked(uint64_t device, HistoryMetric metric, uint32_t time, float value) {
+    if (!pool || metric >= HISTORY_METRIC_COUNT) {
+        return false;
+    }
+    Series* entry = findSeries(device, metric, true);
+    if (!entry) {
+        return false;
+    }
+    if (entry->tail != HISTORY_NONE && time < entry->lastTime) {
+        return false;
+    }
+    uint16_t owner = entry - series;
+    appended++;
+    if (entry->firstTime == HISTORY_NO_TIME) {
+        entry->firstTime = time;
+    }
+    rollUp(*entry, time, value);
+    if (entry->tail == HISTORY_NONE) {
+        startBlock(*entry, owner, time, value);
+        return true;
+    }
+    
+    int32_t delta = (int32_t)(time - entry->lastTime);
+    int64_t dod = (int64_t)delta - entry->lastDelta;
+    TimestampCode code = timestampCode(dod);
+    uint32_t bits = floatBits(value);
+    uint32_t x = bits ^ entry->lastBits;
+    uint16_t cost = code.prefixBits + code.valueBits + valueCost(x, entry->leading, entry->meaningful);
+    
+    HistoryBlockHeader* header = (HistoryBlockHeader*)block(entry->tail);
+    if (header->bits + cost > HISTORY_BLOCK_BITS || header->count == 0xFFFF) {
+        startBlock(*entry, owner, time, value);
+        return true;
+    }
+    
+    uint8_t* data = block(entry->tail) + HISTORY_BLOCK_HEADER;
+    uint16_t position = header->bits;
+    writeBits(data, position, code.prefix, code.prefixBits);
+    if (code.valueBits > 0) {
+        writeBits(data, position, (uint32_t)dod, code.valueBits);
+    }
+    
+    if (x == 0) {
+        writeBits(data, position, 0, 1);
+    } else {
+        uint8_t lz = leadingZeros(x);
+        uint8_t tz = (uint8_t)__builtin_ctz(x);
+        if (entry->meaningful > 0 && lz >= entry->leading && tz >= 32 - entry->leading - entry->meaningful) {
+            writeBits(data, position, 0x2, 2);
+            writeBits(data, position, x >> (32 - entry->leading - entry->meaningful), entry->meaningful);
+        } else {
+            uint8_t meaningful = 32 - lz - tz;
+            writeBits(data, position, 0x3, 2);
+            writeBits(data, position, lz, 5);
+            writeBits(data, position, meaningful - 1, 5);
+            writeBits(data, position, x >> tz, meaningful);
+            entry->leading = lz;
+            entry->meaningful = meaningful;
+        }
+    }
+    
+    header->count++;
+    header->bits = position;
+    header->lastTime = time;
+    entry->samples++;
+    entry->lastTime = time;
+    entry->lastDelta = delta;
+    entry->lastBits = bits;
+    return true;
+}
+
+bool HistoryStore::append(uint64_t device, HistoryMetric metric, uint32_t time, float value) {
+    std::lock_guard<std::mutex> guard(mutex);
+    return appendLocked(device, metric, time, value);
+}
+
+void HistoryStore::record(const VictronDeviceData& device, uint32_t time) {
+    uint8_t mac[6];
+    if (!AdvertisementFilter::parseAddress(device.address, mac)) {
+        return;
+    }
+    uint64_t key = AdvertisementFilter::addressKey(mac);
+    bool solar = device.type == DEVICE_SMART_SOLAR;
+    
+    std::lock_guard<std::mutex> guard(mutex);
+    if (device.hasVoltage) appendLocked(key, HISTORY_VOLTAGE, time, device.voltage);
+    if (device.hasCurrent) appendLocked(key, HISTORY_CURRENT, time, device.current);
+    if (device.hasPower) appendLocked(key, HISTORY_POWER, time, device.power);
+    if (device.hasSOC) appendLocked(key, HISTORY_SOC, time, device.batterySOC);
+    if (device.hasTemperature) appendLocked(key, HISTORY_TEMPERATURE, time, device.temperature);
+    if (solar) appendLocked(key, HISTORY_PV_POWER, time, device.pvPower);
+    if (solar) appendLocked(key, HISTORY_YIELD_TODAY, time, device.yieldToday);
+}
+
+bool HistoryStore::query(uint64_t device, HistoryMetric metric, uint32_t from, uint32_t to,
+                         std::vector<HistoryPoint>& points, size_t maxPoints) const {
+    std::lock_guard<std::mutex> guard(mutex);
+    const Series* entry = lookup(device, metric);
+    if (!entry) {
+        return true;
+    }
+    
+    for (uint16_t index = entry->head; index != HISTORY_NONE; ) {
+        const HistoryBlockHeader* header = (const HistoryBlockHeader*)block(index);
+        if (header->firstTime > to) {
+            break;
+        }
+        if (header->lastTime < from) {
+            index = header->next;
+            continue;
+        }
+        
+        // Decode the block from its first sample
+        const uint8_t* data = block(index) + HISTORY_BLOCK_HEADER;
+        uint16_t position = 0;
+        uint32_t time = header->firstTime;
+        int32_t delta = 0;
+        uint32_t bits = readBits(data, position, 32);
+        uint8_t leading = 0;
+        uint8_t meaningful = 0;
+        for (uint16_t sample = 0; sample < header->count; sample++) {
+            if (sample > 0) {
+                int32_t dod = 0;
+                if (readBits(data, position, 1)) {
+                    uint8_t width;
+                    if (!readBits(data, position, 1)) {
+                        width = 7;
+                    } else if (!readBits(data, position, 1)) {
+                        width = 9;
+                    } else if (!readBits(data, position, 1)) {
+                        width = 12;
+                    } else {
+                        width = 32;
+                    }
+                    dod = width == 32 ? (int32_t)readBits(data, position, 32)
+                                      : signExtend(readBits(data, position, width), width);
+                }
+                delta += dod;
+                time += delta;
+                
+                if (readBits(data, position, 1)) {
+                    if (readBits(data, position, 1)) {
+                        leading = readBits(data, position, 5);
+                        meaningful = readBits(data, position, 5) + 1;
+                    }
+                    bits ^= readBits(data, position, meaningful) << (32 - leading - meaningful);
+                }
+            }
+            if (time > to) {
+                return true;
+            }
+            if (time >= from) {
+                if (points.size() >= maxPoints) {
+                    return false;
+                }
+                HistoryPoint point = {time, bitsFloat(bits)};
+                points.push_back(point);
+            }
+        }
+        index = header->next;
+    }
+    return true;
+}
+
+bool HistoryStore::queryRollup(uint64_t device, HistoryMetric metric, HistoryTier tier, uint32_t from, uint32_t to,
+                               std::vector<HistoryBucket>& buckets, size_t maxBuckets) const {
+    if (tier >= HISTORY_TIER_COUNT) {
+        return true;
+    }
+    const TierConfig& config = TIERS[tier];
+    
+    // Bucket numbers in memory: the ring's length up to the newest, from the series'
+    // first sample on; n starts at (n - 1) x width. Older ones come from the log.
+    HistoryLog* log;
+    uint32_t first = 0;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        log = logs[tier];
+        const Series* entry = lookup(device, metric);
+        if (entry && entry->rollup != HISTORY_NO_ROLLUP && entry->newest[tier] > 0) {
+            uint32_t newest = entry->newest[tier];
+            first = newest > config.buckets ? newest - config.buckets + 1 : 1;
+            if (entry->firstTime / config.seconds + 1 > first) {
+                first = entry->firstTime / config.seconds + 1;
+            }
+        }
+    }
+    
+    // The log is read without the mutex so flash access does not hold up record()
+    if (log && first != 1) {
+        uint32_t logTo = to;
+        if (first > 0 && (first - 1) * config.seconds - 1 < logTo) {
+            logTo = (first - 1) * config.seconds - 1;
+        }
+        if (from <= logTo && !log->query(device, metric, from, logTo, buckets, maxBuckets)) {
+            return false;
+        }
+    }
+    if (first == 0) {
+        return true;
+    }
+    
+    std::lock_guard<std::mutex> guard(mutex);
+    const Series* entry = lookup(device, metric);
+    if (!entry || entry->rollup == HISTORY_NO_ROLLUP || entry->newest[tier] == 0) {
+        return true;
+    }
+    const Bucket* tierBuckets = ring(*entry, tier);
+    uint32_t newest = entry->newest[tier];
+    if (newest > config.buckets && newest - config.buckets + 1 > first) {
+        first = newest - config.buckets + 1;   // The ring moved on since the log was read
+    }
+    uint32_t firstInRange = (from + config.seconds - 1) / config.seconds + 1;
+    uint32_t lastInRange = to / config.seconds + 1;
+    for (uint32_t n = first > firstInRange ? first : firstInRange; n <= newest && n <= lastInRange; n++) {
+        const Bucket& bucket = tierBuckets[n % config.buckets];
+        if (bucket.count == 0) {
+            continue;
+        }
+        if (buckets.size() >= maxBuckets) {
+            return false;
+        }
+        HistoryBucket result = {(n - 1) * config.seconds, bucket.count, bucket.min, bucket.max,
+                                bucket.sum / bucket.count, bucket.last};
+        buckets.push_back(result);
+    }
+    return true;
+}
+
+void HistoryStore::closeBuckets() {
+    std::lock_guard<std::mutex> guard(mutex);
+    for (uint16_t i = 0; i < seriesCount; i++) {
+        const Series& entry = series[i];
+        if (entry.rollup == HISTORY_NO_ROLLUP) {
+            continue;
+        }
+        for (uint8_t t = 0; t < HISTORY_TIER_COUNT; t++) {
+            HistoryTier tier = (HistoryTier)t;
+            const TierConfig& config = TIERS[tier];
+            if (!logs[tier] || entry.newest[tier] == 0) {
+                continue;
+            }
+            const Bucket& open = ring(entry, tier)[entry.newest[tier] % config.buckets];
+            if (open.count > 0) {
+                HistoryBucket result = {(entry.newest[tier] - 1) * config.seconds, open.count, open.min, open.max,
+                                        open.sum / open.count, open.last};
+                logs[tier]->append(entry.device, entry.metric, result);
+            }
+        }
+    }
+}
+
+HistoryTier HistoryStore::resolutionFor(uint32_t from, uint32_t to, size_t maxPoints) {
+    uint32_t span = to >= from ? to - from + 1 : 1;
+    if (span <= maxPoints) {
+        return HISTORY_TIER_RAW;
+    }
+    for (uint8_t tier = 0; tier < HISTORY_TIER_COUNT; tier++) {
+        if ((span + TIERS[tier].seconds - 1) / TIERS[tier].seconds <= maxPoints) {
+            return (HistoryTier)tier;
+        }
+    }
+    return HISTORY_TIER_HOUR;
+}
+
+HistoryStats HistoryStore::getStats() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    HistoryStats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.psram = psram;
+    stats.budgetBytes = (uint32_t)blockCount * HISTORY_BLOCK_SIZE;
+    stats.blocks = blockCount;
+    stats.series = seriesCount;
+    stats.appended = appended;
+    stats.evictedBlocks = evictedBlocks;
+    for (uint16_t i = 0; i < seriesCount; i++) {
+        stats.samples += series[i].samples;
+        for (uint16_t index = series[i].head; index != HISTORY_NONE; ) {
+            const HistoryBlockHeader* header = (const HistoryBlockHeader*)block(index);
+            stats.blocksUsed++;
+            stats.bytesUsed += HISTORY_BLOCK_HEADER + (header->bits + 7) / 8;
+            index = header->next;
+        }
+    }
+    if (stats.samples > 0) {
+        stats.bytesPerSample = (float)stats.bytesUsed / stats.samples;
+        stats.hoursAt1Hz = stats.budgetBytes / (stats.bytesPerSample * HISTORY_METRIC_COUNT * 3600.0f);
+    }
+    stats.rollupBytes = rollupCapacity * ringBuckets() * sizeof(Bucket);
+    stats.rollupSeries = rollupSeries;
+    stats.rollupCapacity = rollupCapacity;
+    return stats;
+}
+
+uint32_t HistoryStore::now() {
+    return clockBase + millis() / 1000;
+}
+
+void HistoryStore::setClockBase(uint32_t seconds) {
+    clockBase = seconds;
+}
+
+const char* HistoryStore::metricName(HistoryMetric metric) {
+    return metric < HISTORY_METRIC_COUNT ? METRIC_NAMES[metric] : "unknown";
+}
+
+bool HistoryStore::metricFromName(const String& name, HistoryMetric& metric) {
+    for (uint8_t i = 0; i < HISTORY_METRIC_COUNT; i++) {
+        if (name == METRIC_NAMES[i]) {
+            metric = (HistoryMetric)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t HistoryStore::tierSeconds(HistoryTier tier) {
+    return tier < HISTORY_TIER_COUNT ? TIERS[tier].seconds : 1;
+}
+
+const char* HistoryStore::tierName(HistoryTier tier) {
+    return tier < HISTORY_TIER_COUNT ? TIERS[tier].name : "raw";
+}
+
+bool HistoryStore::tierFromName(const String& name, HistoryTier& tier) {
+    if (name == "raw") {
+        tier = HISTORY_TIER_RAW;
+        return true;
+    }
+    for (uint8_t i = 0; i < HISTORY_TIER_COUNT; i++) {
+        if (name == TIERS[i].name) {
+            tier = (HistoryTier)i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,19 +1,44 @@
 #include "MQTTPublisher.h"
+#include "DeferredLog.h"
+
+// Fields with a state topic in publishDeviceData(); a name or type change re-sends discovery
+static const VictronChangeMask MQTT_CHANGE_FIELDS =
+    CHANGE_BIT(CHANGE_VOLTAGE) | CHANGE_BIT(CHANGE_CURRENT) | CHANGE_BIT(CHANGE_POWER) |
+    CHANGE_BIT(CHANGE_SOC) | CHANGE_BIT(CHANGE_TEMPERATURE) | CHANGE_BIT(CHANGE_CONSUMED_AH) |
+    CHANGE_BIT(CHANGE_TIME_TO_GO) | CHANGE_BIT(CHANGE_AUX_VOLTAGE) | CHANGE_BIT(CHANGE_MID_VOLTAGE) |
+    CHANGE_BIT(CHANGE_YIELD_TODAY) | CHANGE_BIT(CHANGE_PV_POWER) | CHANGE_BIT(CHANGE_LOAD_CURRENT) |
+    CHANGE_BIT(CHANGE_DEVICE_STATE) | CHANGE_BIT(CHANGE_CHARGER_ERROR) | CHANGE_BIT(CHANGE_ALARM_STATE) |
+    CHANGE_BIT(CHANGE_AC_OUT_VOLTAGE) | CHANGE_BIT(CHANGE_AC_OUT_POWER) | CHANGE_BIT(CHANGE_INPUT_VOLTAGE) |
+    CHANGE_BIT(CHANGE_OUTPUT_VOLTAGE) | CHANGE_BIT(CHANGE_DEVICE_INFO);
 
 MQTTPublisher::MQTTPublisher() : 
     mqttClient(wifiClient),
     victronBLE(nullptr),
+    changeSubscriber(-1),
     lastPublishTime(0),
-    lastReconnectAttempt(0) {
+    lastReconnectAttempt(0),
+    lastFullPublish(0),
+    fullPublishPending(true) {
+}
+
+MQTTPublisher::~MQTTPublisher() {
+    if (victronBLE) {
+        victronBLE->unsubscribeChanges(changeSubscriber);
+    }
 }
 
 void MQTTPublisher::begin(VictronBLE* vble) {
+    if (victronBLE) {
+        victronBLE->unsubscribeChanges(changeSubscriber);
+    }
     victronBLE = vble;
+    changeSubscriber = victronBLE ? victronBLE->subscribeChanges("mqtt", MQTT_CHANGE_FIELDS) : -1;
+    fullPublishPending = true;
     loadConfig();
     
     if (config.enabled && !config.broker.isEmpty()) {
         mqttClient.setServer(config.broker.c_str(), config.port);
-        Serial.printf("MQTT configured: %s:%d\n", config.broker.c_str(), config.port);
+        LOG_I(MQTT, "MQTT configured: %s:%d\n", config.broker.c_str(), config.port);
     }
 }
 
@@ -48,8 +73,6 @@ void MQTTPublisher::loop() {
 }
 
 void MQTTPublisher::reconnect() {
-    Serial.print("Attempting MQTT connection...");
-    
     String clientId = "ESP32-Victron-" + String(ESP.getEfuseMac(), HEX);
     
     bool connected;
@@ -64,34 +87,75 @@ void MQTTPublisher::reconnect() {
     }
     
     if (connected) {
-        Serial.println(" connected!");
+        LOG_I(MQTT, "MQTT connected to %s:%d\n", config.broker.c_str(), config.port);
         discoveryPublished.clear();  // Re-publish discovery for all devices on reconnect
+        fullPublishPending = true;
     } else {
-        Serial.print(" failed, rc=");
-        Serial.println(mqttClient.state());
+        LOG_W(MQTT, "MQTT connection to %s:%d failed, rc=%d\n", config.broker.c_str(), config.port,
+            mqttClient.state());
     }
 }
 
-void MQTTPublisher::publishAll() {
+void MQTTPublisher::publishAll(bool full) {
     if (!mqttClient.connected() || !victronBLE) {
         return;
     }
     
+    // Without a subscription every pass is a full one
+    unsigned long now = millis();
+    full = full || fullPublishPending || changeSubscriber < 0 || now - lastFullPublish >= MQTT_FULL_PUBLISH_INTERVAL;
+    if (!full && !victronBLE->hasChanges(changeSubscriber)) {
+        return;
+    }
+    
+    // Copy one device at a time and publish without holding the snapshot: a slow
+    // or unreachable broker must not keep the display waiting. A full pass walks
+    // every device; otherwise only the devices named by change events are copied.
     auto& devices = victronBLE->getDevices();
+    ChangeEvent event;
+    if (full) {
+        // Everything goes out below, so the events queued until now are covered
+        VictronBLE::DeviceLock lock(*victronBLE);
+        while (victronBLE->nextChange(changeSubscriber, event)) {
+        }
+    }
     
-    for (auto& pair : devices) {
-        VictronDeviceData* device = &pair.second;
+    for (uint16_t slot = 0; ; slot++) {
+        {
+            VictronBLE::DeviceLock lock(*victronBLE);
+            if (full) {
+                if (slot >= devices.size()) {
+                    break;
+                }
+                event.slot = slot;
+                event.fields = CHANGE_ALL;
+            } else if (!victronBLE->nextChange(changeSubscriber, event)) {
+                break;
+            }
+            publishBuffer = devices.at(event.slot);
+        }
+        VictronDeviceData* device = &publishBuffer;
+        
+        // A new name or type changes the discovery payloads
+        if (!full && (event.fields & CHANGE_BIT(CHANGE_DEVICE_INFO))) {
+            discoveryPublished.erase(device->address);
+        }
         
         // Publish Home Assistant discovery if enabled and not yet published for this device
         if (config.homeAssistant && discoveryPublished.find(device->address) == discoveryPublished.end()) {
-            Serial.printf("Publishing HA discovery for device: %s (%s)\n", 
-                         device->name.c_str(), device->address.c_str());
+            LOG_I(MQTT, "Publishing HA discovery for device: %s (%s)\n", 
+                       device->name.c_str(), device->address.c_str());
             publishDiscovery(device);
             discoveryPublished[device->address] = true;
         }
         
         // Publish device data
-        publishDeviceData(device);
+        publishDeviceData(device, event.fields);
+    }
+    
+    if (full) {
+        fullPublishPending = false;
+        lastFullPublish = now;
     }
 }
 
@@ -197,118 +261,127 @@ void MQTTPublisher::publishDiscovery(VictronDeviceData* device) {
         payload += "}";
         
         mqttClient.publish(discoveryTopic.c_str(), payload.c_str(), true);
-        Serial.printf("Published HA discovery: %s\n", discoveryTopic.c_str());
-        Serial.printf("  Payload length: %d bytes\n", payload.length());
+        LOG_D(MQTT, "Published HA discovery: %s\n", discoveryTopic.c_str());
+        LOG_D(MQTT, "  Payload length: %d bytes\n", payload.length());
         // Note: Discovery messages are sent once on connect, not frequently
         // MQTT client handles queueing internally, no delay needed
     }
 }
 
-void MQTTPublisher::publishDeviceData(VictronDeviceData* device) {
+// Whether a publish pass includes the field
+static bool changed(VictronChangeMask changes, VictronChangeField field) {
+    return (changes & CHANGE_BIT(field)) != 0;
+}
+
+void MQTTPublisher::publishDeviceData(VictronDeviceData* device, VictronChangeMask changes) {
     String deviceId = sanitizeTopicName(device->address);
     String basePath = config.baseTopic + "/" + deviceId;
     
-    // Publish available data - use same topic names as discovery
-    if (device->hasVoltage) {
+    // Publish available data that changed - use same topic names as discovery
+    if (changed(changes, CHANGE_VOLTAGE) && device->hasVoltage) {
         String topic = basePath + "/" + sanitizeTopicName("Voltage");
         mqttClient.publish(topic.c_str(), String(device->voltage, 2).c_str());
     }
     
-    if (device->hasCurrent) {
+    if (changed(changes, CHANGE_CURRENT) && device->hasCurrent) {
         String topic = basePath + "/" + sanitizeTopicName("Current");
         mqttClient.publish(topic.c_str(), String(device->current, 3).c_str());
     }
     
-    if (device->hasPower) {
+    if (changed(changes, CHANGE_POWER) && device->hasPower) {
         String topic = basePath + "/" + sanitizeTopicName("Power");
         mqttClient.publish(topic.c_str(), String(device->power, 1).c_str());
     }
     
-    if (device->hasSOC && device->batterySOC >= 0) {
+    if (changed(changes, CHANGE_SOC) && device->hasSOC && device->batterySOC >= 0) {
         String topic = basePath + "/" + sanitizeTopicName("Battery SOC");
         mqttClient.publish(topic.c_str(), String(device->batterySOC, 1).c_str());
     }
     
-    if (device->hasTemperature && device->temperature > -200) {
+    if (changed(changes, CHANGE_TEMPERATURE) && device->hasTemperature && device->temperature > -200) {
         String topic = basePath + "/" + sanitizeTopicName("Temperature");
         mqttClient.publish(topic.c_str(), String(device->temperature, 1).c_str());
     }
     
     // SmartShunt specific fields
-    if (device->consumedAh > 0) {
+    if (changed(changes, CHANGE_CONSUMED_AH) && device->consumedAh > 0) {
         String topic = basePath + "/" + sanitizeTopicName("Consumed Ah");
         mqttClient.publish(topic.c_str(), String(device->consumedAh, 1).c_str());
     }
     
-    if (device->timeToGo > 0 && device->timeToGo < 65535) {
+    if (changed(changes, CHANGE_TIME_TO_GO) && device->timeToGo > 0 && device->timeToGo < 65535) {
         String topic = basePath + "/" + sanitizeTopicName("Time to Go");
         mqttClient.publish(topic.c_str(), String(device->timeToGo).c_str());
     }
     
-    if (device->auxMode == 0 && device->auxVoltage > 0) {
+    if (changed(changes, CHANGE_AUX_VOLTAGE) && device->auxMode == 0 && device->auxVoltage > 0) {
         String topic = basePath + "/" + sanitizeTopicName("Aux Voltage");
         mqttClient.publish(topic.c_str(), String(device->auxVoltage, 2).c_str());
     }
     
-    if (device->auxMode == 1 && device->midVoltage > 0) {
+    if (changed(changes, CHANGE_MID_VOLTAGE) && device->auxMode == 1 && device->midVoltage > 0) {
         String topic = basePath + "/" + sanitizeTopicName("Mid Voltage");
         mqttClient.publish(topic.c_str(), String(device->midVoltage, 2).c_str());
     }
     
     // Solar Controller specific fields
-    if (device->yieldToday > 0) {
+    if (changed(changes, CHANGE_YIELD_TODAY) && device->yieldToday > 0) {
         String topic = basePath + "/" + sanitizeTopicName("Yield Today");
         mqttClient.publish(topic.c_str(), String(device->yieldToday, 2).c_str());
     }
     
-    if (device->pvPower > 0) {
+    if (changed(changes, CHANGE_PV_POWER) && device->pvPower > 0) {
         String topic = basePath + "/" + sanitizeTopicName("PV Power");
         mqttClient.publish(topic.c_str(), String(device->pvPower, 0).c_str());
     }
     
-    if (device->loadCurrent > 0) {
+    if (changed(changes, CHANGE_LOAD_CURRENT) && device->loadCurrent > 0) {
         String topic = basePath + "/" + sanitizeTopicName("Load Current");
         mqttClient.publish(topic.c_str(), String(device->loadCurrent, 2).c_str());
     }
     
-    if (device->deviceState >= 0) {
+    if (changed(changes, CHANGE_DEVICE_STATE) && device->deviceState >= 0) {
         String topic = basePath + "/" + sanitizeTopicName("Device State");
         mqttClient.publish(topic.c_str(), String(device->deviceState).c_str());
     }
     
-    if (device->chargerError > 0) {
+    if (changed(changes, CHANGE_CHARGER_ERROR) && device->chargerError > 0) {
         String topic = basePath + "/" + sanitizeTopicName("Charger Error");
         mqttClient.publish(topic.c_str(), String(device->chargerError).c_str());
     }
     
-    if (device->alarmState > 0) {
+    if (changed(changes, CHANGE_ALARM_STATE) && device->alarmState > 0) {
         String topic = basePath + "/" + sanitizeTopicName("Alarm State");
         mqttClient.publish(topic.c_str(), String(device->alarmState).c_str());
     }
     
     // Inverter specific fields
     if (device->hasAcOut) {
-        String topic1 = basePath + "/" + sanitizeTopicName("AC Output Voltage");
-        mqttClient.publish(topic1.c_str(), String(device->acOutVoltage, 2).c_str());
-        String topic2 = basePath + "/" + sanitizeTopicName("AC Output Power");
-        mqttClient.publish(topic2.c_str(), String(device->acOutPower, 1).c_str());
+        if (changed(changes, CHANGE_AC_OUT_VOLTAGE)) {
+            String topic1 = basePath + "/" + sanitizeTopicName("AC Output Voltage");
+            mqttClient.publish(topic1.c_str(), String(device->acOutVoltage, 2).c_str());
+        }
+        if (changed(changes, CHANGE_AC_OUT_POWER)) {
+            String topic2 = basePath + "/" + sanitizeTopicName("AC Output Power");
+            mqttClient.publish(topic2.c_str(), String(device->acOutPower, 1).c_str());
+        }
     }
     
-    if (device->hasInputVoltage) {
+    if (changed(changes, CHANGE_INPUT_VOLTAGE) && device->hasInputVoltage) {
         String topic = basePath + "/" + sanitizeTopicName("Input Voltage");
         mqttClient.publish(topic.c_str(), String(device->inputVoltage, 2).c_str());
     }
     
-    if (device->hasOutputVoltage) {
+    if (changed(changes, CHANGE_OUTPUT_VOLTAGE) && device->hasOutputVoltage) {
         String topic = basePath + "/" + sanitizeTopicName("Output Voltage");
         mqttClient.publish(topic.c_str(), String(device->outputVoltage, 2).c_str());
     }
     
-    // Always publish RSSI
+    // Always publish RSSI along with any change
     String rssiTopic = basePath + "/" + sanitizeTopicName("RSSI");
     mqttClient.publish(rssiTopic.c_str(), String(device->rssi).c_str());
     
-    Serial.printf("Published MQTT data for %s\n", device->name.c_str());
+    LOG_D(MQTT, "Published MQTT data for %s\n", device->name.c_str());
 }
 
 String MQTTPublisher::sanitizeTopicName(const String& name) {
@@ -332,7 +405,7 @@ void MQTTPublisher::loadConfig() {
     config.publishInterval = preferences.getUShort("interval", 30);
     preferences.end();
     
-    Serial.println("MQTT config loaded");
+    LOG_I(MQTT, "MQTT config loaded\n");
 }
 
 void MQTTPublisher::saveConfig() {
@@ -347,7 +420,7 @@ void MQTTPublisher::saveConfig() {
     preferences.putUShort("interval", config.publishInterval);
     preferences.end();
     
-    Serial.println("MQTT config saved");
+    LOG_I(MQTT, "MQTT config saved\n");
 }
 
 MQTTConfig& MQTTPublisher::getConfig() {
@@ -363,6 +436,7 @@ void MQTTPublisher::setConfig(const MQTTConfig& cfg) {
         disconnect();
         mqttClient.setServer(config.broker.c_str(), config.port);
         discoveryPublished.clear();  // Re-publish discovery for all devices
+        fullPublishPending = true;
     }
 }
 
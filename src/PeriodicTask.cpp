@@ -0,0 +1,125 @@
+#include "PeriodicTask.h"
+#include <esp_timer.h>
+
+PeriodicTask* PeriodicTask::registry[MAX_PERIODIC_TASKS] = {};
+std::atomic<int> PeriodicTask::registered(0);
+
+PeriodicTask::PeriodicTask()
+    : tick(nullptr), context(nullptr), handle(nullptr), stopRequested(false), running(false),
+      ticks(0), lateTicks(0), maxJitterUs(0), meanJitterUs(0), maxRunUs(0) {
+    memset(&config, 0, sizeof(config));
+}
+
+bool PeriodicTask::start(const TaskConfig& taskConfig, TaskTick taskTick, void* taskContext) {
+    if (running.load() || !taskTick) {
+        return false;
+    }
+    config = taskConfig;
+    tick = taskTick;
+    context = taskContext;
+    stopRequested.store(false);
+    resetTiming();
+    
+    running.store(true);
+    if (xTaskCreatePinnedToCore(entry, config.name, config.stackBytes, this, config.priority,
+                                &handle, config.core) != pdPASS) {
+        running.store(false);
+        return false;
+    }
+    
+    int slot = registered.load();
+    bool known = false;
+    for (int i = 0; i < slot; i++) {
+        known = known || registry[i] == this;
+    }
+    if (!known && slot < MAX_PERIODIC_TASKS) {
+        registry[slot] = this;
+        registered.store(slot + 1);
+    }
+    return true;
+}
+
+bool PeriodicTask::stop(uint32_t timeoutMs) {
+    stopRequested.store(true);
+    unsigned long started = millis();
+    while (running.load()) {
+        if (timeoutMs > 0 && millis() - started >= timeoutMs) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+void PeriodicTask::entry(void* self) {
+    PeriodicTask* task = static_cast<PeriodicTask*>(self);
+    task->run();
+    task->running.store(false);
+    vTaskDelete(nullptr);
+}
+
+void PeriodicTask::run() {
+    const int64_t periodUs = (int64_t)config.periodMs * 1000;
+    int64_t due = esp_timer_get_time();
+    int64_t lastStart = 0;
+    
+    while (!stopRequested.load()) {
+        int64_t started = esp_timer_get_time();
+        tick(context);
+        int64_t finished = esp_timer_get_time();
+        
+        uint32_t runUs = (uint32_t)(finished - started);
+        if (runUs > maxRunUs.load(std::memory_order_relaxed)) {
+            maxRunUs.store(runUs, std::memory_order_relaxed);
+        }
+        if (lastStart != 0) {
+            int64_t spacing = started - lastStart - periodUs;
+            uint32_t jitterUs = (uint32_t)(spacing < 0 ? -spacing : spacing);
+            if (jitterUs > maxJitterUs.load(std::memory_order_relaxed)) {
+                maxJitterUs.store(jitterUs, std::memory_order_relaxed);
+            }
+            if (jitterUs > TASK_JITTER_LIMIT_US) {
+                lateTicks.fetch_add(1, std::memory_order_relaxed);
+            }
+            int32_t mean = (int32_t)meanJitterUs.load(std::memory_order_relaxed);
+            meanJitterUs.store((uint32_t)(mean + ((int32_t)jitterUs - mean) / 16), std::memory_order_relaxed);
+        }
+        lastStart = started;
+        ticks.fetch_add(1, std::memory_order_relaxed);
+        
+        // Sleep until the next slot; after an overrun the next slot is now
+        due += periodUs;
+        int64_t now = esp_timer_get_time();
+        if (due < now) {
+            due = now;
+        }
+        int64_t remainingUs = due - now;
+        vTaskDelay(pdMS_TO_TICKS(remainingUs > 1000 ? (uint32_t)((remainingUs + 999) / 1000) : 1));
+    }
+}
+
+TaskTiming PeriodicTask::getTiming() const {
+    TaskTiming timing;
+    timing.ticks = ticks.load(std::memory_order_relaxed);
+    timing.lateTicks = lateTicks.load(std::memory_order_relaxed);
+    timing.maxJitterUs = maxJitterUs.load(std::memory_order_relaxed);
+    timing.meanJitterUs = meanJitterUs.load(std::memory_order_relaxed);
+    timing.maxRunUs = maxRunUs.load(std::memory_order_relaxed);
+    return timing;
+}
+
+void PeriodicTask::resetTiming() {
+    ticks.store(0);
+    lateTicks.store(0);
+    maxJitterUs.store(0);
+    meanJitterUs.store(0);
+    maxRunUs.store(0);
+}
+
+int PeriodicTask::taskCount() {
+    return registered.load();
+}
+
+const PeriodicTask* PeriodicTask::taskAt(int index) {
+    return index >= 0 && index < registered.load() ? registry[index] : nullptr;
+}
@@ -0,0 +1,202 @@
+#include "ScanScheduler.h"
+#include "DeferredLog.h"
+
+ScanScheduler::ScanScheduler(DeviceScanTiming* deviceTimings, uint16_t slots)
+    : timings(deviceTimings), capacity(slots), adaptive(ADAPTIVE_SCAN_ENABLED != 0),
+      discovery(false), discoveryEndsWhenLocked(false), discoveryEndUs(0), nextDiscoveryUs(0),
+      radioOn(false), radioOnSinceUs(0), radioOnUs(0), startedUs(0), windows(0), missed(0),
+      discoveries(0), radioStarts(0), trackedCount(0), lockedCount(0) {
+    memset(timings, 0, sizeof(DeviceScanTiming) * capacity);
+}
+
+void ScanScheduler::begin(int64_t nowUs) {
+    startedUs = nowUs;
+    radioOnUs = 0;
+    radioOnSinceUs = nowUs;
+    startDiscovery(nowUs, true);
+}
+
+void ScanScheduler::setAdaptive(bool enabled) {
+    adaptive = enabled;
+}
+
+void ScanScheduler::startDiscovery(int64_t nowUs, bool endWhenLocked) {
+    if (!discovery) {
+        discoveries++;
+        discoveryEndsWhenLocked = endWhenLocked;
+        LOG_D(BLE, "Discovery scan started (%s)\n", endWhenLocked ? "learning" : "periodic");
+    } else {
+        // A periodic discovery keeps running for its full duration
+        discoveryEndsWhenLocked = discoveryEndsWhenLocked && endWhenLocked;
+    }
+    discovery = true;
+    discoveryEndUs = nowUs + (int64_t)ADAPTIVE_SCAN_DISCOVERY_DURATION * 1000;
+    nextDiscoveryUs = nowUs + (int64_t)ADAPTIVE_SCAN_DISCOVERY_INTERVAL * 1000;
+}
+
+void ScanScheduler::scheduleWindow(DeviceScanTiming& timing, int64_t centerUs) {
+    int64_t guardUs = (int64_t)ADAPTIVE_SCAN_GUARD * 1000 + 4 * (int64_t)timing.jitterUs;
+    guardUs <<= timing.misses;
+    if (guardUs > timing.periodUs / 2) {
+        guardUs = timing.periodUs / 2;
+    }
+    timing.windowStartUs = centerUs - guardUs;
+    timing.windowEndUs = centerUs + guardUs;
+}
+
+// Period from the interval since the last arrival. An interval that spans several
+// periods (skipped or missed arrivals) is divided down; one that fits no multiple
+// restarts the learning.
+void ScanScheduler::learn(DeviceScanTiming& timing, int64_t timeUs) {
+    if (timing.lastSeenUs == 0) {
+        timing.lastSeenUs = timeUs;
+        return;
+    }
+    int64_t intervalUs = timeUs - timing.lastSeenUs;
+    timing.lastSeenUs = timeUs;
+    
+    int64_t periodUs = timing.periodUs;
+    int64_t periods = periodUs > 0 ? (intervalUs + periodUs / 2) / periodUs : 0;
+    if (periods < 1) {
+        timing.periodUs = intervalUs;
+        timing.consistent = 0;
+        timing.jitterUs = 0;
+        timing.locked = false;
+        return;
+    }
+    
+    int64_t sampleUs = intervalUs / periods;
+    int64_t errorUs = sampleUs - periodUs;
+    if (errorUs > periodUs / 8 || errorUs < -periodUs / 8) {
+        timing.periodUs = intervalUs;
+        timing.consistent = 0;
+        timing.jitterUs = 0;
+        timing.locked = false;
+        return;
+    }
+    
+    timing.periodUs += errorUs / 4;
+    int64_t residualUs = intervalUs - periods * timing.periodUs;
+    if (residualUs < 0) {
+        residualUs = -residualUs;
+    }
+    timing.jitterUs = (uint32_t)((int32_t)timing.jitterUs + ((int32_t)residualUs - (int32_t)timing.jitterUs) / 4);
+    if (timing.consistent < ADAPTIVE_SCAN_LOCK_INTERVALS) {
+        timing.consistent++;
+    }
+    timing.locked = timing.consistent >= ADAPTIVE_SCAN_LOCK_INTERVALS;
+}
+
+void ScanScheduler::observe(uint16_t slot, int64_t timeUs, bool tracked) {
+    if (slot >= capacity) {
+        return;
+    }
+    DeviceScanTiming& timing = timings[slot];
+    timing.tracked = tracked;
+    if (!tracked || (timing.lastSeenUs != 0 && timeUs - timing.lastSeenUs < (int64_t)ADAPTIVE_SCAN_MIN_GAP * 1000)) {
+        return;
+    }
+    
+    bool wasLocked = timing.locked;
+    if (wasLocked && timeUs >= timing.windowStartUs && timeUs <= timing.windowEndUs) {
+        windows++;
+    }
+    learn(timing, timeUs);
+    timing.misses = 0;
+    
+    if (timing.locked) {
+        // Next window: the first arrival at least ADAPTIVE_SCAN_TARGET_PERIOD away
+        int64_t skip = (int64_t)ADAPTIVE_SCAN_TARGET_PERIOD * 1000 / timing.periodUs;
+        scheduleWindow(timing, timeUs + (skip > 1 ? skip : 1) * timing.periodUs);
+    } else {
+        // Still learning (or relearning): keep scanning until the period is known
+        if (wasLocked) {
+            LOG_D(BLE, "Scan slot %u lost its timing, relearning\n", (unsigned)slot);
+        }
+        startDiscovery(timeUs, true);
+    }
+}
+
+bool ScanScheduler::update(int64_t nowUs) {
+    if (discovery && nowUs >= discoveryEndUs) {
+        discovery = false;
+    }
+    if (nowUs >= nextDiscoveryUs) {
+        startDiscovery(nowUs, false);
+    }
+    
+    bool wanted = discovery || !adaptive;
+    uint16_t tracked = 0;
+    uint16_t locked = 0;
+    for (uint16_t slot = 0; slot < capacity; slot++) {
+        DeviceScanTiming& timing = timings[slot];
+        if (!timing.tracked) {
+            continue;
+        }
+        tracked++;
+        if (!timing.locked) {
+            continue;
+        }
+        
+        if (nowUs > timing.windowEndUs) {
+            windows++;
+            missed++;
+            timing.misses++;
+            if (timing.misses >= ADAPTIVE_SCAN_MISS_LIMIT) {
+                LOG_D(BLE, "Scan slot %u missed %u windows, relearning\n", (unsigned)slot, (unsigned)timing.misses);
+                timing.locked = false;
+                timing.consistent = 0;
+                timing.misses = 0;
+                startDiscovery(nowUs, true);
+                continue;
+            }
+            // Listen for the next arrival after the one missed, with a wider window
+            scheduleWindow(timing, (timing.windowStartUs + timing.windowEndUs) / 2 + timing.periodUs);
+        }
+        locked++;
+        if (nowUs >= timing.windowStartUs) {
+            wanted = true;
+        }
+    }
+    trackedCount = tracked;
+    lockedCount = locked;
+    
+    if (discovery && discoveryEndsWhenLocked && tracked > 0 && locked == tracked) {
+        discovery = false;
+        wanted = !adaptive;
+        for (uint16_t slot = 0; slot < capacity && !wanted; slot++) {
+            wanted = timings[slot].locked && nowUs >= timings[slot].windowStartUs;
+        }
+    }
+    return wanted;
+}
+
+void ScanScheduler::radioChanged(bool on, int64_t nowUs) {
+    if (on == radioOn) {
+        return;
+    }
+    if (on) {
+        radioOnSinceUs = nowUs;
+        radioStarts++;
+    } else {
+        radioOnUs += nowUs - radioOnSinceUs;
+    }
+    radioOn = on;
+}
+
+ScanSchedulerStats ScanScheduler::getStats(int64_t nowUs) const {
+    ScanSchedulerStats stats;
+    stats.adaptive = adaptive;
+    stats.discovery = discovery;
+    stats.tracked = trackedCount;
+    stats.locked = lockedCount;
+    uint64_t onUs = radioOnUs + (radioOn ? nowUs - radioOnSinceUs : 0);
+    int64_t elapsedUs = nowUs - startedUs;
+    stats.radioOnPercent = elapsedUs > 0 ? 100.0f * onUs / elapsedUs : 0.0f;
+    stats.windows = windows;
+    stats.missed = missed;
+    stats.missedPercent = windows > 0 ? 100.0f * missed / windows : 0.0f;
+    stats.discoveries = discoveries;
+    stats.radioStarts = radioStarts;
+    return stats;
+}
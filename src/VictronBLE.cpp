@@ -1,9 +1,11 @@
 #include "VictronBLE.h"
-#include <cctype>
-#include <aes/esp_aes.h>
+#include "VictronPayloadLayout.h"
+#include "AdvertisementCapture.h"
+#include "DeferredLog.h"
+#include <esp_timer.h>
 
-// BLE Scan Callback - used for real-time device discovery logging
-// Note: Actual device processing happens in the scan() method
+// BLE Scan Callback - runs in the NimBLE host task for every advertisement
+// Only copies the advertisement into the ring; parsing happens in VictronBLE::loop()
 class VictronAdvertisedDeviceCallbacks: public NimBLEAdvertisedDeviceCallbacks {
 private:
     VictronBLE* victronBLE;
@@ -12,135 +14,769 @@ public:
     VictronAdvertisedDeviceCallbacks(VictronBLE* vble) : victronBLE(vble) {}
     
     void onResult(NimBLEAdvertisedDevice* advertisedDevice) {
-        // Real-time logging of discovered Victron devices during scan
-        if (advertisedDevice->haveManufacturerData()) {
-            std::string mfgData = advertisedDevice->getManufacturerData();
-            if (mfgData.length() >= 2) {
-                uint16_t mfgId = (uint8_t)mfgData[1] << 8 | (uint8_t)mfgData[0];
-                
-                if (mfgId == VICTRON_MANUFACTURER_ID) {
-                    Serial.println("Found Victron device: " + String(advertisedDevice->getName().c_str()));
-                }
-            }
-        }
+        victronBLE->onAdvertisement(advertisedDevice);
+    }
+};
+
+static_assert(NAME_CACHE_NAME_LENGTH == MAX_ADVERTISEMENT_NAME, "name cache entries hold advertised names");
+
+// FNV-1a hash of a manufacturer data frame, used by the nonce cache
+static uint32_t hashFrame(const uint8_t* data, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
     }
+    return hash;
+}
+
+// Format address bytes the same way as NimBLEAddress::toString() ("aa:bb:cc:dd:ee:ff")
+static String formatAddress(const uint8_t* mac) {
+    char buffer[18];
+    snprintf(buffer, sizeof(buffer), "%02x:%02x:%02x:%02x:%02x:%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return String(buffer);
+}
+
+// Device type by readout type (byte 6), the most reliable classification
+static const VictronDeviceType READOUT_DEVICE_TYPES[16] = {
+    DEVICE_UNKNOWN,                 // 0x00
+    DEVICE_SMART_SOLAR,             // 0x01 READOUT_SOLAR_CHARGER
+    DEVICE_SMART_SHUNT,             // 0x02 READOUT_BATTERY_MONITOR
+    DEVICE_INVERTER,                // 0x03 READOUT_INVERTER
+    DEVICE_DCDC_CONVERTER,          // 0x04 READOUT_DCDC_CONVERTER
+    DEVICE_SMART_LITHIUM,           // 0x05 READOUT_SMART_LITHIUM
+    DEVICE_INVERTER_RS,             // 0x06 READOUT_INVERTER_RS
+    DEVICE_UNKNOWN,                 // 0x07 READOUT_GX_DEVICE
+    DEVICE_AC_CHARGER,              // 0x08 READOUT_AC_CHARGER
+    DEVICE_SMART_BATTERY_PROTECT,   // 0x09 READOUT_SMART_BATTERY_PROTECT
+    DEVICE_LYNX_SMART_BMS,          // 0x0A READOUT_LYNX_SMART_BMS
+    DEVICE_MULTI_RS,                // 0x0B READOUT_MULTI_RS
+    DEVICE_VE_BUS,                  // 0x0C READOUT_VE_BUS
+    DEVICE_DC_ENERGY_METER,         // 0x0D READOUT_DC_ENERGY_METER
+    DEVICE_UNKNOWN,                 // 0x0E
+    DEVICE_ORION_XS                 // 0x0F READOUT_ORION_XS
+};
+
+// Model ID ranges (see VictronProductID), sorted by first ID for binary search
+struct VictronModelRange {
+    uint16_t first;
+    uint16_t last;
+    VictronDeviceType type;
 };
 
-VictronBLE::VictronBLE() : retainLastData(true) {
+static constexpr VictronModelRange MODEL_RANGES[] = {
+    { 0x0203, 0x0205, DEVICE_SMART_SHUNT },          // BMV-700 series
+    { 0xA050, 0xA06F, DEVICE_SMART_SOLAR },          // SmartSolar MPPT
+    { 0xA200, 0xA2FF, DEVICE_INVERTER },             // Phoenix Inverter
+    { 0xA340, 0xA34F, DEVICE_BLUE_SMART_CHARGER },   // Phoenix Smart IP43 Charger
+    { 0xA380, 0xA38F, DEVICE_SMART_SHUNT },          // BMV-71x Smart, SmartShunt
+    { 0xA3F0, 0xA3FF, DEVICE_DCDC_CONVERTER },       // Orion Smart / BuckBoost
+};
+
+static constexpr bool modelRangesSorted(const VictronModelRange* ranges, size_t count) {
+    return count < 2 ||
+           (ranges[0].first <= ranges[0].last && ranges[0].last < ranges[1].first &&
+            modelRangesSorted(ranges + 1, count - 1));
+}
+static_assert(modelRangesSorted(MODEL_RANGES, sizeof(MODEL_RANGES) / sizeof(MODEL_RANGES[0])),
+              "MODEL_RANGES must be sorted and must not overlap");
+
+// Summary log line per payload layout
+static void logSmartShunt(const char* name, const VictronReading& reading) {
+    LOG_D(BLE, "%s parsed: V=%.2f, A=%.3f, SOC=%.1f%%, Ah=%.1f\n", 
+              name, reading.voltage, reading.current, reading.batterySOC, reading.consumedAh);
+}
+
+static void logSolarController(const char* name, const VictronReading& reading) {
+    LOG_D(BLE, "%s parsed: V=%.2f, A=%.2f, PV=%.0fW, Yield=%.2fkWh, State=%d, Error=%d\n",
+              name, reading.voltage, reading.current, reading.pvPower, reading.yieldToday, 
+              reading.deviceState, reading.chargerError);
+}
+
+static void logDCDCConverter(const char* name, const VictronReading& reading) {
+    LOG_D(BLE, "%s parsed: In=%.2fV, Out=%.2fV, State=%d, Error=%d, OffReason=0x%08X\n", 
+              name, reading.inputVoltage, reading.outputVoltage, reading.deviceState, 
+              reading.chargerError, reading.offReason);
+}
+
+static void logReading(const char* name, const VictronReading& reading) {
+    LOG_D(BLE, "%s parsed: V=%.2f, A=%.2f, State=%d\n", name, reading.voltage, reading.current, reading.deviceState);
+}
+
+// Payload decoder per device type - parseVictronAdvertisement indexes this by
+// VictronDeviceType instead of testing the type one by one
+struct VictronPayloadDecoder {
+    const char* name;
+    const VictronField* fields;    // nullptr: no fixed layout, parsed as TLV records
+    uint8_t fieldCount;
+    uint8_t payloadBytes;          // Expected payload size, 0 if not fixed
+    void (*log)(const char* name, const VictronReading& reading);
+};
+
+#define DECODER_LAYOUT(layout) layout, (uint8_t)victronLayoutSize(layout)
+#define DECODER_TLV(name) { name, nullptr, 0, 0, nullptr }
+
+static const VictronPayloadDecoder PAYLOAD_DECODERS[] = {
+    DECODER_TLV("Unknown"),                                                                            // DEVICE_UNKNOWN
+    { "SmartShunt", DECODER_LAYOUT(SMART_SHUNT_LAYOUT), SMART_SHUNT_PAYLOAD_SIZE, logSmartShunt },    // DEVICE_SMART_SHUNT
+    // Blue Smart Chargers use the same 16-byte payload format as solar controllers
+    { "SolarController", DECODER_LAYOUT(SOLAR_CONTROLLER_LAYOUT), SOLAR_CONTROLLER_PAYLOAD_SIZE, logSolarController },  // DEVICE_SMART_SOLAR
+    { "BlueSmartCharger", DECODER_LAYOUT(SOLAR_CONTROLLER_LAYOUT), SOLAR_CONTROLLER_PAYLOAD_SIZE, logSolarController }, // DEVICE_BLUE_SMART_CHARGER
+    { "Inverter", DECODER_LAYOUT(INVERTER_LAYOUT), 0, logReading },                                  // DEVICE_INVERTER
+    { "DCDC", DECODER_LAYOUT(DCDC_CONVERTER_LAYOUT), DCDC_CONVERTER_PAYLOAD_SIZE, logDCDCConverter },  // DEVICE_DCDC_CONVERTER
+    { "SmartLithium", DECODER_LAYOUT(SMART_LITHIUM_LAYOUT), 0, logReading },                         // DEVICE_SMART_LITHIUM
+    DECODER_TLV("Inverter RS"),                                                                        // DEVICE_INVERTER_RS
+    { "AC Charger", DECODER_LAYOUT(AC_CHARGER_LAYOUT), 0, logReading },                              // DEVICE_AC_CHARGER
+    DECODER_TLV("Smart Battery Protect"),                                                              // DEVICE_SMART_BATTERY_PROTECT
+    DECODER_TLV("Lynx Smart BMS"),                                                                     // DEVICE_LYNX_SMART_BMS
+    DECODER_TLV("Multi RS"),                                                                           // DEVICE_MULTI_RS
+    DECODER_TLV("VE.Bus"),                                                                             // DEVICE_VE_BUS
+    { "DC Energy Meter", DECODER_LAYOUT(DC_ENERGY_METER_LAYOUT), 0, logReading },                    // DEVICE_DC_ENERGY_METER
+    { "Orion XS", DECODER_LAYOUT(ORION_XS_LAYOUT), 0, logReading },                                  // DEVICE_ORION_XS
+    DECODER_TLV("Smart Battery Sense"),                                                                // DEVICE_SMART_BATTERY_SENSE
+    DECODER_TLV("Eco Worthy BMS"),                                                                     // DEVICE_ECO_WORTHY_BMS
+};
+static_assert(sizeof(PAYLOAD_DECODERS) / sizeof(PAYLOAD_DECODERS[0]) == DEVICE_ECO_WORTHY_BMS + 1,
+              "PAYLOAD_DECODERS needs one entry per VictronDeviceType");
+
+// Reading fields in VictronChangeField order, for mergeDeviceData()
+struct VictronMergeField {
+    uint16_t dest;                 // Byte offset into VictronReading
+    VictronFieldType type;
+    int16_t flag;                  // has* flag guarding the value, or VICTRON_NO_FLAG
+    uint8_t count;                 // Values sharing the bit (the cell voltages)
+};
+
+static const VictronMergeField MERGE_FIELDS[] = {
+    { VICTRON_DEST(voltage), VICTRON_FLAG(hasVoltage), 1 },               // CHANGE_VOLTAGE
+    { VICTRON_DEST(current), VICTRON_FLAG(hasCurrent), 1 },               // CHANGE_CURRENT
+    { VICTRON_DEST(power), VICTRON_FLAG(hasPower), 1 },                   // CHANGE_POWER
+    { VICTRON_DEST(batterySOC), VICTRON_FLAG(hasSOC), 1 },                // CHANGE_SOC
+    { VICTRON_DEST(temperature), VICTRON_FLAG(hasTemperature), 1 },       // CHANGE_TEMPERATURE
+    { VICTRON_DEST(consumedAh), VICTRON_NO_FLAG, 1 },                     // CHANGE_CONSUMED_AH
+    { VICTRON_DEST(timeToGo), VICTRON_NO_FLAG, 1 },                       // CHANGE_TIME_TO_GO
+    { VICTRON_DEST(auxVoltage), VICTRON_NO_FLAG, 1 },                     // CHANGE_AUX_VOLTAGE
+    { VICTRON_DEST(midVoltage), VICTRON_NO_FLAG, 1 },                     // CHANGE_MID_VOLTAGE
+    { VICTRON_DEST(auxMode), VICTRON_NO_FLAG, 1 },                        // CHANGE_AUX_MODE
+    { VICTRON_DEST(yieldToday), VICTRON_NO_FLAG, 1 },                     // CHANGE_YIELD_TODAY
+    { VICTRON_DEST(pvPower), VICTRON_NO_FLAG, 1 },                        // CHANGE_PV_POWER
+    { VICTRON_DEST(loadCurrent), VICTRON_NO_FLAG, 1 },                    // CHANGE_LOAD_CURRENT
+    { VICTRON_DEST(chargerError), VICTRON_NO_FLAG, 1 },                   // CHANGE_CHARGER_ERROR
+    { VICTRON_DEST(acOutVoltage), VICTRON_FLAG(hasAcOut), 1 },            // CHANGE_AC_OUT_VOLTAGE
+    { VICTRON_DEST(acOutCurrent), VICTRON_FLAG(hasAcOut), 1 },            // CHANGE_AC_OUT_CURRENT
+    { VICTRON_DEST(acOutPower), VICTRON_FLAG(hasAcOut), 1 },              // CHANGE_AC_OUT_POWER
+    { VICTRON_DEST(inputVoltage), VICTRON_FLAG(hasInputVoltage), 1 },     // CHANGE_INPUT_VOLTAGE
+    { VICTRON_DEST(outputVoltage), VICTRON_FLAG(hasOutputVoltage), 1 },   // CHANGE_OUTPUT_VOLTAGE
+    { VICTRON_DEST(cellVoltage[0]), VICTRON_NO_FLAG, 8 },                 // CHANGE_CELL_VOLTAGES
+    { VICTRON_DEST(balancerStatus), VICTRON_NO_FLAG, 1 },                 // CHANGE_BALANCER_STATUS
+    { VICTRON_DEST(bmsFlags), VICTRON_NO_FLAG, 1 },                       // CHANGE_BMS_FLAGS
+    { VICTRON_DEST(acInPower), VICTRON_NO_FLAG, 1 },                      // CHANGE_AC_IN_POWER
+    { VICTRON_DEST(activeAcIn), VICTRON_NO_FLAG, 1 },                     // CHANGE_ACTIVE_AC_IN
+    { VICTRON_DEST(batteryVoltage2), VICTRON_NO_FLAG, 1 },                // CHANGE_BATTERY_VOLTAGE2
+    { VICTRON_DEST(batteryCurrent2), VICTRON_NO_FLAG, 1 },                // CHANGE_BATTERY_CURRENT2
+    { VICTRON_DEST(batteryVoltage3), VICTRON_NO_FLAG, 1 },                // CHANGE_BATTERY_VOLTAGE3
+    { VICTRON_DEST(batteryCurrent3), VICTRON_NO_FLAG, 1 },                // CHANGE_BATTERY_CURRENT3
+    { VICTRON_DEST(deviceState), VICTRON_NO_FLAG, 1 },                    // CHANGE_DEVICE_STATE
+    { VICTRON_DEST(alarmState), VICTRON_NO_FLAG, 1 },                     // CHANGE_ALARM_STATE
+    { VICTRON_DEST(offReason), VICTRON_NO_FLAG, 1 },                      // CHANGE_OFF_REASON
+};
+static_assert(sizeof(MERGE_FIELDS) / sizeof(MERGE_FIELDS[0]) == CHANGE_DATA_VALID,
+              "MERGE_FIELDS needs one entry per reading VictronChangeField");
+static_assert(sizeof(((VictronReading*)nullptr)->cellVoltage) == 8 * sizeof(float),
+              "CHANGE_CELL_VOLTAGES covers 8 cells");
+static_assert(sizeof(float) == sizeof(uint32_t) && sizeof(int) == sizeof(uint32_t),
+              "merged values are compared and copied as 4-byte words");
+
+// Whether a value differs from the stored one; floats by more than the deadband
+static bool mergeValueChanged(VictronFieldType type, const uint8_t* stored, const uint8_t* value, float deadband) {
+    if (type != FIELD_FLOAT) {
+        return memcmp(stored, value, sizeof(uint32_t)) != 0;
+    }
+    float a, b;
+    memcpy(&a, stored, sizeof(a));
+    memcpy(&b, value, sizeof(b));
+    return a != b && !(fabsf(a - b) <= deadband);
+}
+
+VictronBLE::VictronBLE() : snapshotPending(false), lastSnapshot(0), scanHeld(false),
+                           retainLastData(true), advertisementsReceived(0), advertisementsProcessed(0),
+                           frameCacheLookups(0), frameCacheHits(0), keyGeneration(0), lastResultsFlush(0),
+                           parseMetrics(nullptr), scanScheduler(scanTimings, VICTRON_MAX_DEVICES),
+                           passiveScan(PASSIVE_SCAN_ENABLED != 0), scanActive(PASSIVE_SCAN_ENABLED == 0),
+                           nameProbing(false), nameProbeRequested(false), nameProbeStarted(0), nameWantedAt(0),
+                           nameProbes(0),
+                           debugWatchedAt(0), debugCaptureActive(false), capture(nullptr) {
     pBLEScan = nullptr;
+    parseError[0] = '\0';
+    memset(debugRecords, 0, sizeof(debugRecords));
+    memset(dirtySlots, 0, sizeof(dirtySlots));
+    memset(pendingChanges, 0, sizeof(pendingChanges));
+    for (int i = 0; i < CHANGE_FIELD_COUNT; i++) {
+        changeDeadbands[i] = 0.0f;
+    }
+    for (int i = 0; i < VICTRON_MAX_DEVICES; i++) {
+        metricsReset(metrics[i]);
+    }
 }
 
 void VictronBLE::begin() {
-    Serial.println("Initializing Victron BLE...");
+    LOG_I(BLE, "Initializing Victron BLE...\n");
     NimBLEDevice::init("");
     
+    // Pick the quickest AES-CTR implementation for Victron-sized payloads on this chip
+    AesCtr::selectFastest();
+    
+    LOG_I(BLE, "Device table: %u slots x %u bytes, %u bytes total\n",
+               (unsigned)VictronDeviceTable::capacity(), (unsigned)VictronDeviceTable::entryBytes(),
+               (unsigned)VictronDeviceTable::memoryBytes());
+    LOG_I(BLE, "Debug record: %u bytes per device, allocated only while /debug is open\n",
+               (unsigned)sizeof(VictronDebugData));
+    
     pBLEScan = NimBLEDevice::getScan();
-    pBLEScan->setAdvertisedDeviceCallbacks(new VictronAdvertisedDeviceCallbacks(this), false);
-    // Use active scanning for faster device discovery
-    // Note: Victron devices broadcast BLE advertisements at their own rate (typically 1-2 seconds)
-    // We cannot "request" faster updates as these are advertisement packets, not connection-based
-    pBLEScan->setActiveScan(true);
+    // Request duplicates so every advertisement of a device is reported, not just the first one
+    pBLEScan->setAdvertisedDeviceCallbacks(new VictronAdvertisedDeviceCallbacks(this), true);
+    pBLEScan->setDuplicateFilter(false);
+    // Victron devices broadcast BLE advertisements at their own rate (typically 1-2 seconds)
+    // and put their data in the primary advertisement. Active scanning only adds the scan
+    // response with the local name, so it is used just for name probes (see updateNameProbe).
+    nameCache.begin();
+    scanActive = !passiveScan;
+    pBLEScan->setActiveScan(scanActive);
     // Scan interval: 100ms (how often to switch channels)
     // Scan window: 99ms (how long to listen on each channel)
     // This means we're scanning almost continuously for maximum responsiveness
     pBLEScan->setInterval(100);
     pBLEScan->setWindow(99);
+    
+    // Whether the scan runs at all is decided per loop(): continuously while devices are
+    // being discovered, then only around each device's expected advertisement
+    scanScheduler.begin(esp_timer_get_time());
+}
+
+void VictronBLE::startScanning() {
+    if (!pBLEScan || pBLEScan->isScanning()) {
+        return;
+    }
+    
+    if (startRadio()) {
+        LOG_I(BLE, "BLE scan started (%s duty cycle)\n", scanScheduler.isAdaptive() ? "adaptive" : "continuous");
+    } else {
+        LOG_E(BLE, "ERROR: Failed to start BLE scan\n");
+    }
+}
+
+bool VictronBLE::startRadio() {
+    // Duration 0 = scan until stopped; passing a completion callback makes start() non-blocking
+    if (!pBLEScan->start(0, nullptr, false)) {
+        return false;
+    }
+    lastResultsFlush = millis();
+    scanScheduler.radioChanged(true, esp_timer_get_time());
+    return true;
+}
+
+void VictronBLE::stopScanning() {
+    if (pBLEScan && pBLEScan->isScanning()) {
+        pBLEScan->stop();
+    }
+}
+
+bool VictronBLE::isScanning() {
+    return pBLEScan && pBLEScan->isScanning();
+}
+
+void VictronBLE::holdScan(bool hold) {
+    // loop() decides on the scan under the ingest lock, so once this returns no tick can
+    // start the radio until the hold is released
+    std::lock_guard<std::mutex> ingest(ingestMutex);
+    scanHeld.store(hold);
+    if (hold && pBLEScan && pBLEScan->isScanning()) {
+        pBLEScan->stop();
+        pBLEScan->clearResults();
+        scanScheduler.radioChanged(false, esp_timer_get_time());
+    }
 }
 
-void VictronBLE::scan(int duration) {
-    Serial.println("Scanning for Victron and Eco Worthy devices...");
+void VictronBLE::onAdvertisement(NimBLEAdvertisedDevice* advertisedDevice) {
+    // NimBLE stores the address little-endian; keep it most significant byte first.
+    // getAddress() returns a copy, so keep it alive while reading its bytes.
+    uint8_t mac[6];
+    NimBLEAddress address = advertisedDevice->getAddress();
+    const uint8_t* native = address.getNative();
+    for (int i = 0; i < 6; i++) {
+        mac[i] = native[5 - i];
+    }
     
-    NimBLEScanResults foundDevices = pBLEScan->start(duration, false);
+    // Read the raw AD structures directly - the NimBLE getters return std::string copies.
+    // Most advertisements at busy sites are unrelated beacons and stop here.
+    RawAdvertisementFields fields;
+    AdvertisementFilter::parseAdStructures(advertisedDevice->getPayload(),
+                                           advertisedDevice->getPayloadLength(), fields);
+    if (!advertisementFilter.accept(mac, fields)) {
+        return;
+    }
     
-    for (int i = 0; i < foundDevices.getCount(); i++) {
-        NimBLEAdvertisedDevice device = foundDevices.getDevice(i);
-        String deviceName = device.getName().c_str();
-        
-        // Check for Eco Worthy devices (these don't use manufacturer data the same way)
-        if (deviceName.startsWith("ECO-WORTHY") || 
-            deviceName.startsWith("DCHOUSE") ||
-            deviceName.indexOf("ECO-WORTHY 02_") >= 0) {
-            // Create a placeholder entry for Eco Worthy device
-            // Actual data will be read via GATT connection separately
-            VictronDeviceData devData;
-            devData.name = deviceName;
-            devData.address = device.getAddress().toString().c_str();
-            devData.rssi = device.getRSSI();
-            devData.lastUpdate = millis();
-            devData.type = DEVICE_ECO_WORTHY_BMS;
-            devData.dataValid = false;  // Will be populated via GATT connection
-            
-            // Add or update in device list
-            devices[devData.address] = devData;
-            
-            Serial.printf("Eco Worthy Device: %s (%s) RSSI: %d\n", 
-                devData.name.c_str(), 
-                devData.address.c_str(), 
-                devData.rssi);
+    VictronAdvertisement adv;
+    memcpy(adv.mac, mac, sizeof(adv.mac));
+    adv.rssi = (int8_t)advertisedDevice->getRSSI();
+    adv.timestampUs = esp_timer_get_time();
+    
+    if (fields.name) {
+        size_t nameLength = fields.nameLength < sizeof(adv.name) - 1 ? fields.nameLength : sizeof(adv.name) - 1;
+        memcpy(adv.name, fields.name, nameLength);
+        adv.name[nameLength] = '\0';
+    }
+    
+    if (fields.manufacturerData) {
+        adv.dataLength = fields.manufacturerDataLength > sizeof(adv.data) ? sizeof(adv.data) : fields.manufacturerDataLength;
+        memcpy(adv.data, fields.manufacturerData, adv.dataLength);
+    }
+    
+    // Never block the BLE host task - if the main loop falls behind the advertisement is dropped
+    // and counted (the device will advertise again within a second or two)
+    if (advertisementRing.push(adv)) {
+        advertisementsReceived++;
+    }
+}
+
+void VictronBLE::loop() {
+    // Debug records exist only while the /debug page keeps polling
+    uint32_t watchedAt = debugWatchedAt.load(std::memory_order_relaxed);
+    if (watchedAt != 0 && millis() - watchedAt <= DEBUG_CAPTURE_TIMEOUT) {
+        debugCaptureActive = true;
+    } else if (debugCaptureActive) {
+        releaseDebugData();
+    }
+    
+    {
+        std::lock_guard<std::mutex> ingest(ingestMutex);
+        VictronAdvertisement adv;
+        while (advertisementRing.pop(adv)) {
+            if (capture) {
+                capture->record(adv);
+            }
+            processAdvertisement(adv);
+            advertisementsProcessed++;
+        }
+        applyQueuedReadings();
+    }
+    publishSnapshot();
+    
+    nameCache.saveIfDue(millis());
+    
+    std::lock_guard<std::mutex> ingest(ingestMutex);  // holdScan() may be stopping the scan
+    updateScan();
+}
+
+void VictronBLE::updateScan() {
+    if (!pBLEScan) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    bool scanning = pBLEScan->isScanning();
+    scanScheduler.radioChanged(scanning, now);  // A GATT connection may have stopped it
+    bool wanted = scanScheduler.update(now);
+    if (scanHeld.load()) {
+        return;
+    }
+    
+    // The scan mode can only change while the scan is stopped
+    updateNameProbe();
+    bool active = !passiveScan || nameProbing;
+    wanted = wanted || nameProbing;
+    if (active != scanActive) {
+        if (scanning) {
+            pBLEScan->stop();
+            pBLEScan->clearResults();
+            scanScheduler.radioChanged(false, now);
+            scanning = false;
+        }
+        pBLEScan->setActiveScan(active);
+        scanActive = active;
+    }
+    
+    // Stop between windows, and periodically to flush NimBLE's internal result list.
+    // Starting again also resumes scanning after a GATT connection (e.g. Eco Worthy).
+    if (scanning && (!wanted || millis() - lastResultsFlush > SCAN_RESULTS_FLUSH_INTERVAL)) {
+        pBLEScan->stop();
+        pBLEScan->clearResults();
+        scanScheduler.radioChanged(false, now);
+        scanning = false;
+    }
+    if (wanted && !scanning) {
+        pBLEScan->clearResults();
+        if (!startRadio()) {
+            LOG_D(BLE, "BLE scan start failed, retrying\n");
+        }
+    }
+}
+
+// A name probe is an active scan that runs while MACs without a known name are heard,
+// at most NAME_PROBE_MAX_DURATION and no more often than every NAME_PROBE_INTERVAL
+void VictronBLE::updateNameProbe() {
+    unsigned long now = millis();
+    if (nameProbing) {
+        bool settled = now - nameProbeStarted >= NAME_PROBE_SETTLE && now - nameWantedAt >= NAME_PROBE_SETTLE;
+        if (settled || now - nameProbeStarted >= NAME_PROBE_MAX_DURATION) {
+            nameProbing = false;
+            LOG_D(BLE, "Name probe %u ended, %u cached name(s)\n", nameProbes, (unsigned)nameCache.getCount());
+        }
+    } else if (nameProbeRequested && passiveScan &&
+               (nameProbes == 0 || now - nameProbeStarted >= NAME_PROBE_INTERVAL)) {
+        nameProbing = true;
+        nameProbeStarted = now;
+        nameProbes++;
+        LOG_D(BLE, "Name probe %u started\n", nameProbes);
+    }
+    nameProbeRequested = false;
+}
+
+void VictronBLE::nameWanted(uint64_t key) {
+    if (nameProbing) {
+        nameCache.heardUnnamed(key, (uint8_t)nameProbes, millis());
+    }
+    if (nameCache.needsProbe(key)) {
+        nameProbeRequested = true;
+        nameWantedAt = millis();
+    }
+}
+
+void VictronBLE::setPassiveScan(bool enabled) {
+    passiveScan = enabled;
+    LOG_I(BLE, "Passive scanning: %s\n", enabled ? "enabled" : "disabled");
+}
+
+void VictronBLE::setAdaptiveScan(bool enabled) {
+    scanScheduler.setAdaptive(enabled);
+    LOG_I(BLE, "Adaptive scan duty cycle: %s\n", enabled ? "enabled" : "disabled");
+}
+
+ScanSchedulerStats VictronBLE::getScanStats() const {
+    return scanScheduler.getStats(esp_timer_get_time());
+}
+
+void VictronBLE::markDirty(const VictronDeviceData& device) {
+    int slot = devices.indexOf(&device);
+    if (slot >= 0) {
+        dirtySlots[slot / 32] |= 1u << (slot % 32);
+        snapshotPending = true;
+    }
+}
+
+void VictronBLE::publishSnapshot() {
+    if (!snapshotPending) {
+        return;
+    }
+    
+    // Skip a turn rather than wait for a reader, unless the snapshot is getting stale
+    std::unique_lock<std::mutex> lock(snapshotMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        if (millis() - lastSnapshot < SNAPSHOT_MAX_DEFER_MS) {
+            return;
+        }
+        lock.lock();
+    }
+    
+    // New devices are always dirty and published in slot order, so every key lands in
+    // the same slot of the snapshot as in the device table
+    for (uint16_t slot = 0; slot < devices.size(); slot++) {
+        uint32_t bit = 1u << (slot % 32);
+        if (!(dirtySlots[slot / 32] & bit)) {
             continue;
         }
+        dirtySlots[slot / 32] &= ~bit;
+        if (slot >= snapshot.size()) {
+            snapshot.insert(devices.keyAt(slot));
+        }
+        snapshot.at(slot) = devices.at(slot);
         
-        // Handle Victron devices (original logic)
-        if (device.haveManufacturerData()) {
-            std::string mfgData = device.getManufacturerData();
+        // One event per slot per batch, whatever number of frames it merged
+        if (pendingChanges[slot]) {
+            changeBus.publish(slot, pendingChanges[slot]);
+            pendingChanges[slot] = 0;
+        }
+    }
+    snapshotPending = false;
+    lastSnapshot = millis();
+}
+
+int VictronBLE::subscribeChanges(const char* name, VictronChangeMask fields) {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    int subscriber = changeBus.subscribe(name, fields);
+    if (subscriber < 0) {
+        LOG_E(BLE, "ERROR: No change subscriber left for %s - raise CHANGE_BUS_MAX_SUBSCRIBERS\n", name);
+    }
+    return subscriber;
+}
+
+void VictronBLE::unsubscribeChanges(int subscriber) {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    changeBus.unsubscribe(subscriber);
+}
+
+void VictronBLE::setChangeDeadband(VictronChangeField field, float deadband) {
+    if (field < CHANGE_FIELD_COUNT) {
+        changeDeadbands[field] = deadband > 0.0f ? deadband : 0.0f;
+    }
+}
+
+bool VictronBLE::queueReading(const String& address, const VictronReading& reading, unsigned long lastUpdate) {
+    uint8_t mac[6];
+    if (!AdvertisementFilter::parseAddress(address, mac)) {
+        return false;
+    }
+    
+    QueuedReading queued;
+    queued.key = AdvertisementFilter::addressKey(mac);
+    queued.reading = reading;
+    queued.lastUpdate = lastUpdate;
+    return readingQueue.push(queued);
+}
+
+void VictronBLE::applyQueuedReadings() {
+    QueuedReading queued;
+    while (readingQueue.pop(queued)) {
+        VictronDeviceData* device = devices.find(queued.key);
+        int slot = device ? devices.indexOf(device) : -1;
+        if (slot < 0) {
+            continue;
+        }
+        pendingChanges[slot] |= mergeDeviceData(queued.reading, *device);
+        device->lastUpdate = queued.lastUpdate;
+        markDirty(*device);
+    }
+}
+
+IngestStats VictronBLE::getIngestStats() const {
+    IngestStats stats;
+    stats.capacity = advertisementRing.capacity();
+    stats.occupancy = advertisementRing.occupancy();
+    stats.highWater = advertisementRing.highWaterMark();
+    stats.drops = advertisementRing.dropCount();
+    stats.filtered = advertisementFilter.getRejectedCount();
+    stats.received = advertisementsReceived;
+    stats.processed = advertisementsProcessed;
+    stats.cacheLookups = frameCacheLookups;
+    stats.cacheHits = frameCacheHits;
+    return stats;
+}
+
+void VictronBLE::setCapture(AdvertisementCapture* recorder) {
+    capture = recorder;
+}
+
+void VictronBLE::replayAdvertisement(const VictronAdvertisement& adv) {
+    std::lock_guard<std::mutex> ingest(ingestMutex);
+    processAdvertisement(adv);
+    advertisementsProcessed++;
+}
+
+void VictronBLE::setAllowedAddresses(const std::vector<String>& addresses) {
+    advertisementFilter.setAllowedAddresses(addresses);
+    LOG_I(BLE, "BLE allowlist: %d configured device(s)\n", advertisementFilter.getAllowedCount());
+}
+
+void VictronBLE::watchDebugData() {
+    uint32_t now = millis();
+    debugWatchedAt.store(now != 0 ? now : 1, std::memory_order_relaxed);
+}
+
+const VictronDebugData* VictronBLE::getDebugData(const VictronDeviceData& device) const {
+    // Takes a snapshot entry (or a device table entry); both tables share slot numbers
+    int slot = snapshot.indexOf(&device);
+    if (slot < 0) {
+        slot = devices.indexOf(&device);
+    }
+    return slot >= 0 ? debugRecords[slot] : nullptr;
+}
+
+VictronDebugData* VictronBLE::captureDebugData(const VictronDeviceData& device) {
+    int slot = devices.indexOf(&device);
+    if (slot < 0) {
+        return nullptr;
+    }
+    if (!debugRecords[slot]) {
+        debugRecords[slot] = new VictronDebugData();
+    }
+    return debugRecords[slot];
+}
+
+void VictronBLE::releaseDebugData() {
+    int released = 0;
+    for (int i = 0; i < VICTRON_MAX_DEVICES; i++) {
+        if (debugRecords[i]) {
+            delete debugRecords[i];
+            debugRecords[i] = nullptr;
+            released++;
+        }
+    }
+    debugCaptureActive = false;
+    debugWatchedAt.store(0, std::memory_order_relaxed);
+    LOG_I(BLE, "Debug capture stopped, released %d debug record(s)\n", released);
+}
+
+void VictronBLE::processAdvertisement(const VictronAdvertisement& adv) {
+    // Everything below works in place on the device entry; the only allocations are
+    // for a device's first advertisement, when its name changes and for debug records
+    uint64_t key = AdvertisementFilter::addressKey(adv.mac);
+    bool isVictron = adv.dataLength >= 2 &&
+                     (uint16_t)(adv.data[1] << 8 | adv.data[0]) == VICTRON_MANUFACTURER_ID;
+    
+    // Passive scans get no scan response, so the name usually comes from the cache.
+    // Unnamed MACs that passed the filter (Eco Worthy service UUID, allowlist) may be
+    // Eco Worthy adapters and are probed too.
+    const char* name = adv.name;
+    if (name[0] == '\0') {
+        const char* cached = nameCache.lookup(key);
+        if (cached) {
+            name = cached;
+        } else {
+            nameWanted(key);
+        }
+    }
+    bool isEcoWorthy = AdvertisementFilter::isEcoWorthyName(name, strlen(name));
+    if (adv.name[0] != '\0' && (isVictron || isEcoWorthy)) {
+        nameCache.remember(key, adv.name, millis());
+    }
+    if (!isEcoWorthy && !isVictron) {
+        return;
+    }
+    
+    bool isNew = false;
+    VictronDeviceData* device = devices.insert(key, &isNew);
+    if (!device) {
+        // Log once per overflow burst, not for every advertisement
+        if (devices.overflowCount() == 1 || devices.overflowCount() % 1000 == 0) {
+            LOG_W(BLE, "WARNING: Device table full (%d devices), ignoring %02x:%02x:%02x:%02x:%02x:%02x - raise VICTRON_MAX_DEVICES\n",
+                       VICTRON_MAX_DEVICES, adv.mac[0], adv.mac[1], adv.mac[2], adv.mac[3], adv.mac[4], adv.mac[5]);
+        }
+        return;
+    }
+    int slot = devices.indexOf(device);
+    if (isNew) {
+        device->address = formatAddress(adv.mac);
+        pendingChanges[slot] = CHANGE_ALL;
+    }
+    markDirty(*device);  // RSSI and lastUpdate change even when the frame is a repeat
+    DeviceMetrics& deviceMetrics = metrics[slot];
+    metricsPacket(deviceMetrics, adv.rssi, adv.timestampUs);
+    
+    // Names are sometimes missing from advertisements - keep the last one seen
+    bool nameChanged = name[0] != '\0' && device->name != name;
+    if (nameChanged) {
+        device->name = name;
+        pendingChanges[slot] |= CHANGE_BIT(CHANGE_DEVICE_INFO);
+    }
+    
+    // Check for Eco Worthy devices (these don't use manufacturer data the same way)
+    if (isEcoWorthy) {
+        // Actual data will be read via GATT connection separately; keep it and only
+        // refresh the advertisement fields
+        device->rssi = adv.rssi;
+        if (device->type != DEVICE_ECO_WORTHY_BMS) {
+            device->type = DEVICE_ECO_WORTHY_BMS;
+            device->lastUpdate = millis();
+            device->dataValid = false;  // Will be populated via GATT connection
+            pendingChanges[slot] |= CHANGE_BIT(CHANGE_DEVICE_INFO) | CHANGE_BIT(CHANGE_DATA_VALID);
             
-            if (mfgData.length() >= 2) {
-                uint16_t mfgId = (uint8_t)mfgData[1] << 8 | (uint8_t)mfgData[0];
-                
-                if (mfgId == VICTRON_MANUFACTURER_ID) {
-                    VictronDeviceData devData;
-                    devData.name = device.getName().c_str();
-                    devData.address = device.getAddress().toString().c_str();
-                    devData.rssi = device.getRSSI();
-                    devData.lastUpdate = millis();
-                    
-                    // Store raw manufacturer data for debug purposes
-                    devData.manufacturerId = mfgId;
-                    devData.rawDataLength = mfgData.length() > sizeof(devData.rawManufacturerData) 
-                                           ? sizeof(devData.rawManufacturerData) 
-                                           : mfgData.length();
-                    memcpy(devData.rawManufacturerData, mfgData.data(), devData.rawDataLength);
-                    
-                    // Extract model ID if available (bytes 2-3, little-endian)
-                    if (mfgData.length() >= 4) {
-                        devData.modelId = (uint8_t)mfgData[2] | ((uint8_t)mfgData[3] << 8);
-                    }
-                    
-                    // Identify device type - first by name, then by model ID if unknown
-                    devData.type = identifyDeviceType(devData.name, devData.modelId);
-                    
-                    // Check if encrypted (byte 4 indicates readout type/encryption)
-                    if (mfgData.length() >= 5) {
-                        devData.encrypted = (mfgData[4] != 0x00);
-                    }
-                    
-                    // Parse manufacturer data with encryption key if available
-                    if (mfgData.length() > 2) {
-                        String encKey = getEncryptionKey(devData.address);
-                        parseVictronAdvertisement((const uint8_t*)mfgData.data(), mfgData.length(), devData, encKey);
-                    }
-                    
-                    // Check if device already exists
-                    auto it = devices.find(devData.address);
-                    if (it != devices.end() && retainLastData) {
-                        // Device exists and retain mode is enabled - merge data
-                        mergeDeviceData(devData, it->second);
-                    } else {
-                        // New device or retain mode disabled - replace completely
-                        devices[devData.address] = devData;
-                    }
-                    
-                    Serial.printf("Device: %s (%s) RSSI: %d\n", 
-                        devData.name.c_str(), 
-                        devData.address.c_str(), 
-                        devData.rssi);
-                }
-            }
+            LOG_I(BLE, "Eco Worthy Device: %s (%s) RSSI: %d\n", 
+                device->name.c_str(), 
+                device->address.c_str(), 
+                device->rssi);
         }
+        return;
     }
     
-    pBLEScan->clearResults();
-    Serial.printf("Found %d device(s) total\n", devices.size());
+    // Handle Victron devices
+    const uint8_t* mfgData = adv.data;
+    size_t mfgLength = adv.dataLength;
+    
+    // Nonce cache: a frame with the same counter and payload as the last one parsed for
+    // this device carries no new data - only refresh the advertisement fields
+    uint16_t frameCounter = mfgLength >= VICTRON_NONCE_OFFSET + 2
+                            ? (uint16_t)(mfgData[VICTRON_NONCE_OFFSET + 1] << 8 | mfgData[VICTRON_NONCE_OFFSET]) : 0;
+    uint32_t frameHash = hashFrame(mfgData, mfgLength);
+    device->rssi = adv.rssi;
+    device->lastUpdate = (unsigned long)(adv.timestampUs / 1000);
+    
+    // Arrival time for the scan duty cycle: configured devices, or every Victron device
+    // while none are configured
+    scanScheduler.observe((uint16_t)slot, adv.timestampUs,
+                          advertisementFilter.getAllowedCount() == 0 || advertisementFilter.isAllowed(key));
+    
+    VictronDebugData* debug = debugCaptureActive ? captureDebugData(*device) : nullptr;
+    if (!isNew) {
+        frameCacheLookups++;
+        // A freshly allocated debug record is filled from the next frame, cached or not
+        if (device->frameCached &&
+            device->frameCounter == frameCounter &&
+            device->frameHash == frameHash &&
+            device->frameKeyGeneration == keyGeneration &&
+            !nameChanged &&
+            !(debug && debug->rawDataLength == 0)) {
+            frameCacheHits++;
+            return;
+        }
+    }
+    metricsFrame(deviceMetrics, device->frameCached, device->frameCounter, frameCounter);
+    device->frameCounter = frameCounter;
+    device->frameHash = frameHash;
+    device->frameKeyGeneration = keyGeneration;
+    device->frameCached = true;
+    
+    // Store raw manufacturer data for debug purposes
+    if (debug) {
+        debug->manufacturerId = VICTRON_MANUFACTURER_ID;
+        debug->rawDataLength = mfgLength > sizeof(debug->rawManufacturerData) 
+                               ? sizeof(debug->rawManufacturerData) 
+                               : mfgLength;
+        memcpy(debug->rawManufacturerData, mfgData, debug->rawDataLength);
+    }
+    
+    // Model ID (bytes 4-5, little-endian) and readout type (byte 6)
+    uint16_t modelId = mfgLength >= VICTRON_MODEL_ID_OFFSET + 2
+                       ? (mfgData[VICTRON_MODEL_ID_OFFSET] | (mfgData[VICTRON_MODEL_ID_OFFSET + 1] << 8)) : 0;
+    uint8_t readoutType = mfgLength > VICTRON_READOUT_TYPE_OFFSET ? mfgData[VICTRON_READOUT_TYPE_OFFSET] : 0;
+    
+    // The classification is cached in the device entry and only redone when one of
+    // its inputs changes; an unknown result keeps the previous type.
+    if (nameChanged || modelId != device->modelId || readoutType != device->readoutType) {
+        device->modelId = modelId;
+        device->readoutType = readoutType;
+        VictronDeviceType type = classifyDevice(readoutType, modelId, device->name);
+        if (type != DEVICE_UNKNOWN && type != device->type) {
+            device->type = type;
+            pendingChanges[slot] |= CHANGE_BIT(CHANGE_DEVICE_INFO);
+        }
+    }
+    
+    // Every Victron record with a full header carries an encrypted payload
+    device->encrypted = mfgLength >= VICTRON_PAYLOAD_OFFSET;
+    
+    // Decode into a stack reading, then apply it to the device
+    VictronReading reading;
+    parseMetrics = &deviceMetrics;
+    uint32_t parseStart = ESP.getCycleCount();
+    parseVictronAdvertisement(mfgData, mfgLength, *device, findEncryptionKey(adv.mac), reading, debug);
+    metricsParse(deviceMetrics, ESP.getCycleCount() - parseStart);
+    parseMetrics = nullptr;
+    pendingChanges[slot] |= mergeDeviceData(reading, *device);
+    
+    // Error text follows the telemetry: with retainLastData the last error is kept
+    // until a valid frame arrives. Only touch the String when the text changes.
+    if (debug) {
+        const char* errorMessage = reading.dataValid ? "" : parseError;
+        if ((errorMessage[0] != '\0' || reading.dataValid || !retainLastData) &&
+            debug->errorMessage != errorMessage) {
+            debug->errorMessage = errorMessage;
+        }
+    }
+    
+    LOG_D(BLE, "Device: %s (%s) RSSI: %d\n", 
+        device->name.c_str(), 
+        device->address.c_str(), 
+        device->rssi);
 }
 
 VictronDeviceType VictronBLE::identifyDeviceType(const String& name, uint16_t modelId) {
@@ -187,143 +823,156 @@ VictronDeviceType VictronBLE::identifyDeviceType(const String& name, uint16_t mo
     }
     
     // If name-based detection failed, try model ID-based detection
-    if (modelId != 0) {
-        // SmartShunt and BMV model IDs (0xA380-0xA38F range)
-        if ((modelId >= 0xA380 && modelId <= 0xA38F) || 
-            (modelId >= 0x0203 && modelId <= 0x0205)) {
-            return DEVICE_SMART_SHUNT;
-        }
-        // Solar MPPT model IDs (0xA050-0xA06F range)
-        else if (modelId >= 0xA050 && modelId <= 0xA06F) {
-            return DEVICE_SMART_SOLAR;
-        }
-        // Phoenix Inverter model IDs (0xA200-0xA2FF range)
-        else if (modelId >= 0xA200 && modelId <= 0xA2FF) {
-            return DEVICE_INVERTER;
-        }
-        // Phoenix Smart IP43 Charger model IDs (0xA340-0xA34F range)
-        // Also includes model ID 0x0010 which appears to be a Blue Smart Charger variant
-        else if ((modelId >= 0xA340 && modelId <= 0xA34F) || modelId == 0x0010) {
-            return DEVICE_BLUE_SMART_CHARGER;
-        }
-        // Orion/DC-DC model IDs (0xA3F0-0xA3FF range)
-        else if (modelId >= 0xA3F0 && modelId <= 0xA3FF) {
-            return DEVICE_DCDC_CONVERTER;
+    return modelDeviceType(modelId);
+}
+
+VictronDeviceType VictronBLE::readoutDeviceType(uint8_t readoutType) {
+    return readoutType < sizeof(READOUT_DEVICE_TYPES) / sizeof(READOUT_DEVICE_TYPES[0])
+           ? READOUT_DEVICE_TYPES[readoutType] : DEVICE_UNKNOWN;
+}
+
+VictronDeviceType VictronBLE::modelDeviceType(uint16_t modelId) {
+    // Last range starting at or below modelId
+    size_t low = 0;
+    size_t high = sizeof(MODEL_RANGES) / sizeof(MODEL_RANGES[0]);
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (MODEL_RANGES[mid].first <= modelId) {
+            low = mid + 1;
+        } else {
+            high = mid;
         }
     }
-    
+    if (low > 0 && modelId <= MODEL_RANGES[low - 1].last) {
+        return MODEL_RANGES[low - 1].type;
+    }
     return DEVICE_UNKNOWN;
 }
 
-bool VictronBLE::parseVictronAdvertisement(const uint8_t* data, size_t length, VictronDeviceData& device, const String& encryptionKey) {
+VictronDeviceType VictronBLE::classifyDevice(uint8_t readoutType, uint16_t modelId, const String& name) {
+    VictronDeviceType type = readoutDeviceType(readoutType);
+    VictronDeviceType modelType = modelDeviceType(modelId);
+    
+    // Solar controllers and Blue Smart Chargers share a readout type; the model tells them apart
+    if (type == DEVICE_SMART_SOLAR && modelType == DEVICE_BLUE_SMART_CHARGER) {
+        return modelType;
+    }
+    if (type != DEVICE_UNKNOWN) {
+        return type;
+    }
+    if (modelType != DEVICE_UNKNOWN) {
+        return modelType;
+    }
+    
+    // Older firmware or unknown readout types: fall back to the advertised name
+    return identifyDeviceType(name);
+}
+
+
+bool VictronBLE::parseVictronAdvertisement(const uint8_t* data, size_t length, VictronDeviceData& device,
+                                           const VictronDeviceKey* encryptionKey, VictronReading& reading,
+                                           VictronDebugData* debug) {
     // Victron BLE advertisement format (based on reference implementation):
     // [0-1]: Manufacturer ID (0x02E1) - little-endian
-    // [2-3]: Model ID - little-endian
-    // [4]: Readout type / Encryption indicator (0x00 for instant readout, non-zero for encrypted)
-    // For encrypted packets:
-    //   [5-6]: Additional flags/padding
-    //   [7-8]: IV/Counter (nonce) - little-endian (LSB, MSB)
-    //   [9]: Encryption key match byte (should match first byte of key)
-    //   [10+]: Encrypted data records
-    // For unencrypted packets:
-    //   [5+]: Data records (unencrypted)
-    
-    if (length < 5) return false;
+    // [2-3]: Record prefix
+    // [4-5]: Model ID - little-endian
+    // [6]: Readout type - selects the payload layout (VictronReadoutType)
+    // [7-8]: IV/Counter (nonce) - little-endian (LSB, MSB)
+    // [9]: Encryption key match byte (should match first byte of key)
+    // [10+]: Payload, always encrypted ("Instant Readout" only publishes the key)
+    //
+    // Decoded values go into reading; the caller applies it with mergeDeviceData().
+    // Errors are left in parseError. Nothing here allocates: decryption uses a stack
+    // buffer, and TLV records are only kept when a debug record is passed in.
     
-    // Clear previous parsed records
-    device.parsedRecords.clear();
+    parseError[0] = '\0';
     
-    // Check if data is encrypted (byte 4 != 0x00)
-    bool isEncrypted = (data[4] != 0x00);
+    // Clear previous parsed records
+    if (debug) {
+        debug->parsedRecords.clear();
+    }
     
-    // For encrypted data, we need at least 10 bytes (manufacturer ID, model ID, readout type, 
-    // flags/padding, IV, and key check byte)
-    if (isEncrypted && length < 10) {
-        Serial.printf("ERROR: Encrypted packet too short: %d bytes (need at least 10)\n", length);
+    if (length < VICTRON_PAYLOAD_OFFSET) {
+        LOG_E(BLE, "ERROR: Advertisement too short: %u bytes (need at least %d)\n", (unsigned)length,
+              VICTRON_PAYLOAD_OFFSET);
         return false;
     }
     
-    const uint8_t* dataToProcess = data;
-    uint8_t* decryptedBuffer = nullptr;
+    if (length > MAX_ADVERTISEMENT_DATA) {
+        LOG_E(BLE, "ERROR: Advertisement too long: %u bytes (max %d)\n", (unsigned)length, MAX_ADVERTISEMENT_DATA);
+        return false;
+    }
     
-    if (isEncrypted) {
-        if (encryptionKey.isEmpty()) {
-            device.errorMessage = "Device is encrypted. Add encryption key in web configuration, or enable 'Instant Readout' in VictronConnect app.";
-            Serial.printf("Device %s is encrypted but no key provided\n", device.address.c_str());
-            return false;
+    if (!encryptionKey || encryptionKey->hex.isEmpty()) {
+        if (parseMetrics) {
+            parseMetrics->noKey++;
         }
-        
-        // Allocate buffer for decrypted data
-        decryptedBuffer = new uint8_t[length];
-        if (!decryptData(data, length, decryptedBuffer, encryptionKey)) {
-            device.errorMessage = "Decryption failed. Please verify the encryption key is correct.";
-            delete[] decryptedBuffer;
-            Serial.printf("Failed to decrypt data for %s\n", device.address.c_str());
-            return false;
+        strlcpy(parseError, "Device is encrypted. Add encryption key in web configuration, or enable 'Instant Readout' in VictronConnect app.", sizeof(parseError));
+        LOG_W(BLE, "Device %s is encrypted but no key provided\n", device.address.c_str());
+        return false;
+    }
+    
+    uint8_t decryptedBuffer[MAX_ADVERTISEMENT_DATA];
+    if (!decryptData(data, length, decryptedBuffer, *encryptionKey)) {
+        if (parseMetrics) {
+            parseMetrics->decryptFailures++;
         }
-        
-        dataToProcess = decryptedBuffer;
-        Serial.printf("Successfully decrypted data for %s\n", device.address.c_str());
+        strlcpy(parseError, "Decryption failed. Please verify the encryption key is correct.", sizeof(parseError));
+        LOG_W(BLE, "Failed to decrypt data for %s\n", device.address.c_str());
+        return false;
     }
+    const uint8_t* dataToProcess = decryptedBuffer;
+    LOG_D(BLE, "Successfully decrypted data for %s\n", device.address.c_str());
     
-    device.dataValid = true;
-    device.errorMessage = "";  // Clear any previous error message
+    reading.dataValid = true;
     
-    // Determine where the payload data starts
-    // For encrypted data: payload starts at byte 10 (after header + IV + key check byte)
-    // For unencrypted data: payload starts at byte 5 (after manufacturer ID, model ID, and readout type)
-    size_t payloadStart = isEncrypted ? 10 : 5;
+    // The payload starts after the header, nonce and key check byte
+    size_t payloadStart = VICTRON_PAYLOAD_OFFSET;
     
-    // The decrypted/unencrypted payload contains a fixed structure
+    // The decrypted payload contains a fixed structure
     // The structure varies by device type (SmartShunt vs Solar Controller vs DC-DC, etc.)
     // According to the reference implementation, we need to parse this as a fixed structure,
     // NOT as TLV records
     // Note: SmartShunt uses 15 bytes, while Solar Controller and DC-DC use 16 bytes
     
-    // Determine expected payload size based on device type for informational purposes
-    size_t expectedPayloadBytes;
-    if (device.type == DEVICE_SMART_SHUNT) {
-        expectedPayloadBytes = SMART_SHUNT_PAYLOAD_SIZE;
-    } else if (device.type == DEVICE_SMART_SOLAR || device.type == DEVICE_BLUE_SMART_CHARGER) {
-        // Both Solar Controllers and Blue Smart Chargers use 16-byte payloads
-        expectedPayloadBytes = SOLAR_CONTROLLER_PAYLOAD_SIZE;
-    } else if (device.type == DEVICE_DCDC_CONVERTER) {
-        expectedPayloadBytes = DCDC_CONVERTER_PAYLOAD_SIZE;
-    } else {
-        // Unknown device types will use TLV parsing, no expected size
-        expectedPayloadBytes = 0;
+    // Select the decoder by device type with a single table lookup
+    size_t typeIndex = (size_t)device.type;
+    if (typeIndex >= sizeof(PAYLOAD_DECODERS) / sizeof(PAYLOAD_DECODERS[0])) {
+        typeIndex = DEVICE_UNKNOWN;
     }
+    const VictronPayloadDecoder& decoder = PAYLOAD_DECODERS[typeIndex];
     
     // Log a warning if we have less data than expected, but continue parsing
     // We'll parse whatever fields are available based on the actual data length
+    size_t expectedPayloadBytes = decoder.payloadBytes;
     if (expectedPayloadBytes > 0 && length < payloadStart + expectedPayloadBytes) {
-        Serial.printf("WARNING: Partial data received (%d bytes, expected %d) - parsing available fields\n", 
-                     length, payloadStart + expectedPayloadBytes);
+        if (parseMetrics) {
+            parseMetrics->partialPayloads++;
+        }
+        LOG_W(BLE, "WARNING: Partial data received (%u bytes, expected %u) - parsing available fields\n", 
+                  (unsigned)length, (unsigned)(payloadStart + expectedPayloadBytes));
     }
     
     // Point to the fixed structure payload (size varies by device type)
     const uint8_t* output = &dataToProcess[payloadStart];
     size_t outputLen = length - payloadStart;
     
-    // Parse based on device type
-    if (device.type == DEVICE_SMART_SHUNT) {
-        parseSmartShuntData(output, outputLen, device);
-    } else if (device.type == DEVICE_SMART_SOLAR || device.type == DEVICE_BLUE_SMART_CHARGER) {
-        // Both Solar Controllers and Blue Smart Chargers use the same 16-byte payload format
-        parseSolarControllerData(output, outputLen, device);
-    } else if (device.type == DEVICE_DCDC_CONVERTER) {
-        parseDCDCConverterData(output, outputLen, device);
+    if (decoder.fields) {
+        bool decoded = decodeFields(decoder.fields, decoder.fieldCount, output, outputLen, reading);
+#if LOG_LEVEL_BLE >= LOG_LEVEL_DEBUG
+        if (decoded) {
+            decoder.log(decoder.name, reading);
+        }
+#else
+        (void)decoded;
+#endif
     } else {
         // For unknown device types, try to parse as TLV records
         // This provides backwards compatibility for devices we haven't specifically implemented
-        parseTLVRecords(dataToProcess, length, payloadStart, device);
+        parseTLVRecords(dataToProcess, length, payloadStart, reading, debug ? &debug->parsedRecords : nullptr);
     }
     
-    if (decryptedBuffer) {
-        delete[] decryptedBuffer;
-    }
-    
-    return true;
+    return reading.dataValid;
 }
 
 float VictronBLE::decodeValue(const uint8_t* data, int len, float scale) {
@@ -346,61 +995,28 @@ float VictronBLE::decodeValue(const uint8_t* data, int len, float scale) {
     return value * scale;
 }
 
-std::map<String, VictronDeviceData>& VictronBLE::getDevices() {
-    return devices;
+VictronDeviceTable& VictronBLE::getDevices() {
+    return snapshot;
 }
 
 VictronDeviceData* VictronBLE::getDevice(const String& address) {
-    if (devices.find(address) != devices.end()) {
-        return &devices[address];
+    uint8_t mac[6];
+    if (!AdvertisementFilter::parseAddress(address, mac)) {
+        return nullptr;
     }
-    return nullptr;
+    return getDevice(mac);
 }
 
-bool VictronBLE::hasDevices() {
-    return !devices.empty();
+VictronDeviceData* VictronBLE::getDevice(const uint8_t* mac) {
+    return snapshot.find(AdvertisementFilter::addressKey(mac));
 }
 
-int VictronBLE::getDeviceCount() {
-    return devices.size();
-}
-
-String VictronBLE::normalizeAddress(const String& address) {
-    // Normalize MAC address for consistent comparison
-    // Removes colons and converts to lowercase
-    // Example: "E5:78:04:B9:4D:55" -> "e57804b94d55"
-    String normalized = "";
-    normalized.reserve(12);  // Pre-allocate for MAC address without colons (12 hex chars)
-    for (size_t i = 0; i < address.length(); i++) {
-        char c = address[i];
-        if (c != ':') {
-            normalized += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
-        }
-    }
-    return normalized;
-}
-
-void VictronBLE::setEncryptionKey(const String& address, const String& key) {
-    // Note: Encryption keys are stored using normalized addresses (no colons, lowercase)
-    // while devices in the devices map use BLE format addresses (with colons).
-    // This allows users to enter addresses in any format when configuring encryption keys.
-    String normalizedAddr = normalizeAddress(address);
-    encryptionKeys[normalizedAddr] = key;
-    Serial.printf("Set encryption key for device %s (normalized: %s)\n", address.c_str(), normalizedAddr.c_str());
-}
-
-String VictronBLE::getEncryptionKey(const String& address) {
-    // Normalize the BLE address before looking up the encryption key
-    // This ensures the lookup works regardless of the address format used
-    String normalizedAddr = normalizeAddress(address);
-    if (encryptionKeys.find(normalizedAddr) != encryptionKeys.end()) {
-        return encryptionKeys[normalizedAddr];
-    }
-    return "";
+bool VictronBLE::hasDevices() {
+    return !snapshot.empty();
 }
 
-void VictronBLE::clearEncryptionKeys() {
-    encryptionKeys.clear();
+int VictronBLE::getDeviceCount() {
+    return snapshot.size();
 }
 
 // Helper function to convert a hex character to its numeric value
@@ -416,94 +1032,111 @@ static int hexCharToValue(char c) {
     return -1;
 }
 
-bool VictronBLE::decryptData(const uint8_t* encryptedData, size_t length, uint8_t* decryptedData, const String& key) {
-    // Victron uses AES-128-CTR encryption for BLE data
-    // Packet structure (based on reference implementation):
-    // [0-1]: Manufacturer ID (0x02E1) - little-endian
-    // [2-3]: Model ID - little-endian
-    // [4]: Readout type / Encryption indicator
-    // [5-6]: Additional flags/padding
-    // [7-8]: IV/Counter (nonce) - little-endian (LSB, MSB)
-    // [9]: Encryption Key Match byte (should match first byte of key)
-    // [10+]: Encrypted payload
-    
-    if (key.isEmpty() || length < 10) {
-        Serial.printf("ERROR: Invalid encryption key or data length (minimum 10 bytes required, got %d)\n", length);
-        return false;
+void VictronBLE::setEncryptionKey(const String& address, const String& key) {
+    // Keys are stored by binary MAC, so the configured address may use any format
+    // ("E5:78:04:B9:4D:55", "e57804b94d55", ...) and lookups need no String work
+    uint8_t mac[6];
+    if (!AdvertisementFilter::parseAddress(address, mac)) {
+        LOG_E(BLE, "ERROR: Invalid MAC address for encryption key: %s\n", address.c_str());
+        return;
     }
     
+    std::lock_guard<std::mutex> ingest(ingestMutex);  // loop() reads the key map
+    VictronDeviceKey& entry = encryptionKeys[AdvertisementFilter::addressKey(mac)];
+    entry.hex = key;
+    entry.valid = false;
+    keyGeneration++;  // Frames cached with the old key must be parsed again
+    
     // Validate key format (should be 32 hex characters = 16 bytes)
     if (key.length() != 32) {
-        Serial.printf("ERROR: Encryption key must be 32 hex characters, got %d\n", key.length());
-        return false;
+        LOG_E(BLE, "ERROR: Encryption key for %s must be 32 hex characters, got %d\n", address.c_str(), key.length());
+        return;
     }
     
     // Convert hex string key to 16-byte array with validation
-    // Using direct character access for efficiency (no String allocations)
-    uint8_t keyBytes[16];
     for (int i = 0; i < 16; i++) {
-        char highNibble = key.charAt(i * 2);
-        char lowNibble = key.charAt(i * 2 + 1);
-        
-        // Validate and convert high nibble
-        int highVal = hexCharToValue(highNibble);
-        if (highVal < 0) {
-            Serial.printf("ERROR: Invalid hex character '%c' in encryption key at position %d\n", highNibble, i * 2);
-            return false;
-        }
-        
-        // Validate and convert low nibble
-        int lowVal = hexCharToValue(lowNibble);
-        if (lowVal < 0) {
-            Serial.printf("ERROR: Invalid hex character '%c' in encryption key at position %d\n", lowNibble, i * 2 + 1);
-            return false;
+        int highVal = hexCharToValue(key.charAt(i * 2));
+        int lowVal = hexCharToValue(key.charAt(i * 2 + 1));
+        if (highVal < 0 || lowVal < 0) {
+            LOG_E(BLE, "ERROR: Invalid hex character in encryption key for %s at position %d\n",
+                       address.c_str(), highVal < 0 ? i * 2 : i * 2 + 1);
+            return;
         }
-        
-        // Combine nibbles into byte
-        keyBytes[i] = (highVal << 4) | lowVal;
+        entry.bytes[i] = (highVal << 4) | lowVal;
+    }
+    
+    // Expand the key schedule once; decryptData() reuses it for every packet
+    if (!AesCtr::setKey(entry.aes, entry.bytes)) {
+        LOG_E(BLE, "ERROR: Failed to set AES key for %s\n", address.c_str());
+        return;
+    }
+    
+    entry.valid = true;
+    LOG_I(BLE, "Set encryption key for device %s\n", address.c_str());
+}
+
+String VictronBLE::getEncryptionKey(const String& address) {
+    uint8_t mac[6];
+    if (!AdvertisementFilter::parseAddress(address, mac)) {
+        return "";
+    }
+    const VictronDeviceKey* key = findEncryptionKey(mac);
+    return key ? key->hex : String("");
+}
+
+const VictronDeviceKey* VictronBLE::findEncryptionKey(const uint8_t* mac) const {
+    auto it = encryptionKeys.find(AdvertisementFilter::addressKey(mac));
+    return it != encryptionKeys.end() ? &it->second : nullptr;
+}
+
+void VictronBLE::clearEncryptionKeys() {
+    std::lock_guard<std::mutex> ingest(ingestMutex);
+    for (auto& pair : encryptionKeys) {
+        AesCtr::freeKey(pair.second.aes);
+    }
+    encryptionKeys.clear();
+    keyGeneration++;
+}
+
+
+bool VictronBLE::decryptData(const uint8_t* encryptedData, size_t length, uint8_t* decryptedData, const VictronDeviceKey& key) {
+    // Victron uses AES-128-CTR encryption for BLE data
+    // Packet structure as in parseVictronAdvertisement(): the nonce is at bytes 7-8, the
+    // key match byte at 9 and the encrypted payload from byte 10
+    
+    if (!key.valid || length < VICTRON_PAYLOAD_OFFSET) {
+        LOG_E(BLE, "ERROR: Invalid encryption key or data length (minimum 10 bytes required, got %u)\n", (unsigned)length);
+        return false;
     }
     
-    // Verify the encryption key match byte (byte 9 should match keyBytes[0])
+    // Verify the encryption key match byte (byte 9 should match the first key byte)
     // This is a validation check - if it doesn't match, the key might be wrong
     // However, we'll proceed with decryption anyway as requested, since sometimes
     // the validation can reject valid keys (e.g., when data format varies)
-    if (encryptedData[9] != keyBytes[0]) {
-        Serial.println("==========================================");
-        Serial.printf("WARNING: Encryption key match byte mismatch!\n");
-        Serial.printf("  Expected: 0x%02X (first byte of your key)\n", keyBytes[0]);
-        Serial.printf("  Got:      0x%02X (byte 9 of BLE packet)\n", encryptedData[9]);
-        Serial.println("  This may indicate an incorrect encryption key.");
-        Serial.println("  Attempting decryption anyway...");
-        Serial.println("==========================================");
+    if (encryptedData[VICTRON_KEY_MATCH_OFFSET] != key.bytes[0]) {
+        if (parseMetrics) {
+            parseMetrics->keyMismatches++;
+        }
+        LOG_W(BLE, "WARNING: Encryption key match byte mismatch (expected 0x%02X, the first byte of your key; "
+                "got 0x%02X, byte 9 of the packet) - the key may be wrong, attempting decryption anyway\n",
+            key.bytes[0], encryptedData[VICTRON_KEY_MATCH_OFFSET]);
         // Continue with decryption instead of returning false
     }
     
     // Extract nonce/counter from bytes 7 and 8
-    uint8_t dataCounterLSB = encryptedData[7];
-    uint8_t dataCounterMSB = encryptedData[8];
+    uint8_t dataCounterLSB = encryptedData[VICTRON_NONCE_OFFSET];
+    uint8_t dataCounterMSB = encryptedData[VICTRON_NONCE_OFFSET + 1];
     
     // Copy header (first 10 bytes) as-is - they are not encrypted
-    memcpy(decryptedData, encryptedData, 10);
+    memcpy(decryptedData, encryptedData, VICTRON_PAYLOAD_OFFSET);
     
     // Decrypt the payload starting from byte 10
-    size_t encryptedPayloadLength = length - 10;
+    size_t encryptedPayloadLength = length - VICTRON_PAYLOAD_OFFSET;
     if (encryptedPayloadLength == 0) {
-        Serial.println("WARNING: No encrypted payload to decrypt");
+        LOG_W(BLE, "WARNING: No encrypted payload to decrypt\n");
         return true; // No payload to decrypt, but not an error
     }
     
-    // Initialize AES context
-    esp_aes_context aesCtx;
-    esp_aes_init(&aesCtx);
-    
-    // Set encryption key (128 bits)
-    int status = esp_aes_setkey(&aesCtx, keyBytes, 128);
-    if (status != 0) {
-        Serial.printf("ERROR: Failed to set AES key (status %d)\n", status);
-        esp_aes_free(&aesCtx);
-        return false;
-    }
-    
     // Prepare nonce/counter for AES-CTR mode
     // The counter is initialized with data counter bytes (from BLE packet) and remaining bytes set to zero
     // Format: [dataCounterLSB, dataCounterMSB, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0]
@@ -514,97 +1147,127 @@ bool VictronBLE::decryptData(const uint8_t* encryptedData, size_t length, uint8_
     nonceCounter[1] = dataCounterMSB;
     // Bytes 2-15 remain zero as per AES-CTR spec
     
-    uint8_t streamBlock[16];
-    memset(streamBlock, 0, sizeof(streamBlock));
-    size_t ncOffset = 0;
-    
-    // Decrypt using AES-128-CTR
-    status = esp_aes_crypt_ctr(&aesCtx, 
-                               encryptedPayloadLength, 
-                               &ncOffset, 
-                               nonceCounter, 
-                               streamBlock, 
-                               &encryptedData[10],        // source: encrypted payload
-                               &decryptedData[10]);       // destination: decrypted payload
-    
-    esp_aes_free(&aesCtx);
+    // Decrypt using AES-128-CTR with the key schedule prepared in setEncryptionKey()
+    bool decrypted = AesCtr::crypt(key.aes, nonceCounter, &encryptedData[VICTRON_PAYLOAD_OFFSET],
+                                   &decryptedData[VICTRON_PAYLOAD_OFFSET], encryptedPayloadLength);
     
-    if (status != 0) {
-        Serial.printf("ERROR: AES-CTR decryption failed (status %d)\n", status);
+    if (!decrypted) {
+        LOG_E(BLE, "ERROR: AES-CTR decryption failed (%s backend)\n", AesCtr::backendName(AesCtr::getBackend()));
         return false;
     }
     
-    Serial.printf("Successfully decrypted %d bytes of data\n", encryptedPayloadLength);
+    LOG_D(BLE, "Successfully decrypted %u bytes of data\n", (unsigned)encryptedPayloadLength);
     return true;
 }
 
-// Helper functions for multi-byte value extraction
-
-// Extract signed 16-bit value (little-endian with sign bit)
-int16_t VictronBLE::extractSigned16(const uint8_t* data, int byteIndex) {
-    bool neg = (data[byteIndex + 1] & 0x80) >> 7;  // extract sign bit from MSB
-    int16_t value = ((data[byteIndex + 1] & 0x7F) << 8) | data[byteIndex];  // exclude sign bit
-    if (neg) value = value - 32768;  // 2's complement = val - 2^(b-1), b=16
-    return value;
-}
-
-// Extract unsigned 16-bit value (little-endian)
-uint16_t VictronBLE::extractUnsigned16(const uint8_t* data, int byteIndex) {
-    return (data[byteIndex + 1] << 8) | data[byteIndex];
-}
-
-// Extract signed 22-bit value (spread across 3 bytes, little-endian)
-// Battery current for SmartShunt: bytes 8-10
-int32_t VictronBLE::extractSigned22(const uint8_t* data, int startByte) {
-    bool neg = (data[startByte + 2] & 0x80) >> 7;  // bit 21 (sign bit)
-    
-    // Extract the 21-bit unsigned value spread across the bytes
-    // Byte 0 (8): bits 2-7 contain bits 0-5 of value
-    // Byte 1 (9): bits 0-1 contain bits 6-7, bits 2-7 contain bits 8-13
-    // Byte 2 (10): bits 0-1 contain bits 14-15, bits 2-6 contain bits 16-20
-    int32_t value = ((data[startByte] & 0xFC) >> 2) |                           // bits 0-5
-                   (((data[startByte + 1] & 0x03) << 6)) |                       // bits 6-7
-                   (((data[startByte + 1] & 0xFC) >> 2) << 8) |                  // bits 8-13
-                   (((data[startByte + 2] & 0x03) << 14)) |                      // bits 14-15
-                   (((data[startByte + 2] & 0x7C) >> 2) << 16);                  // bits 16-20
+// Extract a bit field, LSB first across little-endian bytes (Victron payload packing).
+// Signed fields are two's complement of bitWidth bits.
+int64_t VictronBLE::extractBits(const uint8_t* data, uint8_t bitOffset, uint8_t bitWidth, bool isSigned) {
+    size_t firstByte = bitOffset / 8;
+    size_t lastByte = (bitOffset + bitWidth - 1) / 8;
+    
+    // At most 5 bytes for a 32-bit field, so this fits in 64 bits
+    uint64_t value = 0;
+    for (size_t i = lastByte + 1; i-- > firstByte; ) {
+        value = (value << 8) | data[i];
+    }
+    value = (value >> (bitOffset % 8)) & ((1ULL << bitWidth) - 1);
     
-    if (neg) value = value - 2097152;  // 2's complement = val - 2^(b-1), b=22
-    return value;
-}
-
-// Extract unsigned 20-bit value (spread across 3 bytes, little-endian)
-// Consumed Ah for SmartShunt: bytes 11-13 (lower 4 bits of byte 13)
-uint32_t VictronBLE::extractUnsigned20(const uint8_t* data, int startByte) {
-    return data[startByte] |                     // bits 0-7
-          (data[startByte + 1] << 8) |           // bits 8-15
-          ((data[startByte + 2] & 0x0F) << 16);  // bits 16-19
+    if (isSigned && (value >> (bitWidth - 1)) != 0) {
+        return (int64_t)value - (int64_t)(1ULL << bitWidth);
+    }
+    return (int64_t)value;
 }
 
-// Extract unsigned 10-bit value (spread across 2 bytes)
-// State of Charge for SmartShunt: bytes 13-14 (upper 4 bits of byte 13, bits 0-5 of byte 14)
-uint16_t VictronBLE::extractUnsigned10(const uint8_t* data, int startByte) {
-    // Byte 13: bits 4-7 contain bits 0-3 of value (extract with 0xF0, shift right by 4)
-    // Byte 14: bits 0-3 contain bits 4-7 of value (extract with 0x0F, shift left by 4)
-    // Byte 14: bits 4-5 contain bits 8-9 of value (extract with 0x30, shift left by 4 more)
-    return ((data[startByte] & 0xF0) >> 4) |       // bits 0-3
-           ((data[startByte + 1] & 0x0F) << 4) |   // bits 4-7
-           ((data[startByte + 1] & 0x30) << 4);    // bits 8-9 (bits 4-5 of byte shifted to 8-9)
+// Decode the fields of a payload layout into reading
+bool VictronBLE::decodeFields(const VictronField* fields, size_t count, const uint8_t* payload, size_t length,
+                              VictronReading& reading) {
+    uint8_t* base = reinterpret_cast<uint8_t*>(&reading);
+    int selector = -1;
+    
+    for (size_t i = 0; i < count; i++) {
+        const VictronField& field = fields[i];
+        
+        // Parse whatever fields are available based on actual data length
+        if ((size_t)field.bitOffset + field.bitWidth > length * 8) {
+            continue;
+        }
+        if (field.when != VICTRON_ALWAYS && field.when != selector) {
+            continue;
+        }
+        
+        int64_t raw = extractBits(payload, field.bitOffset, field.bitWidth, field.isSigned);
+        if (raw == field.notAvailable) {
+            continue;
+        }
+        
+        float value = 0;
+        switch (field.type) {
+            case FIELD_FLOAT:
+                value = (float)((double)((float)raw / field.divisor) + field.offset);
+                if (field.check == CHECK_VOLTAGE && !validateVoltage(value, field.source, reading)) {
+                    return false;
+                }
+                if (field.check == CHECK_TEMPERATURE && !validateTemperature(value, field.source, reading)) {
+                    return false;
+                }
+                *reinterpret_cast<float*>(base + field.dest) = value;
+                break;
+            case FIELD_INT:
+                *reinterpret_cast<int*>(base + field.dest) = (int)raw;
+                break;
+            case FIELD_UINT32:
+                *reinterpret_cast<uint32_t*>(base + field.dest) = (uint32_t)raw;
+                break;
+        }
+        if (field.flag != VICTRON_NO_FLAG) {
+            *reinterpret_cast<bool*>(base + field.flag) = true;
+        }
+        
+        // Sanity check: If current seems unrealistic (>100A or <-100A), encryption key is likely wrong
+        if (field.check == CHECK_CURRENT_LIMIT && (value > 100.0f || value < -100.0f)) {
+            reading.dataValid = false;
+            strlcpy(parseError, "Invalid current reading - check encryption key", sizeof(parseError));
+            LOG_E(BLE, "ERROR: Unrealistic current %.2fA detected - encryption key is likely incorrect\n", value);
+            return false;
+        }
+        
+        switch (field.action) {
+            case ACTION_POWER:
+                // Calculate power if we have both voltage and current
+                if (reading.hasVoltage) {
+                    reading.power = reading.voltage * reading.current;
+                    reading.hasPower = true;
+                }
+                break;
+            case ACTION_SET_VOLTAGE:
+                reading.voltage = value;
+                reading.hasVoltage = true;
+                break;
+            case ACTION_SELECTOR:
+                selector = (int)raw;
+                break;
+            default:
+                break;
+        }
+    }
+    return true;
 }
 
 // Validate voltage reading with sanity check
 // Returns true if voltage is valid (within MIN_VALID_VOLTAGE to MAX_VALID_VOLTAGE), false if invalid
-// If invalid, sets device.dataValid to false and logs an error
-bool VictronBLE::validateVoltage(float voltage, const char* source, VictronDeviceData& device) {
+// If invalid, sets reading.dataValid to false, fills parseError and logs an error
+bool VictronBLE::validateVoltage(float voltage, const char* source, VictronReading& reading) {
     // Sanity check: discard packet if voltage > MAX_VALID_VOLTAGE or < MIN_VALID_VOLTAGE (clearly incorrect data)
     if (voltage > MAX_VALID_VOLTAGE || voltage < MIN_VALID_VOLTAGE) {
-        device.dataValid = false;
-        // Build error message using snprintf for better performance
-        char errorMsg[100];
-        snprintf(errorMsg, sizeof(errorMsg), "Invalid voltage reading (%.2fV, valid range: %.0fV to %.0fV) - packet discarded", 
+        reading.dataValid = false;
+        if (parseMetrics) {
+            parseMetrics->validationRejects++;
+        }
+        snprintf(parseError, sizeof(parseError), "Invalid voltage reading (%.2fV, valid range: %.0fV to %.0fV) - packet discarded", 
                  voltage, MIN_VALID_VOLTAGE, MAX_VALID_VOLTAGE);
-        device.errorMessage = errorMsg;
-        Serial.printf("ERROR: Invalid voltage %.2fV detected in %s packet (valid range: %.0fV to %.0fV) - discarding\n", 
-                     voltage, source, MIN_VALID_VOLTAGE, MAX_VALID_VOLTAGE);
+        LOG_E(BLE, "ERROR: Invalid voltage %.2fV detected in %s packet (valid range: %.0fV to %.0fV) - discarding\n", 
+                  voltage, source, MIN_VALID_VOLTAGE, MAX_VALID_VOLTAGE);
         return false;
     }
     return true;
@@ -612,283 +1275,30 @@ bool VictronBLE::validateVoltage(float voltage, const char* source, VictronDevic
 
 // Validate temperature reading with sanity check
 // Returns true if temperature is valid (between valid range and not exceeding MAX_VALID_TEMPERATURE), false if invalid
-// If invalid, sets device.dataValid to false and logs an error
-bool VictronBLE::validateTemperature(float temperature, const char* source, VictronDeviceData& device) {
+// If invalid, sets reading.dataValid to false, fills parseError and logs an error
+bool VictronBLE::validateTemperature(float temperature, const char* source, VictronReading& reading) {
     // Sanity check: discard packet if temperature > MAX_VALID_TEMPERATURE (clearly incorrect data)
     if (temperature > MAX_VALID_TEMPERATURE) {
-        device.dataValid = false;
-        // Build error message using snprintf for better performance
-        char errorMsg[100];
-        snprintf(errorMsg, sizeof(errorMsg), "Invalid temperature reading (%.1f°C, max: %.0f°C) - packet discarded", 
+        reading.dataValid = false;
+        if (parseMetrics) {
+            parseMetrics->validationRejects++;
+        }
+        snprintf(parseError, sizeof(parseError), "Invalid temperature reading (%.1f°C, max: %.0f°C) - packet discarded", 
                  temperature, MAX_VALID_TEMPERATURE);
-        device.errorMessage = errorMsg;
-        Serial.printf("ERROR: Invalid temperature %.1f°C detected in %s packet (max: %.0f°C) - discarding\n", 
-                     temperature, source, MAX_VALID_TEMPERATURE);
+        LOG_E(BLE, "ERROR: Invalid temperature %.1f°C detected in %s packet (max: %.0f°C) - discarding\n", 
+                  temperature, source, MAX_VALID_TEMPERATURE);
         return false;
     }
     return true;
 }
 
-// Parse SmartShunt data (15-byte fixed structure, but handle partial data)
-// Based on VBM.cpp from reference implementation
-void VictronBLE::parseSmartShuntData(const uint8_t* output, size_t length, VictronDeviceData& device) {
-    // Parse whatever fields are available based on actual data length
-    // Each field is only parsed if we have enough bytes for it
-    
-    // Time To Go (bytes 0-1, little-endian, unsigned 16-bit, units: minutes)
-    if (length >= 2) {
-        uint16_t ttgMinutes = extractUnsigned16(output, 0);
-        if (ttgMinutes != 0xFFFF) {
-            device.timeToGo = ttgMinutes;
-        }
-    }
-    
-    // Battery Voltage (bytes 2-3, signed 16-bit, units: 10mV)
-    if (length >= 4) {
-        int16_t battMv10 = extractSigned16(output, 2);
-        if (battMv10 != 0x7FFF) {
-            float voltage = battMv10 / 100.0f;  // convert 10mV to V
-            if (!validateVoltage(voltage, "SmartShunt", device)) {
-                return;
-            }
-            device.voltage = voltage;
-            device.hasVoltage = true;
-        }
-    }
-    
-    // Alarm bits (bytes 4-5)
-    if (length >= 6) {
-        device.alarmState = extractUnsigned16(output, 4);
-    }
-    
-    // Auxiliary input (bytes 6-7) and aux mode (byte 8)
-    // The type is determined by bits 0-1 of byte 8
-    if (length >= 9) {
-        device.auxMode = output[8] & 0x03;
-        
-        if (device.auxMode == 0) {
-            // Aux voltage (signed 16-bit, units: 10mV)
-            int16_t auxMv10 = extractSigned16(output, 6);
-            if (auxMv10 != 0x7FFF) {
-                device.auxVoltage = auxMv10 / 100.0f;
-            }
-        } else if (device.auxMode == 1) {
-            // Mid-point voltage (unsigned 16-bit, units: 10mV)
-            uint16_t midMv10 = extractUnsigned16(output, 6);
-            if (midMv10 != 0xFFFF) {
-                device.midVoltage = midMv10 / 100.0f;
-            }
-        } else if (device.auxMode == 2) {
-            // Temperature (unsigned 16-bit, units: 10mK = 0.01K)
-            uint16_t tempK01 = extractUnsigned16(output, 6);
-            if (tempK01 != 0xFFFF) {
-                float temperature = (tempK01 / 100.0f) - 273.15;  // convert 0.01K to Celsius
-                if (!validateTemperature(temperature, "SmartShunt", device)) {
-                    return;
-                }
-                device.temperature = temperature;
-                device.hasTemperature = true;
-            }
-        }
-    }
-    
-    // Battery Current (bytes 8-10, signed 22-bit, units: mA)
-    if (length >= 11) {
-        int32_t battMa = extractSigned22(output, 8);
-        if (battMa != 0x1FFFFF) {
-            device.current = battMa / 1000.0f;  // convert mA to A
-            device.hasCurrent = true;
-            
-            // Calculate power if we have both voltage and current
-            if (device.hasVoltage) {
-                device.power = device.voltage * device.current;
-                device.hasPower = true;
-            }
-        }
-    }
-    
-    // Consumed Ah (bytes 11-13, unsigned 20-bit, units: 100mAh = 0.1Ah)
-    if (length >= 14) {
-        uint32_t consumedAh01 = extractUnsigned20(output, 11);
-        if (consumedAh01 != 0xFFFFF) {
-            device.consumedAh = consumedAh01 / 10.0f;  // convert 0.1Ah to Ah
-        }
-    }
-    
-    // State of Charge (bytes 13-14, unsigned 10-bit, units: 0.1%)
-    if (length >= 15) {
-        uint16_t soc01 = extractUnsigned10(output, 13);
-        if (soc01 != 0x3FF) {
-            device.batterySOC = soc01 / 10.0f;  // convert 0.1% to %
-            device.hasSOC = true;
-        }
-    }
-    
-    Serial.printf("SmartShunt parsed: V=%.2f, A=%.3f, SOC=%.1f%%, Ah=%.1f\n", 
-                 device.voltage, device.current, device.batterySOC, device.consumedAh);
-}
-
-// Parse Solar Controller data (16-byte fixed structure, but handle partial data)
-// Blue Smart Chargers also use this same format
-// Based on VSC.cpp from reference implementation
-void VictronBLE::parseSolarControllerData(const uint8_t* output, size_t length, VictronDeviceData& device) {
-    // Parse whatever fields are available based on actual data length
-    // Each field is only parsed if we have enough bytes for it
-    
-    // Debug: Print raw payload bytes
-    Serial.printf("Raw charger payload (%d bytes): ", length);
-    for (size_t i = 0; i < length && i < 16; i++) {
-        Serial.printf("%02X ", output[i]);
-    }
-    Serial.println();
-    
-    // Device State (byte 0)
-    if (length >= 1) {
-        device.deviceState = output[0];
-    }
-    
-    // Charger Error (byte 1)
-    if (length >= 2) {
-        device.chargerError = output[1];
-    }
-    
-    // Battery Voltage (bytes 2-3, signed 16-bit, units: 10mV)
-    if (length >= 4) {
-        int16_t battMv10 = extractSigned16(output, 2);
-        Serial.printf("Debug: Voltage bytes [2-3]: %02X %02X -> raw value: %d (0x%04X) -> %.2fV\n",
-                     output[2], output[3], battMv10, (uint16_t)battMv10, battMv10 / 100.0f);
-        if (battMv10 != 0x7FFF) {
-            float voltage = battMv10 / 100.0f;  // convert 10mV to V
-            if (!validateVoltage(voltage, "SolarController", device)) {
-                return;
-            }
-            device.voltage = voltage;
-            device.hasVoltage = true;
-        }
-    }
-    
-    // Battery Current (bytes 4-5, signed 16-bit, units: 100mA)
-    // Both Solar Controllers and Blue Smart Chargers use SIGNED current
-    if (length >= 6) {
-        int16_t battMa100 = extractSigned16(output, 4);
-        Serial.printf("Debug: Current bytes [4-5]: %02X %02X -> raw value: %d (0x%04X) -> %.2fA\n",
-                     output[4], output[5], battMa100, (uint16_t)battMa100, battMa100 / 10.0f);
-        if (battMa100 != 0x7FFF) {
-            device.current = battMa100 / 10.0f;  // convert 100mA to A
-            device.hasCurrent = true;
-            
-            // Sanity check: If current seems unrealistic (>100A or <-100A), encryption key is likely wrong
-            if (device.current > 100.0f || device.current < -100.0f) {
-                device.dataValid = false;
-                device.errorMessage = "Invalid current reading - check encryption key";
-                Serial.printf("ERROR: Unrealistic current %.2fA detected - encryption key is likely incorrect\n", device.current);
-                return;
-            }
-            
-            // Calculate power if we have both voltage and current
-            if (device.hasVoltage) {
-                device.power = device.voltage * device.current;
-                device.hasPower = true;
-            }
-        }
-    }
-    
-    // Yield Today (bytes 6-7, unsigned 16-bit, units: 10Wh = 0.01kWh)
-    if (length >= 8) {
-        uint16_t yieldWh10 = extractUnsigned16(output, 6);
-        if (yieldWh10 != 0xFFFF) {
-            device.yieldToday = yieldWh10 / 100.0f;  // convert 10Wh to kWh
-        }
-    }
-    
-    // PV Power (bytes 8-9, unsigned 16-bit, units: W)
-    if (length >= 10) {
-        uint16_t pvW = extractUnsigned16(output, 8);
-        if (pvW != 0xFFFF) {
-            device.pvPower = pvW;
-        }
-    }
-    
-    // Load Current (bytes 10-11, partially used, units: 100mA)
-    // Only 9 bits are used: bit 0 of byte 11 + all 8 bits of byte 10
-    if (length >= 12) {
-        uint16_t loadMa100 = ((output[11] & 0x01) << 8) | output[10];
-        if (loadMa100 != 0x1FF) {
-            device.loadCurrent = loadMa100 / 10.0f;  // convert 100mA to A
-        }
-    }
-    
-    Serial.printf("%s parsed: V=%.2f, A=%.2f, PV=%.0fW, Yield=%.2fkWh, State=%d, Error=%d\n",
-                 (device.type == DEVICE_BLUE_SMART_CHARGER) ? "BlueSmartCharger" : "SolarController",
-                 device.voltage, device.current, device.pvPower, device.yieldToday, 
-                 device.deviceState, device.chargerError);
-}
-
-// Parse DC-DC Converter data (16-byte fixed structure, but handle partial data)
-// Based on reference implementation: mp-se/victron-receiver
-// Data layout: state(8), error(8), inputV(16), outputV(16), offReason(32)
-void VictronBLE::parseDCDCConverterData(const uint8_t* output, size_t length, VictronDeviceData& device) {
-    // Parse whatever fields are available based on actual data length
-    // Each field is only parsed if we have enough bytes for it
-    
-    // Device State (byte 0)
-    if (length >= 1) {
-        device.deviceState = output[0];
-    }
-    
-    // Error code (byte 1)
-    if (length >= 2) {
-        device.chargerError = output[1];
-    }
-    
-    // Input Voltage (bytes 2-3, unsigned 16-bit, units: 10mV)
-    if (length >= 4) {
-        uint16_t inputMv10 = extractUnsigned16(output, 2);
-        if (inputMv10 != 0xFFFF) {
-            float inputVoltage = inputMv10 / 100.0f;
-            if (!validateVoltage(inputVoltage, "DCDC input", device)) {
-                return;
-            }
-            device.inputVoltage = inputVoltage;
-            device.hasInputVoltage = true;
-        }
-    }
-    
-    // Output Voltage (bytes 4-5, signed 16-bit, units: 10mV)
-    if (length >= 6) {
-        int16_t outputMv10 = extractSigned16(output, 4);
-        if (outputMv10 != 0x7FFF) {
-            float outputVoltage = outputMv10 / 100.0f;
-            if (!validateVoltage(outputVoltage, "DCDC output", device)) {
-                return;
-            }
-            device.outputVoltage = outputVoltage;
-            device.hasOutputVoltage = true;
-            // Also set as general voltage for display
-            device.voltage = device.outputVoltage;
-            device.hasVoltage = true;
-        }
-    }
-    
-    // Off Reason (bytes 6-9, unsigned 32-bit)
-    if (length >= 10) {
-        device.offReason = (uint32_t)output[6] | 
-                          ((uint32_t)output[7] << 8) | 
-                          ((uint32_t)output[8] << 16) | 
-                          ((uint32_t)output[9] << 24);
-    }
-    
-    Serial.printf("DCDC parsed: In=%.2fV, Out=%.2fV, State=%d, Error=%d, OffReason=0x%08X\n", 
-                 device.inputVoltage, device.outputVoltage, device.deviceState, 
-                 device.chargerError, device.offReason);
-}
-
-// Parse TLV records (fallback for unknown device types or unencrypted instant readout)
+// Parse TLV records (fallback for unknown device types)
 // This provides backwards compatibility
-void VictronBLE::parseTLVRecords(const uint8_t* data, size_t length, size_t startPos, VictronDeviceData& device) {
+void VictronBLE::parseTLVRecords(const uint8_t* data, size_t length, size_t startPos, VictronReading& reading,
+                                 std::vector<VictronRecord>* records) {
     size_t pos = startPos;
     
-    Serial.println("Parsing TLV records (fallback mode)");
+    LOG_D(BLE, "Parsing TLV records (fallback mode)\n");
     
     while (pos < length) {
         if (pos + 1 >= length) break;
@@ -901,12 +1311,12 @@ void VictronBLE::parseTLVRecords(const uint8_t* data, size_t length, size_t star
         const uint8_t* recordData = &data[pos + 2];
         
         // Store parsed record for debug purposes
-        VictronRecord rec;
-        rec.type = recordType;
-        rec.length = recordLen;
-        if (recordLen <= sizeof(rec.data)) {
+        if (records && recordLen <= sizeof(VictronRecord::data)) {
+            VictronRecord rec;
+            rec.type = recordType;
+            rec.length = recordLen;
             memcpy(rec.data, recordData, recordLen);
-            device.parsedRecords.push_back(rec);
+            records->push_back(rec);
         }
         
         switch (recordType) {
@@ -915,86 +1325,86 @@ void VictronBLE::parseTLVRecords(const uint8_t* data, size_t length, size_t star
             case CHARGER_VOLTAGE:
                 {
                     float voltage = decodeValue(recordData, recordLen, 0.01); // 10mV resolution
-                    if (!validateVoltage(voltage, "TLV", device)) {
+                    if (!validateVoltage(voltage, "TLV", reading)) {
                         return;
                     }
-                    device.voltage = voltage;
-                    device.hasVoltage = true;
+                    reading.voltage = voltage;
+                    reading.hasVoltage = true;
                 }
                 break;
                 
             case BATTERY_CURRENT:
             case SOLAR_CHARGER_CURRENT:
             case CHARGER_CURRENT:
-                device.current = decodeValue(recordData, recordLen, 0.001); // 1mA resolution
-                device.hasCurrent = true;
+                reading.current = decodeValue(recordData, recordLen, 0.001); // 1mA resolution
+                reading.hasCurrent = true;
                 break;
                 
             case BATTERY_POWER:
-                device.power = decodeValue(recordData, recordLen, 1.0);
-                device.hasPower = true;
+                reading.power = decodeValue(recordData, recordLen, 1.0);
+                reading.hasPower = true;
                 break;
                 
             case BATTERY_SOC:
-                device.batterySOC = decodeValue(recordData, recordLen, 0.01); // 0.01% resolution
-                device.hasSOC = true;
+                reading.batterySOC = decodeValue(recordData, recordLen, 0.01); // 0.01% resolution
+                reading.hasSOC = true;
                 break;
                 
             case BATTERY_TEMPERATURE:
             case EXTERNAL_TEMPERATURE:
                 {
                     float temperature = decodeValue(recordData, recordLen, 0.01) - 273.15; // Kelvin to Celsius
-                    if (!validateTemperature(temperature, "TLV", device)) {
+                    if (!validateTemperature(temperature, "TLV", reading)) {
                         return;
                     }
-                    device.temperature = temperature;
-                    device.hasTemperature = true;
+                    reading.temperature = temperature;
+                    reading.hasTemperature = true;
                 }
                 break;
                 
             case CONSUMED_AH:
-                device.consumedAh = decodeValue(recordData, recordLen, 0.1);
+                reading.consumedAh = decodeValue(recordData, recordLen, 0.1);
                 break;
                 
             case TIME_TO_GO:
-                device.timeToGo = (int)decodeValue(recordData, recordLen, 1.0);
+                reading.timeToGo = (int)decodeValue(recordData, recordLen, 1.0);
                 break;
                 
             case DEVICE_STATE:
-                device.deviceState = (int)decodeValue(recordData, recordLen, 1.0);
+                reading.deviceState = (int)decodeValue(recordData, recordLen, 1.0);
                 break;
                 
             case ALARM:
-                device.alarmState = (int)decodeValue(recordData, recordLen, 1.0);
+                reading.alarmState = (int)decodeValue(recordData, recordLen, 1.0);
                 break;
                 
             case AC_OUT_VOLTAGE:
-                device.acOutVoltage = decodeValue(recordData, recordLen, 0.01);
-                device.hasAcOut = true;
+                reading.acOutVoltage = decodeValue(recordData, recordLen, 0.01);
+                reading.hasAcOut = true;
                 break;
                 
             case AC_OUT_CURRENT:
-                device.acOutCurrent = decodeValue(recordData, recordLen, 0.1);
-                device.hasAcOut = true;
+                reading.acOutCurrent = decodeValue(recordData, recordLen, 0.1);
+                reading.hasAcOut = true;
                 break;
                 
             case AC_OUT_POWER:
-                device.acOutPower = decodeValue(recordData, recordLen, 1.0);
-                device.hasAcOut = true;
+                reading.acOutPower = decodeValue(recordData, recordLen, 1.0);
+                reading.hasAcOut = true;
                 break;
                 
             case INPUT_VOLTAGE:
-                device.inputVoltage = decodeValue(recordData, recordLen, 0.01);
-                device.hasInputVoltage = true;
+                reading.inputVoltage = decodeValue(recordData, recordLen, 0.01);
+                reading.hasInputVoltage = true;
                 break;
                 
             case OUTPUT_VOLTAGE:
-                device.outputVoltage = decodeValue(recordData, recordLen, 0.01);
-                device.hasOutputVoltage = true;
+                reading.outputVoltage = decodeValue(recordData, recordLen, 0.01);
+                reading.hasOutputVoltage = true;
                 break;
                 
             case OFF_REASON:
-                device.offReason = (int)decodeValue(recordData, recordLen, 1.0);
+                reading.offReason = (int)decodeValue(recordData, recordLen, 1.0);
                 break;
         }
         
@@ -1002,127 +1412,60 @@ void VictronBLE::parseTLVRecords(const uint8_t* data, size_t length, size_t star
     }
 }
 
-// Merge new device data with existing data
-// This preserves the last good values when new parsing fails or returns invalid data
-void VictronBLE::mergeDeviceData(const VictronDeviceData& newData, VictronDeviceData& existingData) {
-    // Update name only if new name is not empty (sometimes BLE advertisements don't include the name)
-    if (!newData.name.isEmpty()) {
-        existingData.name = newData.name;
-    } else {
-        Serial.print("Retaining existing device name '");
-        Serial.print(existingData.name);
-        Serial.print("' for ");
-        Serial.print(existingData.address);
-        Serial.println(" (new name empty)");
+// Merge a newly decoded reading into the existing device entry
+// This preserves the last good values when new parsing fails or returns invalid data.
+// Name, type, RSSI and debug data are updated in place by processAdvertisement().
+// Fields are compared before they are written, so a stable reading touches nothing.
+VictronChangeMask VictronBLE::mergeDeviceData(const VictronReading& newData, VictronDeviceData& existingData) {
+    // Retain mode disabled - replace the telemetry completely, flags included
+    bool replace = !retainLastData;
+    if (!replace && !newData.dataValid) {
+        // New data is invalid - keep existing valid data
+        LOG_D(BLE, "Retaining last good data for %s (new data invalid)\n", existingData.address.c_str());
+        return 0;
     }
     
-    // Update type only if new type is not DEVICE_UNKNOWN (type is derived from name)
-    if (newData.type != DEVICE_UNKNOWN) {
-        existingData.type = newData.type;
-    } else {
-        Serial.print("Retaining existing device type for ");
-        Serial.print(existingData.address);
-        Serial.println(" (new type unknown)");
-    }
-    
-    // Always update these fields regardless of parsing success
-    existingData.rssi = newData.rssi;
-    existingData.lastUpdate = newData.lastUpdate;
-    existingData.manufacturerId = newData.manufacturerId;
-    existingData.modelId = newData.modelId;
-    existingData.encrypted = newData.encrypted;
-    
-    // Safely copy raw data with bounds checking
-    existingData.rawDataLength = newData.rawDataLength > sizeof(existingData.rawManufacturerData) 
-                                 ? sizeof(existingData.rawManufacturerData) 
-                                 : newData.rawDataLength;
-    memcpy(existingData.rawManufacturerData, newData.rawManufacturerData, existingData.rawDataLength);
-    
-    existingData.parsedRecords = newData.parsedRecords;
-    
-    // If new data is valid, update all the measurement fields
-    if (newData.dataValid) {
-        existingData.dataValid = true;
-        existingData.errorMessage = newData.errorMessage;
-        
-        // Update voltage if newly available
-        if (newData.hasVoltage) {
-            existingData.voltage = newData.voltage;
-            existingData.hasVoltage = true;
-        }
-        
-        // Update current if newly available
-        if (newData.hasCurrent) {
-            existingData.current = newData.current;
-            existingData.hasCurrent = true;
-        }
-        
-        // Update power if newly available
-        if (newData.hasPower) {
-            existingData.power = newData.power;
-            existingData.hasPower = true;
-        }
-        
-        // Update SOC if newly available
-        if (newData.hasSOC) {
-            existingData.batterySOC = newData.batterySOC;
-            existingData.hasSOC = true;
-        }
-        
-        // Update temperature if newly available
-        if (newData.hasTemperature) {
-            existingData.temperature = newData.temperature;
-            existingData.hasTemperature = true;
-        }
-        
-        // Update AC output if newly available
-        if (newData.hasAcOut) {
-            existingData.acOutVoltage = newData.acOutVoltage;
-            existingData.acOutCurrent = newData.acOutCurrent;
-            existingData.acOutPower = newData.acOutPower;
-            existingData.hasAcOut = true;
-        }
-        
-        // Update input voltage if newly available
-        if (newData.hasInputVoltage) {
-            existingData.inputVoltage = newData.inputVoltage;
-            existingData.hasInputVoltage = true;
-        }
-        
-        // Update output voltage if newly available
-        if (newData.hasOutputVoltage) {
-            existingData.outputVoltage = newData.outputVoltage;
-            existingData.hasOutputVoltage = true;
+    const uint8_t* source = reinterpret_cast<const uint8_t*>(&newData);
+    uint8_t* stored = reinterpret_cast<uint8_t*>(static_cast<VictronReading*>(&existingData));
+    VictronChangeMask changes = 0;
+    if (existingData.dataValid != newData.dataValid) {
+        existingData.dataValid = newData.dataValid;
+        changes |= CHANGE_BIT(CHANGE_DATA_VALID);
+    }
+    
+    for (uint8_t field = 0; field < CHANGE_DATA_VALID; field++) {
+        const VictronMergeField& merge = MERGE_FIELDS[field];
+        // Flagged values are only updated when newly available, unless replacing.
+        // A flag that flips always carries its value with it, deadband or not.
+        bool flagChanged = false;
+        if (merge.flag != VICTRON_NO_FLAG) {
+            bool available = source[merge.flag] != 0;
+            if (!available && !replace) {
+                continue;
+            }
+            if ((stored[merge.flag] != 0) != available) {
+                stored[merge.flag] = available;
+                flagChanged = true;
+                changes |= CHANGE_BIT(field) | CHANGE_BIT(CHANGE_DATA_VALID);
+            }
         }
         
-        // Update all device-specific fields when data is valid
-        // These fields don't have corresponding 'has' flags because they're always
-        // present in the data structure (even if zero/default). Since we're in the
-        // dataValid block, we know parsing succeeded and these values are meaningful.
-        existingData.consumedAh = newData.consumedAh;
-        existingData.timeToGo = newData.timeToGo;
-        existingData.auxVoltage = newData.auxVoltage;
-        existingData.midVoltage = newData.midVoltage;
-        existingData.auxMode = newData.auxMode;
-        existingData.yieldToday = newData.yieldToday;
-        existingData.pvPower = newData.pvPower;
-        existingData.loadCurrent = newData.loadCurrent;
-        existingData.deviceState = newData.deviceState;
-        existingData.chargerError = newData.chargerError;
-        existingData.alarmState = newData.alarmState;
-        existingData.offReason = newData.offReason;
-    } else {
-        // New data is invalid - keep existing valid data but update error message
-        if (!newData.errorMessage.isEmpty()) {
-            existingData.errorMessage = newData.errorMessage;
+        // Fields without a flag are always present in the structure (even if zero/default);
+        // a valid reading means parsing succeeded and these values are meaningful
+        for (uint8_t i = 0; i < merge.count; i++) {
+            size_t offset = merge.dest + i * sizeof(uint32_t);
+            if (flagChanged || mergeValueChanged(merge.type, stored + offset, source + offset, changeDeadbands[field])) {
+                memcpy(stored + offset, source + offset, sizeof(uint32_t));
+                changes |= CHANGE_BIT(field);
+            }
         }
-        Serial.printf("Retaining last good data for %s (new data invalid)\n", existingData.address.c_str());
     }
+    return changes;
 }
 
 void VictronBLE::setRetainLastData(bool retain) {
     retainLastData = retain;
-    Serial.printf("Retain last data: %s\n", retain ? "enabled" : "disabled");
+    LOG_I(BLE, "Retain last data: %s\n", retain ? "enabled" : "disabled");
 }
 
 bool VictronBLE::getRetainLastData() const {
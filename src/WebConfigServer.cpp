@@ -1,19 +1,45 @@
 #include "WebConfigServer.h"
 #include "VictronBLE.h"
 #include "MQTTPublisher.h"
+#include "AdvertisementCapture.h"
+#include "AdvertisementFilter.h"
+#include "HistoryStore.h"
+#include "HistoryLog.h"
+#include "DeferredLog.h"
+#include "PeriodicTask.h"
 #include <esp_wifi.h>
+#include <esp_timer.h>
 
-WebConfigServer::WebConfigServer() : server(nullptr), serverStarted(false), filesystemMounted(false), victronBLE(nullptr), mqttPublisher(nullptr) {
+// Everything in the /api/devices/live document; cells, BMS and multi-output fields are not in it
+static const VictronChangeMask LIVE_DATA_FIELDS = CHANGE_ALL &
+    ~(CHANGE_BIT(CHANGE_CELL_VOLTAGES) | CHANGE_BIT(CHANGE_BALANCER_STATUS) | CHANGE_BIT(CHANGE_BMS_FLAGS) |
+      CHANGE_BIT(CHANGE_AC_IN_POWER) | CHANGE_BIT(CHANGE_ACTIVE_AC_IN) |
+      CHANGE_BIT(CHANGE_BATTERY_VOLTAGE2) | CHANGE_BIT(CHANGE_BATTERY_CURRENT2) |
+      CHANGE_BIT(CHANGE_BATTERY_VOLTAGE3) | CHANGE_BIT(CHANGE_BATTERY_CURRENT3));
+
+WebConfigServer::WebConfigServer() : server(nullptr), serverStarted(false), filesystemMounted(false),
+                                     liveDataBuiltAt(0), liveDataDevices(0), liveDataCached(false),
+                                     liveDataSubscriber(-1),
+                                     victronBLE(nullptr), mqttPublisher(nullptr),
+                                     capture(nullptr), captureReplay(nullptr), history(nullptr) {
 }
 
 WebConfigServer::~WebConfigServer() {
     if (server) {
         delete server;
     }
+    if (victronBLE) {
+        victronBLE->unsubscribeChanges(liveDataSubscriber);
+    }
 }
 
 void WebConfigServer::setVictronBLE(VictronBLE* vble) {
+    if (victronBLE) {
+        victronBLE->unsubscribeChanges(liveDataSubscriber);
+    }
     victronBLE = vble;
+    liveDataSubscriber = victronBLE ? victronBLE->subscribeChanges("web", LIVE_DATA_FIELDS) : -1;
+    liveDataCached = false;
     // Sync any loaded encryption keys to the VictronBLE instance
     syncEncryptionKeys();
 }
@@ -22,17 +48,26 @@ void WebConfigServer::setMQTTPublisher(MQTTPublisher* mqtt) {
     mqttPublisher = mqtt;
 }
 
+void WebConfigServer::setCapture(AdvertisementCapture* recorder, CaptureReplay* replay) {
+    capture = recorder;
+    captureReplay = replay;
+}
+
+void WebConfigServer::setHistory(HistoryStore* store) {
+    history = store;
+}
+
 void WebConfigServer::begin() {
-    Serial.println("Initializing Web Configuration Server...");
+    LOG_I(WEB, "Initializing Web Configuration Server...\n");
     
     // Initialize LittleFS
     filesystemMounted = LittleFS.begin(true);
     if (!filesystemMounted) {
-        Serial.println("ERROR: Failed to mount LittleFS!");
-        Serial.println("Web interface will not work properly.");
-        Serial.println("Please upload filesystem: pio run --target uploadfs");
+        LOG_E(WEB, "ERROR: Failed to mount LittleFS!\n");
+        LOG_E(WEB, "Web interface will not work properly.\n");
+        LOG_E(WEB, "Please upload filesystem: pio run --target uploadfs\n");
     } else {
-        Serial.println("LittleFS mounted successfully");
+        LOG_I(WEB, "LittleFS mounted successfully\n");
     }
     
     // Load configurations
@@ -47,7 +82,7 @@ void WebConfigServer::begin() {
 }
 
 void WebConfigServer::startWiFi() {
-    Serial.println("Starting WiFi...");
+    LOG_I(WEB, "Starting WiFi...\n");
     
     // Disable WiFi library's internal credential storage to avoid conflicts
     // Note: WiFi settings are still persistent via the Preferences API (saveWiFiConfig/loadWiFiConfig)
@@ -56,25 +91,24 @@ void WebConfigServer::startWiFi() {
     
     if (wifiConfig.apMode) {
         // Access Point mode
-        Serial.println("Starting in AP mode...");
+        LOG_I(WEB, "Starting in AP mode...\n");
         WiFi.mode(WIFI_AP);
         
         // Configure and start SoftAP
         bool apStarted = WiFi.softAP("Victron-Config", wifiConfig.apPassword.c_str());
         
         if (apStarted) {
-            Serial.println("SoftAP started successfully");
+            LOG_I(WEB, "SoftAP started successfully\n");
             // Give the AP a moment to fully initialize
             delay(100);
             
-            Serial.print("AP IP address: ");
-            Serial.println(WiFi.softAPIP());
+            LOG_I(WEB, "AP IP address: %s\n", WiFi.softAPIP().toString().c_str());
         } else {
-            Serial.println("ERROR: Failed to start SoftAP!");
+            LOG_E(WEB, "ERROR: Failed to start SoftAP!\n");
         }
     } else {
         // Station mode
-        Serial.println("Connecting to WiFi...");
+        LOG_I(WEB, "Connecting to WiFi...\n");
         
         // Ensure clean state before connecting
         WiFi.disconnect(true);
@@ -91,14 +125,13 @@ void WebConfigServer::startWiFi() {
         int attempts = 0;
         while (WiFi.status() != WL_CONNECTED && attempts < 20) {
             delay(500);
-            Serial.print(".");
             attempts++;
             // Yield to allow background tasks to run and prevent watchdog timeout
             yield();
         }
         
         if (WiFi.status() == WL_CONNECTED) {
-            Serial.println("\nWiFi connected!");
+            LOG_I(WEB, "WiFi connected after %d ms\n", attempts * 500);
             
             // Set WiFi to minimum modem sleep mode when both WiFi and BLE are enabled
             // This is REQUIRED by ESP32 when using WiFi + BLE simultaneously to avoid boot loops
@@ -106,12 +139,11 @@ void WebConfigServer::startWiFi() {
             // WiFi connected and is compatible with BLE operation.
             // Note: WIFI_PS_NONE would cause "Should enable WiFi modem sleep" error and crash.
             esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
-            Serial.println("WiFi modem sleep set to MIN_MODEM (required for WiFi+BLE)");
+            LOG_I(WEB, "WiFi modem sleep set to MIN_MODEM (required for WiFi+BLE)\n");
             
-            Serial.print("IP address: ");
-            Serial.println(WiFi.localIP());
+            LOG_I(WEB, "IP address: %s\n", WiFi.localIP().toString().c_str());
         } else {
-            Serial.println("\nWiFi connection failed, falling back to AP mode");
+            LOG_W(WEB, "WiFi connection failed, falling back to AP mode\n");
             wifiConfig.apMode = true;
             
             // Disconnect and clean up before switching to AP mode
@@ -123,12 +155,11 @@ void WebConfigServer::startWiFi() {
             bool apStarted = WiFi.softAP("Victron-Config", wifiConfig.apPassword.c_str());
             
             if (apStarted) {
-                Serial.println("Fallback SoftAP started successfully");
+                LOG_I(WEB, "Fallback SoftAP started successfully\n");
                 delay(100);
-                Serial.print("AP IP address: ");
-                Serial.println(WiFi.softAPIP());
+                LOG_I(WEB, "AP IP address: %s\n", WiFi.softAPIP().toString().c_str());
             } else {
-                Serial.println("ERROR: Failed to start fallback SoftAP!");
+                LOG_E(WEB, "ERROR: Failed to start fallback SoftAP!\n");
             }
         }
     }
@@ -186,6 +217,14 @@ void WebConfigServer::startServer() {
         handleGetDebugData(request);
     });
     
+    server->on("/api/metrics", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetMetrics(request);
+    });
+    
+    server->on("/api/history", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetHistory(request);
+    });
+    
     server->on("/api/wifi", HTTP_GET, [this](AsyncWebServerRequest *request) {
         handleGetWiFiConfig(request);
     });
@@ -248,9 +287,21 @@ void WebConfigServer::startServer() {
         handleRestart(request);
     });
     
+    server->on("/api/capture/file", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleDownloadCapture(request);
+    });
+    
+    server->on("/api/capture", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        handleGetCapture(request);
+    });
+    
+    server->on("/api/capture", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        handleSetCapture(request);
+    });
+    
     server->begin();
     serverStarted = true;
-    Serial.println("Web server started");
+    LOG_I(WEB, "Web server started\n");
 }
 
 void WebConfigServer::handleRoot(AsyncWebServerRequest *request) {
@@ -290,15 +341,31 @@ void WebConfigServer::handleGetLiveData(AsyncWebServerRequest *request) {
         return;
     }
     
-    String json = "[";
+    VictronBLE::DeviceLock lock(*victronBLE);
     auto& devices = victronBLE->getDevices();
+    
+    // Drain every event, so none are left over for the next request
+    unsigned long now = millis();
+    bool stale = !liveDataCached || liveDataSubscriber < 0 || devices.size() != liveDataDevices ||
+                 now - liveDataBuiltAt >= LIVE_DATA_MAX_AGE;
+    ChangeEvent event;
+    while (victronBLE->nextChange(liveDataSubscriber, event)) {
+        stale = true;
+    }
+    if (!stale) {
+        request->send(200, "application/json", liveDataJson);
+        return;
+    }
+    
+    String& json = liveDataJson;
+    json = "[";
     bool first = true;
     
-    for (auto& pair : devices) {
+    for (VictronDeviceData& entry : devices) {
         if (!first) json += ",";
         first = false;
         
-        VictronDeviceData* device = &pair.second;
+        VictronDeviceData* device = &entry;
         json += "{";
         json += "\"name\":\"" + device->name + "\",";
         json += "\"address\":\"" + device->address + "\",";
@@ -371,6 +438,9 @@ void WebConfigServer::handleGetLiveData(AsyncWebServerRequest *request) {
     }
     
     json += "]";
+    liveDataBuiltAt = now;
+    liveDataDevices = devices.size();
+    liveDataCached = true;
     request->send(200, "application/json", json);
 }
 
@@ -496,15 +566,26 @@ void WebConfigServer::handleGetDebugData(AsyncWebServerRequest *request) {
         return;
     }
     
+    // Keep debug records alive while this page polls; they fill in from the next advertisement
+    victronBLE->watchDebugData();
+    
     String json = "{\"devices\":[";
     auto& devices = victronBLE->getDevices();
     bool first = true;
+    static const VictronDebugData noDebugData;
     
-    for (auto& pair : devices) {
+    // Debug records are written by the ingest task: hold it off while they are read
+    VictronBLE::IngestLock ingestLock(*victronBLE);
+    VictronBLE::DeviceLock lock(*victronBLE);
+    for (VictronDeviceData& entry : devices) {
         if (!first) json += ",";
         first = false;
         
-        VictronDeviceData* device = &pair.second;
+        VictronDeviceData* device = &entry;
+        const VictronDebugData* debug = victronBLE->getDebugData(entry);
+        if (!debug) {
+            debug = &noDebugData;
+        }
         json += "{";
         json += "\"name\":\"" + device->name + "\",";
         json += "\"address\":\"" + device->address + "\",";
@@ -536,35 +617,35 @@ void WebConfigServer::handleGetDebugData(AsyncWebServerRequest *request) {
         json += "\"rssi\":" + String(device->rssi) + ",";
         json += "\"dataValid\":" + String(device->dataValid ? "true" : "false") + ",";
         json += "\"encrypted\":" + String(device->encrypted ? "true" : "false") + ",";
-        json += "\"errorMessage\":\"" + device->errorMessage + "\",";
-        String mfgIdHex = String(device->manufacturerId, HEX);
+        json += "\"errorMessage\":\"" + debug->errorMessage + "\",";
+        String mfgIdHex = String(debug->manufacturerId, HEX);
         mfgIdHex.toUpperCase();
         json += "\"manufacturerId\":\"0x" + mfgIdHex + "\",";
         String modelIdHex = String(device->modelId, HEX);
         modelIdHex.toUpperCase();
         json += "\"modelId\":\"0x" + modelIdHex + "\",";
-        json += "\"rawDataLength\":" + String(device->rawDataLength) + ",";
+        json += "\"rawDataLength\":" + String(debug->rawDataLength) + ",";
         json += "\"lastUpdate\":" + String(millis() - device->lastUpdate) + ",";
         
         // Raw manufacturer data as byte array
         json += "\"rawData\":[";
-        for (size_t i = 0; i < device->rawDataLength; i++) {
+        for (size_t i = 0; i < debug->rawDataLength; i++) {
             if (i > 0) json += ",";
-            json += String(device->rawManufacturerData[i]);
+            json += String(debug->rawManufacturerData[i]);
         }
         json += "],";
         
         // Parsed records
         json += "\"records\":[";
-        for (size_t i = 0; i < device->parsedRecords.size(); i++) {
+        for (size_t i = 0; i < debug->parsedRecords.size(); i++) {
             if (i > 0) json += ",";
             json += "{";
-            json += "\"type\":" + String(device->parsedRecords[i].type) + ",";
-            json += "\"length\":" + String(device->parsedRecords[i].length) + ",";
+            json += "\"type\":" + String(debug->parsedRecords[i].type) + ",";
+            json += "\"length\":" + String(debug->parsedRecords[i].length) + ",";
             json += "\"data\":[";
-            for (size_t j = 0; j < device->parsedRecords[i].length; j++) {
+            for (size_t j = 0; j < debug->parsedRecords[i].length; j++) {
                 if (j > 0) json += ",";
-                json += String(device->parsedRecords[i].data[j]);
+                json += String(debug->parsedRecords[i].data[j]);
             }
             json += "]";
             json += "}";
@@ -574,6 +655,270 @@ void WebConfigServer::handleGetDebugData(AsyncWebServerRequest *request) {
         json += "}";
     }
     
+    json += "],";
+    json += "\"debugCapture\":" + String(victronBLE->isDebugCaptureActive() ? "true" : "false") + ",";
+    
+    // Advertisement ring statistics (for sizing ADVERTISEMENT_RING_SIZE)
+    IngestStats ingest = victronBLE->getIngestStats();
+    json += "\"ingest\":{";
+    json += "\"capacity\":" + String(ingest.capacity) + ",";
+    json += "\"occupancy\":" + String(ingest.occupancy) + ",";
+    json += "\"highWater\":" + String(ingest.highWater) + ",";
+    json += "\"drops\":" + String(ingest.drops) + ",";
+    json += "\"filtered\":" + String(ingest.filtered) + ",";
+    json += "\"received\":" + String(ingest.received) + ",";
+    json += "\"processed\":" + String(ingest.processed) + ",";
+    json += "\"cacheLookups\":" + String(ingest.cacheLookups) + ",";
+    json += "\"cacheHits\":" + String(ingest.cacheHits) + ",";
+    float hitRate = ingest.cacheLookups > 0 ? 100.0f * ingest.cacheHits / ingest.cacheLookups : 0.0f;
+    json += "\"cacheHitRate\":" + String(hitRate, 1);
+    json += "},";
+    
+    // Scan duty cycle (ScanScheduler.h) and passive scanning name probes
+    ScanSchedulerStats scan = victronBLE->getScanStats();
+    json += "\"scan\":{";
+    json += "\"adaptive\":" + String(scan.adaptive ? "true" : "false") + ",";
+    json += "\"discovery\":" + String(scan.discovery ? "true" : "false") + ",";
+    json += "\"tracked\":" + String(scan.tracked) + ",";
+    json += "\"locked\":" + String(scan.locked) + ",";
+    json += "\"radioOnPercent\":" + String(scan.radioOnPercent, 1) + ",";
+    json += "\"windows\":" + String(scan.windows) + ",";
+    json += "\"missed\":" + String(scan.missed) + ",";
+    json += "\"missedPercent\":" + String(scan.missedPercent, 1) + ",";
+    json += "\"discoveries\":" + String(scan.discoveries) + ",";
+    json += "\"radioStarts\":" + String(scan.radioStarts) + ",";
+    json += "\"passive\":" + String(victronBLE->isPassiveScan() ? "true" : "false") + ",";
+    json += "\"nameProbes\":" + String(victronBLE->getNameProbeCount()) + ",";
+    json += "\"cachedNames\":" + String(victronBLE->getCachedNameCount());
+    json += "},";
+
+    // Deferred log ring (for sizing LOG_RING_BYTES)
+    LogStats log = logRing.getStats();
+    json += "\"log\":{";
+    json += "\"capacity\":" + String(log.capacity) + ",";
+    json += "\"highWater\":" + String(log.highWater) + ",";
+    json += "\"records\":" + String(log.records) + ",";
+    json += "\"dropped\":" + String(log.dropped);
+    json += "},";
+    
+    // Task timing (PeriodicTask.h): jitter of each task's tick against its period
+    json += "\"tasks\":[";
+    for (int i = 0; i < PeriodicTask::taskCount(); i++) {
+        const PeriodicTask* task = PeriodicTask::taskAt(i);
+        const TaskConfig& config = task->getConfig();
+        TaskTiming timing = task->getTiming();
+        if (i > 0) json += ",";
+        json += "{";
+        json += "\"name\":\"" + String(config.name) + "\",";
+        json += "\"core\":" + String((int)config.core) + ",";
+        json += "\"priority\":" + String((int)config.priority) + ",";
+        json += "\"periodMs\":" + String(config.periodMs) + ",";
+        json += "\"ticks\":" + String(timing.ticks) + ",";
+        json += "\"lateTicks\":" + String(timing.lateTicks) + ",";
+        json += "\"maxJitterUs\":" + String(timing.maxJitterUs) + ",";
+        json += "\"meanJitterUs\":" + String(timing.meanJitterUs) + ",";
+        json += "\"maxRunUs\":" + String(timing.maxRunUs);
+        json += "}";
+    }
+    json += "]}";
+    request->send(200, "application/json", json);
+}
+
+void WebConfigServer::handleGetMetrics(AsyncWebServerRequest *request) {
+    if (!victronBLE) {
+        request->send(500, "application/json", "{\"error\":\"VictronBLE not initialized\"}");
+        return;
+    }
+    
+    // Ring drops and task jitter point at CPU starvation rather than a single device
+    IngestStats ingest = victronBLE->getIngestStats();
+    String json = "{";
+    json += "\"cpuMhz\":" + String(ESP.getCpuFreqMHz()) + ",";
+    json += "\"ringDrops\":" + String(ingest.drops) + ",";
+    json += "\"ringHighWater\":" + String(ingest.highWater) + ",";
+    json += "\"parseBucketCycles\":[";
+    for (int i = 0; i < METRICS_PARSE_BUCKETS - 1; i++) {
+        if (i > 0) json += ",";
+        json += String(metricsBucketLimit(i));
+    }
+    json += "],\"devices\":[";
+    
+    // One slot at a time, so the ingest task is never held off for the whole response
+    int64_t now = esp_timer_get_time();
+    int count;
+    {
+        VictronBLE::DeviceLock lock(*victronBLE);
+        count = victronBLE->getDeviceCount();
+    }
+    for (int slot = 0; slot < count; slot++) {
+        DeviceMetrics metrics;
+        String name;
+        String address;
+        {
+            VictronBLE::IngestLock ingestLock(*victronBLE);
+            VictronBLE::DeviceLock lock(*victronBLE);
+            metrics = victronBLE->getDeviceMetrics(slot);
+            name = victronBLE->getDevices().at(slot).name;
+            address = victronBLE->getDevices().at(slot).address;
+        }
+        
+        if (slot > 0) json += ",";
+        json += "{";
+        json += "\"name\":\"" + name + "\",";
+        json += "\"address\":\"" + address + "\",";
+        json += "\"packets\":" + String(metrics.packets) + ",";
+        json += "\"packetsPerSecond\":" + String(metricsPacketRate(metrics, now), 2) + ",";
+        json += "\"lastPacketAgeMs\":" + String(metrics.packets > 0 ? (uint32_t)((now - metrics.lastPacketUs) / 1000) : 0) + ",";
+        json += "\"rssiAverage\":" + String(metrics.rssiAverageX16 / 16.0f, 1) + ",";
+        json += "\"frames\":" + String(metrics.frames) + ",";
+        json += "\"counterGaps\":" + String(metrics.counterGaps) + ",";
+        json += "\"noKey\":" + String(metrics.noKey) + ",";
+        json += "\"decryptFailures\":" + String(metrics.decryptFailures) + ",";
+        json += "\"keyMismatches\":" + String(metrics.keyMismatches) + ",";
+        json += "\"validationRejects\":" + String(metrics.validationRejects) + ",";
+        json += "\"partialPayloads\":" + String(metrics.partialPayloads) + ",";
+        json += "\"maxParseCycles\":" + String(metrics.maxParseCycles) + ",";
+        json += "\"parseHistogram\":[";
+        for (int i = 0; i < METRICS_PARSE_BUCKETS; i++) {
+            if (i > 0) json += ",";
+            json += String(metrics.parseHistogram[i]);
+        }
+        json += "]}";
+    }
+    
+    // Change bus subscribers: a growing overflow count means a consumer falls behind
+    json += "],\"changeSubscribers\":[";
+    bool first = true;
+    for (int i = 0; i < CHANGE_BUS_MAX_SUBSCRIBERS; i++) {
+        ChangeSubscriberStats stats;
+        {
+            VictronBLE::DeviceLock lock(*victronBLE);
+            stats = victronBLE->getChangeStats(i);
+        }
+        if (!stats.name) {
+            continue;
+        }
+        if (!first) json += ",";
+        first = false;
+        json += "{";
+        json += "\"name\":\"" + String(stats.name) + "\",";
+        json += "\"events\":" + String(stats.events) + ",";
+        json += "\"coalesced\":" + String(stats.coalesced) + ",";
+        json += "\"overflows\":" + String(stats.overflows) + ",";
+        json += "\"delivered\":" + String(stats.delivered);
+        json += "}";
+    }
+    json += "]";
+    
+    if (history) {
+        HistoryStats stats = history->getStats();
+        json += ",\"history\":{";
+        json += "\"psram\":" + String(stats.psram ? "true" : "false") + ",";
+        json += "\"budgetBytes\":" + String(stats.budgetBytes) + ",";
+        json += "\"blocks\":" + String(stats.blocks) + ",";
+        json += "\"blocksUsed\":" + String(stats.blocksUsed) + ",";
+        json += "\"series\":" + String(stats.series) + ",";
+        json += "\"samples\":" + String(stats.samples) + ",";
+        json += "\"appended\":" + String(stats.appended) + ",";
+        json += "\"evictedBlocks\":" + String(stats.evictedBlocks) + ",";
+        json += "\"bytesUsed\":" + String(stats.bytesUsed) + ",";
+        json += "\"bytesPerSample\":" + String(stats.bytesPerSample, 3) + ",";
+        json += "\"hoursAt1Hz\":" + String(stats.hoursAt1Hz, 1) + ",";
+        json += "\"rollupBytes\":" + String(stats.rollupBytes) + ",";
+        json += "\"rollupSeries\":" + String(stats.rollupSeries) + ",";
+        json += "\"rollupCapacity\":" + String(stats.rollupCapacity) + ",";
+        
+        // Rollup tiers persisted to LittleFS
+        json += "\"logs\":{";
+        bool firstLog = true;
+        for (uint8_t tier = 0; tier < HISTORY_TIER_COUNT; tier++) {
+            HistoryLog* log = history->getLog((HistoryTier)tier);
+            if (!log) {
+                continue;
+            }
+            HistoryLogStats logStats = log->getStats();
+            json += String(firstLog ? "" : ",") + "\"" + HistoryStore::tierName((HistoryTier)tier) + "\":{";
+            json += "\"segments\":" + String(logStats.segments) + ",";
+            json += "\"bytes\":" + String(logStats.bytes) + ",";
+            json += "\"budgetBytes\":" + String(logStats.budgetBytes) + ",";
+            json += "\"oldestTime\":" + String(logStats.oldestTime) + ",";
+            json += "\"blocksWritten\":" + String(logStats.blocksWritten) + ",";
+            json += "\"recordsWritten\":" + String(logStats.recordsWritten) + ",";
+            json += "\"buffered\":" + String(logStats.buffered) + ",";
+            json += "\"dropped\":" + String(logStats.dropped) + ",";
+            json += "\"errors\":" + String(logStats.errors) + ",";
+            json += "\"recoveredRecords\":" + String(logStats.recoveredRecords) + ",";
+            json += "\"tornBytes\":" + String(logStats.tornBytes);
+            json += "}";
+            firstLog = false;
+        }
+        json += "}}";
+    }
+    json += "}";
+    request->send(200, "application/json", json);
+}
+
+// GET /api/history?address=<mac>&metric=<name>[&from=<s>][&to=<s>][&resolution=raw|1m|15m|1h]
+// Times are HistoryStore::now() seconds; the default range is the last hour. Without a
+// resolution the finest one that fits the range in HISTORY_QUERY_MAX_POINTS is used,
+// so long ranges are read from a rollup tier. Raw points are [time, value], rollup
+// points [start, mean, min, max, last, count]. A truncated answer continues with from
+// set to the last point's time + 1.
+void WebConfigServer::handleGetHistory(AsyncWebServerRequest *request) {
+    if (!history) {
+        request->send(500, "application/json", "{\"error\":\"History not initialized\"}");
+        return;
+    }
+    
+    uint8_t mac[6];
+    HistoryMetric metric;
+    if (!request->hasParam("address") || !AdvertisementFilter::parseAddress(request->getParam("address")->value(), mac)) {
+        request->send(400, "application/json", "{\"error\":\"Invalid address\"}");
+        return;
+    }
+    if (!request->hasParam("metric") || !HistoryStore::metricFromName(request->getParam("metric")->value(), metric)) {
+        request->send(400, "application/json", "{\"error\":\"Invalid metric\"}");
+        return;
+    }
+    uint32_t now = HistoryStore::now();
+    uint32_t to = request->hasParam("to") ? (uint32_t)request->getParam("to")->value().toInt() : now;
+    uint32_t from = request->hasParam("from") ? (uint32_t)request->getParam("from")->value().toInt()
+                                              : (to > 3600 ? to - 3600 : 0);
+    HistoryTier resolution = HistoryStore::resolutionFor(from, to, HISTORY_QUERY_MAX_POINTS);
+    if (request->hasParam("resolution") && request->getParam("resolution")->value() != "auto" &&
+        !HistoryStore::tierFromName(request->getParam("resolution")->value(), resolution)) {
+        request->send(400, "application/json", "{\"error\":\"Invalid resolution\"}");
+        return;
+    }
+    
+    uint64_t device = AdvertisementFilter::addressKey(mac);
+    std::vector<HistoryPoint> points;
+    std::vector<HistoryBucket> buckets;
+    bool complete;
+    if (resolution == HISTORY_TIER_RAW) {
+        points.reserve(HISTORY_QUERY_MAX_POINTS);
+        complete = history->query(device, metric, from, to, points, HISTORY_QUERY_MAX_POINTS);
+    } else {
+        buckets.reserve(HISTORY_QUERY_MAX_POINTS);
+        complete = history->queryRollup(device, metric, resolution, from, to, buckets, HISTORY_QUERY_MAX_POINTS);
+    }
+    
+    String json = "{";
+    json += "\"metric\":\"" + String(HistoryStore::metricName(metric)) + "\",";
+    json += "\"resolution\":\"" + String(HistoryStore::tierName(resolution)) + "\",";
+    json += "\"now\":" + String(now) + ",";
+    json += "\"truncated\":" + String(complete ? "false" : "true") + ",";
+    json += "\"points\":[";
+    for (size_t i = 0; i < points.size(); i++) {
+        if (i > 0) json += ",";
+        json += "[" + String(points[i].time) + "," + String(points[i].value, 3) + "]";
+    }
+    for (size_t i = 0; i < buckets.size(); i++) {
+        const HistoryBucket& bucket = buckets[i];
+        if (i > 0) json += ",";
+        json += "[" + String(bucket.start) + "," + String(bucket.mean, 3) + "," + String(bucket.min, 3) + "," +
+                String(bucket.max, 3) + "," + String(bucket.last, 3) + "," + String(bucket.count) + "]";
+    }
     json += "]}";
     request->send(200, "application/json", json);
 }
@@ -659,12 +1004,115 @@ void WebConfigServer::handleSetMQTTConfig(AsyncWebServerRequest *request) {
     }
 }
 
+// Reboot flag shared with the LCD configuration below (defined in main.cpp)
+extern bool pendingReboot;
+extern unsigned long rebootScheduledTime;
+
 void WebConfigServer::handleRestart(AsyncWebServerRequest *request) {
     request->send(200, "application/json", "{\"success\":true,\"message\":\"Restarting...\"}");
-    // Delay is intentional here to allow the HTTP response to complete
-    // before restart. This is acceptable for a restart endpoint.
-    delay(1000);
-    ESP.restart();
+    // The UI task restarts after REBOOT_DELAY, which lets the response complete and the
+    // history logs be written first
+    rebootScheduledTime = millis();
+    pendingReboot = true;
+}
+
+void WebConfigServer::handleGetCapture(AsyncWebServerRequest *request) {
+    if (!capture || !captureReplay) {
+        request->send(500, "application/json", "{\"error\":\"Capture not initialized\"}");
+        return;
+    }
+    
+    CaptureStats stats = capture->getStats();
+    String json = "{\"recording\":" + String(stats.recording ? "true" : "false") + ",";
+    json += "\"records\":" + String(stats.records) + ",";
+    json += "\"bytes\":" + String(stats.bytes) + ",";
+    json += "\"fileBytes\":" + String(stats.fileBytes) + ",";
+    json += "\"maxBytes\":" + String(stats.maxBytes) + ",";
+    json += "\"rotations\":" + String(stats.rotations) + ",";
+    json += "\"errors\":" + String(stats.errors) + ",";
+    json += "\"files\":[";
+    bool first = true;
+    const String* paths[] = { &capture->getRotatedPath(), &capture->getPath() };
+    for (int i = 0; i < 2; i++) {
+        if (filesystemMounted && LittleFS.exists(*paths[i])) {
+            if (!first) json += ",";
+            json += "\"" + *paths[i] + "\"";
+            first = false;
+        }
+    }
+    json += "],";
+    
+    CaptureReplayStats replay = captureReplay->getStats();
+    json += "\"replay\":{";
+    json += "\"active\":" + String(replay.active ? "true" : "false") + ",";
+    json += "\"mode\":\"" + String(replay.mode == REPLAY_FAST ? "fast" : "realtime") + "\",";
+    json += "\"replayed\":" + String(replay.replayed) + ",";
+    json += "\"corrupt\":" + String(replay.corrupt) + ",";
+    int64_t endUs = replay.finishedUs != 0 ? replay.finishedUs : esp_timer_get_time();
+    json += "\"elapsedMs\":" + String(replay.startedUs != 0 ? (unsigned long)((endUs - replay.startedUs) / 1000) : 0UL);
+    json += "}}";
+    request->send(200, "application/json", json);
+}
+
+void WebConfigServer::handleSetCapture(AsyncWebServerRequest *request) {
+    if (!capture || !captureReplay) {
+        request->send(500, "application/json", "{\"error\":\"Capture not initialized\"}");
+        return;
+    }
+    if (!filesystemMounted) {
+        request->send(500, "application/json", "{\"success\":false,\"error\":\"Filesystem not mounted\"}");
+        return;
+    }
+    if (!request->hasParam("action", true)) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Missing action\"}");
+        return;
+    }
+    
+    // start/stop record; replay feeds the capture back through the parser (mode=fast|realtime).
+    // Both are applied by the main loop, so the request returns before they take effect.
+    String action = request->getParam("action", true)->value();
+    if (action == "start") {
+        if (captureReplay->isActive()) {
+            request->send(409, "application/json", "{\"success\":false,\"error\":\"Replay in progress\"}");
+            return;
+        }
+        capture->start();
+    } else if (action == "stop") {
+        capture->stop();
+    } else if (action == "replay") {
+        if (capture->isRecording()) {
+            request->send(409, "application/json", "{\"success\":false,\"error\":\"Stop recording first\"}");
+            return;
+        }
+        bool fast = request->hasParam("mode", true) && request->getParam("mode", true)->value() == "fast";
+        captureReplay->start(capture->getPath(), fast ? REPLAY_FAST : REPLAY_REALTIME);
+    } else if (action == "stopReplay") {
+        captureReplay->stop();
+    } else {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"Unknown action\"}");
+        return;
+    }
+    request->send(200, "application/json", "{\"success\":true}");
+}
+
+void WebConfigServer::handleDownloadCapture(AsyncWebServerRequest *request) {
+    if (!capture || !filesystemMounted) {
+        request->send(500, "text/plain", "Capture not available");
+        return;
+    }
+    if (capture->isRecording()) {
+        request->send(409, "text/plain", "Stop recording before downloading the capture");
+        return;
+    }
+    
+    // part=1 is the older, rotated file
+    bool rotated = request->hasParam("part") && request->getParam("part")->value() == "1";
+    const String& path = rotated ? capture->getRotatedPath() : capture->getPath();
+    if (!LittleFS.exists(path)) {
+        request->send(404, "text/plain", "No capture");
+        return;
+    }
+    request->send(LittleFS, path, "application/octet-stream");
 }
 
 
@@ -676,7 +1124,7 @@ void WebConfigServer::saveWiFiConfig() {
     preferences.putBool("apMode", wifiConfig.apMode);
     preferences.putString("apPassword", wifiConfig.apPassword);
     preferences.end();
-    Serial.println("WiFi config saved");
+    LOG_I(WEB, "WiFi config saved\n");
 }
 
 void WebConfigServer::loadWiFiConfig() {
@@ -686,7 +1134,7 @@ void WebConfigServer::loadWiFiConfig() {
     wifiConfig.apMode = preferences.getBool("apMode", true);
     wifiConfig.apPassword = preferences.getString("apPassword", "victron123");
     preferences.end();
-    Serial.println("WiFi config loaded");
+    LOG_I(WEB, "WiFi config loaded\n");
 }
 
 void WebConfigServer::saveDeviceConfigs() {
@@ -702,7 +1150,7 @@ void WebConfigServer::saveDeviceConfigs() {
     }
     
     preferences.end();
-    Serial.println("Device configs saved");
+    LOG_I(WEB, "Device configs saved\n");
 }
 
 void WebConfigServer::loadDeviceConfigs() {
@@ -724,7 +1172,7 @@ void WebConfigServer::loadDeviceConfigs() {
     }
     
     preferences.end();
-    Serial.printf("Loaded %d device configs\n", deviceConfigs.size());
+    LOG_I(WEB, "Loaded %u device configs\n", (unsigned)deviceConfigs.size());
     
     // Sync encryption keys to VictronBLE instance if available
     syncEncryptionKeys();
@@ -752,6 +1200,7 @@ void WebConfigServer::addDeviceConfig(const DeviceConfig& config) {
             deviceConfigs[i] = config;
             saveDeviceConfigs();
             syncSingleEncryptionKey(config);
+            syncDeviceAllowlist();
             return;
         }
     }
@@ -760,6 +1209,7 @@ void WebConfigServer::addDeviceConfig(const DeviceConfig& config) {
     deviceConfigs.push_back(config);
     saveDeviceConfigs();
     syncSingleEncryptionKey(config);
+    syncDeviceAllowlist();
 }
 
 void WebConfigServer::updateDeviceConfig(const String& address, const DeviceConfig& config) {
@@ -768,6 +1218,7 @@ void WebConfigServer::updateDeviceConfig(const String& address, const DeviceConf
             deviceConfigs[i] = config;
             saveDeviceConfigs();
             syncSingleEncryptionKey(config);
+            syncDeviceAllowlist();
             return;
         }
     }
@@ -778,6 +1229,7 @@ void WebConfigServer::removeDeviceConfig(const String& address) {
         if (deviceConfigs[i].address.equalsIgnoreCase(address)) {
             deviceConfigs.erase(deviceConfigs.begin() + i);
             saveDeviceConfigs();
+            syncDeviceAllowlist();
             // Note: We don't remove the encryption key from VictronBLE as it's harmless to keep it
             return;
         }
@@ -793,15 +1245,30 @@ void WebConfigServer::syncEncryptionKeys() {
     for (const auto& config : deviceConfigs) {
         syncSingleEncryptionKey(config);
     }
+    syncDeviceAllowlist();
 }
 
 void WebConfigServer::syncSingleEncryptionKey(const DeviceConfig& config) {
     if (victronBLE && !config.encryptionKey.isEmpty()) {
         victronBLE->setEncryptionKey(config.address, config.encryptionKey);
-        Serial.printf("Synced encryption key for device %s\n", config.address.c_str());
+        LOG_I(WEB, "Synced encryption key for device %s\n", config.address.c_str());
     }
 }
 
+void WebConfigServer::syncDeviceAllowlist() {
+    if (!victronBLE) {
+        return;
+    }
+    
+    std::vector<String> addresses;
+    for (const auto& config : deviceConfigs) {
+        if (config.enabled) {
+            addresses.push_back(config.address);
+        }
+    }
+    victronBLE->setAllowedAddresses(addresses);
+}
+
 // WiFi info methods
 String WebConfigServer::getIPAddress() {
     if (wifiConfig.apMode) {
@@ -921,8 +1388,6 @@ extern String lcdOrientation;
 extern bool lcdAutoScroll;
 extern int largeDisplayTimeout;
 extern void saveLCDConfig();
-extern bool pendingReboot;
-extern unsigned long rebootScheduledTime;
 extern const unsigned long REBOOT_DELAY;
 
 void WebConfigServer::handleGetLCDConfig(AsyncWebServerRequest *request) {
@@ -3,7 +3,6 @@
 #include <vector>
 #include <Preferences.h>
 // #include <ArduinoOTA.h>  // ArduinoOTA disabled/commented out
-#include "NoDebug.h"
 
 // Add the project headers that define the classes/types used below.
 // Adjust filenames if your headers use different names/paths.
@@ -11,32 +10,58 @@
 #include "EcoWorthyBMS.h"
 #include "WebConfigServer.h"
 #include "MQTTPublisher.h"
+#include "AdvertisementCapture.h"
+#include "HistoryStore.h"
+#include "HistoryLog.h"
+#include "DeferredLog.h"
+#include "PeriodicTask.h"
 
 // change globals to pointers to avoid constructor-side effects
 VictronBLE *victron = nullptr;
 EcoWorthyBMS *ecoWorthy = nullptr;
 WebConfigServer *webServer = nullptr;
 MQTTPublisher *mqttPublisher = nullptr;
+AdvertisementCapture *capture = nullptr;
+CaptureReplay *captureReplay = nullptr;
+HistoryStore *history = nullptr;
+HistoryLog *quarterLog = nullptr;   // 15 min rollups on LittleFS
+HistoryLog *hourLog = nullptr;      // 1 h rollups on LittleFS
 
-// Reboot flag for orientation changes
+// Ingest, display and network run on their own pinned tasks (PeriodicTask.h), started
+// at the end of setup(). Display and network only read devices from VictronBLE's
+// snapshot, under a VictronBLE::DeviceLock; a stalled broker or GATT connection
+// therefore holds up neither the parser nor the screen.
+PeriodicTask bleTask;
+PeriodicTask uiTask;
+PeriodicTask netTask;
+
+// Reboot flag for orientation changes and /api/restart
 bool pendingReboot = false;
 unsigned long rebootScheduledTime = 0;
 const unsigned long REBOOT_DELAY = 2000;  // 2 seconds delay before reboot
+const uint32_t REBOOT_NET_STOP_TIMEOUT = 200;  // ms; a tick stuck in a broker connect is not waited out
 
-std::vector<String> deviceAddresses;
+std::vector<String> deviceAddresses;  // UI task; others read it under a DeviceLock
 int currentDeviceIndex = 0;
-unsigned long lastScanTime = 0;
+unsigned long lastDeviceListUpdate = 0;
+unsigned long lastEcoWorthyPoll = 0;
 unsigned long lastDisplayUpdate = 0;
+unsigned long lastDisplayRedraw = 0;  // Last periodic redraw; skipped while the shown device is unchanged
+int displaySubscriber = -1;  // Change events for the device on screen
+bool shownDeviceChanged = false;  // An event for the shown device arrived since the last redraw
 unsigned long lastDeviceSwitch = 0;  // Track when device was last switched
 unsigned long lastButtonPressTime = 0;  // For debouncing
 unsigned long lastVerticalScroll = 0;  // Track when vertical scroll last occurred
-const unsigned long SCAN_INTERVAL = 30000;  // Scan every 30 seconds
+unsigned long lastHistorySample = 0;
+const unsigned long DEVICE_LIST_INTERVAL = 2000;  // Refresh configured device list every 2 seconds
+const unsigned long ECO_WORTHY_POLL_INTERVAL = 30000;  // Read Eco Worthy BMS over GATT every 30 seconds
 const unsigned long DISPLAY_UPDATE_INTERVAL = 1000;  // Update display every second
+const unsigned long DISPLAY_REFRESH_INTERVAL = 5000;  // Redraw at least this often (RSSI) while values are stable
 const unsigned long BUTTON_DEBOUNCE = 500;  // Debounce period in ms
 const unsigned long LONG_PRESS_DURATION = 1000;  // Long press duration in ms
 const unsigned long VERTICAL_SCROLL_INTERVAL = 3000;  // Scroll vertically every 3 seconds
 
-bool scanning = false;
+bool pollingEcoWorthy = false;
 bool webConfigMode = false;  // Toggle between normal mode and web config display
 bool largeDisplayMode = false;  // Toggle for large display mode (voltage, current, SOC only)
 bool largeDisplayJustEntered = false;  // Track when we just entered large display mode to reset cache
@@ -53,9 +78,11 @@ Preferences buzzerPreferences;
 bool buzzerEnabled = true;
 float buzzerThreshold = 10.0;  // Default 10% battery SOC
 bool buzzerAlarmActive = false;
-unsigned long lastBuzzerCheck = 0;
+int alarmSubscriber = -1;  // SOC change events; the alarm is re-checked on each one
+bool lastAlarmEnabled = false;  // Settings and device count as of the last check
+float lastAlarmThreshold = -1.0;
+size_t lastAlarmDevices = 0;
 unsigned long lastBuzzerBeep = 0;
-const unsigned long BUZZER_CHECK_INTERVAL = 5000;  // Check every 5 seconds
 const unsigned long BUZZER_BEEP_INTERVAL = 200;  // Beep duration/interval in ms
 const int BUZZER_FREQUENCY = 2000;  // Buzzer frequency in Hz
 int buzzerBeepCount = 0;
@@ -76,6 +103,8 @@ unsigned long lastUserInteraction = 0;  // Track last user button press for time
 
 // Forward declarations
 void updateDeviceList();
+bool copyShownDevice(VictronDeviceData& shown);
+VictronDeviceType shownDeviceType();
 void drawDisplay();
 void drawLargeDisplay();
 void loadBuzzerConfig();
@@ -86,13 +115,17 @@ void loadLCDConfig();
 void saveLCDConfig();
 void checkBatteryAlarm();
 void handleBuzzerBeep();
+void pollEcoWorthy();
+void bleTick(void* context);
+void uiTick(void* context);
+void netTick(void* context);
 
 void loadBuzzerConfig() {
     buzzerPreferences.begin("buzzer", true);  // read-only
     buzzerEnabled = buzzerPreferences.getBool("enabled", true);
     buzzerThreshold = buzzerPreferences.getFloat("threshold", 10.0);
     buzzerPreferences.end();
-    Serial.printf("Buzzer config loaded: enabled=%d, threshold=%.1f%%\n", buzzerEnabled, buzzerThreshold);
+    LOG_I(MAIN, "Buzzer config loaded: enabled=%d, threshold=%.1f%%\n", buzzerEnabled, buzzerThreshold);
 }
 
 void saveBuzzerConfig() {
@@ -100,21 +133,21 @@ void saveBuzzerConfig() {
     buzzerPreferences.putBool("enabled", buzzerEnabled);
     buzzerPreferences.putFloat("threshold", buzzerThreshold);
     buzzerPreferences.end();
-    Serial.printf("Buzzer config saved: enabled=%d, threshold=%.1f%%\n", buzzerEnabled, buzzerThreshold);
+    LOG_I(MAIN, "Buzzer config saved: enabled=%d, threshold=%.1f%%\n", buzzerEnabled, buzzerThreshold);
 }
 
 void loadDataRetentionConfig() {
     dataPreferences.begin("victron-data", true);  // read-only
     retainLastData = dataPreferences.getBool("retainLast", true);
     dataPreferences.end();
-    Serial.printf("Data retention config loaded: retainLastData=%d\n", retainLastData);
+    LOG_I(MAIN, "Data retention config loaded: retainLastData=%d\n", retainLastData);
 }
 
 void saveDataRetentionConfig() {
     dataPreferences.begin("victron-data", false);  // read-write
     dataPreferences.putBool("retainLast", retainLastData);
     dataPreferences.end();
-    Serial.printf("Data retention config saved: retainLastData=%d\n", retainLastData);
+    LOG_I(MAIN, "Data retention config saved: retainLastData=%d\n", retainLastData);
 }
 
 void loadLCDConfig() {
@@ -125,8 +158,8 @@ void loadLCDConfig() {
     lcdAutoScroll = lcdPreferences.getBool("autoScroll", true);
     largeDisplayTimeout = lcdPreferences.getInt("largeTimeout", 60);
     lcdPreferences.end();
-    Serial.printf("LCD config loaded: fontSize=%d, scrollRate=%d, orientation=%s, autoScroll=%d, largeTimeout=%d\n", 
-                  lcdFontSize, lcdScrollRate, lcdOrientation.c_str(), lcdAutoScroll, largeDisplayTimeout);
+    LOG_I(MAIN, "LCD config loaded: fontSize=%d, scrollRate=%d, orientation=%s, autoScroll=%d, largeTimeout=%d\n", 
+                lcdFontSize, lcdScrollRate, lcdOrientation.c_str(), lcdAutoScroll, largeDisplayTimeout);
 }
 
 void saveLCDConfig() {
@@ -137,10 +170,11 @@ void saveLCDConfig() {
     lcdPreferences.putBool("autoScroll", lcdAutoScroll);
     lcdPreferences.putInt("largeTimeout", largeDisplayTimeout);
     lcdPreferences.end();
-    Serial.printf("LCD config saved: fontSize=%d, scrollRate=%d, orientation=%s, autoScroll=%d, largeTimeout=%d\n", 
-                  lcdFontSize, lcdScrollRate, lcdOrientation.c_str(), lcdAutoScroll, largeDisplayTimeout);
+    LOG_I(MAIN, "LCD config saved: fontSize=%d, scrollRate=%d, orientation=%s, autoScroll=%d, largeTimeout=%d\n", 
+                lcdFontSize, lcdScrollRate, lcdOrientation.c_str(), lcdAutoScroll, largeDisplayTimeout);
 }
 
+// Caller holds a DeviceLock
 void checkBatteryAlarm() {
     if (!buzzerEnabled) {
         buzzerAlarmActive = false;
@@ -155,7 +189,7 @@ void checkBatteryAlarm() {
         if (device && device->hasSOC && device->dataValid) {
             if (device->batterySOC < buzzerThreshold && device->batterySOC >= 0) {
                 alarmCondition = true;
-                Serial.printf("Battery alarm triggered: %s at %.1f%% (threshold: %.1f%%)\n", 
+                LOG_W(MAIN, "Battery alarm triggered: %s at %.1f%% (threshold: %.1f%%)\n", 
                     device->name.c_str(), device->batterySOC, buzzerThreshold);
                 break;
             }
@@ -166,7 +200,7 @@ void checkBatteryAlarm() {
     if (alarmCondition && !buzzerAlarmActive) {
         buzzerAlarmActive = true;
         buzzerBeepCount = 0;  // Start beep sequence
-        Serial.println("Battery alarm activated");
+        LOG_W(MAIN, "Battery alarm activated\n");
     } else if (!alarmCondition) {
         buzzerAlarmActive = false;
         buzzerBeepCount = 0;
@@ -185,7 +219,7 @@ void handleBuzzerBeep() {
         if (buzzerBeepCount % 2 == 0) {
             // Even count: start beep
             M5.Speaker.tone(BUZZER_FREQUENCY, BUZZER_BEEP_INTERVAL);
-            Serial.printf("Beep %d/3\n", (buzzerBeepCount / 2) + 1);
+            LOG_D(MAIN, "Beep %d/3\n", (buzzerBeepCount / 2) + 1);
         }
         buzzerBeepCount++;
         lastBuzzerBeep = currentTime;
@@ -195,34 +229,39 @@ void handleBuzzerBeep() {
 void setup() {
     Serial.begin(115200);
     delay(200);
-    Serial.println("STARTUP: Serial ready");
+    LOG_I(MAIN, "STARTUP: Serial ready\n");
 
-    Serial.println("STARTUP: calling M5.begin()");
+    LOG_I(MAIN, "STARTUP: calling M5.begin()\n");
     M5.begin();
-    Serial.println("STARTUP: M5.begin() returned");
+    LOG_I(MAIN, "STARTUP: M5.begin() returned\n");
     
     // Initialize user interaction timestamp
     lastUserInteraction = millis();
     
     // Load buzzer configuration
-    Serial.println("STARTUP: loading buzzer config");
+    LOG_I(MAIN, "STARTUP: loading buzzer config\n");
     loadBuzzerConfig();
     
     // Load data retention configuration
-    Serial.println("STARTUP: loading data retention config");
+    LOG_I(MAIN, "STARTUP: loading data retention config\n");
     loadDataRetentionConfig();
     
     // Load LCD display configuration
-    Serial.println("STARTUP: loading LCD config");
+    LOG_I(MAIN, "STARTUP: loading LCD config\n");
     loadLCDConfig();
 
     // instantiate objects (no heavy init in constructors)
-    Serial.println("STARTUP: new VictronBLE/EcoWorthyBMS/WebConfigServer/MQTTPublisher");
+    LOG_I(MAIN, "STARTUP: new VictronBLE/EcoWorthyBMS/WebConfigServer/MQTTPublisher\n");
     victron = new VictronBLE();
     ecoWorthy = new EcoWorthyBMS();
     webServer = new WebConfigServer();
     mqttPublisher = new MQTTPublisher();
-    Serial.println("STARTUP: allocations done");
+    capture = new AdvertisementCapture();
+    captureReplay = new CaptureReplay();
+    history = new HistoryStore();
+    quarterLog = new HistoryLog();
+    hourLog = new HistoryLog();
+    LOG_I(MAIN, "STARTUP: allocations done\n");
 
     // Basic display sanity test
     if (lcdOrientation == "portrait") {
@@ -241,32 +280,66 @@ void setup() {
     delay(500);
 
     // Try enabling Victron BLE first (needed by other components)
-    Serial.println("STARTUP: attempting victron->begin()");
+    LOG_I(MAIN, "STARTUP: attempting victron->begin()\n");
+    logRing.flush(Serial);      // Startup is not time-critical; a hang still shows the last step
     victron->begin();
-    Serial.println("STARTUP: victron->begin() returned");
+    LOG_I(MAIN, "STARTUP: victron->begin() returned\n");
     
     // Initialize Eco Worthy BMS (uses same NimBLE stack)
-    Serial.println("STARTUP: attempting ecoWorthy->begin()");
+    LOG_I(MAIN, "STARTUP: attempting ecoWorthy->begin()\n");
+    logRing.flush(Serial);
     ecoWorthy->begin();
-    Serial.println("STARTUP: ecoWorthy->begin() returned");
+    LOG_I(MAIN, "STARTUP: ecoWorthy->begin() returned\n");
     
     // Apply data retention setting to VictronBLE
     victron->setRetainLastData(retainLastData);
     
     // Initialize MQTT publisher with VictronBLE reference
-    Serial.println("STARTUP: attempting mqttPublisher->begin()");
+    LOG_I(MAIN, "STARTUP: attempting mqttPublisher->begin()\n");
+    logRing.flush(Serial);
     mqttPublisher->begin(victron);
-    Serial.println("STARTUP: mqttPublisher->begin() returned");
+    LOG_I(MAIN, "STARTUP: mqttPublisher->begin() returned\n");
+    
+    // The UI task redraws and checks the alarm on change events rather than on a timer
+    displaySubscriber = victron->subscribeChanges("display", CHANGE_ALL);
+    alarmSubscriber = victron->subscribeChanges("alarm", CHANGE_BIT(CHANGE_SOC) | CHANGE_BIT(CHANGE_DATA_VALID));
     
     // Initialize web server with references to other components
-    Serial.println("STARTUP: setting up webServer references");
+    LOG_I(MAIN, "STARTUP: setting up webServer references\n");
     webServer->setVictronBLE(victron);
     webServer->setMQTTPublisher(mqttPublisher);
+    webServer->setCapture(capture, captureReplay);
+    webServer->setHistory(history);
     
     // Initialize web server (WiFi + HTTP server)
-    Serial.println("STARTUP: attempting webServer->begin()");
+    LOG_I(MAIN, "STARTUP: attempting webServer->begin()\n");
+    logRing.flush(Serial);
     webServer->begin();
-    Serial.println("STARTUP: webServer->begin() returned");
+    LOG_I(MAIN, "STARTUP: webServer->begin() returned\n");
+    
+    // Advertisement capture/replay (controlled from /api/capture); needs LittleFS,
+    // which webServer->begin() mounts
+    capture->begin(LittleFS);
+    captureReplay->begin(LittleFS, victron);
+    victron->setCapture(capture);
+    
+    // Reading history (/api/history): PSRAM when the board has it, else a small heap pool.
+    // The 15 min and 1 h rollups are kept on LittleFS as well; the sample clock starts
+    // after the newest bucket logged before this boot so the logged ones are never reopened.
+    quarterLog->begin(LittleFS, "/history/15m", HISTORY_LOG_QUARTER_BUDGET);
+    hourLog->begin(LittleFS, "/history/1h", HISTORY_LOG_HOUR_BUDGET);
+    uint32_t clockBase = 0;
+    if (quarterLog->getStats().segments > 0) {
+        clockBase = quarterLog->getLastTime() + HistoryStore::tierSeconds(HISTORY_TIER_QUARTER);
+    }
+    if (hourLog->getStats().segments > 0 &&
+        hourLog->getLastTime() + HistoryStore::tierSeconds(HISTORY_TIER_HOUR) > clockBase) {
+        clockBase = hourLog->getLastTime() + HistoryStore::tierSeconds(HISTORY_TIER_HOUR);
+    }
+    HistoryStore::setClockBase(clockBase);
+    history->setLog(HISTORY_TIER_QUARTER, quarterLog);
+    history->setLog(HISTORY_TIER_HOUR, hourLog);
+    history->begin();
 
     // Initialize ArduinoOTA for over-the-air firmware updates
     // Serial.println("STARTUP: initializing ArduinoOTA");
@@ -350,19 +423,33 @@ void setup() {
     //     Serial.println(WiFi.localIP());
     // }
 
-    Serial.println("STARTUP: doing a short scan to populate devices");
-    victron->scan(2);            // short scan
-    updateDeviceList();
-
+    // Start continuous scanning - advertisements are parsed in loop() as they arrive
+    LOG_I(MAIN, "STARTUP: starting continuous BLE scan\n");
+    victron->startScanning();
+    {
+        VictronBLE::DeviceLock lock(*victron);
+        updateDeviceList();
+    }
     if (!deviceAddresses.empty()) {
         drawDisplay();
     } else {
-        Serial.println("STARTUP: no devices found yet - showing basic screen");
+        LOG_I(MAIN, "STARTUP: no devices found yet - showing basic screen\n");
     }
 
-    // Leave setup so loop() runs normally (do NOT block here)
+    logRing.flush(Serial);
+
+    // From here on everything runs on the three tasks; the network task prints the log
+    const TaskConfig bleConfig = {"ble", BLE_TASK_STACK, BLE_TASK_PRIORITY, BLE_TASK_CORE, BLE_TASK_PERIOD_MS};
+    const TaskConfig uiConfig = {"ui", UI_TASK_STACK, UI_TASK_PRIORITY, UI_TASK_CORE, UI_TASK_PERIOD_MS};
+    const TaskConfig netConfig = {"net", NET_TASK_STACK, NET_TASK_PRIORITY, NET_TASK_CORE, NET_TASK_PERIOD_MS};
+    if (!bleTask.start(bleConfig, bleTick, nullptr) || !uiTask.start(uiConfig, uiTick, nullptr) ||
+        !netTask.start(netConfig, netTick, nullptr)) {
+        LOG_E(MAIN, "ERROR: Failed to start the BLE, UI and network tasks\n");
+        logRing.flush(Serial);
+    }
 }
 
+// Caller holds a DeviceLock
 void updateDeviceList() {
     deviceAddresses.clear();
     auto& devices = victron->getDevices();
@@ -371,17 +458,17 @@ void updateDeviceList() {
     auto& configuredDevices = webServer->getDeviceConfigs();
     
     // Only add devices that are configured and enabled
-    for (auto& pair : devices) {
+    for (const VictronDeviceData& device : devices) {
         bool isConfigured = false;
         for (const auto& config : configuredDevices) {
-            if (config.address.equalsIgnoreCase(pair.first) && config.enabled) {
+            if (config.address.equalsIgnoreCase(device.address) && config.enabled) {
                 isConfigured = true;
                 break;
             }
         }
         
         if (isConfigured) {
-            deviceAddresses.push_back(pair.first);
+            deviceAddresses.push_back(device.address);
         }
     }
     
@@ -390,6 +477,32 @@ void updateDeviceList() {
     }
 }
 
+// Copy of the device on screen, so the paint that follows does not hold the snapshot
+// lock (publishSnapshot() and the web handlers wait on it). False if there is none.
+bool copyShownDevice(VictronDeviceData& shown) {
+    VictronBLE::DeviceLock lock(*victron);
+    if (deviceAddresses.empty()) {
+        return false;
+    }
+    VictronDeviceData* device = victron->getDevice(deviceAddresses[currentDeviceIndex]);
+    if (!device) {
+        return false;
+    }
+    shown = *device;
+    return true;
+}
+
+// Type of the device on screen (DEVICE_UNKNOWN if there is none)
+VictronDeviceType shownDeviceType() {
+    VictronBLE::DeviceLock lock(*victron);
+    if (deviceAddresses.empty()) {
+        return DEVICE_UNKNOWN;
+    }
+    VictronDeviceData* device = victron->getDevice(deviceAddresses[currentDeviceIndex]);
+    return device ? device->type : DEVICE_UNKNOWN;
+}
+
+// Takes the DeviceLock itself while copying the device: call it without one
 void drawDisplay() {
     // Check if we're in large display mode
     if (largeDisplayMode) {
@@ -434,15 +547,11 @@ void drawDisplay() {
         return;
     }
     
-    if (deviceAddresses.empty()) {
-        return;
-    }
-    
-    VictronDeviceData* device = victron->getDevice(deviceAddresses[currentDeviceIndex]);
-    
-    if (!device) {
+    VictronDeviceData shown;
+    if (!copyShownDevice(shown)) {
         return;
     }
+    VictronDeviceData* device = &shown;
     
     // Calculate layout constants early so they are available when handling device/scroll changes
     const int TITLE_FONT_SIZE = 1;  // Keep title font size constant
@@ -1045,15 +1154,11 @@ void drawLargeDisplay() {
     // Large display mode: Show only Voltage, Current, and Battery SOC in large font
     // This mode is designed for SmartShunt devices, but will work with any device that has the data
     
-    if (deviceAddresses.empty()) {
-        return;
-    }
-    
-    VictronDeviceData* device = victron->getDevice(deviceAddresses[currentDeviceIndex]);
-    
-    if (!device) {
+    VictronDeviceData shown;
+    if (!copyShownDevice(shown)) {
         return;
     }
+    VictronDeviceData* device = &shown;
     
     // Track if this is a new device to force full redraw
     static String lastDeviceAddress = "";
@@ -1204,15 +1309,60 @@ void drawLargeDisplay() {
 }
 
 void loop() {
+    // Nothing left for the Arduino loop task: bleTick, uiTick and netTick do the work
+    vTaskDelete(nullptr);
+}
+
+// Ingest task: parse what the scan delivered and publish the snapshot. The capture
+// shares its buffer with VictronBLE::loop(), so it is flushed on this task as well.
+void bleTick(void* context) {
+    (void)context;
+    victron->loop();
+    capture->loop();
+    captureReplay->loop();
+}
+
+// Network task: everything that may block for seconds
+void netTick(void* context) {
+    (void)context;
+    mqttPublisher->loop();
+    pollEcoWorthy();
+    
+    // Closed history buckets, one flash write per full block or HISTORY_LOG_FLUSH_INTERVAL
+    quarterLog->loop();
+    hourLog->loop();
+    
+    // Print queued log records, only as much as the UART takes without waiting
+    logRing.drain(Serial);
+}
+
+// Display task: buttons, screen and alarm, all reading the device snapshot
+void uiTick(void* context) {
+    (void)context;
     M5.update();
     unsigned long currentTime = millis();
     
-    // Check for pending reboot (from orientation change)
+    // Check for pending reboot (orientation change or /api/restart)
     if (pendingReboot && (currentTime - rebootScheduledTime > REBOOT_DELAY)) {
-        Serial.println("Rebooting due to orientation change...");
+        LOG_I(MAIN, "Rebooting...\n");
+        bool netStopped = netTask.stop(REBOOT_NET_STOP_TIMEOUT);
+        
+        // This task is the only one recording: the open buckets are final. The logs
+        // lock their own flash access, so a net tick still running does not matter.
+        history->closeBuckets();
+        quarterLog->flush();
+        hourLog->flush();
+        
+        // The net task reads the log ring; flush it here only if that task has finished
+        if (netStopped) {
+            logRing.flush(Serial);
+        }
         ESP.restart();
     }
     
+    // Device reads below hold the snapshot still only while they read; drawDisplay()
+    // paints from its own copy, so no LCD drawing happens under the lock
+    
     // Handle ArduinoOTA updates
     // ArduinoOTA.handle();
     
@@ -1242,25 +1392,24 @@ void loop() {
         // Check if this is a double press
         if (waitingForDoublePress && (currentTime - lastButtonClickTime < DOUBLE_PRESS_INTERVAL)) {
             // Double press detected - toggle large display mode
-            Serial.println("Double press detected - toggling large display mode");
+            LOG_I(MAIN, "Double press detected - toggling large display mode\n");
             waitingForDoublePress = false;
             
             // Exit large mode if already in it
             if (largeDisplayMode) {
                 largeDisplayMode = false;
                 M5.Lcd.fillScreen(BLACK);  // Full screen refresh when exiting large mode
-                Serial.println("Exiting large display mode");
+                LOG_I(MAIN, "Exiting large display mode\n");
             }
             // Enter large display mode if we're in normal mode with a SmartShunt device
             else if (!webConfigMode && !deviceAddresses.empty()) {
-                VictronDeviceData* device = victron->getDevice(deviceAddresses[currentDeviceIndex]);
-                if (device && device->type == DEVICE_SMART_SHUNT) {
+                if (shownDeviceType() == DEVICE_SMART_SHUNT) {
                     largeDisplayMode = true;
                     largeDisplayJustEntered = true;  // Set flag to reset cache
                     M5.Lcd.fillScreen(BLACK);  // Full screen refresh when entering large mode
-                    Serial.println("Entering large display mode");
+                    LOG_I(MAIN, "Entering large display mode\n");
                 } else {
-                    Serial.println("Large display mode only works with SmartShunt devices");
+                    LOG_I(MAIN, "Large display mode only works with SmartShunt devices\n");
                 }
             }
             drawDisplay();
@@ -1306,9 +1455,8 @@ void loop() {
     if (largeDisplayTimeout > 0 && !largeDisplayMode && !webConfigMode && !deviceAddresses.empty()) {
         if (currentTime - lastUserInteraction > (largeDisplayTimeout * 1000)) {
             // Check if current device is a SmartShunt
-            VictronDeviceData* device = victron->getDevice(deviceAddresses[currentDeviceIndex]);
-            if (device && device->type == DEVICE_SMART_SHUNT) {
-                Serial.println("Auto-entering large display mode due to inactivity");
+            if (shownDeviceType() == DEVICE_SMART_SHUNT) {
+                LOG_I(MAIN, "Auto-entering large display mode due to inactivity\n");
                 largeDisplayMode = true;
                 largeDisplayJustEntered = true;  // Set flag to reset cache
                 M5.Lcd.fillScreen(BLACK);  // Full screen refresh when entering large mode
@@ -1317,113 +1465,102 @@ void loop() {
         }
     }
     
-    // Periodic BLE scan (only in normal mode)
-    if (!webConfigMode && currentTime - lastScanTime > SCAN_INTERVAL && !scanning) {
-        scanning = true;
-        Serial.println("Periodic scan...");
-        victron->scan(2);  // Quick 2-second scan
-        
-        // Update device list based on scan results
-        updateDeviceList();
+    // Refresh the list of configured devices that have been seen
+    if (currentTime - lastDeviceListUpdate > DEVICE_LIST_INTERVAL) {
+        size_t previousCount = deviceAddresses.size();
+        {
+            VictronBLE::DeviceLock lock(*victron);
+            updateDeviceList();
+        }
+        lastDeviceListUpdate = currentTime;
         
-        // For Eco Worthy devices, try to connect and read data
+        if (previousCount == 0 && !deviceAddresses.empty() && !webConfigMode) {
+            drawDisplay();
+        }
+    }
+    
+    // Sample the history once a second from devices with a recent reading
+    if (currentTime - lastHistorySample >= HISTORY_SAMPLE_INTERVAL) {
+        uint32_t now = HistoryStore::now();
+        VictronBLE::DeviceLock lock(*victron);
         for (const auto& address : deviceAddresses) {
             VictronDeviceData* device = victron->getDevice(address);
-            if (device && device->type == DEVICE_ECO_WORTHY_BMS) {
-                // Check if we need to connect to this device
-                bool needsConnection = !ecoWorthy->isDeviceConnected();
-                if (!needsConnection) {
-                    EcoWorthyBMSData* currentEcoData = ecoWorthy->getData();
-                    needsConnection = (currentEcoData->address != address);
-                }
-                
-                // Try to connect and read data from Eco Worthy BMS
-                if (needsConnection) {
-                    Serial.printf("Connecting to Eco Worthy BMS: %s\n", address.c_str());
-                    ecoWorthy->disconnect();  // Disconnect any previous device
-                    if (ecoWorthy->connectToAddress(address)) {
-                        Serial.println("Successfully connected to Eco Worthy BMS");
-                        if (ecoWorthy->updateData()) {
-                            // Copy data from EcoWorthyBMS to VictronDeviceData
-                            EcoWorthyBMSData* ecoData = ecoWorthy->getData();
-                            device->voltage = ecoData->voltage;
-                            device->current = ecoData->current;
-                            device->power = ecoData->power;
-                            device->batterySOC = ecoData->batteryLevel;
-                            device->dataValid = ecoData->dataValid;
-                            device->lastUpdate = ecoData->lastUpdate;
-                            device->hasVoltage = true;
-                            device->hasCurrent = true;
-                            device->hasPower = true;
-                            device->hasSOC = true;
-                            
-                            // Set temperature if available
-                            if (ecoData->tempSensorCount > 0) {
-                                device->temperature = ecoData->temperatures[0];
-                                device->hasTemperature = true;
-                            }
-                            
-                            Serial.println("Successfully updated Eco Worthy BMS data");
-                        }
-                    } else {
-                        Serial.println("Failed to connect to Eco Worthy BMS");
-                    }
-                }
+            if (device && device->dataValid && currentTime - device->lastUpdate <= HISTORY_MAX_AGE) {
+                history->record(*device, now);
             }
         }
-        
-        lastScanTime = currentTime;
-        scanning = false;
-        
-        if (!deviceAddresses.empty()) {
-            drawDisplay();
+        lastHistorySample = currentTime;
+    }
+    
+    // Note change events for the device on screen
+    if (victron->hasChanges(displaySubscriber)) {
+        VictronBLE::DeviceLock lock(*victron);
+        VictronDeviceData* shown = deviceAddresses.empty() ? nullptr : victron->getDevice(deviceAddresses[currentDeviceIndex]);
+        int shownSlot = shown ? victron->getDevices().indexOf(shown) : -1;
+        ChangeEvent event;
+        while (victron->nextChange(displaySubscriber, event)) {
+            if (event.slot == shownSlot) {
+                shownDeviceChanged = true;
+            }
         }
     }
     
+    // Large display mode only repaints the values that moved: update it as soon as they do
+    if (!webConfigMode && largeDisplayMode && shownDeviceChanged) {
+        drawDisplay();
+        shownDeviceChanged = false;
+    }
+    
     // Update display periodically (only in normal mode with devices)
     if (!webConfigMode && !largeDisplayMode && currentTime - lastDisplayUpdate > DISPLAY_UPDATE_INTERVAL) {
         if (!deviceAddresses.empty()) {
+            int previousDeviceIndex = currentDeviceIndex;
+            int previousScrollOffset = verticalScrollOffset;
+            
             // Get current device to check if it needs scrolling
-            VictronDeviceData* device = victron->getDevice(deviceAddresses[currentDeviceIndex]);
-            if (device) {
-                // Count data items to see if scrolling is needed
-                int dataItemCount = 2;  // Voltage and Current
-                if (device->hasPower) dataItemCount++;
-                if (device->hasSOC) dataItemCount++;
-                if (device->hasTemperature) dataItemCount++;
-                if (device->type == DEVICE_SMART_SHUNT) {
-                    if (device->consumedAh != 0) dataItemCount++;
-                    if (device->timeToGo != 0) dataItemCount++;
-                }
-                if (device->hasAcOut) {
-                    dataItemCount++;
-                    if (device->acOutCurrent != 0 || device->acOutPower != 0) dataItemCount++;
-                }
-                if (device->hasInputVoltage) dataItemCount++;
-                if (device->hasOutputVoltage) dataItemCount++;
-                // Add DC-DC specific fields
-                if (device->type == DEVICE_DCDC_CONVERTER) {
-                    if (device->deviceState != 0 && device->deviceState != 0xFF) dataItemCount++;
-                    if (device->offReason != 0) dataItemCount++;
-                }
-                
-                // Calculate if scrolling is needed
-                const int lineSpacing = 15 * lcdFontSize;
-                const int bottomY = (lcdOrientation == "portrait") ? 220 : 110;
-                const int dataStartY = 30;
-                const int dataAreaHeight = bottomY - dataStartY;
-                int maxItemsVisible = dataAreaHeight / lineSpacing;
-                bool needsScroll = (dataItemCount > maxItemsVisible);
-                
-                // Auto-scroll vertically if needed
-                if (needsScroll && currentTime - lastVerticalScroll > VERTICAL_SCROLL_INTERVAL) {
-                    int maxScrollOffset = dataItemCount - maxItemsVisible;
-                    verticalScrollOffset++;
-                    if (verticalScrollOffset > maxScrollOffset) {
-                        verticalScrollOffset = 0;  // Wrap back to top
+            {
+                VictronBLE::DeviceLock lock(*victron);
+                VictronDeviceData* device = victron->getDevice(deviceAddresses[currentDeviceIndex]);
+                if (device) {
+                    // Count data items to see if scrolling is needed
+                    int dataItemCount = 2;  // Voltage and Current
+                    if (device->hasPower) dataItemCount++;
+                    if (device->hasSOC) dataItemCount++;
+                    if (device->hasTemperature) dataItemCount++;
+                    if (device->type == DEVICE_SMART_SHUNT) {
+                        if (device->consumedAh != 0) dataItemCount++;
+                        if (device->timeToGo != 0) dataItemCount++;
+                    }
+                    if (device->hasAcOut) {
+                        dataItemCount++;
+                        if (device->acOutCurrent != 0 || device->acOutPower != 0) dataItemCount++;
+                    }
+                    if (device->hasInputVoltage) dataItemCount++;
+                    if (device->hasOutputVoltage) dataItemCount++;
+                    // Add DC-DC specific fields
+                    if (device->type == DEVICE_DCDC_CONVERTER) {
+                        if (device->deviceState != 0 && device->deviceState != 0xFF) dataItemCount++;
+                        if (device->offReason != 0) dataItemCount++;
+                    }
+                    
+                    // Calculate if scrolling is needed
+                    const int lineSpacing = 15 * lcdFontSize;
+                    const int bottomY = (lcdOrientation == "portrait") ? 220 : 110;
+                    const int dataStartY = 30;
+                    const int dataAreaHeight = bottomY - dataStartY;
+                    int maxItemsVisible = dataAreaHeight / lineSpacing;
+                    bool needsScroll = (dataItemCount > maxItemsVisible);
+                    
+                    // Auto-scroll vertically if needed
+                    if (needsScroll && currentTime - lastVerticalScroll > VERTICAL_SCROLL_INTERVAL) {
+                        int maxScrollOffset = dataItemCount - maxItemsVisible;
+                        verticalScrollOffset++;
+                        if (verticalScrollOffset > maxScrollOffset) {
+                            verticalScrollOffset = 0;  // Wrap back to top
+                        }
+                        lastVerticalScroll = currentTime;
+                        LOG_D(MAIN, "Vertical scroll: %d (max: %d)\n", verticalScrollOffset, maxScrollOffset);
                     }
-                    lastVerticalScroll = currentTime;
-                    Serial.printf("Vertical scroll: %d (max: %d)\n", verticalScrollOffset, maxScrollOffset);
                 }
             }
             
@@ -1432,22 +1569,112 @@ void loop() {
                 currentDeviceIndex = (currentDeviceIndex + 1) % deviceAddresses.size();
                 lastDeviceSwitch = currentTime;
             }
-            drawDisplay();
+            
+            // Skip the redraw while no change event named the shown device
+            if (shownDeviceChanged || currentDeviceIndex != previousDeviceIndex || verticalScrollOffset != previousScrollOffset ||
+                currentTime - lastDisplayRedraw >= DISPLAY_REFRESH_INTERVAL) {
+                drawDisplay();
+                lastDisplayRedraw = currentTime;
+                shownDeviceChanged = false;
+            }
         }
         lastDisplayUpdate = currentTime;
     }
     
-    // Check battery alarm periodically
-    if (currentTime - lastBuzzerCheck > BUZZER_CHECK_INTERVAL) {
+    // Check the battery alarm when an SOC moves, a device is added or removed, or
+    // the settings change from the web page
+    bool alarmDue = buzzerEnabled != lastAlarmEnabled || buzzerThreshold != lastAlarmThreshold ||
+                    deviceAddresses.size() != lastAlarmDevices;
+    if (victron->hasChanges(alarmSubscriber)) {
+        VictronBLE::DeviceLock lock(*victron);
+        ChangeEvent event;
+        while (victron->nextChange(alarmSubscriber, event)) {
+            alarmDue = true;
+        }
+    }
+    if (alarmDue) {
+        VictronBLE::DeviceLock lock(*victron);
         checkBatteryAlarm();
-        lastBuzzerCheck = currentTime;
+        lastAlarmEnabled = buzzerEnabled;
+        lastAlarmThreshold = buzzerThreshold;
+        lastAlarmDevices = deviceAddresses.size();
     }
     
     // Handle buzzer beeps (non-blocking)
     handleBuzzerBeep();
+}
+
+// Periodic Eco Worthy BMS poll (only in normal mode), on the network task: the GATT
+// connection can take seconds. Readings go to the ingest task through queueReading().
+void pollEcoWorthy() {
+    unsigned long currentTime = millis();
+    if (webConfigMode || currentTime - lastEcoWorthyPoll <= ECO_WORTHY_POLL_INTERVAL || pollingEcoWorthy) {
+        return;
+    }
+    pollingEcoWorthy = true;
     
-    // Handle MQTT publishing
-    mqttPublisher->loop();
+    // Pick the configured Eco Worthy devices; the lock is not held while connecting
+    std::vector<String> ecoWorthyAddresses;
+    {
+        VictronBLE::DeviceLock lock(*victron);
+        for (const auto& address : deviceAddresses) {
+            VictronDeviceData* device = victron->getDevice(address);
+            if (device && device->type == DEVICE_ECO_WORTHY_BMS) {
+                ecoWorthyAddresses.push_back(address);
+            }
+        }
+    }
+    
+    // For Eco Worthy devices, try to connect and read data
+    for (const auto& address : ecoWorthyAddresses) {
+        // Check if we need to connect to this device
+        bool needsConnection = !ecoWorthy->isDeviceConnected();
+        if (!needsConnection) {
+            EcoWorthyBMSData* currentEcoData = ecoWorthy->getData();
+            needsConnection = (currentEcoData->address != address);
+        }
+        
+        // Try to connect and read data from Eco Worthy BMS
+        // The scan is stopped and held while connecting; victron->loop() restarts it once released
+        if (needsConnection) {
+            LOG_I(MAIN, "Connecting to Eco Worthy BMS: %s\n", address.c_str());
+            victron->holdScan(true);
+            ecoWorthy->disconnect();  // Disconnect any previous device
+            if (ecoWorthy->connectToAddress(address)) {
+                LOG_I(MAIN, "Successfully connected to Eco Worthy BMS\n");
+                if (ecoWorthy->updateData()) {
+                    // Hand the BMS data to the ingest task as a reading
+                    EcoWorthyBMSData* ecoData = ecoWorthy->getData();
+                    VictronReading reading;
+                    reading.voltage = ecoData->voltage;
+                    reading.current = ecoData->current;
+                    reading.power = ecoData->power;
+                    reading.batterySOC = ecoData->batteryLevel;
+                    reading.dataValid = ecoData->dataValid;
+                    reading.hasVoltage = true;
+                    reading.hasCurrent = true;
+                    reading.hasPower = true;
+                    reading.hasSOC = true;
+                    
+                    // Set temperature if available
+                    if (ecoData->tempSensorCount > 0) {
+                        reading.temperature = ecoData->temperatures[0];
+                        reading.hasTemperature = true;
+                    }
+                    
+                    if (victron->queueReading(address, reading, ecoData->lastUpdate)) {
+                        LOG_I(MAIN, "Successfully updated Eco Worthy BMS data\n");
+                    } else {
+                        LOG_W(MAIN, "Eco Worthy BMS reading dropped (queue full)\n");
+                    }
+                }
+            } else {
+                LOG_W(MAIN, "Failed to connect to Eco Worthy BMS\n");
+            }
+            victron->holdScan(false);
+        }
+    }
     
-    delay(10);
+    lastEcoWorthyPoll = currentTime;
+    pollingEcoWorthy = false;
 }